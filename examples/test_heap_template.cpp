@@ -0,0 +1,136 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Microbenchmark for packet generation, comparing encoding every packet from
+ * scratch to patching pre-encoded headers from a heap template.
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <memory>
+#include <boost/program_options.hpp>
+#include <spead2/send_heap.h>
+#include <spead2/send_heap_template.h>
+#include <spead2/send_packet.h>
+
+namespace po = boost::program_options;
+
+typedef std::chrono::time_point<std::chrono::high_resolution_clock> time_point;
+
+struct options
+{
+    std::string type = "template";
+    std::size_t packet_size = 1472;
+    std::size_t heap_size = 8192;
+    std::size_t items = 16;
+    std::size_t heaps = 1000000;
+};
+
+static void usage(std::ostream &o, const po::options_description &desc)
+{
+    o << "Usage: test_heap_template [options]\n";
+    o << desc;
+}
+
+template<typename T>
+static po::typed_value<T> *make_opt(T &var)
+{
+    return po::value<T>(&var)->default_value(var);
+}
+
+static options parse_args(int argc, const char **argv)
+{
+    options opts;
+    po::options_description desc;
+    desc.add_options()
+        ("type", make_opt(opts.type), "Generation method (plain | template)")
+        ("packet-size", make_opt(opts.packet_size), "Maximum packet size")
+        ("heap-size", make_opt(opts.heap_size), "Payload size per heap")
+        ("items", make_opt(opts.items), "Number of constant immediate items per heap")
+        ("heaps", make_opt(opts.heaps), "Heaps to generate")
+        ("help,h", "Show help text");
+
+    try
+    {
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv)
+            .style(po::command_line_style::default_style & ~po::command_line_style::allow_guessing)
+            .options(desc)
+            .run(), vm);
+        po::notify(vm);
+        if (vm.count("help"))
+        {
+            usage(std::cout, desc);
+            std::exit(0);
+        }
+        if (opts.type != "plain" && opts.type != "template")
+            throw po::error("--type must be plain or template");
+        return opts;
+    }
+    catch (po::error &e)
+    {
+        std::cerr << e.what() << '\n';
+        usage(std::cerr, desc);
+        std::exit(2);
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    options opts = parse_args(argc, argv);
+
+    std::vector<std::uint8_t> payload(opts.heap_size);
+    spead2::send::heap h;
+    auto timestamp = h.add_item(0x1600, 0);
+    for (std::size_t i = 0; i < opts.items; i++)
+        h.add_item(0x1700 + i, i);
+    h.add_item(0x1000, payload.data(), payload.size(), false);
+    if (opts.type == "template")
+    {
+        h.set_template(std::make_shared<spead2::send::heap_template>(
+            h, opts.packet_size,
+            std::vector<spead2::send::heap::item_handle>{timestamp}));
+    }
+
+    std::unique_ptr<std::uint8_t[]> scratch(new std::uint8_t[opts.packet_size]);
+    std::size_t packets = 0;
+    std::size_t bytes = 0;
+    time_point start = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < opts.heaps; i++)
+    {
+        h.get_item(timestamp).data.immediate = i * 4096;
+        spead2::send::packet_generator gen(h, i + 1, opts.packet_size);
+        while (gen.has_next_packet())
+        {
+            auto buffers = gen.next_packet(scratch.get());
+            bytes += boost::asio::buffer_size(buffers);
+            packets++;
+        }
+    }
+    time_point end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> elapsed_duration = end - start;
+    double elapsed = elapsed_duration.count();
+    std::cout << packets << " packets (" << bytes << " bytes) in " << elapsed << "s ("
+        << packets / elapsed * 1e-6 << " Mpkt/s)\n";
+    return 0;
+}
@@ -0,0 +1,174 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Microbenchmark for copying packet payloads into memory from different
+ * allocators. Packets are copied to the destination in a shuffled order, as
+ * happens when many heaps are being reassembled at once, so the cost of TLB
+ * misses (which huge pages reduce) is visible.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <spead2/common_memcpy.h>
+#include <spead2/common_memory_allocator.h>
+
+namespace po = boost::program_options;
+
+struct options
+{
+    std::string allocator = "default";
+    std::size_t page_size = 0;
+    std::size_t size = 1024 * 1024 * 1024;
+    std::size_t packet = 1024;
+    int passes = 5;
+    bool nontemporal = false;
+};
+
+static void usage(std::ostream &o, const po::options_description &desc)
+{
+    o << "Usage: test_memcpy [options]\n";
+    o << desc;
+}
+
+template<typename T>
+static po::typed_value<T> *make_opt(T &var)
+{
+    return po::value<T>(&var)->default_value(var);
+}
+
+static options parse_args(int argc, const char **argv)
+{
+    options opts;
+    po::options_description desc;
+    desc.add_options()
+        ("allocator", make_opt(opts.allocator), "Destination allocator (default | mmap | hugepage)")
+        ("page-size", make_opt(opts.page_size), "Huge page size for --allocator=hugepage (0 for default)")
+        ("size", make_opt(opts.size), "Destination buffer size in bytes")
+        ("packet", make_opt(opts.packet), "Bytes per copy")
+        ("passes", make_opt(opts.passes), "Number of passes over the buffer")
+        ("nt", po::bool_switch(&opts.nontemporal), "Use non-temporal memcpy")
+        ("help,h", "Show help text")
+    ;
+    try
+    {
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv)
+            .style(po::command_line_style::default_style & ~po::command_line_style::allow_guessing)
+            .options(desc)
+            .run(), vm);
+        po::notify(vm);
+        if (vm.count("help"))
+        {
+            usage(std::cout, desc);
+            std::exit(0);
+        }
+        if (opts.packet == 0 || opts.size < opts.packet)
+            throw po::error("--packet must be non-zero and no larger than --size");
+        return opts;
+    }
+    catch (po::error &e)
+    {
+        std::cerr << e.what() << '\n';
+        usage(std::cerr, desc);
+        std::exit(2);
+    }
+}
+
+static const char *mode_name(spead2::hugepage_allocator::mode m)
+{
+    switch (m)
+    {
+    case spead2::hugepage_allocator::mode::HUGETLB:
+        return "hugetlb";
+    case spead2::hugepage_allocator::mode::TRANSPARENT:
+        return "transparent huge pages";
+    default:
+        return "normal pages";
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    options opts = parse_args(argc, argv);
+
+    std::shared_ptr<spead2::memory_allocator> allocator;
+    std::shared_ptr<spead2::hugepage_allocator> huge;
+    if (opts.allocator == "default")
+        allocator = std::make_shared<spead2::memory_allocator>();
+    else if (opts.allocator == "mmap")
+        allocator = std::make_shared<spead2::mmap_allocator>();
+    else if (opts.allocator == "hugepage")
+        allocator = huge = std::make_shared<spead2::hugepage_allocator>(opts.page_size);
+    else
+    {
+        std::cerr << "Unknown allocator " << opts.allocator << "\n";
+        return 2;
+    }
+
+    auto start_alloc = std::chrono::high_resolution_clock::now();
+    spead2::memory_allocator::pointer dest = allocator->allocate(opts.size, nullptr);
+    std::chrono::duration<double> alloc_time = std::chrono::high_resolution_clock::now() - start_alloc;
+    std::cout << "Allocated " << opts.size << " bytes in " << alloc_time.count() << " s";
+    if (huge)
+        std::cout << " using " << mode_name(huge->get_last_mode())
+            << " (page size " << huge->get_page_size() << ")";
+    std::cout << '\n';
+
+    // A small source that stays in cache, so that the destination dominates
+    const std::size_t n_sources = 64;
+    std::vector<std::uint8_t> source(opts.packet * n_sources, 1);
+    std::vector<std::size_t> offsets;
+    for (std::size_t offset = 0; offset + opts.packet <= opts.size; offset += opts.packet)
+        offsets.push_back(offset);
+    std::mt19937_64 engine(1);
+    std::shuffle(offsets.begin(), offsets.end(), engine);
+
+    double best = 0.0;
+    for (int pass = 0; pass < opts.passes; pass++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::size_t src = 0;
+        for (std::size_t offset : offsets)
+        {
+            std::uint8_t *d = dest.get() + offset;
+            const std::uint8_t *s = source.data() + src * opts.packet;
+            if (opts.nontemporal)
+                spead2::memcpy_nontemporal(d, s, opts.packet);
+            else
+                std::memcpy(d, s, opts.packet);
+            if (++src == n_sources)
+                src = 0;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+        double rate = offsets.size() * opts.packet / elapsed.count();
+        best = std::max(best, rate);
+        std::cout << "Pass " << pass << ": " << rate * 8e-9 << " Gb/s\n";
+    }
+    std::cout << "Best: " << best * 8e-9 << " Gb/s\n";
+    return 0;
+}
@@ -21,12 +21,14 @@
  */
 
 #include <iostream>
+#include <algorithm>
 #include <thread>
 #include <future>
 #include <type_traits>
 #include <chrono>
 #include <cstdint>
 #include <memory>
+#include <vector>
 #include <cerrno>
 #include <sched.h>
 #include <boost/program_options.hpp>
@@ -45,7 +47,9 @@ static constexpr std::size_t alignment = 64;
 struct options
 {
     std::string type = "light";
+    std::string kind = "locked";
     std::size_t capacity = 2;
+    std::size_t batch = 1;
     std::int64_t items = 100000;
     int producer_cpu = -1;
     int consumer_cpu = -1;
@@ -68,8 +72,10 @@ static options parse_args(int argc, const char **argv)
     options opts;
     po::options_description desc;
     desc.add_options()
-        ("type", make_opt(opts.type), "Semaphore type (light | fd | pipe | eventfd | posix)")
+        ("type", make_opt(opts.type), "Semaphore type (light | fd | spin | pipe | eventfd | posix | futex)")
+        ("kind", make_opt(opts.kind), "Ring buffer implementation (locked | spsc | mpmc)")
         ("capacity", make_opt(opts.capacity), "Ring buffer capacity")
+        ("batch", make_opt(opts.batch), "Items per push_many/pop_many (1 to use push/pop)")
         ("items", make_opt(opts.items), "Items to transmit")
         ("producer-cpu,p", make_opt(opts.producer_cpu), "CPU core to bind producer to")
         ("consumer-cpu,c", make_opt(opts.consumer_cpu), "CPU core to bind consumer to");
@@ -87,6 +93,8 @@ static options parse_args(int argc, const char **argv)
             usage(std::cout, desc);
             std::exit(0);
         }
+        if (opts.batch == 0)
+            throw po::error("--batch must be positive");
         return opts;
     }
     catch (po::error &e)
@@ -125,10 +133,19 @@ static void reader(Ringbuffer &ring, const options &opts)
     bind_cpu(opts.consumer_cpu);
     try
     {
-        while (true)
+        if (opts.batch == 1)
         {
-            item_t item = ring.pop();
-            (void) item;
+            while (true)
+            {
+                item_t item = ring.pop();
+                (void) item;
+            }
+        }
+        else
+        {
+            std::vector<item_t> items(opts.batch);
+            while (true)
+                ring.pop_many(items.data(), opts.batch);
         }
     }
     catch (spead2::ringbuffer_stopped &)
@@ -151,9 +168,21 @@ static void run(const options &opts)
     // Give the thread time to get going
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
     time_point start = std::chrono::high_resolution_clock::now();
-    for (std::int64_t i = 0; i < opts.items; i++)
+    if (opts.batch == 1)
     {
-        ring->push(item_t());
+        for (std::int64_t i = 0; i < opts.items; i++)
+        {
+            ring->push(item_t());
+        }
+    }
+    else
+    {
+        std::vector<item_t> items(opts.batch);
+        for (std::int64_t i = 0; i < opts.items; i += opts.batch)
+        {
+            std::size_t n = std::min(std::int64_t(opts.batch), opts.items - i);
+            ring->push_many(items.begin(), items.begin() + n);
+        }
     }
     ring->stop();
     thread.join();
@@ -164,26 +193,46 @@ static void run(const options &opts)
     ring->~Ringbuffer();
 }
 
+template<typename Semaphore>
+static void run_kind(const options &opts)
+{
+    if (opts.kind == "locked")
+        run<spead2::ringbuffer<item_t, Semaphore, Semaphore>>(opts);
+    else if (opts.kind == "spsc")
+        run<spead2::ringbuffer_spsc<item_t, Semaphore, Semaphore>>(opts);
+    else if (opts.kind == "mpmc")
+        run<spead2::ringbuffer_mpmc<item_t, Semaphore, Semaphore>>(opts);
+    else
+    {
+        std::cerr << "Unknown ringbuffer kind " << opts.kind << "\n";
+        std::exit(2);
+    }
+}
+
 int main(int argc, const char **argv)
 {
     options opts = parse_args(argc, argv);
     bind_cpu(opts.producer_cpu);
 
     if (opts.type == "fd")
-        run<spead2::ringbuffer<item_t, spead2::semaphore_fd, spead2::semaphore_fd>>(opts);
+        run_kind<spead2::semaphore_fd>(opts);
     else if (opts.type == "light")
-        run<spead2::ringbuffer<item_t>>(opts);
+        run_kind<spead2::semaphore>(opts);
     else if (opts.type == "spin")
-        run<spead2::ringbuffer<item_t, spead2::semaphore_spin, spead2::semaphore_spin>>(opts);
+        run_kind<spead2::semaphore_spin>(opts);
     else if (opts.type == "pipe")
-        run<spead2::ringbuffer<item_t, spead2::semaphore_pipe, spead2::semaphore_pipe>>(opts);
+        run_kind<spead2::semaphore_pipe>(opts);
 #if SPEAD2_USE_POSIX_SEMAPHORES
     else if (opts.type == "posix")
-        run<spead2::ringbuffer<item_t, spead2::semaphore_posix, spead2::semaphore_posix>>(opts);
+        run_kind<spead2::semaphore_posix>(opts);
 #endif
 #if SPEAD2_USE_EVENTFD
     else if (opts.type == "eventfd")
-        run<spead2::ringbuffer<item_t, spead2::semaphore_eventfd, spead2::semaphore_eventfd>>(opts);
+        run_kind<spead2::semaphore_eventfd>(opts);
+#endif
+#if SPEAD2_USE_FUTEX
+    else if (opts.type == "futex")
+        run_kind<spead2::semaphore_futex>(opts);
 #endif
     else
     {
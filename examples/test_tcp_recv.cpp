@@ -0,0 +1,208 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Loopback benchmark for the framing of received TCP data, comparing the
+ * mirrored ring buffer to the copying linear buffer.
+ */
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <memory>
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_stream.h>
+#include <spead2/recv_tcp.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_packet.h>
+
+namespace po = boost::program_options;
+
+typedef std::chrono::time_point<std::chrono::high_resolution_clock> time_point;
+
+struct options
+{
+    std::string type = "mirror";
+    std::size_t packet_size = 9000;
+    std::size_t heap_size = 1024 * 1024;
+    std::size_t ring_size = 0;
+    std::size_t heaps = 4096;
+    int sender_cpu = -1;
+    int receiver_cpu = -1;
+};
+
+static void usage(std::ostream &o, const po::options_description &desc)
+{
+    o << "Usage: test_tcp_recv [options]\n";
+    o << desc;
+}
+
+template<typename T>
+static po::typed_value<T> *make_opt(T &var)
+{
+    return po::value<T>(&var)->default_value(var);
+}
+
+static options parse_args(int argc, const char **argv)
+{
+    options opts;
+    po::options_description desc;
+    desc.add_options()
+        ("type", make_opt(opts.type), "Buffer type (mirror | copy)")
+        ("packet-size", make_opt(opts.packet_size), "Maximum packet size")
+        ("heap-size", make_opt(opts.heap_size), "Payload size per heap")
+        ("ring-size", make_opt(opts.ring_size), "Receive buffer size (0 for default)")
+        ("heaps", make_opt(opts.heaps), "Heaps to transmit")
+        ("sender-cpu,s", make_opt(opts.sender_cpu), "CPU core to bind sender to")
+        ("receiver-cpu,r", make_opt(opts.receiver_cpu), "CPU core to bind receiver to")
+        ("help,h", "Show help text");
+
+    try
+    {
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv)
+            .style(po::command_line_style::default_style & ~po::command_line_style::allow_guessing)
+            .options(desc)
+            .run(), vm);
+        po::notify(vm);
+        if (vm.count("help"))
+        {
+            usage(std::cout, desc);
+            std::exit(0);
+        }
+        if (opts.type != "mirror" && opts.type != "copy")
+            throw po::error("--type must be mirror or copy");
+        return opts;
+    }
+    catch (po::error &e)
+    {
+        std::cerr << e.what() << '\n';
+        usage(std::cerr, desc);
+        std::exit(2);
+    }
+}
+
+static void bind_cpu(int cpu)
+{
+    if (cpu != -1)
+    {
+        spead2::thread_pool::set_affinity(cpu);
+    }
+}
+
+// Counts the heaps and discards them
+class counting_stream : public spead2::recv::stream_base
+{
+private:
+    virtual void heap_ready(spead2::recv::live_heap &&heap) override
+    {
+        if (heap.is_complete())
+            complete++;
+    }
+
+public:
+    std::size_t complete = 0;
+
+    using spead2::recv::stream_base::stream_base;
+};
+
+// Serialise one heap into the packets that a TCP sender would write
+static std::vector<std::uint8_t> make_heap_data(const options &opts)
+{
+    std::vector<std::uint8_t> payload(opts.heap_size);
+    spead2::send::heap h;
+    h.add_item(0x1000, payload.data(), payload.size(), false);
+    spead2::send::packet_generator gen(h, 1, opts.packet_size);
+    std::unique_ptr<std::uint8_t[]> scratch(new std::uint8_t[gen.get_max_packet_size()]);
+    std::vector<std::uint8_t> out;
+    while (gen.has_next_packet())
+    {
+        for (const auto &buffer : gen.next_packet(scratch.get()))
+        {
+            auto data = boost::asio::buffer_cast<const std::uint8_t *>(buffer);
+            out.insert(out.end(), data, data + boost::asio::buffer_size(buffer));
+        }
+    }
+    return out;
+}
+
+static void sender(boost::asio::ip::tcp::socket &socket,
+                   const std::vector<std::uint8_t> &data, const options &opts)
+{
+    bind_cpu(opts.sender_cpu);
+    for (std::size_t i = 0; i < opts.heaps; i++)
+        boost::asio::write(socket, boost::asio::buffer(data));
+    socket.shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+}
+
+int main(int argc, const char **argv)
+{
+    options opts = parse_args(argc, argv);
+    std::vector<std::uint8_t> data = make_heap_data(opts);
+
+    boost::asio::io_service io_service;
+    boost::asio::ip::tcp::acceptor acceptor(
+        io_service,
+        boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    boost::asio::ip::tcp::socket send_socket(io_service), recv_socket(io_service);
+    send_socket.connect(acceptor.local_endpoint());
+    acceptor.accept(recv_socket);
+
+    counting_stream stream;
+    spead2::recv::detail::tcp_framer framer(opts.packet_size, opts.ring_size, opts.type == "mirror");
+    if (opts.type == "mirror" && !framer.is_mirrored())
+    {
+        std::cerr << "Mirrored buffers are not supported\n";
+        return 1;
+    }
+
+    bind_cpu(opts.receiver_cpu);
+    std::thread thread(sender, std::ref(send_socket), std::cref(data), std::cref(opts));
+    time_point start = std::chrono::high_resolution_clock::now();
+    while (true)
+    {
+        boost::system::error_code ec;
+        std::size_t n = recv_socket.receive(framer.prepare_receive(), 0, ec);
+        if (ec == boost::asio::error::eof)
+            break;
+        else if (ec)
+            throw boost::system::system_error(ec);
+        spead2::recv::stream_base::add_packet_state state(stream);
+        framer.process_buffer(state, n);
+    }
+    stream.flush();
+    time_point end = std::chrono::high_resolution_clock::now();
+    thread.join();
+
+    std::chrono::duration<double> elapsed_duration = end - start;
+    double elapsed = elapsed_duration.count();
+    double bytes = double(data.size()) * opts.heaps;
+    std::cout << stream.complete << " heaps in " << elapsed << "s ("
+        << bytes * 8e-9 / elapsed << " Gb/s)\n";
+    if (stream.complete != opts.heaps)
+    {
+        std::cerr << "Expected " << opts.heaps << " heaps\n";
+        return 1;
+    }
+    return 0;
+}
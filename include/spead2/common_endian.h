@@ -48,6 +48,16 @@ struct Endian<std::uint64_t>
     {
         return be64toh(in);
     }
+
+    static std::uint64_t htole(std::uint64_t in)
+    {
+        return htole64(in);
+    }
+
+    static std::uint64_t letoh(std::uint64_t in)
+    {
+        return le64toh(in);
+    }
 };
 
 template<>
@@ -62,6 +72,16 @@ struct Endian<std::uint32_t>
     {
         return be32toh(in);
     }
+
+    static std::uint32_t htole(std::uint32_t in)
+    {
+        return htole32(in);
+    }
+
+    static std::uint32_t letoh(std::uint32_t in)
+    {
+        return le32toh(in);
+    }
 };
 
 template<>
@@ -76,6 +96,16 @@ struct Endian<std::uint16_t>
     {
         return be16toh(in);
     }
+
+    static std::uint16_t htole(std::uint16_t in)
+    {
+        return htole16(in);
+    }
+
+    static std::uint16_t letoh(std::uint16_t in)
+    {
+        return le16toh(in);
+    }
 };
 
 } // namespace detail
@@ -92,6 +122,18 @@ static inline T betoh(T in)
     return detail::Endian<T>::betoh(in);
 }
 
+template<typename T>
+static inline T htole(T in)
+{
+    return detail::Endian<T>::htole(in);
+}
+
+template<typename T>
+static inline T letoh(T in)
+{
+    return detail::Endian<T>::letoh(in);
+}
+
 /**
  * Load a big-endian value stored at address @a ptr (not necessarily aligned).
  */
@@ -103,6 +145,17 @@ static inline T load_be(const uint8_t *ptr)
     return betoh(out);
 }
 
+/**
+ * Load a little-endian value stored at address @a ptr (not necessarily aligned).
+ */
+template<typename T>
+static inline T load_le(const uint8_t *ptr)
+{
+    T out;
+    std::memcpy(&out, ptr, sizeof(T));
+    return letoh(out);
+}
+
 } // namespace spead2
 
 #endif // SPEAD2_COMMON_ENDIAN_H
@@ -20,6 +20,8 @@
 #include <memory>
 #include <cstdint>
 #include <cstddef>
+#include <vector>
+#include <mutex>
 #include <spead2/common_unbounded_queue.h>
 #include <spead2/common_semaphore.h>
 
@@ -40,21 +42,57 @@ public:
     {
         std::unique_ptr<std::uint8_t[]> data;
         std::size_t size;
+        /// Allocated size of @ref data, or 0 if it should not be recycled
+        std::size_t capacity = 0;
     };
 
-    unbounded_queue<packet, semaphore_fd> buffer;
+    /// Maximum number of packet buffers held for reuse
+    static constexpr std::size_t max_free_packets = 4096;
+
+    /**
+     * Batches of packets. Each entry is signalled with a single semaphore
+     * operation, and is never empty.
+     */
+    unbounded_queue<std::vector<packet>, semaphore_fd> buffer;
 
     /// Add a packet directly to the queue
     void add_packet(packet &&pkt);
 
+    /**
+     * Add a batch of packets to the queue. If @a pkts is empty, this does
+     * nothing. On success, @a pkts is left empty.
+     *
+     * @throw ringbuffer_stopped if @ref stop has been called
+     */
+    void add_packets(std::vector<packet> &pkts);
+
+    /**
+     * Move up to @a n previously-used packets into @a out, for reuse by a
+     * sender. Their @c size is undefined, and their @c capacity may be
+     * smaller than a new packet requires.
+     */
+    void reuse_packets(std::vector<packet> &out, std::size_t n);
+
+    /**
+     * Return the packets of a batch that has been consumed, so that their
+     * storage can be reused by @ref reuse_packets. Packets with zero
+     * capacity are freed, as are any beyond @ref max_free_packets.
+     */
+    void recycle_packets(std::vector<packet> &&pkts);
+
     /**
      * Indicate end-of-stream to receivers. It is an error to add any more
      * packets after this.
      */
     void stop();
+
+private:
+    std::mutex free_mutex;
+    /// Packets available for reuse (protected by @ref free_mutex)
+    std::vector<packet> free_packets;
 };
 
-extern template class unbounded_queue<inproc_queue::packet, semaphore_fd>;
+extern template class unbounded_queue<std::vector<inproc_queue::packet>, semaphore_fd>;
 
 } // namespace spead2
 
@@ -0,0 +1,173 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_COMMON_MEMFD_ALLOCATOR_H
+#define SPEAD2_COMMON_MEMFD_ALLOCATOR_H
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_MEMFD
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <spead2/common_memory_allocator.h>
+
+namespace spead2
+{
+
+/// Location of an allocation within the file backing a @ref memfd_allocator
+struct memfd_descriptor
+{
+    int fd;               ///< File descriptor of the region
+    std::size_t offset;   ///< Offset of the allocation within the region
+    std::size_t length;   ///< Size of the allocation (as requested)
+};
+
+/**
+ * Allocator that carves allocations out of a single shared memory region
+ * created with @c memfd_create. The file descriptor can be passed to another
+ * process (for example, over a Unix domain socket or by inheritance), which
+ * maps the region with @ref memfd_mapping and uses the
+ * @ref memfd_descriptor of an allocation to read its contents in place,
+ * without copying.
+ *
+ * The region has a fixed size, and is mapped and pre-faulted on
+ * construction. If it is exhausted, allocation throws @c std::bad_alloc
+ * rather than falling back to other memory, since such memory could not be
+ * shared. It can be used as the base allocator of a @ref memory_pool.
+ *
+ * By default the region is sealed against growing or shrinking, so that a
+ * consumer cannot truncate it and cause the producer to fault.
+ *
+ * The allocator must be managed by a std::shared_ptr. Allocations keep it
+ * alive, so it is safe to drop other references to it while memory is still
+ * allocated. This class is thread-safe.
+ */
+class memfd_allocator : public memory_allocator
+{
+public:
+    /// Alignment of allocations within the region
+    static constexpr std::size_t alignment = 64;
+
+private:
+    struct allocation
+    {
+        std::size_t length;     ///< Size requested
+        std::size_t reserved;   ///< Size reserved in the region
+    };
+
+    int fd = -1;
+    std::uint8_t *base = nullptr;
+    std::size_t region_size = 0;
+    bool hugetlb = false;
+
+    mutable std::mutex mutex;
+    /// Unused parts of the region (offset to length), with no two adjacent
+    std::map<std::size_t, std::size_t> free_ranges;
+    /// Live allocations, indexed by offset
+    std::map<std::size_t, allocation> allocations;
+
+    /// Create the memfd and map it
+    void create(std::size_t size, bool hugetlb, bool seal);
+    void release(std::size_t offset);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param size     Size of the region. It is rounded up to a multiple of
+     *                 the page size.
+     * @param hugetlb  Back the region with huge pages from the hugetlb pool.
+     *                 If that fails (for example, because no huge pages are
+     *                 reserved), normal pages are used instead.
+     * @param seal     Seal the region against changes in size.
+     * @throw std::system_error if the region could not be created or mapped
+     */
+    explicit memfd_allocator(std::size_t size, bool hugetlb = false, bool seal = true);
+    virtual ~memfd_allocator();
+
+    /// File descriptor for the region
+    int get_fd() const { return fd; }
+    /// Size of the region
+    std::size_t get_size() const { return region_size; }
+    /// Start of the region in this process
+    std::uint8_t *get_data() const { return base; }
+    /// Whether the region is backed by huge pages from the hugetlb pool
+    bool is_hugetlb() const { return hugetlb; }
+
+    /**
+     * Describe the allocation containing @a ptr, which may point anywhere
+     * inside memory returned by @ref allocate.
+     *
+     * @throw std::invalid_argument if @a ptr is not inside a live allocation
+     * from this allocator
+     */
+    memfd_descriptor get_descriptor(const std::uint8_t *ptr) const;
+
+    virtual pointer allocate(std::size_t size, void *hint) override;
+};
+
+/**
+ * Mapping of the region of a @ref memfd_allocator into the address space of
+ * a consumer (typically in another process).
+ */
+class memfd_mapping
+{
+private:
+    std::uint8_t *ptr = nullptr;
+    std::size_t map_size = 0;
+    bool writable;
+
+public:
+    /**
+     * Map the whole file referenced by @a fd. The caller retains ownership
+     * of @a fd, which may be closed once this constructor returns.
+     *
+     * @param fd        File descriptor from @ref memfd_allocator::get_fd
+     * @param writable  Map the region for writing as well as reading
+     * @throw std::system_error if the file could not be mapped
+     */
+    explicit memfd_mapping(int fd, bool writable = false);
+    ~memfd_mapping();
+
+    memfd_mapping(const memfd_mapping &) = delete;
+    memfd_mapping &operator=(const memfd_mapping &) = delete;
+
+    /// Start of the mapping
+    std::uint8_t *data() const { return ptr; }
+    /// Size of the mapping
+    std::size_t size() const { return map_size; }
+    /// Whether the mapping may be written
+    bool is_writable() const { return writable; }
+
+    /**
+     * Get a pointer to the allocation described by @a desc (@a desc.fd is
+     * ignored).
+     *
+     * @throw std::out_of_range if the allocation lies outside the mapping
+     */
+    std::uint8_t *get(const memfd_descriptor &desc) const;
+};
+
+} // namespace spead2
+
+#endif // SPEAD2_USE_MEMFD
+#endif // SPEAD2_COMMON_MEMFD_ALLOCATOR_H
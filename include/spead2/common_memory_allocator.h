@@ -22,6 +22,7 @@
 #define SPEAD2_COMMON_MEMORY_ALLOCATOR_H
 
 #include <memory>
+#include <atomic>
 #include <cstdint>
 #include <cstddef>
 #include <utility>
@@ -172,6 +173,75 @@ public:
     virtual pointer allocate(std::size_t size, void *hint) override;
 };
 
+/**
+ * Allocator that backs memory with huge pages, to reduce TLB misses when
+ * large buffers (such as heap payloads or chunks) are filled. Each
+ * allocation uses the first of the following that succeeds:
+ *
+ * -# @c MAP_HUGETLB with the requested page size. This requires huge pages
+ *    of that size to have been reserved by the administrator (see
+ *    <code>/proc/sys/vm/nr_hugepages</code>). Once this fails, it is not
+ *    attempted again unless @a retry_hugetlb is passed to the constructor,
+ *    since a failed @c MAP_HUGETLB mmap is not cheap.
+ * -# Anonymous memory aligned to the transparent huge page size and marked
+ *    with <code>madvise(MADV_HUGEPAGE)</code>, so that the kernel can use
+ *    transparent huge pages.
+ * -# Normal pages.
+ *
+ * Sizes are rounded up to a multiple of the huge page size, so this is only
+ * suitable for large allocations (typically underneath a @ref memory_pool).
+ * The memory is pre-faulted. The path taken by the most recent allocation can
+ * be queried with @ref get_last_mode, and the first fallback is logged.
+ */
+class hugepage_allocator : public memory_allocator
+{
+public:
+    /// How memory was backed
+    enum class mode
+    {
+        NORMAL,        ///< Normal pages
+        TRANSPARENT,   ///< Transparent huge pages requested with @c madvise
+        HUGETLB        ///< Huge pages from the hugetlb pool
+    };
+
+private:
+    std::size_t page_size;
+    std::size_t transparent_page_size;
+    int flags;
+    bool retry_hugetlb;
+    std::atomic<bool> hugetlb_failed{false};
+    std::atomic<mode> last_mode{mode::NORMAL};
+    std::atomic<bool> logged_hugetlb_fallback{false};
+    std::atomic<bool> logged_madvise_fallback{false};
+
+    pointer allocate_hugetlb(std::size_t size);
+    pointer allocate_transparent(std::size_t size);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param page_size  Huge page size to request from hugetlb, e.g. 2 MiB or
+     *                   1 GiB on x86-64. If zero, the system default huge
+     *                   page size is used.
+     * @param flags      Extra flags to pass on to mmap
+     * @param retry_hugetlb If true, try @c MAP_HUGETLB for every allocation,
+     *                   even after it has failed (for example, because
+     *                   huge pages may be freed by other processes)
+     * @throw std::invalid_argument if @a page_size is not a power of two, or
+     *                   is smaller than the system page size
+     */
+    explicit hugepage_allocator(std::size_t page_size = 0, int flags = 0,
+                                bool retry_hugetlb = false);
+
+    /// Huge page size used for hugetlb allocations
+    std::size_t get_page_size() const { return page_size; }
+    /// Backing used by the most recent allocation (@c NORMAL if there are none)
+    mode get_last_mode() const { return last_mode.load(std::memory_order_relaxed); }
+
+    virtual pointer allocate(std::size_t size, void *hint) override;
+};
+
 } // namespace spead2
 
 #endif // SPEAD2_COMMON_MEMORY_ALLOCATOR_H
@@ -23,8 +23,7 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <mutex>
-#include <stack>
+#include <atomic>
 #include <memory>
 #include <boost/asio.hpp>
 #include <boost/optional.hpp>
@@ -34,7 +33,43 @@
 namespace spead2
 {
 
-namespace detail { class memory_pool_deleter; }
+namespace detail
+{
+class memory_pool_deleter;
+class memory_pool_core;
+struct memory_pool_block;
+}
+
+/**
+ * Statistics about the behaviour of a @ref memory_pool. The values are not
+ * read atomically, so they may be slightly inconsistent while other threads
+ * are using the pool.
+ */
+struct memory_pool_stats
+{
+    /// Allocations served from the free pool
+    std::uint64_t hits = 0;
+    /// Allocations outside the pool's size range, which were passed to the base allocator
+    std::uint64_t misses = 0;
+    /// Allocations in the pool's size range made while the pool was empty
+    std::uint64_t empty = 0;
+    /// Background refill tasks started
+    std::uint64_t refills = 0;
+    /// Time spent in background refill tasks (nanoseconds)
+    std::uint64_t refill_time_ns = 0;
+    /// Number of free buffers
+    std::size_t free = 0;
+    /**
+     * Highest number of free buffers seen. This may overestimate slightly,
+     * because space for free buffers is reserved in batches.
+     */
+    std::size_t free_high_water = 0;
+    /// Bytes in buffers obtained from the pool that have not yet been freed
+    std::uint64_t bytes_outstanding = 0;
+
+    /// Combine statistics from another pool (adding all the values)
+    memory_pool_stats &operator+=(const memory_pool_stats &other);
+};
 
 /**
  * Memory allocator that pre-allocates memory and recycles it. This wastes
@@ -49,28 +84,32 @@ namespace detail { class memory_pool_deleter; }
  * drop its references, even if there is still memory that has been allocated
  * and not yet freed.
  *
- * This class is thread-safe.
+ * This class is thread-safe. Handing out and returning pooled memory does not
+ * take a lock or allocate memory in the common case: each pooled buffer has a
+ * header allocated once when the buffer is created, and free buffers are kept
+ * in small per-thread caches ("magazines"), which refill from and spill to a
+ * lock-free stack shared by all threads.
  */
 class memory_pool : public memory_allocator
 {
-    friend class detail::memory_pool_deleter;
-
 private:
     boost::optional<io_service_ref> io_service;
     const std::size_t lower, upper, max_free, initial, low_water;
     const std::shared_ptr<memory_allocator> base_allocator;
-    mutable std::mutex mutex;
-    /// Free pool; these pointers are owned by the base allocator
-    std::stack<pointer> pool;
-    bool refilling = false;
-    bool warn_on_empty = true;
+    /**
+     * Free buffers and their headers. It is reference-counted separately
+     * from the pool, because it must outlive the pool if buffers are still
+     * allocated when the pool is destroyed.
+     */
+    detail::memory_pool_core *core;
+    std::atomic<bool> refilling{false};
+    std::atomic<bool> warn_on_empty{true};
+    std::atomic<std::uint64_t> misses{0}, empty{0}, refills{0}, refill_time_ns{0};
 
     // Like shared_from_this but pointer has the right type
     std::shared_ptr<memory_pool> shared_this();
-    // Called by memory_pool_deleter to return a pointer to the pool
-    void free_impl(std::uint8_t *ptr, memory_allocator::deleter &&base_deleter);
-    // Makes ourself the owner
-    pointer convert(pointer &&base);
+    // Hand out a buffer from the pool
+    pointer convert(detail::memory_pool_block *block);
     static void refill(std::size_t upper, std::shared_ptr<memory_allocator> allocator,
                        std::weak_ptr<memory_pool> self_weak);
 
@@ -83,8 +122,11 @@ public:
                 std::shared_ptr<memory_allocator> allocator = nullptr);
     memory_pool(io_service_ref io_service, std::size_t lower, std::size_t upper, std::size_t max_free, std::size_t initial, std::size_t low_water,
                 std::shared_ptr<memory_allocator> allocator = nullptr);
+    virtual ~memory_pool();
     bool get_warn_on_empty() const;
     void set_warn_on_empty(bool warn);
+    /// Get statistics about the behaviour of the pool
+    memory_pool_stats get_stats() const;
     virtual pointer allocate(std::size_t size, void *hint) override;
 
     /**
@@ -0,0 +1,66 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_COMMON_MIRRORED_BUFFER_H
+#define SPEAD2_COMMON_MIRRORED_BUFFER_H
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_MEMFD
+
+#include <cstddef>
+#include <cstdint>
+
+namespace spead2
+{
+
+/**
+ * Buffer for use as a ring, whose memory is mapped twice in consecutive
+ * virtual addresses. Any range of up to @ref size bytes starting within the
+ * first mapping is thus contiguous in virtual memory, even if it wraps
+ * around the end of the ring.
+ */
+class mirrored_buffer
+{
+private:
+    std::uint8_t *ptr = nullptr;
+    std::size_t buffer_size = 0;
+
+public:
+    /**
+     * Constructor. The size is rounded up to a multiple of the page size.
+     *
+     * @throws std::system_error if the memory could not be allocated or mapped.
+     */
+    explicit mirrored_buffer(std::size_t size);
+    ~mirrored_buffer();
+
+    mirrored_buffer(const mirrored_buffer &) = delete;
+    mirrored_buffer &operator=(const mirrored_buffer &) = delete;
+
+    /// Start of the first mapping (the second mapping starts at <code>data() + size()</code>)
+    std::uint8_t *data() const { return ptr; }
+    /// Size of the buffer (rather than of both mappings)
+    std::size_t size() const { return buffer_size; }
+};
+
+} // namespace spead2
+
+#endif // SPEAD2_USE_MEMFD
+#endif // SPEAD2_COMMON_MIRRORED_BUFFER_H
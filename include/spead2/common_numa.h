@@ -0,0 +1,112 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * NUMA topology discovery and node-local memory placement.
+ */
+
+#ifndef SPEAD2_COMMON_NUMA_H
+#define SPEAD2_COMMON_NUMA_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <spead2/common_memory_allocator.h>
+
+namespace spead2
+{
+
+/**
+ * Return the NUMA nodes that are online, in increasing order. The topology
+ * is read from sysfs once and cached. If it is not available (for example,
+ * on a non-Linux system or a kernel without NUMA support), the machine is
+ * treated as a single node 0.
+ */
+const std::vector<int> &numa_nodes();
+
+/**
+ * Return the CPUs that belong to NUMA node @a node, in increasing order.
+ * When the topology is not available, node 0 contains all the CPUs.
+ *
+ * @throw std::invalid_argument if @a node is not an online node
+ */
+std::vector<int> numa_node_cpus(int node);
+
+/// Return the NUMA node containing CPU @a cpu, or -1 if it is not known
+int numa_cpu_node(int cpu);
+
+/**
+ * Make the calling thread prefer to allocate memory from @a node. This is
+ * a no-op on single-node machines. Failures are logged but do not cause an
+ * exception.
+ */
+void numa_set_preferred_node(int node);
+
+/**
+ * Allocator that places memory on a specific NUMA node. Memory is obtained
+ * with mmap, bound to the node with @c mbind, and then pre-faulted so that
+ * the pages are allocated immediately. It can be used directly or as the
+ * base allocator of a @ref memory_pool, and allocations for chunks can be
+ * made by calling @ref allocate from the chunk allocation callback.
+ *
+ * On single-node machines (or when the kernel does not support memory
+ * policies) the binding step is skipped, and it behaves like
+ * @ref mmap_allocator.
+ */
+class numa_allocator : public memory_allocator
+{
+private:
+    int node;
+    bool strict;
+    int flags;
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param node     NUMA node on which to place memory
+     * @param strict   If true, memory is only taken from @a node. Otherwise
+     *                 the node is preferred, but other nodes are used if it
+     *                 runs out of memory.
+     * @param flags    Extra flags to pass on to mmap
+     * @throw std::invalid_argument if @a node is not an online node
+     */
+    explicit numa_allocator(int node, bool strict = false, int flags = 0);
+
+    int get_node() const { return node; }
+    bool get_strict() const { return strict; }
+
+    virtual pointer allocate(std::size_t size, void *hint) override;
+};
+
+namespace detail
+{
+
+/**
+ * Parse a list of IDs in the format used by sysfs for CPU and node lists,
+ * such as <code>0-3,8,10-11</code>. The result is sorted.
+ *
+ * @throw std::invalid_argument if the list is malformed
+ */
+std::vector<int> parse_id_list(const std::string &list);
+
+} // namespace detail
+
+} // namespace spead2
+
+#endif // SPEAD2_COMMON_NUMA_H
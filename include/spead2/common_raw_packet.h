@@ -55,6 +55,14 @@ mac_address multicast_mac(const boost::asio::ip::address &address);
  */
 mac_address interface_mac(const boost::asio::ip::address &address);
 
+/**
+ * Determine the interface index for an interface, given the interface's IP
+ * address.
+ *
+ * @throw std::runtime_error if no interface with this IP address is found.
+ */
+unsigned int interface_index(const boost::asio::ip::address &address);
+
 class packet_buffer
 {
 private:
@@ -203,6 +211,15 @@ public:
  */
 packet_buffer udp_from_ethernet(void *ptr, size_t size);
 
+/**
+ * Inspect an IPv4 packet (without a link-layer header) to extract the UDP
+ * payload, with sanity checks.
+ *
+ * @throws length_error if any length fields are invalid
+ * @throws packet_type_error if there are other problems e.g. it is not UDP
+ */
+packet_buffer udp_from_ipv4(void *ptr, size_t size);
+
 } // namespace spead2
 
 #endif // SPEAD2_COMMON_RAW_PACKET_H
@@ -29,9 +29,15 @@
 #include <memory>
 #include <stdexcept>
 #include <utility>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <thread>
 #include <cassert>
 #include <climits>
+#include <cstdint>
 #include <iostream>
+#include <spead2/common_defines.h>
 #include <spead2/common_logging.h>
 #include <spead2/common_semaphore.h>
 
@@ -130,6 +136,26 @@ protected:
     /// Implementation of popping functions, which doesn't touch semaphores
     T pop_internal();
 
+    /**
+     * Implementation of batch pushing, which doesn't touch semaphores. It
+     * moves @a n items starting at @a first into the ringbuffer.
+     *
+     * @throw ringbuffer_stopped if stopped, in which case no items are moved
+     */
+    template<typename InputIterator>
+    void push_many_internal(InputIterator first, std::size_t n);
+
+    /**
+     * Implementation of batch popping, which doesn't touch semaphores. It
+     * moves up to @a n items to @a out, stopping early only if the stop
+     * position is reached.
+     *
+     * @returns the number of items popped
+     * @throw ringbuffer_stopped if no items could be popped because the ringbuffer is stopped
+     */
+    template<typename OutputIterator>
+    std::size_t pop_many_internal(OutputIterator out, std::size_t n);
+
     /**
      * Implementation of stopping, without the semaphores.
      *
@@ -250,6 +276,43 @@ T ringbuffer_base<T>::pop_internal()
     return result;
 }
 
+template<typename T>
+template<typename InputIterator>
+void ringbuffer_base<T>::push_many_internal(InputIterator first, std::size_t n)
+{
+    std::lock_guard<std::mutex> lock(tail_mutex);
+    if (stopped)
+    {
+        throw ringbuffer_stopped();
+    }
+    for (std::size_t i = 0; i < n; i++, ++first)
+    {
+        new (get(tail)) T(std::move(*first));
+        tail = next(tail);
+    }
+}
+
+template<typename T>
+template<typename OutputIterator>
+std::size_t ringbuffer_base<T>::pop_many_internal(OutputIterator out, std::size_t n)
+{
+    std::lock_guard<std::mutex> lock(head_mutex);
+    std::size_t popped = 0;
+    while (popped < n && head != stop_position)
+    {
+        *out = std::move(*get(head));
+        ++out;
+        get(head)->~T();
+        head = next(head);
+        popped++;
+    }
+    if (popped == 0)
+    {
+        throw ringbuffer_stopped();
+    }
+    return popped;
+}
+
 template<typename T>
 bool ringbuffer_base<T>::stop_internal(bool remove_producer)
 {
@@ -282,6 +345,507 @@ void ringbuffer_base<T>::add_producer()
     producers++;
 }
 
+namespace detail
+{
+
+/**
+ * Internal base class for @ref ringbuffer_spsc_base and @ref
+ * ringbuffer_mpmc_base, holding the positions and stop state.
+ *
+ * Positions increase monotonically and are mapped onto a power-of-two number
+ * of slots, which may exceed the capacity (the capacity is enforced by the
+ * space semaphore, which is why the lock-free bases are only usable through
+ * @ref ringbuffer). The top bit of @ref tail is set when the ringbuffer is
+ * stopped. Producers reserve positions with a compare-and-swap on @ref tail
+ * that fails once that bit is set, so a push either lands before the stop
+ * position or throws @ref ringbuffer_stopped without consuming its argument.
+ */
+template<typename T>
+class ringbuffer_lockfree_base
+{
+    static_assert(std::is_nothrow_move_constructible<T>::value,
+                  "lock-free ringbuffers require a nothrow move constructor");
+
+protected:
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_type;
+
+    /// Bit of @ref tail that indicates that the ringbuffer is stopped
+    static constexpr std::size_t stop_bit = ~(SIZE_MAX >> 1);
+
+    const std::size_t cap;      ///< Maximum number of items
+    const std::size_t mask;     ///< Number of slots, minus 1
+
+private:
+    char pad0[detail::cache_line_size];
+    /// Next position to reserve for a producer, plus @ref stop_bit once stopped
+    std::atomic<std::size_t> tail{0};
+    char pad1[detail::cache_line_size];
+
+protected:
+    /// Next position for a consumer to take
+    std::atomic<std::size_t> head{0};
+    char pad2[detail::cache_line_size];
+
+private:
+    /// Value of @ref tail when stopped, or @c SIZE_MAX if not stopped
+    std::atomic<std::size_t> stop_position{SIZE_MAX};
+    std::mutex producers_mutex;
+    std::size_t producers = 0;  ///< Number of producers registered with @ref add_producer
+
+    static std::size_t round_up_pow2(std::size_t n);
+
+protected:
+    explicit ringbuffer_lockfree_base(std::size_t cap);
+
+    /// Get the last position that has been reserved, plus one
+    std::size_t get_tail() const { return tail.load(std::memory_order_acquire) & ~stop_bit; }
+
+    /**
+     * Reserve @a n consecutive positions for writing.
+     *
+     * @returns the first reserved position
+     * @throw ringbuffer_stopped if the ringbuffer has been stopped
+     */
+    std::size_t reserve(std::size_t n);
+
+    /**
+     * Limit a request to consume @a n items starting at position @a pos to
+     * those before the stop position.
+     *
+     * @throw ringbuffer_stopped if @a pos is the stop position
+     */
+    std::size_t limit_claim(std::size_t pos, std::size_t n) const;
+
+    /// Wait briefly for another thread that is part-way through an operation
+    static void backoff() { std::this_thread::yield(); }
+
+    /// @copydoc ringbuffer_base::throw_empty_or_stopped
+    void throw_empty_or_stopped();
+
+    /// @copydoc ringbuffer_base::throw_full_or_stopped
+    void throw_full_or_stopped();
+
+    /// @copydoc ringbuffer_base::stop_internal
+    bool stop_internal(bool remove_producer = false);
+
+public:
+    /// @copydoc ringbuffer_base::capacity
+    std::size_t capacity() const { return cap; }
+
+    /// @copydoc ringbuffer_base::size
+    std::size_t size() const;
+
+    /// @copydoc ringbuffer_base::add_producer
+    void add_producer();
+};
+
+template<typename T>
+constexpr std::size_t ringbuffer_lockfree_base<T>::stop_bit;
+
+template<typename T>
+std::size_t ringbuffer_lockfree_base<T>::round_up_pow2(std::size_t n)
+{
+    std::size_t slots = 1;
+    while (slots < n)
+        slots *= 2;
+    return slots;
+}
+
+template<typename T>
+ringbuffer_lockfree_base<T>::ringbuffer_lockfree_base(std::size_t cap)
+    : cap(cap), mask(round_up_pow2(cap) - 1)
+{
+    assert(cap > 0);
+}
+
+template<typename T>
+std::size_t ringbuffer_lockfree_base<T>::reserve(std::size_t n)
+{
+    std::size_t pos = tail.load(std::memory_order_relaxed);
+    do
+    {
+        if (pos & stop_bit)
+            throw ringbuffer_stopped();
+    } while (!tail.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed));
+    return pos;
+}
+
+template<typename T>
+std::size_t ringbuffer_lockfree_base<T>::limit_claim(std::size_t pos, std::size_t n) const
+{
+    std::size_t stop = stop_position.load(std::memory_order_acquire);
+    if (stop != SIZE_MAX)
+    {
+        if (pos == stop)
+            throw ringbuffer_stopped();
+        n = std::min(n, stop - pos);
+    }
+    return n;
+}
+
+template<typename T>
+void ringbuffer_lockfree_base<T>::throw_empty_or_stopped()
+{
+    if (head.load(std::memory_order_relaxed) == stop_position.load(std::memory_order_acquire))
+        throw ringbuffer_stopped();
+    else
+        throw ringbuffer_empty();
+}
+
+template<typename T>
+void ringbuffer_lockfree_base<T>::throw_full_or_stopped()
+{
+    if (tail.load(std::memory_order_relaxed) & stop_bit)
+        throw ringbuffer_stopped();
+    else
+        throw ringbuffer_full();
+}
+
+template<typename T>
+bool ringbuffer_lockfree_base<T>::stop_internal(bool remove_producer)
+{
+    std::lock_guard<std::mutex> lock(producers_mutex);
+    if (remove_producer)
+    {
+        assert(producers != 0);
+        producers--;
+        if (producers != 0)
+            return false;
+    }
+    std::size_t old_tail = tail.fetch_or(stop_bit, std::memory_order_acq_rel);
+    if (!(old_tail & stop_bit))
+        stop_position.store(old_tail, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+std::size_t ringbuffer_lockfree_base<T>::size() const
+{
+    // Load head first so that the result cannot be negative
+    std::size_t h = head.load(std::memory_order_acquire);
+    return get_tail() - h;
+}
+
+template<typename T>
+void ringbuffer_lockfree_base<T>::add_producer()
+{
+    std::lock_guard<std::mutex> lock(producers_mutex);
+    producers++;
+}
+
+} // namespace detail
+
+/**
+ * Lock-free replacement for @ref ringbuffer_base, for use with a single
+ * producer thread and a single consumer thread at a time. Use it through
+ * @ref ringbuffer_spsc. The ringbuffer may still be stopped from any
+ * thread, and several producers may be registered with @ref add_producer
+ * provided that they do not push concurrently.
+ *
+ * The producer publishes items by advancing @ref committed after constructing
+ * them, and the consumer frees slots by advancing the head, so the fast path
+ * involves one compare-and-swap and a few plain atomic loads and stores.
+ */
+template<typename T>
+class ringbuffer_spsc_base : public detail::ringbuffer_lockfree_base<T>
+{
+private:
+    typedef typename detail::ringbuffer_lockfree_base<T>::storage_type storage_type;
+
+    std::unique_ptr<storage_type[]> storage;
+    char pad[detail::cache_line_size];
+    /// Positions before this one hold constructed items
+    std::atomic<std::size_t> committed{0};
+
+    /// Gets pointer to the slot for position @a pos
+    T *get(std::size_t pos) { return reinterpret_cast<T *>(&storage[pos & this->mask]); }
+
+    /// Wait until positions before @a end have been constructed
+    void wait_committed(std::size_t end);
+
+protected:
+    explicit ringbuffer_spsc_base(std::size_t cap);
+    ~ringbuffer_spsc_base();
+
+    /// @copydoc ringbuffer_base::emplace_internal
+    template<typename... Args>
+    void emplace_internal(Args&&... args);
+
+    /// @copydoc ringbuffer_base::emplace_internal
+    void emplace_internal(T &&value);
+
+    /// @copydoc ringbuffer_base::pop_internal
+    T pop_internal();
+
+    /// @copydoc ringbuffer_base::push_many_internal
+    template<typename InputIterator>
+    void push_many_internal(InputIterator first, std::size_t n);
+
+    /// @copydoc ringbuffer_base::pop_many_internal
+    template<typename OutputIterator>
+    std::size_t pop_many_internal(OutputIterator out, std::size_t n);
+};
+
+template<typename T>
+ringbuffer_spsc_base<T>::ringbuffer_spsc_base(std::size_t cap)
+    : detail::ringbuffer_lockfree_base<T>(cap), storage(new storage_type[this->mask + 1])
+{
+}
+
+template<typename T>
+ringbuffer_spsc_base<T>::~ringbuffer_spsc_base()
+{
+    // Drain any remaining elements
+    std::size_t end = committed.load(std::memory_order_acquire);
+    for (std::size_t pos = this->head.load(std::memory_order_relaxed); pos != end; pos++)
+        get(pos)->~T();
+}
+
+template<typename T>
+void ringbuffer_spsc_base<T>::wait_committed(std::size_t end)
+{
+    /* This only waits if the consumer was woken by a stop while the producer
+     * was part-way through a push.
+     */
+    while (committed.load(std::memory_order_acquire) < end)
+        this->backoff();
+}
+
+template<typename T>
+template<typename... Args>
+void ringbuffer_spsc_base<T>::emplace_internal(Args&&... args)
+{
+    // Construct first, so that a throwing constructor can't leave a hole
+    emplace_internal(T(std::forward<Args>(args)...));
+}
+
+template<typename T>
+void ringbuffer_spsc_base<T>::emplace_internal(T &&value)
+{
+    std::size_t pos = this->reserve(1);
+    new (get(pos)) T(std::move(value));
+    committed.store(pos + 1, std::memory_order_release);
+}
+
+template<typename T>
+T ringbuffer_spsc_base<T>::pop_internal()
+{
+    std::size_t pos = this->head.load(std::memory_order_relaxed);
+    this->limit_claim(pos, 1);
+    wait_committed(pos + 1);
+    T *slot = get(pos);
+    T result = std::move(*slot);
+    slot->~T();
+    this->head.store(pos + 1, std::memory_order_release);
+    return result;
+}
+
+template<typename T>
+template<typename InputIterator>
+void ringbuffer_spsc_base<T>::push_many_internal(InputIterator first, std::size_t n)
+{
+    std::size_t pos = this->reserve(n);
+    for (std::size_t i = 0; i < n; i++, ++first)
+        new (get(pos + i)) T(std::move(*first));
+    committed.store(pos + n, std::memory_order_release);
+}
+
+template<typename T>
+template<typename OutputIterator>
+std::size_t ringbuffer_spsc_base<T>::pop_many_internal(OutputIterator out, std::size_t n)
+{
+    std::size_t pos = this->head.load(std::memory_order_relaxed);
+    n = this->limit_claim(pos, n);
+    wait_committed(pos + n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        T *slot = get(pos + i);
+        *out = std::move(*slot);
+        ++out;
+        slot->~T();
+    }
+    this->head.store(pos + n, std::memory_order_release);
+    return n;
+}
+
+/**
+ * Lock-free replacement for @ref ringbuffer_base that supports multiple
+ * concurrent producers and consumers. Use it through @ref ringbuffer_mpmc.
+ *
+ * This follows Dmitry Vyukov's bounded MPMC queue: each slot carries a
+ * sequence number indicating whether it is ready to be written or read for
+ * a given position. Producers and consumers claim positions with a
+ * compare-and-swap on the tail or head respectively, and then wait (only
+ * if another thread is part-way through an operation on the same slot) for
+ * the sequence number before transferring the item.
+ */
+template<typename T>
+class ringbuffer_mpmc_base : public detail::ringbuffer_lockfree_base<T>
+{
+private:
+    typedef typename detail::ringbuffer_lockfree_base<T>::storage_type storage_type;
+
+    struct cell
+    {
+        /**
+         * Equal to the position if the slot is free for it, or the position
+         * plus one once the item at that position has been constructed.
+         */
+        std::atomic<std::size_t> seq;
+        storage_type value;
+    };
+
+    std::unique_ptr<cell[]> cells;
+
+    /// Get the cell for position @a pos
+    cell &get_cell(std::size_t pos) { return cells[pos & this->mask]; }
+
+    /// Construct the item at reserved position @a pos
+    template<typename... Args>
+    void put_at(std::size_t pos, Args&&... args);
+
+    /// Wait for the item at claimed position @a pos to be constructed
+    T *wait_readable(std::size_t pos);
+
+    /// Mark the slot for position @a pos as free, once its item has been destroyed
+    void release(std::size_t pos);
+
+    /// Claim up to @a n positions for reading
+    std::size_t claim(std::size_t n, std::size_t &pos);
+
+protected:
+    explicit ringbuffer_mpmc_base(std::size_t cap);
+    ~ringbuffer_mpmc_base();
+
+    /// @copydoc ringbuffer_base::emplace_internal
+    template<typename... Args>
+    void emplace_internal(Args&&... args);
+
+    /// @copydoc ringbuffer_base::emplace_internal
+    void emplace_internal(T &&value);
+
+    /// @copydoc ringbuffer_base::pop_internal
+    T pop_internal();
+
+    /// @copydoc ringbuffer_base::push_many_internal
+    template<typename InputIterator>
+    void push_many_internal(InputIterator first, std::size_t n);
+
+    /// @copydoc ringbuffer_base::pop_many_internal
+    template<typename OutputIterator>
+    std::size_t pop_many_internal(OutputIterator out, std::size_t n);
+};
+
+template<typename T>
+ringbuffer_mpmc_base<T>::ringbuffer_mpmc_base(std::size_t cap)
+    : detail::ringbuffer_lockfree_base<T>(cap), cells(new cell[this->mask + 1])
+{
+    for (std::size_t i = 0; i <= this->mask; i++)
+        cells[i].seq.store(i, std::memory_order_relaxed);
+}
+
+template<typename T>
+ringbuffer_mpmc_base<T>::~ringbuffer_mpmc_base()
+{
+    // Drain any remaining elements
+    std::size_t end = this->get_tail();
+    for (std::size_t pos = this->head.load(std::memory_order_relaxed); pos != end; pos++)
+        reinterpret_cast<T *>(&get_cell(pos).value)->~T();
+}
+
+template<typename T>
+template<typename... Args>
+void ringbuffer_mpmc_base<T>::put_at(std::size_t pos, Args&&... args)
+{
+    cell &c = get_cell(pos);
+    // Wait for a consumer that is still moving out the previous occupant
+    while (c.seq.load(std::memory_order_acquire) != pos)
+        this->backoff();
+    new (&c.value) T(std::forward<Args>(args)...);
+    c.seq.store(pos + 1, std::memory_order_release);
+}
+
+template<typename T>
+T *ringbuffer_mpmc_base<T>::wait_readable(std::size_t pos)
+{
+    cell &c = get_cell(pos);
+    // Wait for a producer that has reserved the position but not yet written it
+    while (c.seq.load(std::memory_order_acquire) != pos + 1)
+        this->backoff();
+    return reinterpret_cast<T *>(&c.value);
+}
+
+template<typename T>
+void ringbuffer_mpmc_base<T>::release(std::size_t pos)
+{
+    // Make the slot available for the position one lap later
+    get_cell(pos).seq.store(pos + this->mask + 1, std::memory_order_release);
+}
+
+template<typename T>
+std::size_t ringbuffer_mpmc_base<T>::claim(std::size_t n, std::size_t &pos)
+{
+    pos = this->head.load(std::memory_order_relaxed);
+    std::size_t claimed;
+    do
+    {
+        claimed = this->limit_claim(pos, n);
+    } while (!this->head.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed));
+    return claimed;
+}
+
+template<typename T>
+template<typename... Args>
+void ringbuffer_mpmc_base<T>::emplace_internal(Args&&... args)
+{
+    // Construct first, so that a throwing constructor can't leave a hole
+    emplace_internal(T(std::forward<Args>(args)...));
+}
+
+template<typename T>
+void ringbuffer_mpmc_base<T>::emplace_internal(T &&value)
+{
+    put_at(this->reserve(1), std::move(value));
+}
+
+template<typename T>
+T ringbuffer_mpmc_base<T>::pop_internal()
+{
+    std::size_t pos;
+    claim(1, pos);
+    T *item = wait_readable(pos);
+    T result = std::move(*item);
+    item->~T();
+    release(pos);
+    return result;
+}
+
+template<typename T>
+template<typename InputIterator>
+void ringbuffer_mpmc_base<T>::push_many_internal(InputIterator first, std::size_t n)
+{
+    std::size_t pos = this->reserve(n);
+    for (std::size_t i = 0; i < n; i++, ++first)
+        put_at(pos + i, std::move(*first));
+}
+
+template<typename T>
+template<typename OutputIterator>
+std::size_t ringbuffer_mpmc_base<T>::pop_many_internal(OutputIterator out, std::size_t n)
+{
+    std::size_t pos;
+    n = claim(n, pos);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        T *item = wait_readable(pos + i);
+        *out = std::move(*item);
+        ++out;
+        item->~T();
+        release(pos + i);
+    }
+    return n;
+}
+
 ///////////////////////////////////////////////////////////////////////
 
 /**
@@ -297,6 +861,12 @@ void ringbuffer_base<T>::add_producer()
  * completion with @ref remove_producer. If this causes the number of
  * producers to fall to zero, the stream is stopped.
  *
+ * The storage and synchronisation of the items themselves is provided by
+ * @a Base. The default (@ref ringbuffer_base) uses a mutex for each end. The
+ * lock-free alternatives are most conveniently used through the
+ * @ref ringbuffer_spsc and @ref ringbuffer_mpmc aliases. The semaphores are
+ * needed in all cases, to block when empty or full.
+ *
  * \internal
  *
  * The design is mostly standard: head and tail pointers, and semaphores
@@ -314,8 +884,9 @@ void ringbuffer_base<T>::add_producer()
  * causes the semaphore to be transiently unavailable, which leads to the need
  * for @ref throw_empty_or_stopped and @ref throw_full_or_stopped.
  */
-template<typename T, typename DataSemaphore = semaphore, typename SpaceSemaphore = semaphore>
-class ringbuffer : public ringbuffer_base<T>
+template<typename T, typename DataSemaphore = semaphore, typename SpaceSemaphore = semaphore,
+         typename Base = ringbuffer_base<T>>
+class ringbuffer : public Base
 {
 private:
     DataSemaphore data_sem;     ///< Number of filled slots
@@ -382,6 +953,34 @@ public:
     template<typename... SemArgs>
     T pop(SemArgs&&... sem_args);
 
+    /**
+     * Append a sequence of items to the queue, blocking if necessary. Items
+     * are moved out of [@a first, @a last). As many items as there is space
+     * for are appended at once, and consumers are signalled once for each
+     * such batch rather than once per item.
+     *
+     * @param first, last  Range of items to move
+     * @param sem_args  Arbitrary arguments to pass to the space semaphore
+     * @throw ringbuffer_stopped if @ref stop is called before all the items
+     * are appended. The items that were not appended are left in the range.
+     */
+    template<typename ForwardIterator, typename... SemArgs>
+    void push_many(ForwardIterator first, ForwardIterator last, SemArgs&&... sem_args);
+
+    /**
+     * Retrieve up to @a max_items items from the queue, blocking until there
+     * is at least one or until the queue is stopped. Producers are signalled
+     * once for the whole batch.
+     *
+     * @param out        Output iterator to which the items are moved
+     * @param max_items  Maximum number of items to retrieve
+     * @param sem_args   Arbitrary arguments to pass to the data semaphore
+     * @returns the number of items retrieved
+     * @throw ringbuffer_stopped if the queue is empty and @ref stop was called
+     */
+    template<typename OutputIterator, typename... SemArgs>
+    std::size_t pop_many(OutputIterator out, std::size_t max_items, SemArgs&&... sem_args);
+
     /**
      * Indicate that no more items will be produced. This does not immediately
      * stop consumers if there are still items in the queue; instead,
@@ -407,15 +1006,15 @@ public:
     const SpaceSemaphore &get_space_sem() const { return space_sem; }
 };
 
-template<typename T, typename DataSemaphore, typename SpaceSemaphore>
-ringbuffer<T, DataSemaphore, SpaceSemaphore>::ringbuffer(size_t cap)
-    : ringbuffer_base<T>(cap), data_sem(0), space_sem(cap)
+template<typename T, typename DataSemaphore, typename SpaceSemaphore, typename Base>
+ringbuffer<T, DataSemaphore, SpaceSemaphore, Base>::ringbuffer(size_t cap)
+    : Base(cap), data_sem(0), space_sem(cap)
 {
 }
 
-template<typename T, typename DataSemaphore, typename SpaceSemaphore>
+template<typename T, typename DataSemaphore, typename SpaceSemaphore, typename Base>
 template<typename... Args>
-void ringbuffer<T, DataSemaphore, SpaceSemaphore>::emplace(Args&&... args)
+void ringbuffer<T, DataSemaphore, SpaceSemaphore, Base>::emplace(Args&&... args)
 {
     semaphore_get(space_sem);
     try
@@ -431,9 +1030,9 @@ void ringbuffer<T, DataSemaphore, SpaceSemaphore>::emplace(Args&&... args)
     }
 }
 
-template<typename T, typename DataSemaphore, typename SpaceSemaphore>
+template<typename T, typename DataSemaphore, typename SpaceSemaphore, typename Base>
 template<typename... Args>
-void ringbuffer<T, DataSemaphore, SpaceSemaphore>::try_emplace(Args&&... args)
+void ringbuffer<T, DataSemaphore, SpaceSemaphore, Base>::try_emplace(Args&&... args)
 {
     /* TODO: try_get needs to be modified to distinguish between interrupted
      * system calls and zero semaphore (EAGAIN vs EINTR).
@@ -453,9 +1052,9 @@ void ringbuffer<T, DataSemaphore, SpaceSemaphore>::try_emplace(Args&&... args)
     }
 }
 
-template<typename T, typename DataSemaphore, typename SpaceSemaphore>
+template<typename T, typename DataSemaphore, typename SpaceSemaphore, typename Base>
 template<typename... SemArgs>
-void ringbuffer<T, DataSemaphore, SpaceSemaphore>::push(T &&value, SemArgs&&... sem_args)
+void ringbuffer<T, DataSemaphore, SpaceSemaphore, Base>::push(T &&value, SemArgs&&... sem_args)
 {
     semaphore_get(space_sem, std::forward<SemArgs>(sem_args)...);
     try
@@ -471,8 +1070,8 @@ void ringbuffer<T, DataSemaphore, SpaceSemaphore>::push(T &&value, SemArgs&&...
     }
 }
 
-template<typename T, typename DataSemaphore, typename SpaceSemaphore>
-void ringbuffer<T, DataSemaphore, SpaceSemaphore>::try_push(T &&value)
+template<typename T, typename DataSemaphore, typename SpaceSemaphore, typename Base>
+void ringbuffer<T, DataSemaphore, SpaceSemaphore, Base>::try_push(T &&value)
 {
     if (space_sem.try_get() == -1)
         this->throw_full_or_stopped();
@@ -489,9 +1088,9 @@ void ringbuffer<T, DataSemaphore, SpaceSemaphore>::try_push(T &&value)
     }
 }
 
-template<typename T, typename DataSemaphore, typename SpaceSemaphore>
+template<typename T, typename DataSemaphore, typename SpaceSemaphore, typename Base>
 template<typename... SemArgs>
-T ringbuffer<T, DataSemaphore, SpaceSemaphore>::pop(SemArgs&&... sem_args)
+T ringbuffer<T, DataSemaphore, SpaceSemaphore, Base>::pop(SemArgs&&... sem_args)
 {
     semaphore_get(data_sem, std::forward<SemArgs>(sem_args)...);
     try
@@ -508,8 +1107,8 @@ T ringbuffer<T, DataSemaphore, SpaceSemaphore>::pop(SemArgs&&... sem_args)
     }
 }
 
-template<typename T, typename DataSemaphore, typename SpaceSemaphore>
-T ringbuffer<T, DataSemaphore, SpaceSemaphore>::try_pop()
+template<typename T, typename DataSemaphore, typename SpaceSemaphore, typename Base>
+T ringbuffer<T, DataSemaphore, SpaceSemaphore, Base>::try_pop()
 {
     if (data_sem.try_get() == -1)
         this->throw_empty_or_stopped();
@@ -527,8 +1126,67 @@ T ringbuffer<T, DataSemaphore, SpaceSemaphore>::try_pop()
     }
 }
 
-template<typename T, typename DataSemaphore, typename SpaceSemaphore>
-bool ringbuffer<T, DataSemaphore, SpaceSemaphore>::stop()
+template<typename T, typename DataSemaphore, typename SpaceSemaphore, typename Base>
+template<typename ForwardIterator, typename... SemArgs>
+void ringbuffer<T, DataSemaphore, SpaceSemaphore, Base>::push_many(
+    ForwardIterator first, ForwardIterator last, SemArgs&&... sem_args)
+{
+    std::size_t remaining = std::distance(first, last);
+    while (remaining > 0)
+    {
+        // Wait for one slot, then take whatever others are free
+        semaphore_get(space_sem, sem_args...);
+        std::size_t n = 1;
+        while (n < remaining && space_sem.try_get() != -1)
+            n++;
+        try
+        {
+            this->push_many_internal(first, n);
+            data_sem.put(n);
+        }
+        catch (ringbuffer_stopped &e)
+        {
+            // We didn't actually use the slots we reserved with space_sem
+            space_sem.put(n);
+            throw;
+        }
+        std::advance(first, n);
+        remaining -= n;
+    }
+}
+
+template<typename T, typename DataSemaphore, typename SpaceSemaphore, typename Base>
+template<typename OutputIterator, typename... SemArgs>
+std::size_t ringbuffer<T, DataSemaphore, SpaceSemaphore, Base>::pop_many(
+    OutputIterator out, std::size_t max_items, SemArgs&&... sem_args)
+{
+    if (max_items == 0)
+        return 0;
+    // Wait for one item, then take whatever others are available
+    semaphore_get(data_sem, std::forward<SemArgs>(sem_args)...);
+    std::size_t n = 1;
+    while (n < max_items && data_sem.try_get() != -1)
+        n++;
+    std::size_t popped;
+    try
+    {
+        popped = this->pop_many_internal(out, n);
+    }
+    catch (ringbuffer_stopped &e)
+    {
+        // We didn't consume any data, wake up the next waiter
+        data_sem.put(n);
+        throw;
+    }
+    // If we hit the stop position, pass the remaining wakeups on
+    if (popped < n)
+        data_sem.put(n - popped);
+    space_sem.put(popped);
+    return popped;
+}
+
+template<typename T, typename DataSemaphore, typename SpaceSemaphore, typename Base>
+bool ringbuffer<T, DataSemaphore, SpaceSemaphore, Base>::stop()
 {
     if (this->stop_internal())
     {
@@ -540,8 +1198,8 @@ bool ringbuffer<T, DataSemaphore, SpaceSemaphore>::stop()
         return false;
 }
 
-template<typename T, typename DataSemaphore, typename SpaceSemaphore>
-bool ringbuffer<T, DataSemaphore, SpaceSemaphore>::remove_producer()
+template<typename T, typename DataSemaphore, typename SpaceSemaphore, typename Base>
+bool ringbuffer<T, DataSemaphore, SpaceSemaphore, Base>::remove_producer()
 {
     if (this->stop_internal(true))
     {
@@ -553,6 +1211,20 @@ bool ringbuffer<T, DataSemaphore, SpaceSemaphore>::remove_producer()
         return false;
 }
 
+/**
+ * Lock-free @ref ringbuffer for a single producer and a single consumer.
+ * See @ref ringbuffer_spsc_base for the restrictions.
+ */
+template<typename T, typename DataSemaphore = semaphore, typename SpaceSemaphore = semaphore>
+using ringbuffer_spsc = ringbuffer<T, DataSemaphore, SpaceSemaphore, ringbuffer_spsc_base<T>>;
+
+/**
+ * Lock-free @ref ringbuffer for any number of producers and consumers.
+ * See @ref ringbuffer_mpmc_base.
+ */
+template<typename T, typename DataSemaphore = semaphore, typename SpaceSemaphore = semaphore>
+using ringbuffer_mpmc = ringbuffer<T, DataSemaphore, SpaceSemaphore, ringbuffer_mpmc_base<T>>;
+
 } // namespace spead2
 
 #endif // SPEAD2_COMMON_RINGBUFFER_H
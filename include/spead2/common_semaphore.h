@@ -28,6 +28,8 @@
 # define _GNU_SOURCE
 #endif
 #include <spead2/common_features.h>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <atomic>
 #if SPEAD2_USE_POSIX_SEMAPHORES
@@ -55,6 +57,9 @@ public:
     /// Increment
     void put();
 
+    /// Increment by @a n, waking up to @a n waiters
+    void put(std::size_t n);
+
     /**
      * Decrement semaphore, blocking if necessary.
      *
@@ -94,9 +99,12 @@ public:
     /// Move assignment
     semaphore_pipe &operator=(semaphore_pipe &&);
 
-    /// @copydoc semaphore_spin::put
+    /// @copydoc semaphore_spin::put()
     void put();
 
+    /// @copydoc semaphore_spin::put(std::size_t)
+    void put(std::size_t n);
+
     /// @copydoc semaphore_spin::get
     int get();
 
@@ -128,9 +136,12 @@ public:
     /// Move assignment
     semaphore_eventfd &operator=(semaphore_eventfd &&);
 
-    /// @copydoc semaphore_spin::put
+    /// @copydoc semaphore_spin::put()
     void put();
 
+    /// @copydoc semaphore_spin::put(std::size_t)
+    void put(std::size_t n);
+
     /// @copydoc semaphore_spin::get
     int get();
 
@@ -160,9 +171,12 @@ public:
     explicit semaphore_posix(unsigned int initial = 0);
     ~semaphore_posix();
 
-    /// @copydoc semaphore_spin::put
+    /// @copydoc semaphore_spin::put()
     void put();
 
+    /// @copydoc semaphore_spin::put(std::size_t)
+    void put(std::size_t n);
+
     /// @copydoc semaphore_spin::get
     int get();
 
@@ -172,12 +186,145 @@ public:
 
 #endif // SPEAD2_USE_POSIX_SEMAPHORES
 
+namespace detail
+{
+
+/// Kernel-backed semaphore that can be polled, used to build @ref semaphore_futex_fd
 #if SPEAD2_USE_EVENTFD
-typedef semaphore_eventfd semaphore_fd;
+typedef semaphore_eventfd semaphore_os_fd;
 #else
-typedef semaphore_pipe semaphore_fd;
+typedef semaphore_pipe semaphore_os_fd;
 #endif
 
+} // namespace detail
+
+#if SPEAD2_USE_FUTEX
+
+/**
+ * Semaphore built directly on futex(2). It keeps a count of sleeping
+ * waiters, so that @ref put only makes a system call if a thread is
+ * actually asleep, and @ref get spins for a while before going to sleep.
+ * In the uncontended case neither makes any system calls.
+ *
+ * Spinning is skipped on machines with a single CPU, where it could only
+ * delay the thread that would put the semaphore.
+ */
+class semaphore_futex
+{
+private:
+    std::atomic<std::uint32_t> value;
+    std::atomic<std::uint32_t> waiters{0};   ///< Number of threads in (or about to enter) FUTEX_WAIT
+    const unsigned int spin_count;
+
+    // Prevent copying: semaphores are not copyable resources
+    semaphore_futex(const semaphore_futex &) = delete;
+    semaphore_futex &operator=(const semaphore_futex &) = delete;
+
+protected:
+    /// Current value (for metrics and to check for races, not for control flow)
+    std::uint32_t current() const { return value.load(); }
+
+    /**
+     * Increment by @a n, waking sleepers if there are any.
+     *
+     * @returns the previous value
+     */
+    std::uint32_t increment(std::uint32_t n);
+
+    /**
+     * Decrement if the value is positive, without blocking.
+     *
+     * @param[out] old  The value before decrementing, on success
+     * @returns whether the value was decremented
+     */
+    bool try_decrement(std::uint32_t &old);
+
+    /**
+     * Decrement, blocking if necessary.
+     *
+     * @param[out] old  The value before decrementing, on success
+     * @retval -1 if a system call was interrupted
+     * @retval 0 on success
+     */
+    int decrement(std::uint32_t &old);
+
+public:
+    /// Default number of attempts made by @ref get before sleeping
+    static constexpr unsigned int default_spin_count = 1000;
+
+    explicit semaphore_futex(unsigned int initial = 0, unsigned int spin_count = default_spin_count);
+
+    /// @copydoc semaphore_spin::put()
+    void put();
+
+    /// @copydoc semaphore_spin::put(std::size_t)
+    void put(std::size_t n);
+
+    /// @copydoc semaphore_spin::get
+    int get();
+
+    /// @copydoc semaphore_spin::try_get
+    int try_get();
+};
+
+/**
+ * Variant of @ref semaphore_futex that also provides a file descriptor that
+ * is readable when the semaphore is positive, so that it can be plumbed into
+ * an event loop (such as asio or asyncio).
+ *
+ * The file descriptor is only maintained once @ref get_fd has been called,
+ * and even then is only written when the semaphore becomes positive and read
+ * when it drops to zero. Until then, and for threads that block in
+ * @ref get, it behaves exactly like @ref semaphore_futex. While puts and gets
+ * are in flight the file descriptor may briefly be readable while the
+ * semaphore is zero, so a waiter should use @ref try_get when it becomes
+ * readable; once they complete it is readable exactly when the semaphore is
+ * positive.
+ */
+class semaphore_futex_fd : private semaphore_futex
+{
+private:
+    mutable detail::semaphore_os_fd fd_sem;
+    mutable std::atomic<bool> fd_active{false};
+
+    /**
+     * Make the file descriptor readable if and only if the value is positive.
+     * It is safe to call concurrently with puts and gets.
+     */
+    void sync_fd() const;
+    /// Update the file descriptor after the value rose from @a old
+    void increased(std::uint32_t old);
+    /// Update the file descriptor after the value fell from @a old
+    void decreased(std::uint32_t old);
+
+public:
+    using semaphore_futex::default_spin_count;
+
+    explicit semaphore_futex_fd(unsigned int initial = 0, unsigned int spin_count = default_spin_count);
+
+    /// @copydoc semaphore_spin::put()
+    void put();
+
+    /// @copydoc semaphore_spin::put(std::size_t)
+    void put(std::size_t n);
+
+    /// @copydoc semaphore_spin::get
+    int get();
+
+    /// @copydoc semaphore_spin::try_get
+    int try_get();
+
+    /// @copydoc semaphore_pipe::get_fd
+    int get_fd() const;
+};
+
+typedef semaphore_futex_fd semaphore_fd;
+typedef semaphore_futex semaphore;
+
+#else // !SPEAD2_USE_FUTEX
+
+typedef detail::semaphore_os_fd semaphore_fd;
+
 #if SPEAD2_USE_POSIX_SEMAPHORES
 
 typedef semaphore_posix semaphore;
@@ -196,6 +343,7 @@ public:
 };
 
 #endif // !SPEAD2_USE_POSIX_SEMAPHORES
+#endif // !SPEAD2_USE_FUTEX
 
 /////////////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,193 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_COMMON_SHM_H
+#define SPEAD2_COMMON_SHM_H
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_SHM
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <string>
+
+namespace spead2
+{
+
+/**
+ * Queue for packets being passed between processes on the same host, through
+ * a shared memory segment.
+ *
+ * The segment holds a ring of fixed-size packet slots, with a
+ * single-producer, single-consumer lock-free protocol. A consumer that finds
+ * the ring empty sleeps on a futex in the segment, and the producer only
+ * makes a system call to wake it if it is actually asleep.
+ *
+ * One process creates the queue (either with a name, which other processes
+ * can open, or anonymously, in which case the file descriptor must be passed
+ * to the other process, for example across @c fork or over a Unix domain
+ * socket). At most one sender and one receiver may use the queue at a time.
+ *
+ * Unlike @ref inproc_queue, the queue has a fixed capacity. A sender that
+ * finds it full waits for the receiver to make space.
+ */
+class shm_queue
+{
+public:
+    /// Slot size used by the Python bindings if none is given
+    static constexpr std::size_t default_slot_size = 9200;
+    /// Number of slots used by the Python bindings if none is given
+    static constexpr std::size_t default_num_slots = 4096;
+
+private:
+    struct header;
+
+    int fd = -1;
+    std::string unlink_name;    ///< Name to unlink on destruction (empty if none)
+    header *hdr = nullptr;
+    std::uint8_t *slots = nullptr;
+    std::size_t mapped_size = 0;
+    std::size_t slot_size = 0;
+    std::size_t num_slots = 0;
+    std::size_t slot_stride = 0;
+
+    /// Unmap and close everything (used by the destructor and on failure)
+    void cleanup();
+    /// Initialise a newly-created segment
+    void create(std::size_t slot_size, std::size_t num_slots);
+    /// Map an existing segment from @ref fd
+    void attach();
+    /// Pointer to the start (size field) of the slot at @a index
+    std::uint8_t *slot(std::uint64_t index) const;
+    void wake_consumer();
+
+public:
+    /**
+     * Create a new named queue. The name follows the rules of
+     * @c shm_open (it should start with a slash and contain no other
+     * slashes), and the name is removed again when this object is destroyed.
+     *
+     * @param name       Name of the shared memory object
+     * @param slot_size  Maximum packet size that can be passed
+     * @param num_slots  Number of packets the queue can hold
+     * @throw std::invalid_argument if @a slot_size or @a num_slots is zero
+     * @throw std::system_error if the object already exists or cannot be
+     * created
+     */
+    shm_queue(const std::string &name, std::size_t slot_size, std::size_t num_slots);
+
+    /**
+     * Open a queue that was created by another process.
+     *
+     * @throw std::invalid_argument if the object is not a queue
+     * @throw std::system_error if the object cannot be opened
+     */
+    explicit shm_queue(const std::string &name);
+
+    /**
+     * Create a new anonymous queue. Other processes can access it through the
+     * file descriptor returned by @ref get_fd.
+     */
+    shm_queue(std::size_t slot_size, std::size_t num_slots);
+
+    /**
+     * Open a queue from a file descriptor returned by @ref get_fd (possibly in
+     * another process). The descriptor is duplicated, so the caller retains
+     * ownership of @a fd.
+     */
+    explicit shm_queue(int fd);
+
+    ~shm_queue();
+
+    shm_queue(const shm_queue &) = delete;
+    shm_queue &operator=(const shm_queue &) = delete;
+
+    /// File descriptor of the shared memory segment
+    int get_fd() const { return fd; }
+    /// Maximum packet size
+    std::size_t get_slot_size() const { return slot_size; }
+    /// Capacity of the queue, in packets
+    std::size_t get_num_slots() const { return num_slots; }
+
+    /**
+     * @name Producer interface
+     * These functions must only be used by a single sender.
+     */
+    ///@{
+    /// Number of slots that can be filled without waiting for the consumer
+    std::size_t free_slots() const;
+    /**
+     * Get storage for the @a i-th free slot (counting from zero) and set the
+     * size of the packet it will hold. It does not become visible to the
+     * consumer until @ref commit is called.
+     */
+    std::uint8_t *get_free_slot(std::size_t i, std::size_t size);
+    /// Make the next @a n free slots visible to the consumer
+    void commit(std::size_t n);
+    /**
+     * Indicate end-of-stream to the receiver. It is an error to add any more
+     * packets after this.
+     */
+    void stop();
+    /// Whether @ref close has been called by the receiver
+    bool is_closed() const;
+    /**
+     * Whether the process recorded by @ref set_consumer no longer exists.
+     * This is false if no receiver has been recorded, or if the receiver is
+     * in a different PID namespace.
+     */
+    bool consumer_exited() const;
+    ///@}
+
+    /**
+     * @name Consumer interface
+     * These functions must only be used by a single receiver.
+     */
+    ///@{
+    /**
+     * Record the calling process as the receiver, so that a sender waiting
+     * for space can detect that it has exited without calling @ref close.
+     */
+    void set_consumer();
+    /// Number of packets ready to be read
+    std::size_t filled_slots() const;
+    /// Get the data and size of the @a i-th ready packet (counting from zero)
+    const std::uint8_t *get_filled_slot(std::size_t i, std::size_t &size) const;
+    /// Return the first @a n ready packets to the producer
+    void release(std::size_t n);
+    /// Whether @ref stop has been called by the sender
+    bool is_stopped() const;
+    /**
+     * Block until there are packets, the sender has called @ref stop, or
+     * @a interrupt is set and @ref interrupt_consumer is called.
+     */
+    void wait_for_data(const std::atomic<bool> &interrupt);
+    /// Wake a consumer blocked in @ref wait_for_data
+    void interrupt_consumer();
+    /// Indicate that no more packets will be read
+    void close();
+    ///@}
+};
+
+} // namespace spead2
+
+#endif // SPEAD2_USE_SHM
+#endif // SPEAD2_COMMON_SHM_H
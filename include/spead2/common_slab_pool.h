@@ -0,0 +1,132 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_COMMON_SLAB_POOL_H
+#define SPEAD2_COMMON_SLAB_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <boost/optional.hpp>
+#include <spead2/common_thread_pool.h>
+#include <spead2/common_memory_allocator.h>
+#include <spead2/common_memory_pool.h>
+
+namespace spead2
+{
+
+/**
+ * Memory allocator that pools memory in several size classes. Each class
+ * behaves like a @ref memory_pool with its own free list, limits and
+ * (optional) background refilling, and serves allocations larger than the
+ * next-smaller class and no larger than its own size. Allocations larger
+ * than the largest class are passed directly to the underlying allocator.
+ *
+ * This is useful when a stream carries heaps of very different sizes (for
+ * example, small metadata heaps interleaved with large data heaps), where a
+ * single @ref memory_pool would either waste memory or not be used at all.
+ *
+ * Like @ref memory_pool, it must be managed by a std::shared_ptr, and memory
+ * may safely outlive the pool.
+ */
+class slab_pool : public memory_allocator
+{
+public:
+    /// Parameters for one size class
+    struct size_class
+    {
+        /// Size of the buffers in this class
+        std::size_t size;
+        /// Maximum number of free buffers to retain
+        std::size_t max_free;
+        /// Number of buffers to allocate up front
+        std::size_t initial;
+        /**
+         * When fewer than this many free buffers remain, refill the class up
+         * to @ref initial in the background (requires a thread pool).
+         */
+        std::size_t low_water;
+
+        size_class(std::size_t size, std::size_t max_free, std::size_t initial,
+                   std::size_t low_water = 0);
+    };
+
+private:
+    const std::vector<size_class> classes;
+    const std::shared_ptr<memory_allocator> base_allocator;
+    std::vector<std::shared_ptr<memory_pool>> pools;
+    /// Allocations too large for any class
+    std::atomic<std::uint64_t> misses{0};
+
+    slab_pool(boost::optional<io_service_ref> io_service, std::vector<size_class> classes,
+              std::shared_ptr<memory_allocator> allocator);
+
+public:
+    /**
+     * Construct without background refilling.
+     *
+     * @throw std::invalid_argument if the class sizes are not strictly
+     * increasing, if a class has more initial than maximum free buffers, or
+     * if any class has a non-zero low water mark.
+     */
+    explicit slab_pool(std::vector<size_class> classes,
+                       std::shared_ptr<memory_allocator> allocator = nullptr);
+
+    /**
+     * Construct with background refilling, which runs on @a io_service.
+     *
+     * @throw std::invalid_argument if the class sizes are not strictly
+     * increasing, or if a class has more initial than maximum free buffers or
+     * a low water mark greater than the initial number of buffers.
+     */
+    slab_pool(io_service_ref io_service, std::vector<size_class> classes,
+              std::shared_ptr<memory_allocator> allocator = nullptr);
+
+    /**
+     * Generate size classes with power-of-two sizes, starting from the
+     * smallest power of two that is at least @a min_size and ending with the
+     * smallest that is at least @a max_size. Every class gets the same limits.
+     */
+    static std::vector<size_class> power_of_two_classes(
+        std::size_t min_size, std::size_t max_size,
+        std::size_t max_free, std::size_t initial, std::size_t low_water = 0);
+
+    const std::vector<size_class> &get_classes() const { return classes; }
+
+    bool get_warn_on_empty() const;
+    /// Set whether every size class warns when it is empty
+    void set_warn_on_empty(bool warn);
+
+    /// Get statistics for each size class
+    std::vector<memory_pool_stats> get_class_stats() const;
+    /**
+     * Get statistics summed over the size classes. Allocations larger than
+     * every class count as misses.
+     */
+    memory_pool_stats get_stats() const;
+
+    virtual pointer allocate(std::size_t size, void *hint) override;
+};
+
+} // namespace spead2
+
+#endif // SPEAD2_COMMON_SLAB_POOL_H
@@ -51,6 +51,9 @@ private:
     std::vector<std::future<void> > workers;
 
 public:
+    /// Tag type to select the NUMA-aware constructor
+    struct numa_nodes_tag {};
+
     explicit thread_pool(int num_threads = 1);
     /**
      * Construct with explicit core affinity for the threads. The @a affinity
@@ -59,6 +62,17 @@ public:
      * but do not cause an exception.
      */
     thread_pool(int num_threads, const std::vector<int> &affinity);
+    /**
+     * Construct with threads placed on NUMA nodes. Threads are allocated in
+     * round-robin fashion to the nodes in @a nodes. Each thread is bound to
+     * all the CPUs of its node (see @ref numa_node_cpus) and prefers to
+     * allocate memory from that node. Failures to set affinity or memory
+     * policy are logged but do not cause an exception.
+     *
+     * @throw std::invalid_argument if @a nodes is empty or contains a node
+     * that is not online.
+     */
+    thread_pool(int num_threads, numa_nodes_tag, const std::vector<int> &nodes);
     ~thread_pool();
 
     /// Retrieve the embedded io_service
@@ -70,6 +84,10 @@ public:
      * Set CPU affinity of current thread.
      */
     static void set_affinity(int core);
+    /**
+     * Set CPU affinity of current thread to a set of cores.
+     */
+    static void set_affinity(const std::vector<int> &cores);
 };
 
 /**
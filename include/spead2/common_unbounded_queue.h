@@ -46,7 +46,7 @@ template<typename T, typename DataSemaphore = semaphore>
 class unbounded_queue
 {
 private:
-    semaphore_fd data_sem;
+    DataSemaphore data_sem;
     std::mutex mutex;
     bool stopped = false;
     std::queue<T> data;
@@ -0,0 +1,156 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_RECV_BUSY_POLL_H
+#define SPEAD2_RECV_BUSY_POLL_H
+
+#include <cstddef>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+namespace spead2
+{
+namespace recv
+{
+
+/**
+ * Configuration for running a reader in busy-polling mode. Instead of
+ * waiting for completion handlers on the stream's @c io_service, the reader
+ * owns a thread which repeatedly makes non-blocking receive calls. This
+ * avoids the wakeup latency of the event loop at the cost of burning a CPU
+ * core.
+ *
+ * When a poll finds no data, the thread spins for up to
+ * @ref get_spin_count "spin_count" further polls, then sleeps for
+ * @ref get_sleep "sleep" between polls until data arrives again.
+ */
+class busy_poll_config
+{
+public:
+    /// Number of empty polls before sleeping, if none is explicitly set
+    static constexpr std::size_t default_spin_count = 10000;
+    /// Time to sleep between polls once idle, if none is explicitly set
+    static constexpr std::chrono::microseconds default_sleep{50};
+
+private:
+    int affinity = -1;
+    int busy_poll = 0;
+    bool prefer_busy_poll = false;
+    std::size_t spin_count = default_spin_count;
+    std::chrono::microseconds sleep = default_sleep;
+
+public:
+    /// Get the CPU core for the polling thread, or -1 if it is not pinned
+    int get_affinity() const { return affinity; }
+    /// Set the CPU core for the polling thread, or -1 to not pin it
+    busy_poll_config &set_affinity(int affinity);
+
+    /// Get the @c SO_BUSY_POLL value (in microseconds), or 0 if not set
+    int get_busy_poll() const { return busy_poll; }
+    /**
+     * Set the @c SO_BUSY_POLL socket option (in microseconds), which lets
+     * the kernel poll the device queue during receive calls. Zero leaves
+     * the system default. Raising it above the @c net.core.busy_read sysctl
+     * requires @c CAP_NET_ADMIN; failures are logged but not fatal.
+     *
+     * @throws std::invalid_argument if @a busy_poll is negative.
+     */
+    busy_poll_config &set_busy_poll(int busy_poll);
+
+    /// Get whether @c SO_PREFER_BUSY_POLL is set
+    bool get_prefer_busy_poll() const { return prefer_busy_poll; }
+    /**
+     * Set the @c SO_PREFER_BUSY_POLL socket option, which (together with
+     * interrupt deferral on the device) keeps the kernel from processing
+     * the queue in softirq context while the application is polling.
+     */
+    busy_poll_config &set_prefer_busy_poll(bool prefer_busy_poll);
+
+    /// Get the number of empty polls before sleeping
+    std::size_t get_spin_count() const { return spin_count; }
+    /// Set the number of empty polls before sleeping
+    busy_poll_config &set_spin_count(std::size_t spin_count);
+
+    /// Get the time to sleep between polls once idle
+    std::chrono::microseconds get_sleep() const { return sleep; }
+    /**
+     * Set the time to sleep between polls once idle. This also bounds the
+     * time for the reader to notice that the stream has been stopped.
+     *
+     * @throws std::invalid_argument if @a sleep is negative.
+     */
+    busy_poll_config &set_sleep(std::chrono::microseconds sleep);
+};
+
+namespace detail
+{
+
+/**
+ * Thread used by readers in busy-polling mode. The reader supplies a
+ * function that makes a single non-blocking attempt to receive data, and a
+ * function to run when polling ends (which must close the reader's
+ * descriptors and call @ref reader::stopped).
+ *
+ * Since the thread may be inside a receive call at any time, the reader's
+ * @ref reader::stop must only call @ref stop on this object rather than
+ * closing descriptors itself.
+ */
+class busy_poller
+{
+public:
+    enum class status
+    {
+        IDLE,       ///< No data was available
+        PROGRESS,   ///< Some data was processed
+        DONE        ///< The reader has reached the end of its input
+    };
+
+private:
+    const busy_poll_config config;
+    std::atomic<bool> stop_requested{false};
+    std::thread thread;
+
+    void run(std::function<status()> poll, std::function<void()> finish);
+
+public:
+    explicit busy_poller(const busy_poll_config &config);
+    /// Joins the thread
+    ~busy_poller();
+
+    const busy_poll_config &get_config() const { return config; }
+
+    /// Start the thread. This must be called at most once.
+    void start(std::function<status()> poll, std::function<void()> finish);
+
+    /// Ask the thread to finish. It does not wait for it to do so.
+    void stop();
+
+    /// Apply the socket options from the config to a socket, logging failures
+    void apply_socket_options(int fd) const;
+};
+
+} // namespace detail
+
+} // namespace recv
+} // namespace spead2
+
+#endif // SPEAD2_RECV_BUSY_POLL_H
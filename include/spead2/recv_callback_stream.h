@@ -0,0 +1,155 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_RECV_CALLBACK_STREAM_H
+#define SPEAD2_RECV_CALLBACK_STREAM_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_live_heap.h>
+#include <spead2/recv_heap.h>
+#include <spead2/recv_stream.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+/**
+ * Callback that receives each heap as a @ref live_heap. See
+ * @ref callback_stream_config::set_live_heap_callback.
+ */
+typedef std::function<void(live_heap &&, std::uint64_t *batch_stats)> live_heap_callback_function;
+
+/**
+ * Callback that receives each heap after freezing it. See
+ * @ref callback_stream_config::set_heap_callback.
+ */
+typedef std::function<void(heap &&, std::uint64_t *batch_stats)> heap_callback_function;
+
+/**
+ * Callback that receives the heaps from a batch of packets. See
+ * @ref callback_stream_config::set_batch_callback.
+ */
+typedef std::function<void(std::vector<live_heap> &heaps, std::uint64_t *batch_stats)> heap_batch_callback_function;
+
+/**
+ * Parameters for configuring @ref callback_stream. Exactly one of the
+ * callbacks must be set.
+ */
+class callback_stream_config
+{
+private:
+    live_heap_callback_function live_heap_callback;
+    heap_callback_function heap_callback;
+    heap_batch_callback_function batch_callback;
+    bool contiguous_only = true;
+
+public:
+    /**
+     * Set a function that is called with each heap as soon as it is ejected
+     * from the stream.
+     */
+    callback_stream_config &set_live_heap_callback(live_heap_callback_function callback);
+    /// Get the function set with @ref set_live_heap_callback
+    const live_heap_callback_function &get_live_heap_callback() const { return live_heap_callback; }
+
+    /**
+     * Set a function that is called with each heap as soon as it is ejected
+     * from the stream, after it has been frozen. This requires
+     * @ref set_contiguous_only to be true, since incomplete heaps cannot be
+     * frozen.
+     */
+    callback_stream_config &set_heap_callback(heap_callback_function callback);
+    /// Get the function set with @ref set_heap_callback
+    const heap_callback_function &get_heap_callback() const { return heap_callback; }
+
+    /**
+     * Set a function that is called once for each batch of packets taken
+     * from a reader, with all the heaps that the batch completed or evicted
+     * (it is not called if there are none). The function may move heaps out
+     * of the vector; the vector is cleared afterwards. If the function
+     * throws, the exception is logged and the heaps are discarded.
+     */
+    callback_stream_config &set_batch_callback(heap_batch_callback_function callback);
+    /// Get the function set with @ref set_batch_callback
+    const heap_batch_callback_function &get_batch_callback() const { return batch_callback; }
+
+    /// Set whether only contiguous heaps are passed to the callback
+    callback_stream_config &set_contiguous_only(bool contiguous_only);
+    /// Get whether only contiguous heaps are passed to the callback
+    bool get_contiguous_only() const { return contiguous_only; }
+};
+
+/**
+ * Stream that passes heaps directly to a user-provided callback, avoiding
+ * the ringbuffer and thread hand-off of @ref ring_stream.
+ *
+ * The callback is called on the thread running the reader (or the thread
+ * that calls @ref stop), while the stream's internal lock is held. It
+ * should thus return promptly, since it holds up the reader, and must not
+ * call back into the stream (e.g. to stop it). Dropped incomplete heaps are
+ * logged, and other heaps are passed to the callback.
+ *
+ * The @a batch_stats argument to the callback provides access to the custom
+ * statistics of the stream (see @ref stream_base::batch_stats).
+ */
+class callback_stream : public stream
+{
+private:
+    const callback_stream_config callback_config;
+    /**
+     * Heaps collected for the batch callback. It is reused between batches,
+     * but grows if a batch completes more heaps than its capacity.
+     */
+    std::vector<live_heap> batch;
+
+    virtual void heap_ready(live_heap &&) override;
+    virtual void batch_ready() override;
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param io_service       I/O service (also used by the readers).
+     * @param config           Stream configuration
+     * @param callback_config  Callback configuration
+     *
+     * @throw std::invalid_argument if not exactly one callback is set in
+     * @a callback_config, or if a heap callback is set without
+     * @ref callback_stream_config::set_contiguous_only.
+     */
+    callback_stream(
+        io_service_ref io_service,
+        const stream_config &config,
+        const callback_stream_config &callback_config);
+
+    virtual ~callback_stream() override;
+
+    /// Get the callback configuration passed to the constructor
+    const callback_stream_config &get_callback_config() const { return callback_config; }
+};
+
+} // namespace recv
+} // namespace spead2
+
+#endif // SPEAD2_RECV_CALLBACK_STREAM_H
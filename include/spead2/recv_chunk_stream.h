@@ -27,6 +27,7 @@
 #include <cstdint>
 #include <cstddef>
 #include <utility>
+#include <chrono>
 #include <spead2/common_defines.h>
 #include <spead2/common_memory_allocator.h>
 #include <spead2/common_ringbuffer.h>
@@ -52,6 +53,13 @@ public:
     std::size_t present_size = 0;
     /// Chunk payload
     memory_allocator::pointer data;
+    /**
+     * Earliest receive timestamp of the complete heaps in the chunk, or the
+     * epoch if there are none or the reader does not provide timestamps.
+     */
+    std::chrono::system_clock::time_point first_timestamp;
+    /// Latest receive timestamp of the complete heaps in the chunk (see @ref first_timestamp)
+    std::chrono::system_clock::time_point last_timestamp;
 
     chunk() = default;
     // These need to be explicitly declared, because there is an explicit destructor.
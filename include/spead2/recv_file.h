@@ -0,0 +1,162 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_RECV_FILE_H
+#define SPEAD2_RECV_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <spead2/common_memory_allocator.h>
+#include <spead2/recv_reader.h>
+#include <spead2/recv_stream.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+/**
+ * View of a whole file, mapped into memory.
+ *
+ * The mapping is private and writable, so that heaps referencing it (see
+ * @ref file_mapping_allocator) can be modified without affecting the file.
+ */
+class file_mapping
+{
+private:
+    std::uint8_t *data = nullptr;
+    std::size_t size = 0;
+
+public:
+    /**
+     * Map a file.
+     *
+     * @throw std::system_error if the file cannot be opened or mapped
+     */
+    explicit file_mapping(const std::string &filename);
+    ~file_mapping();
+
+    file_mapping(const file_mapping &) = delete;
+    file_mapping &operator=(const file_mapping &) = delete;
+
+    /// Start of the mapping (null if the file is empty)
+    const std::uint8_t *get_data() const { return data; }
+    /// Size of the file
+    std::size_t get_size() const { return size; }
+    /// Whether [@a ptr, @a ptr + @a length) lies within the mapping
+    bool contains(const std::uint8_t *ptr, std::size_t length) const;
+};
+
+/**
+ * Allocator that, for heaps contained in a single packet of a
+ * @ref file_mapping, returns a pointer to the payload in the mapping instead
+ * of allocating memory, so that the payload does not need to be copied. Other
+ * heaps are allocated with a fallback allocator.
+ *
+ * The payloads are only valid as long as the mapping, so each such heap holds
+ * a reference to it. This is normally used through
+ * @ref file_mapping_zero_copy rather than directly.
+ */
+class file_mapping_allocator : public memory_allocator
+{
+private:
+    std::shared_ptr<const file_mapping> mapping;
+    std::shared_ptr<memory_allocator> fallback;
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param mapping   File mapping from which packets are read
+     * @param fallback  Allocator for heaps that span several packets (if
+     *                  null, a default-constructed @ref memory_allocator)
+     */
+    file_mapping_allocator(
+        std::shared_ptr<const file_mapping> mapping,
+        std::shared_ptr<memory_allocator> fallback = nullptr);
+
+    virtual pointer allocate(std::size_t size, void *hint) override;
+};
+
+/**
+ * Modify a stream configuration so that the payloads of single-packet heaps
+ * read from @a mapping reference the mapping rather than being copied. It
+ * installs a @ref file_mapping_allocator (falling back to the allocator
+ * already in @a config) and wraps the memcpy function in @a config to skip
+ * payloads that are already in place.
+ *
+ * This should be used with @ref file_reader constructed from the same
+ * mapping. Heaps from other readers are unaffected.
+ */
+void file_mapping_zero_copy(stream_config &config, std::shared_ptr<const file_mapping> mapping);
+
+/**
+ * Reader that feeds a file containing a raw SPEAD byte stream (as written by
+ * @ref send::streambuf_stream or @ref send::file_stream) to a stream.
+ *
+ * The file is memory-mapped, with the kernel advised that it will be read
+ * sequentially and asked to read ahead of the current position, and packets
+ * are passed to the stream in batches. Reading stops at the end of the file,
+ * or at the first malformed or truncated packet.
+ */
+class file_reader : public reader
+{
+private:
+    /// Maximum number of packets to process in one handler
+    static constexpr int max_batch = 64;
+    /// Amount of data to request the kernel to read ahead
+    static constexpr std::size_t readahead_size = 64 * 1024 * 1024;
+
+    std::shared_ptr<const file_mapping> mapping;
+    /// Position of the next packet
+    std::size_t offset = 0;
+    /// Position up to which read-ahead has been requested
+    std::size_t readahead = 0;
+
+    void run();
+    void advise(std::size_t end);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param owner     Owning stream
+     * @param filename  File to read
+     *
+     * @throw std::system_error if the file cannot be opened or mapped
+     */
+    file_reader(stream &owner, const std::string &filename);
+
+    /**
+     * Constructor, for a file that has already been mapped (for example, to
+     * use @ref file_mapping_zero_copy).
+     */
+    file_reader(stream &owner, std::shared_ptr<const file_mapping> mapping);
+
+    virtual void stop() override {}
+    virtual bool lossy() const override;
+};
+
+} // namespace recv
+} // namespace spead2
+
+#endif // SPEAD2_RECV_FILE_H
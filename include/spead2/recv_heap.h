@@ -26,6 +26,7 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <chrono>
 #include <spead2/common_defines.h>
 #include <spead2/common_flavour.h>
 #include <spead2/common_memory_allocator.h>
@@ -71,13 +72,14 @@ private:
     /**
      * Storage for immediate values. If the number of items is small enough,
      * they are stored in the object itself, avoiding the cost of a malloc.
-     * Otherwise they are stored in dynamically allocated memory. It is not
-     * necessary to store an indicator of which storage is used because the
-     * storage is accessed via the items.
+     * Otherwise they are stored in dynamically allocated memory (and
+     * @ref immediate_payload is non-empty).
      */
     std::uint8_t immediate_payload_inline[24];   // 4 items in SPEAD-64-48
-    std::unique_ptr<std::uint8_t[]> immediate_payload;
+    std::vector<std::uint8_t> immediate_payload;
     /**@}*/
+    /// Receive timestamps (see @ref live_heap)
+    std::chrono::system_clock::time_point first_timestamp, last_timestamp;
 
     /* Copy inline immediate items and fix up pointers to it */
     void transfer_immediates(heap_base &&other) noexcept;
@@ -95,6 +97,7 @@ public:
     heap_base() = default;
     heap_base(heap_base &&other) noexcept;
     heap_base &operator=(heap_base &&other) noexcept;
+    ~heap_base();
 
     /// Get heap ID
     s_item_pointer_t get_cnt() const { return cnt; }
@@ -106,6 +109,17 @@ public:
      */
     const std::vector<item> &get_items() const { return items; }
 
+    /**
+     * Get the time at which the kernel received the first packet of the
+     * heap, or the epoch if the reader did not provide timestamps.
+     */
+    std::chrono::system_clock::time_point get_first_timestamp() const { return first_timestamp; }
+    /**
+     * Get the time at which the kernel received the last packet of the
+     * heap, or the epoch if the reader did not provide timestamps.
+     */
+    std::chrono::system_clock::time_point get_last_timestamp() const { return last_timestamp; }
+
     /**
      * Convenience function to check whether any of the items is
      * a @c STREAM_CTRL_ID item with value @a value.
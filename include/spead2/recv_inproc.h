@@ -22,10 +22,12 @@
 #define SPEAD2_RECV_INPROC_H
 
 #include <memory>
+#include <vector>
 #include <boost/asio.hpp>
 #include <spead2/common_inproc.h>
 #include <spead2/recv_reader.h>
 #include <spead2/recv_stream.h>
+#include <spead2/recv_busy_poll.h>
 
 namespace spead2
 {
@@ -40,18 +42,39 @@ class inproc_reader : public reader
 private:
     std::shared_ptr<inproc_queue> queue;
     boost::asio::posix::stream_descriptor data_sem_wrapper;
+    /// Polling thread, if in busy-polling mode (must be destroyed first)
+    std::unique_ptr<detail::busy_poller> poller;
 
     void process_one_packet(stream_base::add_packet_state &state,
                             const inproc_queue::packet &packet);
+    /// Process a batch of packets, then return their storage to the queue
+    void process_packets(stream_base::add_packet_state &state,
+                         std::vector<inproc_queue::packet> &&packets);
     void packet_handler(const boost::system::error_code &error, std::size_t bytes_received);
     void enqueue();
 
+    /// Make a single non-blocking receive attempt from the polling thread
+    detail::busy_poller::status poll_busy();
+    /// Called by the polling thread when it ends
+    void finish_busy();
+
 public:
     /// Constructor.
     inproc_reader(
         stream &owner,
         std::shared_ptr<inproc_queue> queue);
 
+    /**
+     * Constructor for busy-polling mode. Instead of using the stream's
+     * @c io_service, the reader polls the queue on its own thread, as
+     * described by @a busy_config. Socket options in @a busy_config are
+     * ignored.
+     */
+    inproc_reader(
+        stream &owner,
+        std::shared_ptr<inproc_queue> queue,
+        const busy_poll_config &busy_config);
+
     virtual void stop() override;
     virtual bool lossy() const override;
 };
@@ -147,6 +147,16 @@ private:
      */
     std::map<s_item_pointer_t, s_item_pointer_t> payload_ranges;
 
+    /**
+     * @name Receive timestamps
+     * @{
+     * Timestamps of the first and last accepted packets that carried one,
+     * or the epoch if none did.
+     */
+    std::chrono::system_clock::time_point first_timestamp;
+    std::chrono::system_clock::time_point last_timestamp;
+    /** @} */
+
     /**
      * Make sure at least @a size bytes are allocated for payload. If
      * @a exact is false, then a doubling heuristic will be used.
@@ -206,6 +216,10 @@ public:
     s_item_pointer_t get_received_length() const;
     /// Get amount of payload expected, or -1 if not known
     s_item_pointer_t get_heap_length() const;
+    /// Get the receive timestamp of the first packet, or the epoch if not known
+    std::chrono::system_clock::time_point get_first_timestamp() const { return first_timestamp; }
+    /// Get the receive timestamp of the last packet, or the epoch if not known
+    std::chrono::system_clock::time_point get_last_timestamp() const { return last_timestamp; }
     /// Get first stored item pointer
     item_pointer_t *pointers_begin();
     /// Get last stored item pointer
@@ -23,6 +23,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <chrono>
 #include <spead2/common_defines.h>
 
 namespace spead2
@@ -56,6 +57,12 @@ struct packet_header
     const std::uint8_t *payload;
     /// The original packet
     const std::uint8_t *packet;
+    /**
+     * Time at which the kernel received the packet, or the epoch if it is not
+     * known. This is not set by @ref decode_packet; readers that support
+     * timestamps fill it in afterwards.
+     */
+    std::chrono::system_clock::time_point timestamp;
 };
 
 /**
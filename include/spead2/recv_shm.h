@@ -0,0 +1,83 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_RECV_SHM_H
+#define SPEAD2_RECV_SHM_H
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_SHM
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <spead2/common_shm.h>
+#include <spead2/recv_reader.h>
+#include <spead2/recv_stream.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+/**
+ * Stream reader that receives packets from an @ref shm_queue, which may be
+ * fed by another process.
+ *
+ * Since the queue cannot signal the stream's @c io_service, the reader
+ * receives on its own thread, which sleeps on the queue when it is empty.
+ * When the reader stops, it closes the queue, so that the sender gets errors
+ * rather than waiting for space indefinitely.
+ */
+class shm_reader : public reader
+{
+private:
+    static constexpr std::size_t max_batch = 64;
+
+    std::shared_ptr<shm_queue> queue;
+    std::atomic<bool> stop_requested{false};
+    std::thread thread;
+
+    void run(int affinity);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param owner     Owning stream
+     * @param queue     Queue to receive from
+     * @param affinity  CPU core for the receive thread, or -1 to not pin it
+     */
+    shm_reader(
+        stream &owner,
+        std::shared_ptr<shm_queue> queue,
+        int affinity = -1);
+
+    /// Joins the receive thread
+    virtual ~shm_reader() override;
+
+    virtual void stop() override;
+    virtual bool lossy() const override;
+};
+
+} // namespace recv
+} // namespace spead2
+
+#endif // SPEAD2_USE_SHM
+#endif // SPEAD2_RECV_SHM_H
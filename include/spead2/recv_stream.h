@@ -104,7 +104,8 @@ static constexpr std::size_t max_batch = 5;
 static constexpr std::size_t single_packet_heaps = 6;
 static constexpr std::size_t search_dist = 7;
 static constexpr std::size_t worker_blocked = 8;
-static constexpr std::size_t custom = 9;  ///< Index for first user-defined statistic
+static constexpr std::size_t reassembly_time_ns = 9;
+static constexpr std::size_t custom = 10;  ///< Index for first user-defined statistic
 
 } // namespace stream_stat_indices
 
@@ -440,6 +441,24 @@ public:
         std::string name,
         stream_stat_config::mode mode = stream_stat_config::mode::COUNTER);
 
+    /**
+     * Add statistics (with names starting <code>memory_pool_</code>) that
+     * report on the memory allocator, if it is a @ref memory_pool or
+     * @ref slab_pool (see @ref memory_pool_stats). They are sampled from the
+     * allocator when the stream statistics are retrieved, so they describe
+     * the whole allocator even if it is shared with other streams.
+     *
+     * The levels (<code>memory_pool_free</code>,
+     * <code>memory_pool_free_high_water</code> and
+     * <code>memory_pool_bytes_outstanding</code>) are merged by taking the
+     * maximum. The others are counters, which are summed when statistics
+     * are merged, so statistics of streams that share an allocator should
+     * not be merged.
+     *
+     * @throw std::invalid_argument if they have already been added.
+     */
+    stream_config &add_memory_pool_stats();
+
     /// Get the stream statistics (including the core ones)
     const std::vector<stream_stat_config> &get_stats() const { return *stats; }
 
@@ -559,6 +578,8 @@ private:
 
     /// Stream configuration
     const stream_config config;
+    /// Index of the first memory pool statistic, or the number of statistics if not present
+    const std::size_t memory_pool_stats_index;
 
 protected:
     /**
@@ -601,6 +622,18 @@ private:
      */
     virtual void heap_ready(live_heap &&) {}
 
+    /**
+     * Callback called at the end of each batch of packets (see
+     * @ref add_packet_state) and at the end of @ref flush, once all the
+     * heaps ejected by it have been passed to @ref heap_ready. The @ref
+     * queue_mutex will be locked during this call. Since it may be called
+     * from a destructor, any exception it throws is logged and discarded.
+     */
+    virtual void batch_ready() {}
+
+    /// Call @ref batch_ready, logging rather than propagating exceptions
+    void call_batch_ready() noexcept;
+
     /// Implementation of @ref flush that assumes the caller has locked @ref queue_mutex
     void flush_unlocked();
 
@@ -653,6 +686,7 @@ public:
         std::uint64_t incomplete_heaps_evicted = 0;
         std::uint64_t single_packet_heaps = 0;
         std::uint64_t search_dist = 0;
+        std::uint64_t reassembly_time_ns = 0;
 
         explicit add_packet_state(stream_base &owner);
         ~add_packet_state();
@@ -669,6 +703,11 @@ public:
          * It is an error to call this after the stream has been stopped.
          */
         bool add_packet(const packet_header &packet) { return owner.add_packet(*this, packet); }
+        /**
+         * Get the staging area for custom statistics (see
+         * @ref stream_base::batch_stats), so that readers can update them.
+         */
+        std::uint64_t *get_batch_stats() const { return owner.batch_stats.data(); }
     };
 
     /**
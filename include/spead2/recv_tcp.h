@@ -28,30 +28,48 @@
 
 #include <spead2/common_features.h>
 #include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
 #include <boost/asio.hpp>
 #include <spead2/recv_reader.h>
 #include <spead2/recv_stream.h>
 #include <spead2/recv_udp_base.h>
+#include <spead2/recv_busy_poll.h>
+#include <spead2/common_mirrored_buffer.h>
 
 namespace spead2
 {
 namespace recv
 {
 
+namespace detail
+{
+
 /**
- * Asynchronous stream reader that receives packets over TCP.
+ * Splits the byte stream of a TCP connection into SPEAD packets, using the
+ * SPEAD header of each packet to determine its length.
+ *
+ * Where possible the data is received into a @ref mirrored_buffer used as a
+ * ring, so that a packet that wraps around the end of the ring can still be
+ * decoded in place. Otherwise, a linear buffer is used and unconsumed data is
+ * moved back to the start when the head passes the middle.
  */
-class tcp_reader : public reader
+class tcp_framer
 {
 private:
-    /// The acceptor object
-    boost::asio::ip::tcp::acceptor acceptor;
-    /// TCP peer socket (i.e., the one connected to the remote end)
-    boost::asio::ip::tcp::socket peer;
     /// Maximum packet size we will accept. Needed mostly for the underlying packet deserialization logic
     std::size_t max_size;
-    /// Buffer for packet data reception
+#if SPEAD2_USE_MEMFD
+    /// Ring buffer for packet data reception, if mirroring is in use
+    std::unique_ptr<mirrored_buffer> mirror;
+#endif
+    /// Buffer for packet data reception, if mirroring is not in use
     std::unique_ptr<std::uint8_t[]> buffer;
+    /// Start of the buffer
+    std::uint8_t *base;
+    /// Size of the buffer (for a ring, excluding the mirror)
+    std::size_t capacity;
     /// The head of the buffer, data is available from this point up to the tail
     std::uint8_t *head;
     /// The tail of the buffer, after this there is no more data
@@ -60,12 +78,67 @@ private:
     std::size_t pkt_size = 0;
     /// Number of bytes that need to be skipped (used when pkt_size > max_size)
     std::size_t to_skip = 0;
-    /// Number of packets to hold on each buffer for asynchronous receive
+
+    /// Parses the size of the next packet to read from the stream, returns true if more data needs to be read to parse the packet size correctly
+    bool parse_packet_size();
+
+    /// Parses the next packet out of the stream, returns false if the contents of the current stream are not enough
+    bool parse_packet(stream_base::add_packet_state &state);
+
+    /// Ignores bytes from the stream according to @a to_skip, returns true if more data needs to be read and skipped
+    bool skip_bytes();
+
+public:
+    /// Number of packets to hold on each buffer for asynchronous receive, if no size is given
     static constexpr std::size_t pkts_per_buffer = 64;
 
+    /**
+     * Constructor.
+     *
+     * @param max_size     Maximum packet size that will be accepted
+     * @param ring_size    Size of the receive buffer, or 0 for
+     *                     @a max_size * @ref pkts_per_buffer. It is
+     *                     increased if necessary to hold at least two packets.
+     * @param mirror       If false, do not use a @ref mirrored_buffer even
+     *                     if available (mainly for benchmarking)
+     */
+    explicit tcp_framer(std::size_t max_size, std::size_t ring_size = 0, bool mirror = true);
+
+    /// Whether the buffer is a mirrored ring
+    bool is_mirrored() const;
+
+    /// Make room in the buffer and return the free space after the tail
+    boost::asio::mutable_buffer prepare_receive();
+
+    /// Processes the content of the buffer, returns true if more reading needs to be enqueued
+    bool process_buffer(stream_base::add_packet_state &state, const std::size_t bytes_recv);
+};
+
+} // namespace detail
+
+/**
+ * Asynchronous stream reader that receives packets over TCP.
+ */
+class tcp_reader : public reader
+{
+private:
+    /// The acceptor object
+    boost::asio::ip::tcp::acceptor acceptor;
+    /// TCP peer socket (i.e., the one connected to the remote end)
+    boost::asio::ip::tcp::socket peer;
+    /// Splits the received data into packets
+    detail::tcp_framer framer;
+    /// Polling thread, if in busy-polling mode (must be destroyed first)
+    std::unique_ptr<detail::busy_poller> poller;
+
     /// Start an asynchronous receive
     void enqueue_receive();
 
+    /// Make a single non-blocking accept or receive attempt from the polling thread
+    detail::busy_poller::status poll_busy();
+    /// Called by the polling thread when it ends
+    void finish_busy();
+
     /// Callback on completion of asynchronous accept
     void accept_handler(
         const boost::system::error_code &error);
@@ -75,18 +148,6 @@ private:
         const boost::system::error_code &error,
         std::size_t bytes_transferred);
 
-    /// Processes the content of the buffer, returns true if more reading needs to be enqueued
-    bool process_buffer(stream_base::add_packet_state &state, const std::size_t bytes_recv);
-
-    /// Parses the size of the next packet to read from the stream, returns true if more data needs to be read to parse the packet size correctly
-    bool parse_packet_size();
-
-    /// Parses the next packet out of the stream, returns false if the contents of the current stream are not enough
-    bool parse_packet(stream_base::add_packet_state &state);
-
-    /// Ignores bytes from the stream according to @a to_skip, returns true if more data needs to be read and skipped
-    bool skip_bytes();
-
     /**
      * Base constructor, used by the other constructors.
      *
@@ -96,12 +157,17 @@ private:
      * @param buffer_size  Requested socket buffer size. Note that the
      *                     operating system might not allow a buffer size
      *                     as big as the default.
+     * @param ring_size    Size of the buffer into which data is received
+     *                     (0 for the default)
+     * @param poller       Polling thread for busy-polling mode, or null
      */
     tcp_reader(
         stream &owner,
         boost::asio::ip::tcp::acceptor &&acceptor,
         std::size_t max_size,
-        std::size_t buffer_size);
+        std::size_t buffer_size,
+        std::size_t ring_size,
+        std::unique_ptr<detail::busy_poller> &&poller);
 
 
 public:
@@ -119,12 +185,17 @@ public:
      * @param buffer_size  Requested socket buffer size. Note that the
      *                     operating system might not allow a buffer size
      *                     as big as the default.
+     * @param ring_size    Size of the buffer into which data is received. A
+     *                     larger buffer allows each system call to return
+     *                     more data. The default (0) holds 64
+     *                     maximum-sized packets.
      */
     tcp_reader(
         stream &owner,
         const boost::asio::ip::tcp::endpoint &endpoint,
         std::size_t max_size = default_max_size,
-        std::size_t buffer_size = default_buffer_size);
+        std::size_t buffer_size = default_buffer_size,
+        std::size_t ring_size = 0);
 
     /**
      * Constructor using an existing acceptor object. This allows acceptor objects
@@ -134,11 +205,53 @@ public:
      * @param owner        Owning stream
      * @param acceptor     Acceptor object, must be bound
      * @param max_size     Maximum packet size that will be accepted.
+     * @param ring_size    Size of the buffer into which data is received
+     *                     (0 for the default)
+     */
+    tcp_reader(
+        stream &owner,
+        boost::asio::ip::tcp::acceptor &&acceptor,
+        std::size_t max_size = default_max_size,
+        std::size_t ring_size = 0);
+
+    /**
+     * Constructor for busy-polling mode. Instead of using the stream's
+     * @c io_service, the reader accepts the connection and receives data on
+     * its own thread, as described by @a busy_config.
+     *
+     * @param owner        Owning stream
+     * @param endpoint     Address on which to listen
+     * @param max_size     Maximum packet size that will be accepted.
+     * @param buffer_size  Requested socket buffer size.
+     * @param busy_config  Options for the polling thread
+     * @param ring_size    Size of the buffer into which data is received
+     *                     (0 for the default)
+     */
+    tcp_reader(
+        stream &owner,
+        const boost::asio::ip::tcp::endpoint &endpoint,
+        std::size_t max_size,
+        std::size_t buffer_size,
+        const busy_poll_config &busy_config,
+        std::size_t ring_size = 0);
+
+    /**
+     * Constructor for busy-polling mode using an existing acceptor object,
+     * which must already be bound.
+     *
+     * @param owner        Owning stream
+     * @param acceptor     Acceptor object, must be bound
+     * @param max_size     Maximum packet size that will be accepted.
+     * @param busy_config  Options for the polling thread
+     * @param ring_size    Size of the buffer into which data is received
+     *                     (0 for the default)
      */
     tcp_reader(
         stream &owner,
         boost::asio::ip::tcp::acceptor &&acceptor,
-        std::size_t max_size = default_max_size);
+        std::size_t max_size,
+        const busy_poll_config &busy_config,
+        std::size_t ring_size = 0);
 
     virtual void stop() override;
 
@@ -146,6 +259,172 @@ public:
 
 };
 
+/**
+ * Configuration for @ref tcp_multi_reader.
+ */
+class tcp_multi_config
+{
+public:
+    /// Value of @ref get_connection_stats indicating that no statistics are kept
+    static constexpr std::size_t no_connection_stats = std::size_t(-1);
+
+private:
+    std::size_t max_size = tcp_reader::default_max_size;
+    std::size_t buffer_size = tcp_reader::default_buffer_size;
+    std::size_t ring_size = 0;
+    std::size_t max_connections = 0;
+    bool stop_on_eof = false;
+    std::size_t connection_stats = no_connection_stats;
+
+public:
+    /// Get maximum packet size to accept
+    std::size_t get_max_size() const { return max_size; }
+    /// Set maximum packet size to accept
+    tcp_multi_config &set_max_size(std::size_t max_size);
+
+    /// Get the requested socket buffer size
+    std::size_t get_buffer_size() const { return buffer_size; }
+    /**
+     * Set the requested socket buffer size. Note that the operating system
+     * might not allow a buffer size as big as the default.
+     */
+    tcp_multi_config &set_buffer_size(std::size_t buffer_size);
+
+    /// Get the size of the buffer into which each connection receives data
+    std::size_t get_ring_size() const { return ring_size; }
+    /**
+     * Set the size of the buffer into which each connection receives data
+     * (see the corresponding @ref tcp_reader constructor argument). Zero
+     * selects the default.
+     */
+    tcp_multi_config &set_ring_size(std::size_t ring_size);
+
+    /// Get the maximum number of simultaneous connections (0 for unlimited)
+    std::size_t get_max_connections() const { return max_connections; }
+    /**
+     * Set the maximum number of simultaneous connections. While this many
+     * connections are open, further connection attempts are left in the
+     * listen backlog until a connection closes. Zero means unlimited.
+     */
+    tcp_multi_config &set_max_connections(std::size_t max_connections);
+
+    /// Get whether the end of any connection stops the stream
+    bool get_stop_on_eof() const { return stop_on_eof; }
+    /**
+     * Set whether the end of any connection stops the stream. If false (the
+     * default), the reader continues to accept new connections until the
+     * stream is stopped by other means.
+     */
+    tcp_multi_config &set_stop_on_eof(bool stop_on_eof);
+
+    /// Get the index of the first per-connection statistic
+    std::size_t get_connection_stats() const { return connection_stats; }
+    /**
+     * Count the packets received on each connection in custom statistics.
+     * Each connection is assigned the lowest free slot number when it is
+     * accepted, and the packets it delivers are added to the statistic with
+     * index @a index + slot. The caller must add @ref get_max_connections
+     * consecutive counters to the @ref stream_config with
+     * @ref stream_config::add_stat, and pass the index of the first.
+     *
+     * Pass @ref no_connection_stats to disable these statistics.
+     */
+    tcp_multi_config &set_connection_stats(std::size_t index);
+};
+
+/**
+ * Asynchronous stream reader that accepts any number of TCP connections on
+ * a single listening socket, and feeds the packets from all of them into
+ * the stream. Each connection is framed independently, but packets from
+ * different connections share the stream's heap assembly, so senders should
+ * use disjoint heap counters (see @ref send::stream::set_cnt_sequence).
+ */
+class tcp_multi_reader : public reader
+{
+private:
+    struct connection
+    {
+        boost::asio::ip::tcp::socket socket;
+        detail::tcp_framer framer;
+
+        connection(boost::asio::io_service &io_service, std::size_t max_size, std::size_t ring_size);
+    };
+
+    const tcp_multi_config config;
+    /// The acceptor object
+    boost::asio::ip::tcp::acceptor acceptor;
+    /// Connection being accepted, if any
+    std::unique_ptr<connection> accepting;
+    /// Open connections, indexed by slot (null for free slots)
+    std::vector<std::unique_ptr<connection>> connections;
+    /// Number of non-null entries in @ref connections
+    std::size_t n_connections = 0;
+    /// Number of asynchronous operations that have not yet completed
+    std::size_t pending = 0;
+    /// Whether @ref stopped has been called
+    bool done = false;
+
+    /// Start an asynchronous accept, if there is room for another connection
+    void enqueue_accept();
+    /// Start an asynchronous receive on a connection
+    void enqueue_receive(std::size_t slot);
+    /// Call @ref stopped if there are no more asynchronous operations
+    void check_done();
+
+    /// Callback on completion of asynchronous accept
+    void accept_handler(const boost::system::error_code &error);
+
+    /// Callback on completion of asynchronous receive
+    void packet_handler(
+        std::size_t slot,
+        const boost::system::error_code &error,
+        std::size_t bytes_transferred);
+
+    /// Base constructor, used by the other constructors.
+    tcp_multi_reader(
+        stream &owner,
+        boost::asio::ip::tcp::acceptor &&acceptor,
+        const tcp_multi_config &config,
+        std::size_t buffer_size);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param owner        Owning stream
+     * @param endpoint     Address on which to listen
+     * @param config       Reader configuration
+     *
+     * @throws std::invalid_argument if per-connection statistics are
+     * requested without a connection limit, or the statistics are not in
+     * the stream's configuration.
+     */
+    tcp_multi_reader(
+        stream &owner,
+        const boost::asio::ip::tcp::endpoint &endpoint,
+        const tcp_multi_config &config = tcp_multi_config());
+
+    /**
+     * Constructor using an existing acceptor object, which must already be
+     * bound and listening. The buffer size in @a config is ignored.
+     *
+     * @param owner        Owning stream
+     * @param acceptor     Acceptor object, must be bound
+     * @param config       Reader configuration
+     *
+     * @throws std::invalid_argument under the same conditions as the other
+     * constructor.
+     */
+    tcp_multi_reader(
+        stream &owner,
+        boost::asio::ip::tcp::acceptor &&acceptor,
+        const tcp_multi_config &config = tcp_multi_config());
+
+    virtual void stop() override;
+
+    virtual bool lossy() const override;
+};
+
 } // namespace recv
 } // namespace spead2
 
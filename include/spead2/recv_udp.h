@@ -30,10 +30,13 @@
 # include <sys/types.h>
 #endif
 #include <cstdint>
+#include <memory>
+#include <chrono>
 #include <boost/asio.hpp>
 #include <spead2/recv_reader.h>
 #include <spead2/recv_stream.h>
 #include <spead2/recv_udp_base.h>
+#include <spead2/recv_busy_poll.h>
 
 namespace spead2
 {
@@ -59,10 +62,14 @@ private:
     std::vector<iovec> iov;
     /// recvmmsg control structures
     std::vector<mmsghdr> msgvec;
+    /// Ancillary data buffers (one per message), if timestamps are enabled
+    std::unique_ptr<std::uint8_t[]> control;
 #else
     /// Buffer for asynchronous receive, of size @a max_size + 1.
     std::unique_ptr<std::uint8_t[]> buffer;
 #endif
+    /// Polling thread, if in busy-polling mode (must be destroyed first)
+    std::unique_ptr<detail::busy_poller> poller;
 
     /// Start an asynchronous receive
     void enqueue_receive();
@@ -72,6 +79,26 @@ private:
         const boost::system::error_code &error,
         std::size_t bytes_transferred);
 
+#if SPEAD2_USE_RECVMMSG
+    /// Receive as many packets as are available without blocking, up to @ref mmsg_count
+    int receive_batch();
+    /// Process packets returned by @ref receive_batch
+    void process_batch(stream_base::add_packet_state &state, int received);
+    /// Extract the receive timestamp from the ancillary data of a message
+    static std::chrono::system_clock::time_point get_timestamp(const msghdr &msg);
+#endif
+
+    /// Make a single non-blocking receive attempt from the polling thread
+    detail::busy_poller::status poll_busy();
+    /// Called by the polling thread when it ends
+    void finish_busy();
+
+    udp_reader(
+        stream &owner,
+        boost::asio::ip::udp::socket &&socket,
+        std::size_t max_size,
+        std::unique_ptr<detail::busy_poller> &&poller);
+
 public:
     /// Socket receive buffer size, if none is explicitly passed to the constructor
     static constexpr std::size_t default_buffer_size = 8 * 1024 * 1024;
@@ -167,7 +194,52 @@ public:
         boost::asio::ip::udp::socket &&socket,
         std::size_t max_size = default_max_size);
 
+    /**
+     * Constructor for busy-polling mode. Instead of using the stream's
+     * @c io_service, the reader receives packets on its own thread, as
+     * described by @a busy_config.
+     *
+     * @param owner        Owning stream
+     * @param endpoint     Address on which to listen
+     * @param max_size     Maximum packet size that will be accepted.
+     * @param buffer_size  Requested socket buffer size.
+     * @param busy_config  Options for the polling thread
+     */
+    udp_reader(
+        stream &owner,
+        const boost::asio::ip::udp::endpoint &endpoint,
+        std::size_t max_size,
+        std::size_t buffer_size,
+        const busy_poll_config &busy_config);
+
+    /**
+     * Constructor for busy-polling mode using an existing socket. See the
+     * other constructors for details.
+     *
+     * @param owner        Owning stream
+     * @param socket       Existing socket which will be taken over. It must
+     *                     use the same I/O service as @a owner.
+     * @param max_size     Maximum packet size that will be accepted.
+     * @param busy_config  Options for the polling thread
+     */
+    udp_reader(
+        stream &owner,
+        boost::asio::ip::udp::socket &&socket,
+        std::size_t max_size,
+        const busy_poll_config &busy_config);
+
     virtual void stop() override;
+
+    /**
+     * Enable kernel receive timestamps (@c SO_TIMESTAMPNS) on a socket. If
+     * a socket with timestamps enabled is passed to the constructor, the
+     * reader records the timestamps in the heaps (see
+     * @ref heap_base::get_first_timestamp). This is only supported when
+     * spead2 is built with @c recvmmsg support.
+     *
+     * @throws std::system_error if the socket option could not be set.
+     */
+    static void enable_timestamps(boost::asio::ip::udp::socket &socket);
 };
 
 /**
@@ -201,6 +273,19 @@ struct reader_factory<udp_reader>
         stream &owner,
         boost::asio::ip::udp::socket &&socket,
         std::size_t max_size = udp_reader::default_max_size);
+
+    static std::unique_ptr<reader> make_reader(
+        stream &owner,
+        const boost::asio::ip::udp::endpoint &endpoint,
+        std::size_t max_size,
+        std::size_t buffer_size,
+        const busy_poll_config &busy_config);
+
+    static std::unique_ptr<reader> make_reader(
+        stream &owner,
+        boost::asio::ip::udp::socket &&socket,
+        std::size_t max_size,
+        const busy_poll_config &busy_config);
 };
 
 } // namespace recv
@@ -23,6 +23,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <chrono>
 #include <spead2/recv_reader.h>
 #include <spead2/recv_stream.h>
 
@@ -45,12 +46,14 @@ protected:
      * @param data      Pointer to the start of the UDP payload
      * @param length    Length of the UDP payload
      * @param max_size  Maximum expected length of the UDP payload
+     * @param timestamp Kernel receive timestamp, or the epoch if not known
      *
      * @return whether the packet caused the stream to stop
      */
     bool process_one_packet(
         stream_base::add_packet_state &state,
-        const std::uint8_t *data, std::size_t length, std::size_t max_size);
+        const std::uint8_t *data, std::size_t length, std::size_t max_size,
+        std::chrono::system_clock::time_point timestamp = std::chrono::system_clock::time_point());
 
 public:
     /// Maximum packet size, if none is explicitly passed to the constructor
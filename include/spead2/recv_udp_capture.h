@@ -0,0 +1,229 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_RECV_UDP_CAPTURE_H
+#define SPEAD2_RECV_UDP_CAPTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/asio.hpp>
+#include <spead2/common_raw_packet.h>
+#include <spead2/recv_file.h>
+#include <spead2/recv_reader.h>
+#include <spead2/recv_stream.h>
+#include <spead2/recv_udp_base.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+namespace detail
+{
+
+/**
+ * Sequential parser for a memory-mapped pcap or pcapng file. Both byte
+ * orders are supported, as are microsecond and nanosecond pcap files and
+ * arbitrary pcapng timestamp resolutions.
+ */
+class capture_file
+{
+public:
+    /// Link-layer header types that are understood
+    static constexpr std::uint32_t linktype_ethernet = 1;
+    static constexpr std::uint32_t linktype_raw = 101;
+    static constexpr std::uint32_t linktype_ipv4 = 228;
+
+    /// A single captured packet
+    struct record
+    {
+        /// Capture time, in nanoseconds since the UNIX epoch
+        std::uint64_t timestamp;
+        /// Link-layer header type
+        std::uint32_t linktype;
+        /// Captured bytes (points into the mapping)
+        std::uint8_t *data;
+        /// Number of bytes captured
+        std::uint32_t captured_length;
+        /// Length of the packet on the wire
+        std::uint32_t original_length;
+    };
+
+private:
+    /// pcapng interface description
+    struct interface
+    {
+        std::uint32_t linktype;
+        /// Timestamps are in units of 2^-exponent (if binary) or 10^-exponent seconds
+        bool binary;
+        unsigned int exponent;
+        /// Offset to add to timestamps, in seconds
+        std::int64_t offset;
+    };
+
+    std::shared_ptr<const file_mapping> mapping;
+    std::string filename;
+    bool pcapng = false;
+    bool big_endian = false;
+    /// Position of the next record or block
+    std::size_t pos = 0;
+    /// Link type and resolution of a pcap file
+    interface pcap_interface;
+    /// Interfaces in the current pcapng section
+    std::vector<interface> interfaces;
+    /// Timestamp of the previous packet, for pcapng blocks without one
+    std::uint64_t last_timestamp = 0;
+
+    template<typename T> T load(std::size_t offset) const;
+    bool next_pcap(record &out);
+    bool next_pcapng(record &out);
+    /// Parse a pcapng section header block at @ref pos; returns its total length
+    std::size_t parse_section_header(std::size_t available);
+    void parse_interface(std::size_t body, std::size_t body_length);
+    /// Log a warning about a malformed file and move to the end of it
+    bool malformed(const char *what);
+
+    static std::uint64_t to_nanoseconds(const interface &iface, std::uint64_t ts);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @throw std::system_error if the file cannot be opened or mapped
+     * @throw std::runtime_error if the file is not a pcap or pcapng file
+     */
+    explicit capture_file(const std::string &filename);
+
+    /**
+     * Retrieve the next packet. Returns false when the end of the file is
+     * reached. A warning is logged if the file is malformed or truncated,
+     * and it is treated as ending at that point.
+     */
+    bool next(record &out);
+
+    /// Read the whole file so that later accesses do not cause page faults
+    void preload() const;
+
+    const std::string &get_filename() const { return filename; }
+};
+
+/**
+ * Merges several capture files in timestamp order, with ties broken by the
+ * order of the files.
+ */
+class capture_merge
+{
+private:
+    std::vector<std::unique_ptr<capture_file>> files;
+    /// Next record from each file, valid if the corresponding entry in @ref have is true
+    std::vector<capture_file::record> heads;
+    std::vector<bool> have;
+
+public:
+    /**
+     * Constructor.
+     *
+     * @throw std::system_error if a file cannot be opened or mapped
+     * @throw std::runtime_error if a file is not a pcap or pcapng file
+     * @throw std::invalid_argument if @a filenames is empty
+     */
+    explicit capture_merge(const std::vector<std::string> &filenames);
+
+    /// Retrieve the earliest remaining packet, returning false if there are none
+    bool next(capture_file::record &out);
+
+    /// Preload all the files (see @ref capture_file::preload)
+    void preload() const;
+};
+
+/**
+ * Extract the UDP payload and destination from a captured packet.
+ *
+ * @retval false if the link type is not supported
+ * @throw packet_type_error if the packet is not an unfragmented IPv4 UDP datagram
+ * @throw std::length_error if the headers are invalid
+ */
+bool udp_from_capture(
+    const capture_file::record &r, packet_buffer &payload,
+    boost::asio::ip::udp::endpoint &destination);
+
+} // namespace detail
+
+/**
+ * Reader that feeds UDP packets from one or more pcap or pcapng capture files
+ * (such as those written by tcpdump or mcdump) to a stream, without depending
+ * on libpcap.
+ *
+ * The files are memory-mapped and the record headers parsed inline. When
+ * several files are given (for example, a capture split across disks), the
+ * packets are merged in timestamp order, with ties broken by the order of the
+ * files. Ethernet (without VLAN tags) and raw IPv4 link types are supported;
+ * non-UDP, fragmented and truncated packets are skipped.
+ *
+ * Optionally, only packets sent to a given destination can be accepted. An
+ * unspecified address or a zero port in the filter matches any address or
+ * port respectively.
+ *
+ * The capture timestamps are passed to the stream as packet timestamps.
+ */
+class udp_capture_reader : public udp_reader_base
+{
+private:
+    /// Maximum number of packets to process in one handler
+    static constexpr int max_batch = 256;
+
+    detail::capture_merge files;
+    boost::asio::ip::udp::endpoint filter;
+
+    void process(stream_base::add_packet_state &state, const detail::capture_file::record &r);
+    void run();
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param owner      Owning stream
+     * @param filenames  Capture files to read and merge
+     * @param filter     Destination to accept packets for (all packets by default)
+     *
+     * @throw std::system_error if a file cannot be opened or mapped
+     * @throw std::runtime_error if a file is not a pcap or pcapng file
+     * @throw std::invalid_argument if @a filenames is empty
+     */
+    udp_capture_reader(
+        stream &owner, const std::vector<std::string> &filenames,
+        const boost::asio::ip::udp::endpoint &filter = boost::asio::ip::udp::endpoint());
+
+    /// Constructor for a single file
+    udp_capture_reader(
+        stream &owner, const std::string &filename,
+        const boost::asio::ip::udp::endpoint &filter = boost::asio::ip::udp::endpoint());
+
+    virtual void stop() override {}
+    virtual bool lossy() const override;
+};
+
+} // namespace recv
+} // namespace spead2
+
+#endif // SPEAD2_RECV_UDP_CAPTURE_H
@@ -0,0 +1,226 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_RECV_UDP_PACKET_MMAP_H
+#define SPEAD2_RECV_UDP_PACKET_MMAP_H
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_PACKET_MMAP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <boost/asio.hpp>
+#include <spead2/recv_reader.h>
+#include <spead2/recv_stream.h>
+#include <spead2/recv_udp_base.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+/**
+ * Configuration for @ref udp_packet_mmap_reader.
+ */
+class udp_packet_mmap_config
+{
+public:
+    /**
+     * Algorithm used to distribute packets between the sockets in a fanout
+     * group. These correspond to the @c PACKET_FANOUT_* constants described
+     * in packet(7).
+     */
+    enum class fanout_mode
+    {
+        HASH,       ///< Hash of the flow (addresses and ports)
+        LB,         ///< Round-robin
+        CPU,        ///< CPU on which the packet arrived
+        ROLLOVER,   ///< Fill one socket before moving on to the next
+        RND,        ///< Random selection
+        QM          ///< Receive queue on the NIC
+    };
+
+    /// Size of each block in the ring, if none is explicitly set
+    static constexpr std::size_t default_block_size = 1024 * 1024;
+    /// Number of blocks in the ring, if none is explicitly set
+    static constexpr std::size_t default_num_blocks = 32;
+    /// Timeout (in milliseconds) to retire a partially-filled block, if none is explicitly set
+    static constexpr unsigned int default_block_timeout = 10;
+    /// Maximum packet size to accept, if none is explicitly set
+    static constexpr std::size_t default_max_size = udp_reader_base::default_max_size;
+
+private:
+    std::vector<boost::asio::ip::udp::endpoint> endpoints;
+    boost::asio::ip::address interface_address;
+    std::size_t max_size = default_max_size;
+    std::size_t block_size = default_block_size;
+    std::size_t num_blocks = default_num_blocks;
+    unsigned int block_timeout = default_block_timeout;
+    int fanout_group = -1;
+    fanout_mode fanout = fanout_mode::HASH;
+
+public:
+    /// Get the configured endpoints
+    const std::vector<boost::asio::ip::udp::endpoint> &get_endpoints() const { return endpoints; }
+    /**
+     * Set the endpoints (replacing any previous). The address of each
+     * endpoint may be unspecified to accept packets for any destination
+     * address on the port.
+     *
+     * @throws std::invalid_argument if any endpoint is not IPv4 or unspecified.
+     */
+    udp_packet_mmap_config &set_endpoints(const std::vector<boost::asio::ip::udp::endpoint> &endpoints);
+    /**
+     * Append a single endpoint.
+     *
+     * @throws std::invalid_argument if @a endpoint is not IPv4 or unspecified.
+     */
+    udp_packet_mmap_config &add_endpoint(const boost::asio::ip::udp::endpoint &endpoint);
+
+    /// Get the currently set interface address
+    const boost::asio::ip::address get_interface_address() const { return interface_address; }
+    /**
+     * Set the interface address. It is used to identify the interface to
+     * bind to and the interface on which to join multicast groups.
+     *
+     * @throws std::invalid_argument if @a interface_address is not an IPv4 address.
+     */
+    udp_packet_mmap_config &set_interface_address(const boost::asio::ip::address &interface_address);
+
+    /// Get maximum packet size to accept
+    std::size_t get_max_size() const { return max_size; }
+    /// Set maximum packet size to accept
+    udp_packet_mmap_config &set_max_size(std::size_t max_size);
+
+    /// Get the size of each block in the ring
+    std::size_t get_block_size() const { return block_size; }
+    /**
+     * Set the size of each block in the ring. It must be a multiple of the
+     * page size, and large enough to hold at least one maximum-sized
+     * packet. Larger blocks amortise the cost of handing blocks back and
+     * forth with the kernel.
+     */
+    udp_packet_mmap_config &set_block_size(std::size_t block_size);
+
+    /// Get the number of blocks in the ring
+    std::size_t get_num_blocks() const { return num_blocks; }
+    /// Set the number of blocks in the ring
+    udp_packet_mmap_config &set_num_blocks(std::size_t num_blocks);
+
+    /// Get the timeout (in milliseconds) to retire a partially-filled block
+    unsigned int get_block_timeout() const { return block_timeout; }
+    /**
+     * Set the timeout (in milliseconds) after which the kernel hands a
+     * partially-filled block to user space. This bounds the latency at low
+     * packet rates. Zero lets the kernel choose.
+     */
+    udp_packet_mmap_config &set_block_timeout(unsigned int block_timeout);
+
+    /// Get the fanout group ID, or -1 if fanout is disabled
+    int get_fanout_group() const { return fanout_group; }
+    /**
+     * Set the fanout group ID. Readers (in the same or other processes)
+     * with the same group ID on the same interface share the traffic
+     * between them, instead of each receiving a copy. A negative value
+     * disables fanout.
+     *
+     * @throws std::invalid_argument if @a fanout_group is larger than 65535.
+     */
+    udp_packet_mmap_config &set_fanout_group(int fanout_group);
+
+    /// Get the algorithm used to distribute packets in the fanout group
+    fanout_mode get_fanout_mode() const { return fanout; }
+    /// Set the algorithm used to distribute packets in the fanout group
+    udp_packet_mmap_config &set_fanout_mode(fanout_mode fanout);
+};
+
+/**
+ * Asynchronous stream reader that receives UDP packets from an
+ * @c AF_PACKET socket with a @c TPACKET_V3 memory-mapped ring. The kernel
+ * fills whole blocks of packets, and each block is processed in a single
+ * pass without any per-packet system calls. A BPF filter on the socket
+ * ensures that only packets for the configured endpoints are delivered.
+ *
+ * Like @ref udp_ibv_reader, it only supports IPv4 without fragmentation.
+ * It requires the @c CAP_NET_RAW capability.
+ */
+class udp_packet_mmap_reader : public udp_reader_base
+{
+private:
+    struct munmap_deleter
+    {
+        std::size_t size;
+        void operator()(std::uint8_t *ptr) const;
+    };
+
+    /// The AF_PACKET socket
+    boost::asio::posix::stream_descriptor descriptor;
+    /// Socket that is used only to join multicast groups
+    boost::asio::ip::udp::socket join_socket;
+    /// Maximum supported packet size
+    const std::size_t max_size;
+    /// Size of each block in the ring
+    const std::size_t block_size;
+    /// Number of blocks in the ring
+    const std::size_t num_blocks;
+    /// Memory-mapped ring
+    std::unique_ptr<std::uint8_t, munmap_deleter> ring;
+    /// Index of the next block to inspect
+    std::size_t next_block = 0;
+
+    /**
+     * Process all the packets in one block and hand it back to the kernel.
+     * Returns false (without doing anything) if the kernel has not yet
+     * retired the block.
+     */
+    bool process_block(stream_base::add_packet_state &state, std::uint8_t *block);
+    void packet_handler(const boost::system::error_code &error);
+    /**
+     * Request a callback when there is data (or as soon as possible, if
+     * @a need_poll is true because the previous pass stopped early).
+     */
+    void enqueue_receive(bool need_poll);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param owner        Owning stream
+     * @param config       Configuration
+     *
+     * @throws std::invalid_argument If no endpoints are set.
+     * @throws std::invalid_argument If no interface address is set.
+     * @throws std::invalid_argument If the block size is not a multiple of
+     *                               the page size or is too small for the
+     *                               maximum packet size.
+     * @throws std::system_error     If the socket could not be configured.
+     */
+    udp_packet_mmap_reader(stream &owner, const udp_packet_mmap_config &config);
+
+    virtual void stop() override;
+};
+
+} // namespace recv
+} // namespace spead2
+
+#endif // SPEAD2_USE_PACKET_MMAP
+#endif // SPEAD2_RECV_UDP_PACKET_MMAP_H
@@ -0,0 +1,428 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_RECV_UDP_REUSEPORT_H
+#define SPEAD2_RECV_UDP_REUSEPORT_H
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_REUSEPORT
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <boost/asio.hpp>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/common_logging.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_live_heap.h>
+#include <spead2/recv_heap.h>
+#include <spead2/recv_stream.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_udp.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+/**
+ * Configuration for @ref udp_reuseport_group.
+ */
+class udp_reuseport_config
+{
+public:
+    /// How the kernel chooses a socket for each incoming packet
+    enum class steering
+    {
+        /**
+         * Use the low bits of the heap counter, so that all packets of a
+         * heap are delivered to the same socket. This assumes that the
+         * heap counter is the first item pointer in the packet (as is the
+         * case for spead2 senders). Other packets fall back to @c HASH.
+         */
+        HEAP_CNT,
+        /**
+         * Use the CPU that processed the packet in the kernel. This keeps
+         * the data on one core if interrupts are steered to match the
+         * affinity of the receiving threads, but only keeps heaps together
+         * if the NIC steers each heap to a single queue.
+         */
+        CPU,
+        /// Use the kernel's default hash of the addresses and ports
+        HASH
+    };
+
+    /// Number of sockets, if none is explicitly set
+    static constexpr std::size_t default_num_sockets = 2;
+    /// Maximum packet size to accept, if none is explicitly set
+    static constexpr std::size_t default_max_size = udp_reader::default_max_size;
+    /// Socket receive buffer size, if none is explicitly set
+    static constexpr std::size_t default_buffer_size = udp_reader::default_buffer_size;
+
+private:
+    boost::asio::ip::udp::endpoint endpoint;
+    std::size_t num_sockets = default_num_sockets;
+    std::size_t max_size = default_max_size;
+    std::size_t buffer_size = default_buffer_size;
+    std::vector<int> affinity;
+    steering steer = steering::HEAP_CNT;
+
+public:
+    /// Get the endpoint to bind to
+    const boost::asio::ip::udp::endpoint &get_endpoint() const { return endpoint; }
+    /**
+     * Set the endpoint to bind to. The kernel delivers a copy of each
+     * multicast packet to every socket, so only unicast (or unspecified)
+     * addresses are supported.
+     *
+     * @throws std::invalid_argument if the address is a multicast address.
+     */
+    udp_reuseport_config &set_endpoint(const boost::asio::ip::udp::endpoint &endpoint);
+
+    /// Get the number of sockets (and hence streams and threads)
+    std::size_t get_num_sockets() const { return num_sockets; }
+    /**
+     * Set the number of sockets (and hence streams and threads).
+     *
+     * @throws std::invalid_argument if @a num_sockets is zero.
+     */
+    udp_reuseport_config &set_num_sockets(std::size_t num_sockets);
+
+    /// Get maximum packet size to accept
+    std::size_t get_max_size() const { return max_size; }
+    /// Set maximum packet size to accept
+    udp_reuseport_config &set_max_size(std::size_t max_size);
+
+    /// Get the socket receive buffer size (per socket)
+    std::size_t get_buffer_size() const { return buffer_size; }
+    /// Set the socket receive buffer size (per socket), or 0 for the OS default
+    udp_reuseport_config &set_buffer_size(std::size_t buffer_size);
+
+    /// Get the CPU cores for the receive threads
+    const std::vector<int> &get_affinity() const { return affinity; }
+    /**
+     * Set the CPU cores for the receive threads. The thread for socket @em i
+     * is pinned to core <code>affinity[i % affinity.size()]</code>. If empty
+     * (the default), threads are not pinned.
+     */
+    udp_reuseport_config &set_affinity(const std::vector<int> &affinity);
+
+    /// Get the packet steering mode
+    steering get_steering() const { return steer; }
+    /// Set the packet steering mode
+    udp_reuseport_config &set_steering(steering steer);
+};
+
+namespace detail
+{
+
+/**
+ * Create a socket bound to @a endpoint with @c SO_REUSEPORT set. If @a first
+ * is true, the steering program is also attached; it applies to the whole
+ * reuseport group.
+ */
+boost::asio::ip::udp::socket make_reuseport_socket(
+    boost::asio::io_service &io_service, const udp_reuseport_config &config,
+    const boost::asio::ip::udp::endpoint &endpoint, bool first);
+
+} // namespace detail
+
+/**
+ * Receives a single UDP endpoint on multiple @c SO_REUSEPORT sockets. Each
+ * socket feeds its own @ref stream, running on its own single-threaded
+ * (optionally pinned) @ref thread_pool, so that the streams do not contend
+ * for a lock. Completed heaps from all the streams are merged into a single
+ * ringbuffer, which has the same interface as that of @ref ring_stream.
+ *
+ * Each stream has its own set of live heaps, so the sockets need to be
+ * chosen such that all the packets of a heap arrive on the same socket (see
+ * @ref udp_reuseport_config::steering). Because each stream sees only some
+ * of the heaps, @ref stream_config::set_max_heaps applies per stream.
+ *
+ * When any stream receives an end-of-stream control item, all the streams
+ * are stopped. The ringbuffer is stopped once all of them have finished.
+ *
+ * This class is thread-safe.
+ */
+template<typename Ringbuffer = ringbuffer<live_heap> >
+class udp_reuseport_group
+{
+private:
+    /// A stream that pushes its heaps into the group's ringbuffer
+    class member_stream : public stream
+    {
+    private:
+        udp_reuseport_group &group;
+
+        virtual void heap_ready(live_heap &&h) override;
+        virtual void stop_received() override;
+
+    public:
+        member_stream(udp_reuseport_group &group, io_service_ref io_service,
+                      const stream_config &config);
+
+        /// Stop the stream as if it had received an end-of-stream item
+        void stop_from_network();
+    };
+
+    const ring_stream_config ring_config;
+    Ringbuffer ready_heaps;
+    std::vector<std::unique_ptr<thread_pool>> thread_pools;
+    std::vector<std::unique_ptr<member_stream>> streams;
+    boost::asio::ip::udp::endpoint local_endpoint;
+
+    /// Called by a member when it stops, to stop the others too
+    void member_stopped(member_stream &member);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param config           Configuration for each of the streams
+     * @param ring_config      Configuration for the merged ringbuffer
+     * @param udp_config       Sockets and threads to create
+     */
+    udp_reuseport_group(
+        const stream_config &config,
+        const ring_stream_config &ring_config,
+        const udp_reuseport_config &udp_config);
+    ~udp_reuseport_group();
+
+    /// See @ref ring_stream::pop
+    heap pop();
+    /// See @ref ring_stream::pop_live
+    template<typename... SemArgs>
+    live_heap pop_live(SemArgs&&... sem_args);
+    /// See @ref ring_stream::try_pop
+    heap try_pop();
+    /// See @ref ring_stream::try_pop_live
+    live_heap try_pop_live();
+
+    /// Stop all the streams and the ringbuffer
+    void stop();
+
+    /// Get the sum of the statistics of all the streams
+    stream_stats get_stats() const;
+
+    /// Get the ringbuffer configuration passed to the constructor
+    const ring_stream_config &get_ring_config() const { return ring_config; }
+    const Ringbuffer &get_ringbuffer() const { return ready_heaps; }
+
+    /// Get the endpoint to which the sockets are bound
+    const boost::asio::ip::udp::endpoint &get_local_endpoint() const { return local_endpoint; }
+
+    /// Number of streams (and sockets) in the group
+    std::size_t get_num_streams() const { return streams.size(); }
+    /// Get one of the streams, e.g. to inspect its statistics
+    const stream &get_stream(std::size_t index) const { return *streams.at(index); }
+};
+
+template<typename Ringbuffer>
+udp_reuseport_group<Ringbuffer>::member_stream::member_stream(
+    udp_reuseport_group &group, io_service_ref io_service, const stream_config &config)
+    : stream(std::move(io_service), config), group(group)
+{
+}
+
+template<typename Ringbuffer>
+void udp_reuseport_group<Ringbuffer>::member_stream::heap_ready(live_heap &&h)
+{
+    // This mirrors ring_stream::heap_ready
+    if (!group.ring_config.get_contiguous_only() || h.is_contiguous())
+    {
+        try
+        {
+            try
+            {
+                group.ready_heaps.try_push(std::move(h));
+            }
+            catch (ringbuffer_full &e)
+            {
+                bool lossy = is_lossy();
+                if (lossy)
+                    log_warning("worker thread blocked by full ringbuffer on heap %d",
+                                h.get_cnt());
+                {
+                    std::lock_guard<std::mutex> lock(stats_mutex);
+                    stats[stream_stat_indices::worker_blocked]++;
+                }
+                group.ready_heaps.push(std::move(h));
+                if (lossy)
+                    log_debug("worker thread unblocked, heap %d pushed", h.get_cnt());
+            }
+        }
+        catch (ringbuffer_stopped &e)
+        {
+            log_info("dropped heap %d due to external stop",
+                     h.get_cnt());
+        }
+    }
+    else
+    {
+        log_warning("dropped incomplete heap %d (%d/%d bytes of payload)",
+                    h.get_cnt(), h.get_received_length(), h.get_heap_length());
+    }
+}
+
+template<typename Ringbuffer>
+void udp_reuseport_group<Ringbuffer>::member_stream::stop_received()
+{
+    // Flush our heaps to the ringbuffer before giving up our claim on it
+    stream::stop_received();
+    group.ready_heaps.remove_producer();
+    group.member_stopped(*this);
+}
+
+template<typename Ringbuffer>
+void udp_reuseport_group<Ringbuffer>::member_stream::stop_from_network()
+{
+    add_packet_state state(*this);
+    if (!state.is_stopped())
+        state.stop();
+}
+
+template<typename Ringbuffer>
+udp_reuseport_group<Ringbuffer>::udp_reuseport_group(
+    const stream_config &config,
+    const ring_stream_config &ring_config,
+    const udp_reuseport_config &udp_config)
+    : ring_config(ring_config), ready_heaps(ring_config.get_heaps())
+{
+    const std::size_t n = udp_config.get_num_sockets();
+    const std::vector<int> &affinity = udp_config.get_affinity();
+    thread_pools.reserve(n);
+    streams.reserve(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        if (affinity.empty())
+            thread_pools.emplace_back(new thread_pool(1));
+        else
+            thread_pools.emplace_back(new thread_pool(1, {affinity[i % affinity.size()]}));
+        ready_heaps.add_producer();
+        streams.emplace_back(new member_stream(*this, *thread_pools[i], config));
+    }
+    /* Sockets are only created once all the streams exist, so that no
+     * stream can stop (and try to stop its siblings) before they all exist.
+     * Sockets are numbered by the kernel in the order they are bound. If
+     * the configured port is zero, the first socket picks one and the rest
+     * follow it.
+     */
+    local_endpoint = udp_config.get_endpoint();
+    for (std::size_t i = 0; i < n; i++)
+    {
+        auto socket = detail::make_reuseport_socket(
+            streams[i]->get_io_service(), udp_config, local_endpoint, i == 0);
+        if (i == 0)
+            local_endpoint = socket.local_endpoint();
+        streams[i]->template emplace_reader<udp_reader>(
+            std::move(socket), udp_config.get_max_size());
+    }
+}
+
+template<typename Ringbuffer>
+udp_reuseport_group<Ringbuffer>::~udp_reuseport_group()
+{
+    stop();
+    /* Members may have posted work to each other's thread pools. Shut the
+     * pools down before destroying the streams so that such work cannot
+     * run on a destroyed stream.
+     */
+    for (const auto &pool : thread_pools)
+        pool->stop();
+}
+
+template<typename Ringbuffer>
+void udp_reuseport_group<Ringbuffer>::member_stopped(member_stream &member)
+{
+    for (const auto &s : streams)
+        if (s.get() != &member)
+        {
+            /* This must be posted rather than called directly: we're holding
+             * the queue_mutex of member, and another member could be doing
+             * the same thing to us at the same time.
+             */
+            member_stream *ptr = s.get();
+            ptr->get_io_service().post([ptr] { ptr->stop_from_network(); });
+        }
+}
+
+template<typename Ringbuffer>
+heap udp_reuseport_group<Ringbuffer>::pop()
+{
+    while (true)
+    {
+        live_heap h = ready_heaps.pop();
+        if (h.is_contiguous())
+            return heap(std::move(h));
+        else
+            log_info("received incomplete heap %d", h.get_cnt());
+    }
+}
+
+template<typename Ringbuffer>
+template<typename... SemArgs>
+live_heap udp_reuseport_group<Ringbuffer>::pop_live(SemArgs&&... sem_args)
+{
+    return ready_heaps.pop(std::forward<SemArgs>(sem_args)...);
+}
+
+template<typename Ringbuffer>
+heap udp_reuseport_group<Ringbuffer>::try_pop()
+{
+    while (true)
+    {
+        live_heap h = ready_heaps.try_pop();
+        if (h.is_contiguous())
+            return heap(std::move(h));
+        else
+            log_info("received incomplete heap %d", h.get_cnt());
+    }
+}
+
+template<typename Ringbuffer>
+live_heap udp_reuseport_group<Ringbuffer>::try_pop_live()
+{
+    return ready_heaps.try_pop();
+}
+
+template<typename Ringbuffer>
+void udp_reuseport_group<Ringbuffer>::stop()
+{
+    // See ring_stream::stop for why the ringbuffer is stopped first
+    ready_heaps.stop();
+    for (const auto &s : streams)
+        s->stop();
+}
+
+template<typename Ringbuffer>
+stream_stats udp_reuseport_group<Ringbuffer>::get_stats() const
+{
+    stream_stats ret = streams.at(0)->get_stats();
+    for (std::size_t i = 1; i < streams.size(); i++)
+        ret += streams[i]->get_stats();
+    return ret;
+}
+
+} // namespace recv
+} // namespace spead2
+
+#endif // SPEAD2_USE_REUSEPORT
+#endif // SPEAD2_RECV_UDP_REUSEPORT_H
@@ -0,0 +1,128 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_SEND_FILE_H
+#define SPEAD2_SEND_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <spead2/send_stream.h>
+
+namespace spead2
+{
+namespace send
+{
+
+/**
+ * File-specific configuration for @ref file_stream.
+ */
+class file_stream_config
+{
+public:
+    /// Default size of each staging block
+    static constexpr std::size_t default_block_size = 4 * 1024 * 1024;
+    /// Default number of staging blocks
+    static constexpr std::size_t default_queue_depth = 4;
+    /// Alignment of block sizes and writes when using @c O_DIRECT
+    static constexpr std::size_t direct_alignment = 4096;
+
+private:
+    std::size_t block_size = default_block_size;
+    std::size_t queue_depth = default_queue_depth;
+    bool direct = false;
+    int affinity = -1;
+
+public:
+    /// Get the size of each staging block
+    std::size_t get_block_size() const { return block_size; }
+    /**
+     * Set the size of each staging block. Packets are assembled into a block
+     * and each block is written to the file in a single system call (or
+     * several, if it needs to be written before it is full).
+     *
+     * @throw std::invalid_argument if @a block_size is zero
+     */
+    file_stream_config &set_block_size(std::size_t block_size);
+
+    /// Get the number of staging blocks
+    std::size_t get_queue_depth() const { return queue_depth; }
+    /**
+     * Set the number of staging blocks. While one block is being filled, the
+     * others can be queued for writing.
+     *
+     * @throw std::invalid_argument if @a queue_depth is zero
+     */
+    file_stream_config &set_queue_depth(std::size_t queue_depth);
+
+    /// Get whether the file is opened with @c O_DIRECT
+    bool get_direct() const { return direct; }
+    /**
+     * Open the file with @c O_DIRECT, bypassing the page cache. This is not
+     * supported by all filesystems. The block size must be a multiple of
+     * @ref direct_alignment (checked when the stream is constructed).
+     */
+    file_stream_config &set_direct(bool direct);
+
+    /// Get the CPU core for the writer thread
+    int get_affinity() const { return affinity; }
+    /// Set the CPU core for the writer thread (-1 for no affinity)
+    file_stream_config &set_affinity(int affinity);
+};
+
+/**
+ * Stream that writes packets to a file, in the same format as
+ * @ref streambuf_stream.
+ *
+ * Packets are assembled in large, page-aligned staging blocks, with packet
+ * headers generated directly in the block, and the blocks are written with
+ * @c pwritev by a dedicated thread. A heap is completed once all its packets
+ * have been written to the file. When there are no more heaps to write, a
+ * partially-filled block is written immediately (when using @c O_DIRECT, this
+ * is padded to the alignment and the file is truncated again afterwards),
+ * and the rest of the block is filled and written later.
+ */
+class file_stream : public stream
+{
+public:
+    /**
+     * Constructor. The file is created if necessary, and truncated if it
+     * already exists.
+     *
+     * @param io_service   I/O service for sending data
+     * @param filename     File to write
+     * @param config       Stream configuration
+     * @param file_config  File-specific configuration
+     *
+     * @throw std::invalid_argument if direct I/O is requested and the block
+     * size is not a multiple of @ref file_stream_config::direct_alignment, or
+     * direct I/O is not supported on this platform.
+     * @throw std::system_error if the file cannot be opened.
+     */
+    file_stream(
+        io_service_ref io_service,
+        const std::string &filename,
+        const stream_config &config = stream_config(),
+        const file_stream_config &file_config = file_stream_config());
+};
+
+} // namespace send
+} // namespace spead2
+
+#endif // SPEAD2_SEND_FILE_H
@@ -37,6 +37,7 @@ namespace send
 {
 
 class packet_generator;
+class heap_template;
 
 /**
  * An item to be inserted into a heap. An item does *not* own its memory.
@@ -124,6 +125,7 @@ struct item
 class heap
 {
     friend class packet_generator;
+    friend class heap_template;
 private:
     flavour flavour_;
     bool repeat_pointers = false;
@@ -135,6 +137,8 @@ private:
      * needed. Items may point to either this storage or external storage.
      */
     std::vector<std::unique_ptr<std::uint8_t[]> > storage;
+    /// Pre-encoded packet headers, if any
+    std::shared_ptr<const heap_template> template_;
 
     /* Make non-copyable. Copy constructors won't compile anyway because
      * of the unique_ptrs in storage, but because std::vector still defines
@@ -260,6 +264,25 @@ public:
     {
         return repeat_pointers;
     }
+
+    /**
+     * Send the heap using pre-encoded packet headers. The heap must match the
+     * layout of the template (see @ref heap_template), and the stream must
+     * have the same maximum packet size as the template, otherwise the
+     * stream rejects the heap with @c boost::asio::error::invalid_argument.
+     *
+     * Pass a null pointer to return to encoding each packet from scratch.
+     */
+    void set_template(std::shared_ptr<const heap_template> tmpl)
+    {
+        template_ = std::move(tmpl);
+    }
+
+    /// Return the template set by @ref set_template.
+    const std::shared_ptr<const heap_template> &get_template() const
+    {
+        return template_;
+    }
 };
 
 } // namespace send
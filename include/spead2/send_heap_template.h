@@ -0,0 +1,141 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_SEND_HEAP_TEMPLATE_H
+#define SPEAD2_SEND_HEAP_TEMPLATE_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <spead2/common_defines.h>
+#include <spead2/common_flavour.h>
+#include <spead2/send_heap.h>
+
+namespace spead2
+{
+namespace send
+{
+
+class packet_generator;
+
+/**
+ * Pre-encoded packet headers for heaps that share a layout.
+ *
+ * It is constructed from a prototype heap and a maximum packet size. The
+ * header of every packet (SPEAD header and item pointers) is encoded once.
+ * A heap that refers to the template (see @ref heap::set_template) only has
+ * the heap counter and the items listed as variable patched into the copied
+ * headers, instead of having every item pointer encoded for every packet.
+ *
+ * A heap using the template must have the same flavour and repeat-pointers
+ * setting as the prototype. It must also have the same number of items, with
+ * the same IDs, the same encoding (inline, immediate or addressed) and, for
+ * items that are not inline, the same lengths. Addressed items may point at
+ * different memory. The values of immediate items that are not listed as
+ * variable are taken from the prototype, and the values in the heap are
+ * ignored.
+ *
+ * Templates are immutable, and so may be shared between heaps and streams
+ * (with the same maximum packet size) in different threads.
+ */
+class heap_template
+{
+    friend class packet_generator;
+private:
+    /// Layout of one item of the prototype heap
+    struct item_layout
+    {
+        s_item_pointer_t id;
+        bool is_inline;
+        bool allow_immediate;
+        std::size_t length;    ///< Length, if not inline
+    };
+
+    /// Part of an addressed item that forms payload of a packet
+    struct segment
+    {
+        std::size_t item;      ///< Index of the item in the heap
+        std::size_t offset;    ///< Byte offset within the item
+        std::size_t length;    ///< Number of bytes
+    };
+
+    /// Location of an item pointer for a variable immediate item
+    struct patch
+    {
+        std::size_t offset;    ///< Byte offset within the packet header
+        std::size_t item;      ///< Index of the item in the heap
+    };
+
+    struct packet
+    {
+        std::size_t header_offset;   ///< Start of the header in @ref headers
+        std::size_t header_size;     ///< Size of the header (including any padding)
+        std::size_t payload_length;  ///< Number of bytes of payload
+        std::size_t first_segment;   ///< Index into @ref segments
+        std::size_t n_segments;
+        std::size_t first_patch;     ///< Index into @ref patches
+        std::size_t n_patches;
+    };
+
+    flavour flavour_;
+    bool repeat_pointers;
+    std::size_t max_packet_size;
+    s_item_pointer_t payload_size;
+    std::vector<item_layout> items;
+
+    /// Encoded headers of all the packets, concatenated
+    std::vector<std::uint8_t> headers;
+    std::vector<packet> packets;
+    std::vector<segment> segments;
+    std::vector<patch> patches;
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param h                Prototype heap
+     * @param max_packet_size  Maximum packet size of the streams that will send
+     *                         heaps with this template
+     * @param variable         Handles of immediate items (in @a h) whose values
+     *                         change from heap to heap
+     * @throw std::invalid_argument if an item in @a variable would not be sent
+     *                              as an immediate
+     */
+    heap_template(
+        const heap &h, std::size_t max_packet_size,
+        const std::vector<heap::item_handle> &variable = {});
+
+    /// Maximum packet size for which the template was constructed, rounded down to a multiple of 8
+    std::size_t get_max_packet_size() const { return max_packet_size; }
+
+    /// Number of packets in each heap
+    std::size_t get_num_packets() const { return packets.size(); }
+
+    /**
+     * Whether @a h can be sent with this template by a stream with maximum
+     * packet size @a max_packet_size.
+     */
+    bool matches(const heap &h, std::size_t max_packet_size) const;
+};
+
+} // namespace send
+} // namespace spead2
+
+#endif // SPEAD2_SEND_HEAP_TEMPLATE_H
@@ -34,9 +34,11 @@ namespace send
 {
 
 class heap;
+class heap_template;
 
 class packet_generator
 {
+    friend class heap_template;
 private:
     // 8 bytes header, item pointers for heap cnt, heap size, payload offset, payload size
     static constexpr std::size_t prefix_size = 8 + 4 * sizeof(item_pointer_t);
@@ -67,6 +69,21 @@ private:
     /// There is payload padding, so we need to add a NULL item pointer
     bool need_null_item = false;
 
+    /// @name Template-based generation
+    /// @{
+    /// Pre-encoded headers (null if not using a template)
+    const heap_template *tmpl;
+    /// Index of the next packet within the template
+    std::size_t next_packet_index = 0;
+    /// Encoded (big endian) item pointer for the heap counter
+    item_pointer_t cnt_pointer = 0;
+    /// @}
+
+    packet_generator(const heap &h, item_pointer_t cnt, std::size_t max_packet_size,
+                     const heap_template *tmpl);
+
+    std::vector<boost::asio::const_buffer> next_packet_template(std::uint8_t *scratch);
+
 public:
     packet_generator(const heap &h, item_pointer_t cnt, std::size_t max_packet_size);
 
@@ -0,0 +1,79 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_SEND_SHM_H
+#define SPEAD2_SEND_SHM_H
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_SHM
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <boost/asio.hpp>
+#include <spead2/common_thread_pool.h>
+#include <spead2/common_shm.h>
+#include <spead2/send_stream.h>
+
+namespace spead2
+{
+namespace send
+{
+
+/**
+ * Stream that sends packets to other processes through @ref shm_queue%s.
+ *
+ * When a queue is full, the stream polls it at intervals of
+ * @ref retry_interval until the receiver has made space. Heaps sent after the
+ * receiver has closed the queue, or after @ref shm_queue::stop, complete with
+ * @c boost::asio::error::operation_aborted. If the receiver process exits
+ * without closing the queue (see @ref shm_queue::set_consumer), heaps that
+ * cannot be delivered complete with @c boost::asio::error::broken_pipe.
+ */
+class shm_stream : public stream
+{
+public:
+    /// Time between checks for space in a full queue
+    static constexpr std::chrono::microseconds retry_interval{20};
+
+    /**
+     * Constructor.
+     *
+     * @param io_service   I/O service for sending data
+     * @param queues       Queues to send to (one per substream)
+     * @param config       Stream configuration
+     *
+     * @throw std::invalid_argument if @a queues is empty or the maximum
+     * packet size is larger than the slot size of a queue.
+     */
+    shm_stream(
+        io_service_ref io_service,
+        const std::vector<std::shared_ptr<shm_queue>> &queues,
+        const stream_config &config = stream_config());
+
+    /// Get the underlying queues
+    const std::vector<std::shared_ptr<shm_queue>> &get_queues() const;
+};
+
+} // namespace send
+} // namespace spead2
+
+#endif // SPEAD2_USE_SHM
+#endif // SPEAD2_SEND_SHM_H
@@ -35,6 +35,7 @@
 #include <boost/optional.hpp>
 #include <boost/system/error_code.hpp>
 #include <spead2/send_heap.h>
+#include <spead2/send_heap_template.h>
 #include <spead2/send_packet.h>
 #include <spead2/send_stream_config.h>
 #include <spead2/send_writer.h>
@@ -211,7 +212,7 @@ private:
     /// Heap cnt for the next heap to send
     item_pointer_t next_cnt = 1;
     /// If true, the writer wants to be woken up when a new heap is added
-    bool need_wakeup;
+    bool need_wakeup = false;
 
     /* Data that's only mostly written by the writer (apart from flush()), and
      * may be read by the stream.
@@ -295,6 +296,15 @@ private:
                 get_io_service().post(std::bind(std::move(handler), boost::asio::error::invalid_argument, 0));
                 return false;
             }
+            const heap_template *tmpl = h.get_template().get();
+            if (tmpl && !tmpl->matches(h, max_packet_size))
+            {
+                unwind.abort();
+                lock.unlock();
+                log_warning("async_send_heap(s): dropping heap because it does not match its template");
+                get_io_service().post(std::bind(std::move(handler), boost::asio::error::invalid_argument, 0));
+                return false;
+            }
             item_pointer_t cnt_mask = (item_pointer_t(1) << h.get_flavour().get_heap_address_bits()) - 1;
 
             if (tail - head == queue_size)
@@ -0,0 +1,82 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_SEND_UDP_PARALLEL_H
+#define SPEAD2_SEND_UDP_PARALLEL_H
+
+#include <boost/asio.hpp>
+#include <vector>
+#include <spead2/send_stream.h>
+#include <spead2/send_udp.h>
+
+namespace spead2
+{
+namespace send
+{
+
+/**
+ * UDP stream that generates and transmits packets from several threads.
+ *
+ * Each thread has its own socket, and takes whole groups (or single heaps
+ * sent with @ref stream::async_send_heap) from the stream's queue, so that
+ * packet generation and the system calls to send packets are spread over
+ * several cores. Packets of different groups may thus be interleaved on the
+ * wire, but the packets of a group are sent in the usual order by a single
+ * thread. Completion handlers are still called in the order in which the
+ * heaps were enqueued, on the @c io_service.
+ *
+ * Rate limiting is not supported: the stream configuration must have a
+ * rate of zero.
+ */
+class udp_parallel_stream : public stream
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param io_service   I/O service on which completions are handled
+     * @param endpoints    Destination host and port for each substream
+     * @param config       Stream configuration (with no rate limit)
+     * @param threads      Number of transmit threads
+     * @param affinity     CPU cores for the transmit threads (empty for no
+     *                     affinity, otherwise reused cyclically)
+     * @param buffer_size  Socket buffer size for each thread's socket
+     * @param interface_address  Source address
+     *                           @verbatim embed:rst:leading-asterisks
+     *                           (see tips on :ref:`routing`)
+     *                           @endverbatim
+     *
+     * @throw std::invalid_argument if @a threads is zero, the configuration
+     * has a rate limit, or the endpoints are empty or have mixed protocols.
+     */
+    udp_parallel_stream(
+        io_service_ref io_service,
+        const std::vector<boost::asio::ip::udp::endpoint> &endpoints,
+        const stream_config &config,
+        std::size_t threads,
+        const std::vector<int> &affinity = {},
+        std::size_t buffer_size = udp_stream::default_buffer_size,
+        const boost::asio::ip::address &interface_address = boost::asio::ip::address());
+};
+
+} // namespace send
+} // namespace spead2
+
+#endif // SPEAD2_SEND_UDP_PARALLEL_H
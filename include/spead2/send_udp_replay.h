@@ -0,0 +1,169 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_SEND_UDP_REPLAY_H
+#define SPEAD2_SEND_UDP_REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <boost/asio.hpp>
+#include <spead2/recv_udp_capture.h>
+
+namespace spead2
+{
+namespace send
+{
+
+/// Configuration for @ref udp_replayer
+class udp_replay_config
+{
+public:
+    /// Default socket send buffer size
+    static constexpr std::size_t default_buffer_size = 512 * 1024;
+
+private:
+    double speed = 1.0;
+    boost::asio::ip::udp::endpoint destination;
+    std::size_t buffer_size = default_buffer_size;
+    int ttl = 1;
+    boost::asio::ip::address interface_address;
+    bool preload = false;
+
+public:
+    /**
+     * Set the replay speed relative to the capture: 2 replays twice as fast
+     * (halving every gap between packets), and 0 sends as fast as possible.
+     *
+     * @throw std::invalid_argument if @a speed is negative or not finite
+     */
+    udp_replay_config &set_speed(double speed);
+    double get_speed() const { return speed; }
+
+    /**
+     * Send every packet to @a destination instead of to the destination
+     * recorded in the capture (for example, to replay multicast traffic to a
+     * receiver on the loopback interface). An endpoint with port 0 (the
+     * default) keeps the original destinations.
+     */
+    udp_replay_config &set_destination(const boost::asio::ip::udp::endpoint &destination);
+    const boost::asio::ip::udp::endpoint &get_destination() const { return destination; }
+
+    /// Set the socket send buffer size
+    udp_replay_config &set_buffer_size(std::size_t buffer_size);
+    std::size_t get_buffer_size() const { return buffer_size; }
+
+    /// Set the TTL for multicast packets
+    udp_replay_config &set_ttl(int ttl);
+    int get_ttl() const { return ttl; }
+
+    /**
+     * Set the address of the interface to send from (for multicast, the
+     * outgoing interface). By default the operating system chooses.
+     */
+    udp_replay_config &set_interface_address(const boost::asio::ip::address &interface_address);
+    const boost::asio::ip::address &get_interface_address() const { return interface_address; }
+
+    /**
+     * Read the whole capture into memory before starting, so that page faults
+     * do not disturb the timing.
+     */
+    udp_replay_config &set_preload(bool preload);
+    bool get_preload() const { return preload; }
+};
+
+/// Timing and volume statistics from @ref udp_replayer::run
+struct udp_replay_stats
+{
+    /// Number of packets sent
+    std::uint64_t packets = 0;
+    /// Number of UDP payload bytes sent
+    std::uint64_t bytes = 0;
+    /// Number of captured packets that were not sent (non-UDP or truncated)
+    std::uint64_t skipped = 0;
+    /// Number of packets that could not be sent due to socket errors
+    std::uint64_t errors = 0;
+    /// Time between first and last packet in the capture, scaled by the speed (seconds)
+    double target_duration = 0.0;
+    /// Time between sending the first and last packet (seconds)
+    double actual_duration = 0.0;
+    /// Mean delay of packets relative to their scheduled times (seconds)
+    double mean_lateness = 0.0;
+    /// Maximum delay of a packet relative to its scheduled time (seconds)
+    double max_lateness = 0.0;
+    /// Root-mean-square difference between actual and scheduled inter-packet gaps (seconds)
+    double rms_gap_error = 0.0;
+};
+
+/**
+ * Retransmits the UDP payloads from pcap or pcapng capture files (such as
+ * those written by mcdump), following the timing recorded in the capture.
+ *
+ * The files are memory-mapped and merged in timestamp order, as for
+ * @ref recv::udp_capture_reader. Each packet is scheduled at the capture time
+ * (relative to the first packet, and scaled by the configured speed). Packets
+ * that are due are sent in batches with @c sendmmsg where available, and the
+ * replayer sleeps (or for short intervals, spins) until the next packet is due.
+ * Packets are never sent early, so bursts in the capture are reproduced as
+ * closely as the host allows, and the achieved timing is reported in
+ * @ref udp_replay_stats.
+ *
+ * Replay runs synchronously on the calling thread.
+ */
+class udp_replayer
+{
+private:
+    /// Maximum number of packets to pass to one system call
+    static constexpr int max_batch = 64;
+
+    udp_replay_config config;
+    recv::detail::capture_merge files;
+    boost::asio::io_service io_service;
+    boost::asio::ip::udp::socket socket;
+    std::atomic<bool> stopped{false};
+
+public:
+    /**
+     * Constructor.
+     *
+     * @throw std::system_error if a file cannot be opened or mapped
+     * @throw std::runtime_error if a file is not a pcap or pcapng file
+     * @throw std::invalid_argument if @a filenames is empty
+     */
+    explicit udp_replayer(
+        const std::vector<std::string> &filenames,
+        const udp_replay_config &config = udp_replay_config());
+
+    /**
+     * Replay the capture. This returns when all packets have been sent or
+     * @ref stop is called, and can only be called once.
+     */
+    udp_replay_stats run();
+
+    /// Make @ref run return early. This may be called from any thread.
+    void stop();
+};
+
+} // namespace send
+} // namespace spead2
+
+#endif // SPEAD2_SEND_UDP_REPLAY_H
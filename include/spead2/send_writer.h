@@ -203,6 +203,36 @@ protected:
      */
     packet_result get_packet(transmit_packet &data, std::uint8_t *scratch);
 
+    /**
+     * Retrieve the next packet of a group, advancing a cursor over the group.
+     * This is the part of @ref get_packet that does not involve rate
+     * limiting or the writer's own position in the queue. It only touches
+     * the queue entries of the group, so different threads may call it
+     * concurrently for different groups claimed with @ref get_group.
+     *
+     * @param active        Queue index of the heap to take the next packet from
+     * @param active_start  Queue index of the start of the group
+     * @param data          Packet information (output)
+     * @param scratch       Scratch space for the packet header
+     */
+    void next_group_packet(
+        std::size_t &active, std::size_t &active_start,
+        transmit_packet &data, std::uint8_t *scratch);
+
+    /**
+     * Claim the next whole group from the queue, as an alternative to
+     * @ref get_packet for writers that transmit groups concurrently. The
+     * group's packets can then be retrieved with @ref next_group_packet,
+     * starting with both cursors at @a start. This does no rate limiting, and
+     * must not be mixed with @ref get_packet.
+     *
+     * @param[out] start    Queue index of the first heap in the group
+     * @param[out] end      Queue index one past the last heap in the group
+     * @retval false        if there are no more groups currently available
+     *                      (use @ref request_wakeup as for @c packet_result::EMPTY)
+     */
+    bool get_group(std::size_t &start, std::size_t &end);
+
     /// Notify the base class that @a n groups have finished transmission.
     void groups_completed(std::size_t n);
 
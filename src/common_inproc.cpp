@@ -19,6 +19,10 @@
  */
 
 #include <utility>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <iterator>
 #include <spead2/common_unbounded_queue.h>
 #include <spead2/common_semaphore.h>
 #include <spead2/common_inproc.h>
@@ -26,11 +30,45 @@
 namespace spead2
 {
 
-template class unbounded_queue<inproc_queue::packet, semaphore_fd>;
+template class unbounded_queue<std::vector<inproc_queue::packet>, semaphore_fd>;
+
+constexpr std::size_t inproc_queue::max_free_packets;
 
 void inproc_queue::add_packet(packet &&pkt)
 {
-    buffer.push(std::move(pkt));
+    std::vector<packet> pkts;
+    pkts.push_back(std::move(pkt));
+    buffer.push(std::move(pkts));
+}
+
+void inproc_queue::add_packets(std::vector<packet> &pkts)
+{
+    if (!pkts.empty())
+    {
+        buffer.push(std::move(pkts));
+        pkts.clear();   // moved-from state is unspecified
+    }
+}
+
+void inproc_queue::reuse_packets(std::vector<packet> &out, std::size_t n)
+{
+    std::lock_guard<std::mutex> lock(free_mutex);
+    n = std::min(n, free_packets.size());
+    auto first = free_packets.end() - n;
+    std::move(first, free_packets.end(), std::back_inserter(out));
+    free_packets.erase(first, free_packets.end());
+}
+
+void inproc_queue::recycle_packets(std::vector<packet> &&pkts)
+{
+    std::lock_guard<std::mutex> lock(free_mutex);
+    for (packet &pkt : pkts)
+    {
+        if (free_packets.size() >= max_free_packets)
+            break;
+        if (pkt.capacity > 0)
+            free_packets.push_back(std::move(pkt));
+    }
 }
 
 void inproc_queue::stop()
@@ -0,0 +1,206 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_MEMFD
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <spead2/common_logging.h>
+#include <spead2/common_memfd_allocator.h>
+
+namespace spead2
+{
+
+constexpr std::size_t memfd_allocator::alignment;
+
+memfd_allocator::memfd_allocator(std::size_t size, bool hugetlb, bool seal)
+{
+    if (hugetlb)
+    {
+        try
+        {
+            create(size, true, seal);
+            this->hugetlb = true;
+            return;
+        }
+        catch (std::system_error &e)
+        {
+            log_info("could not back memfd region with huge pages (%1%), using normal pages", e.what());
+        }
+    }
+    create(size, false, seal);
+}
+
+memfd_allocator::~memfd_allocator()
+{
+    munmap(base, region_size);
+    close(fd);
+}
+
+void memfd_allocator::create(std::size_t size, bool hugetlb, bool seal)
+{
+    unsigned int flags = MFD_CLOEXEC;
+    if (seal)
+        flags |= MFD_ALLOW_SEALING;
+    if (hugetlb)
+        flags |= MFD_HUGETLB;
+    int fd = memfd_create("spead2_memfd_allocator", flags);
+    if (fd < 0)
+        throw_errno("memfd_create failed");
+    try
+    {
+        // For hugetlbfs, the block size is the huge page size
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            throw_errno("fstat failed");
+        std::size_t page_size = hugetlb ? st.st_blksize : sysconf(_SC_PAGESIZE);
+        if (size > SIZE_MAX - page_size)
+            throw std::bad_alloc();
+        size = std::max((size + page_size - 1) / page_size * page_size, page_size);
+        if (ftruncate(fd, size) != 0)
+            throw_errno("ftruncate failed");
+        if (seal && fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0)
+            throw_errno("fcntl(F_ADD_SEALS) failed");
+        void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        if (ptr == MAP_FAILED)
+            throw_errno("mmap failed");
+        this->fd = fd;
+        base = static_cast<std::uint8_t *>(ptr);
+        region_size = size;
+        free_ranges.emplace(0, size);
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+}
+
+memfd_allocator::pointer memfd_allocator::allocate(std::size_t size, void *hint)
+{
+    (void) hint;
+    if (size > region_size)
+        throw std::bad_alloc();
+    std::size_t reserved = std::max((size + alignment - 1) / alignment * alignment, alignment);
+    std::size_t offset;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // First fit
+        auto it = std::find_if(
+            free_ranges.begin(), free_ranges.end(),
+            [reserved](const std::pair<const std::size_t, std::size_t> &range)
+            {
+                return range.second >= reserved;
+            });
+        if (it == free_ranges.end())
+            throw std::bad_alloc();
+        offset = it->first;
+        std::size_t remaining = it->second - reserved;
+        it = free_ranges.erase(it);
+        if (remaining > 0)
+            free_ranges.emplace_hint(it, offset + reserved, remaining);
+        allocations.emplace(offset, allocation{size, reserved});
+    }
+    std::shared_ptr<memfd_allocator> self = std::static_pointer_cast<memfd_allocator>(shared_from_this());
+    return pointer(base + offset, [self, offset](std::uint8_t *) { self->release(offset); });
+}
+
+void memfd_allocator::release(std::size_t offset)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = allocations.find(offset);
+    assert(it != allocations.end());
+    std::size_t length = it->second.reserved;
+    allocations.erase(it);
+
+    // Merge with the neighbouring free ranges
+    auto next = free_ranges.lower_bound(offset);
+    if (next != free_ranges.end() && offset + length == next->first)
+    {
+        length += next->second;
+        next = free_ranges.erase(next);
+    }
+    if (next != free_ranges.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset)
+        {
+            prev->second += length;
+            return;
+        }
+    }
+    free_ranges.emplace_hint(next, offset, length);
+}
+
+memfd_descriptor memfd_allocator::get_descriptor(const std::uint8_t *ptr) const
+{
+    if (ptr < base || ptr >= base + region_size)
+        throw std::invalid_argument("pointer does not belong to this allocator");
+    std::size_t offset = ptr - base;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = allocations.upper_bound(offset);
+    if (it == allocations.begin() || offset >= std::prev(it)->first + std::prev(it)->second.reserved)
+        throw std::invalid_argument("pointer is not inside a live allocation");
+    --it;
+    return memfd_descriptor{fd, it->first, it->second.length};
+}
+
+memfd_mapping::memfd_mapping(int fd, bool writable) : writable(writable)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        throw_errno("fstat failed");
+    std::size_t size = st.st_size;
+    int prot = PROT_READ | (writable ? PROT_WRITE : 0);
+    void *ret = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+    if (ret == MAP_FAILED)
+        throw_errno("mmap failed");
+    ptr = static_cast<std::uint8_t *>(ret);
+    map_size = size;
+}
+
+memfd_mapping::~memfd_mapping()
+{
+    munmap(ptr, map_size);
+}
+
+std::uint8_t *memfd_mapping::get(const memfd_descriptor &desc) const
+{
+    if (desc.offset > map_size || desc.length > map_size - desc.offset)
+        throw std::out_of_range("descriptor lies outside the mapping");
+    return ptr + desc.offset;
+}
+
+} // namespace spead2
+
+#endif // SPEAD2_USE_MEMFD
@@ -18,7 +18,16 @@
  * @file
  */
 
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unistd.h>
 #include <spead2/common_memory_pool.h>
+#include <spead2/common_logging.h>
 
 // Some operating systems only provide MAP_ANON
 #ifndef MAP_ANONYMOUS
@@ -116,4 +125,140 @@ mmap_allocator::pointer mmap_allocator::allocate(std::size_t size, void *hint)
     return pointer(ptr, [size](std::uint8_t *ptr) { munmap(ptr, size); });
 }
 
+/////////////////////////////////////////////////////////////////////////////
+
+static constexpr std::size_t fallback_huge_page_size = 2 * 1024 * 1024;
+
+/// Default hugetlb page size, from /proc/meminfo
+static std::size_t default_huge_page_size()
+{
+    std::ifstream in("/proc/meminfo");
+    std::string key;
+    while (in >> key)
+    {
+        if (key == "Hugepagesize:")
+        {
+            std::size_t kib;
+            if (in >> kib && kib > 0)
+                return kib * 1024;
+            break;
+        }
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return fallback_huge_page_size;
+}
+
+/// Size of a transparent huge page
+static std::size_t transparent_huge_page_size()
+{
+    std::ifstream in("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+    std::size_t size;
+    if (in >> size && size > 0)
+        return size;
+    return default_huge_page_size();
+}
+
+static std::size_t round_up(std::size_t size, std::size_t align)
+{
+    // Avoid overflow for absurd sizes: the caller will fail to allocate anyway
+    if (size > SIZE_MAX - align)
+        throw std::bad_alloc();
+    return (size + align - 1) & ~(align - 1);
+}
+
+hugepage_allocator::hugepage_allocator(std::size_t page_size, int flags, bool retry_hugetlb)
+    : page_size(page_size ? page_size : default_huge_page_size()),
+    transparent_page_size(transparent_huge_page_size()),
+    flags(flags),
+    retry_hugetlb(retry_hugetlb)
+{
+    std::size_t sys_page_size = sysconf(_SC_PAGESIZE);
+    if (this->page_size < sys_page_size || (this->page_size & (this->page_size - 1)))
+        throw std::invalid_argument("page_size must be a power of two and at least the system page size");
+}
+
+hugepage_allocator::pointer hugepage_allocator::allocate_hugetlb(std::size_t size)
+{
+#ifdef MAP_HUGETLB
+    if (hugetlb_failed.load(std::memory_order_relaxed))
+        return pointer();
+    size = round_up(size, page_size);
+    int use_flags = flags | MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB
+#ifdef MAP_POPULATE
+        | MAP_POPULATE
+#endif
+#ifdef MAP_HUGE_SHIFT
+        | (__builtin_ctzll(page_size) << MAP_HUGE_SHIFT)
+#endif
+    ;
+    std::uint8_t *ptr = (std::uint8_t *) mmap(nullptr, size, PROT_READ | PROT_WRITE, use_flags, -1, 0);
+    if (ptr != MAP_FAILED)
+    {
+#ifndef MAP_POPULATE
+        prefault(ptr, size);
+#endif
+        return pointer(ptr, [size](std::uint8_t *ptr) { munmap(ptr, size); });
+    }
+    if (!retry_hugetlb)
+        hugetlb_failed.store(true, std::memory_order_relaxed);
+    if (!logged_hugetlb_fallback.exchange(true, std::memory_order_relaxed))
+    {
+        std::error_code code(errno, std::system_category());
+        log_info("MAP_HUGETLB allocation failed (%1%), falling back to transparent huge pages",
+                 code.message());
+    }
+#endif
+    (void) size;
+    return pointer();
+}
+
+hugepage_allocator::pointer hugepage_allocator::allocate_transparent(std::size_t size)
+{
+    std::size_t align = transparent_page_size;
+    size = round_up(size, align);
+    /* mmap only guarantees alignment to the system page size, so map extra
+     * and trim the ends to get alignment to the huge page size.
+     */
+    if (size > SIZE_MAX - align)
+        throw std::bad_alloc();
+    std::size_t map_size = size + align;
+    std::uint8_t *base = (std::uint8_t *) mmap(
+        nullptr, map_size, PROT_READ | PROT_WRITE, flags | MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (base == MAP_FAILED)
+        throw std::bad_alloc();
+    std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(base);
+    std::uint8_t *ptr = base + (round_up(addr, align) - addr);
+    std::size_t head = ptr - base;
+    std::size_t tail = map_size - head - size;
+    if (head > 0)
+        munmap(base, head);
+    if (tail > 0)
+        munmap(ptr + size, tail);
+
+    mode m = mode::NORMAL;
+#ifdef MADV_HUGEPAGE
+    if (madvise(ptr, size, MADV_HUGEPAGE) == 0)
+        m = mode::TRANSPARENT;
+    else if (!logged_madvise_fallback.exchange(true, std::memory_order_relaxed))
+        log_errno("madvise(MADV_HUGEPAGE) failed, using normal pages: %1% (%2%)");
+#endif
+    // Faulting in after madvise lets the kernel allocate whole huge pages
+    prefault(ptr, size);
+    last_mode.store(m, std::memory_order_relaxed);
+    return pointer(ptr, [size](std::uint8_t *ptr) { munmap(ptr, size); });
+}
+
+hugepage_allocator::pointer hugepage_allocator::allocate(std::size_t size, void *hint)
+{
+    (void) hint;
+    size = std::max(size, std::size_t(1));
+    pointer ptr = allocate_hugetlb(size);
+    if (ptr)
+    {
+        last_mode.store(mode::HUGETLB, std::memory_order_relaxed);
+        return ptr;
+    }
+    return allocate_transparent(size);
+}
+
 } // namespace spead2
@@ -22,74 +22,548 @@
 #include <utility>
 #include <memory>
 #include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <spead2/common_defines.h>
 #include <spead2/common_memory_pool.h>
 #include <spead2/common_logging.h>
 
 namespace spead2
 {
 
-memory_pool::memory_pool()
-    : memory_pool(boost::none, 0, 0, 0, 0, 0, nullptr)
+namespace detail
+{
+
+/**
+ * Header for a buffer owned by a memory pool. It is allocated once, when the
+ * buffer is first obtained from the base allocator, and recycled for another
+ * buffer when that one is returned to the base allocator.
+ */
+struct memory_pool_block
+{
+    std::uint8_t *data = nullptr;
+    memory_allocator::deleter base_deleter;
+    memory_pool_core *core = nullptr;
+    std::uint32_t index = 0;
+    /// Link in a lock-free stack (index + 1 of the next block, or 0 for none)
+    std::atomic<std::uint32_t> next{0};
+};
+
+/**
+ * Deleter for pointers handed out from the pool. It is trivially copyable and
+ * small enough for the small-object storage of @c std::function, so wrapping
+ * a buffer in a @ref memory_allocator::pointer does not allocate.
+ */
+class memory_pool_deleter
+{
+private:
+    memory_pool_block *block;
+
+public:
+    explicit memory_pool_deleter(memory_pool_block *block) : block(block) {}
+
+    void operator()(std::uint8_t *ptr) const;
+
+    memory_allocator::deleter &get_base_deleter() { return block->base_deleter; }
+    const memory_allocator::deleter &get_base_deleter() const { return block->base_deleter; }
+};
+
+/**
+ * The free buffers of a memory pool, and the headers of all its buffers.
+ *
+ * Free blocks are held either in a magazine (a small cache used by a subset
+ * of threads, protected by a spin lock that is normally uncontended) or in a
+ * lock-free stack shared by all threads. The stacks link blocks by index
+ * rather than by pointer, so that a tag can be packed alongside the head to
+ * avoid the ABA problem. For that reason headers live in segments that are
+ * never freed until the core is destroyed.
+ *
+ * To enforce the limit on free blocks without touching a shared counter on
+ * every operation, @ref n_free counts reservations ("credits") rather than
+ * blocks. Each block in the shared stack holds a credit, and each magazine
+ * holds at least as many credits as blocks. Magazines obtain and release
+ * credits in batches, so at most a batch per magazine is reserved without
+ * being used.
+ *
+ * The core is reference-counted: the pool holds one reference and each
+ * buffer (whether free or in use) holds another. This allows buffers to be
+ * freed after the pool itself has been destroyed.
+ */
+class memory_pool_core
+{
+public:
+    /// Maximum number of blocks held in each magazine
+    static constexpr std::size_t max_magazine_size = 16;
+    /// Number of magazines (threads are assigned to them round-robin)
+    static constexpr std::size_t num_magazines = 16;
+
+private:
+    static constexpr std::size_t first_segment_size = 64;
+    static constexpr int max_segments = 26;
+
+    class block_stack
+    {
+    private:
+        memory_pool_core &owner;
+        /// Tag in the upper 32 bits, index + 1 of the top block (or 0) in the lower 32 bits
+        std::atomic<std::uint64_t> head{0};
+
+    public:
+        explicit block_stack(memory_pool_core &owner) : owner(owner) {}
+        void push(memory_pool_block *block);
+        memory_pool_block *pop();
+    };
+
+    struct magazine
+    {
+        char pad[detail::cache_line_size];   // avoid false sharing between magazines
+        std::atomic<bool> locked{false};
+        std::size_t size = 0;      ///< Number of blocks
+        std::size_t credits = 0;   ///< Number of reserved free slots (at least @ref size)
+        std::uint64_t gets = 0;    ///< Number of blocks handed out from this magazine
+        std::uint64_t puts = 0;    ///< Number of blocks returned via this magazine
+        memory_pool_block *blocks[max_magazine_size];
+
+        void lock();
+        void unlock();
+    };
+
+    const std::size_t max_free;
+    const std::size_t magazine_size;
+    /// Number of blocks and credits moved in a batch
+    const std::size_t batch_size;
+    std::atomic<std::size_t> refs{1};
+    std::atomic<std::size_t> n_free{0};
+    std::atomic<std::size_t> n_free_high_water{0};
+    std::atomic<std::uint64_t> stolen{0};   ///< Blocks handed out other than from the local magazine
+    std::atomic<bool> closed{false};
+    block_stack free_blocks{*this};      ///< Free blocks not in a magazine
+    block_stack spare_headers{*this};    ///< Headers not attached to any buffer
+    magazine magazines[num_magazines];
+
+    std::mutex segments_mutex;
+    std::atomic<std::uint32_t> next_index{0};
+    std::atomic<memory_pool_block *> segments[max_segments];
+
+    memory_pool_block *get_block(std::uint32_t index) const;
+    memory_pool_block *new_header();
+    magazine &local_magazine();
+    /// Reserve up to @a n free slots, returning the number reserved
+    std::size_t reserve_credits(std::size_t n);
+    /// Take a free block from another thread's magazine
+    memory_pool_block *steal();
+    /// Return the buffer of a block to the base allocator
+    void destroy_block(memory_pool_block *block);
+    void unref();
+
+public:
+    explicit memory_pool_core(std::size_t max_free);
+    ~memory_pool_core();
+
+    /// Create a block owning @a ptr. The block is not yet in the free pool.
+    memory_pool_block *make_block(memory_allocator::pointer &&ptr);
+    /**
+     * Add a newly-created block to the shared free stack. Returns false (and
+     * frees the buffer) if the pool is full.
+     */
+    bool add(memory_pool_block *block);
+    /// Take a free block, or return @c nullptr if there are none
+    memory_pool_block *get();
+    /// Return an allocated block to the pool (or free it if the pool is full or closed)
+    void put(memory_pool_block *block);
+    /// Number of reserved credits, which is an upper bound on the number of free blocks
+    std::size_t free_count() const { return n_free.load(std::memory_order_relaxed); }
+    /**
+     * Number of free blocks, excluding credits reserved by magazines that do
+     * not hold blocks. This locks every magazine.
+     */
+    std::size_t free_block_count();
+    /**
+     * Whether there are fewer than @a threshold free blocks. The magazines
+     * are only inspected when @ref free_count is too close to @a threshold
+     * to decide.
+     */
+    bool free_below(std::size_t threshold);
+    /**
+     * Fill in the statistics that the core tracks. @a block_size is used to
+     * compute @ref memory_pool_stats::bytes_outstanding, and @a extra_gets is
+     * the number of blocks created on demand.
+     */
+    void get_stats(memory_pool_stats &stats, std::size_t block_size, std::uint64_t extra_gets);
+    /// Free all the free blocks and drop the pool's reference
+    void close();
+};
+
+constexpr std::size_t memory_pool_core::max_magazine_size;
+constexpr std::size_t memory_pool_core::num_magazines;
+constexpr std::size_t memory_pool_core::first_segment_size;
+constexpr int memory_pool_core::max_segments;
+
+void memory_pool_core::block_stack::push(memory_pool_block *block)
 {
+    std::uint64_t old_head = head.load(std::memory_order_relaxed);
+    std::uint64_t new_head;
+    do
+    {
+        block->next.store(std::uint32_t(old_head), std::memory_order_relaxed);
+        new_head = (((old_head >> 32) + 1) << 32) | (block->index + 1);
+    } while (!head.compare_exchange_weak(old_head, new_head,
+                                         std::memory_order_release, std::memory_order_relaxed));
 }
 
-memory_pool::memory_pool(std::size_t lower, std::size_t upper, std::size_t max_free, std::size_t initial,
-                         std::shared_ptr<memory_allocator> allocator)
-    : memory_pool(boost::none, lower, upper, max_free, initial, 0, std::move(allocator))
+memory_pool_block *memory_pool_core::block_stack::pop()
 {
+    std::uint64_t old_head = head.load(std::memory_order_acquire);
+    while (true)
+    {
+        std::uint32_t top = std::uint32_t(old_head);
+        if (top == 0)
+            return nullptr;
+        memory_pool_block *block = owner.get_block(top - 1);
+        /* If the block has been popped (and possibly pushed again) in the
+         * meantime, this may read a stale value, but then the tag will have
+         * changed and the CAS will fail.
+         */
+        std::uint64_t new_head = (((old_head >> 32) + 1) << 32)
+            | block->next.load(std::memory_order_relaxed);
+        if (head.compare_exchange_weak(old_head, new_head,
+                                       std::memory_order_acquire, std::memory_order_acquire))
+            return block;
+    }
 }
 
-memory_pool::memory_pool(
-    io_service_ref io_service,
-    std::size_t lower, std::size_t upper, std::size_t max_free, std::size_t initial,
-    std::size_t low_water,
-    std::shared_ptr<memory_allocator> allocator)
-    : memory_pool(boost::optional<io_service_ref>(std::move(io_service)),
-                  lower, upper, max_free, initial, low_water, std::move(allocator))
+void memory_pool_core::magazine::lock()
 {
+    while (locked.exchange(true, std::memory_order_acquire))
+    {
+        while (locked.load(std::memory_order_relaxed))
+            std::this_thread::yield();
+    }
 }
 
-namespace detail
+void memory_pool_core::magazine::unlock()
 {
+    locked.store(false, std::memory_order_release);
+}
 
-class memory_pool_deleter
+memory_pool_core::memory_pool_core(std::size_t max_free)
+    : max_free(max_free),
+    // Keep the magazines small relative to the pool, so that free blocks are
+    // not stranded in the magazines of threads that do not allocate.
+    magazine_size(std::min(max_magazine_size, max_free / 2)),
+    batch_size(std::max(magazine_size / 2, std::size_t(1)))
 {
-private:
-    struct state_t
+    for (auto &segment : segments)
+        segment.store(nullptr, std::memory_order_relaxed);
+}
+
+memory_pool_core::~memory_pool_core()
+{
+    for (int i = 0; i < max_segments; i++)
+        delete[] segments[i].load(std::memory_order_relaxed);
+}
+
+memory_pool_block *memory_pool_core::get_block(std::uint32_t index) const
+{
+    // Segment s has first_segment_size << s entries
+    std::uint64_t q = index / first_segment_size + 1;
+    int s = 63 - __builtin_clzll(q);
+    std::size_t offset = index - first_segment_size * ((std::size_t(1) << s) - 1);
+    return &segments[s].load(std::memory_order_acquire)[offset];
+}
+
+memory_pool_block *memory_pool_core::new_header()
+{
+    std::uint32_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+    if (index == UINT32_MAX)
+        throw std::bad_alloc();
+    std::uint64_t q = index / first_segment_size + 1;
+    int s = 63 - __builtin_clzll(q);
+    if (!segments[s].load(std::memory_order_acquire))
     {
-        std::shared_ptr<memory_pool> allocator;
-        memory_allocator::deleter base_deleter;
+        std::lock_guard<std::mutex> lock(segments_mutex);
+        if (!segments[s].load(std::memory_order_relaxed))
+            segments[s].store(new memory_pool_block[first_segment_size << s], std::memory_order_release);
+    }
+    memory_pool_block *block = get_block(index);
+    block->core = this;
+    block->index = index;
+    return block;
+}
 
-        state_t(std::shared_ptr<memory_pool> &&allocator,
-                memory_allocator::deleter &&base_deleter)
-            : allocator(std::move(allocator)), base_deleter(std::move(base_deleter)) {}
-    };
+memory_pool_core::magazine &memory_pool_core::local_magazine()
+{
+    static std::atomic<unsigned int> next_slot{0};
+    static thread_local unsigned int slot = next_slot.fetch_add(1, std::memory_order_relaxed);
+    return magazines[slot % num_magazines];
+}
 
-    // See the comments in memory_allocator::legacy_deleter for an explanation
-    // of why this is wrapped in a shared_ptr.
-    std::shared_ptr<state_t> state;
+std::size_t memory_pool_core::reserve_credits(std::size_t n)
+{
+    std::size_t cur = n_free.load(std::memory_order_relaxed);
+    std::size_t grant;
+    do
+    {
+        if (cur >= max_free)
+            return 0;
+        grant = std::min(n, max_free - cur);
+    } while (!n_free.compare_exchange_weak(cur, cur + grant, std::memory_order_relaxed));
+    std::size_t high = n_free_high_water.load(std::memory_order_relaxed);
+    while (cur + grant > high
+           && !n_free_high_water.compare_exchange_weak(high, cur + grant, std::memory_order_relaxed))
+    {
+    }
+    return grant;
+}
 
-public:
-    memory_pool_deleter(
-            std::shared_ptr<memory_pool> &&allocator,
-            memory_allocator::deleter &&base_deleter)
-        : state(std::make_shared<state_t>(std::move(allocator), std::move(base_deleter)))
+memory_pool_block *memory_pool_core::make_block(memory_allocator::pointer &&ptr)
+{
+    memory_pool_block *block = spare_headers.pop();
+    if (!block)
+        block = new_header();
+    block->data = ptr.get();
+    block->base_deleter = std::move(ptr.get_deleter());
+    ptr.release();
+    refs.fetch_add(1, std::memory_order_relaxed);
+    return block;
+}
+
+void memory_pool_core::destroy_block(memory_pool_block *block)
+{
+    block->base_deleter(block->data);
+    // Release any resources held by the deleter
+    block->base_deleter = nullptr;
+    block->data = nullptr;
+    spare_headers.push(block);
+    unref();
+}
+
+void memory_pool_core::unref()
+{
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete this;
+}
+
+bool memory_pool_core::add(memory_pool_block *block)
+{
+    if (reserve_credits(1) == 0)
     {
+        destroy_block(block);
+        return false;
     }
+    free_blocks.push(block);
+    return true;
+}
 
-    void operator()(std::uint8_t *ptr) const
+memory_pool_block *memory_pool_core::steal()
+{
+    memory_pool_block *block = free_blocks.pop();
+    for (std::size_t i = 0; i < num_magazines && !block; i++)
     {
-        state->allocator->free_impl(ptr, std::move(state->base_deleter));
-        // Allow the allocator to be freed even if the unique_ptr lingers on.
-        state->allocator.reset();
+        magazine &mag = magazines[i];
+        mag.lock();
+        if (mag.size > 0)
+        {
+            block = mag.blocks[--mag.size];
+            mag.credits--;
+        }
+        mag.unlock();
     }
+    if (block)
+    {
+        n_free.fetch_sub(1, std::memory_order_relaxed);
+        stolen.fetch_add(1, std::memory_order_relaxed);
+    }
+    return block;
+}
 
-    memory_allocator::deleter &get_base_deleter() { return state->base_deleter; }    
-    const memory_allocator::deleter &get_base_deleter() const { return state->base_deleter; }
-};
+memory_pool_block *memory_pool_core::get()
+{
+    memory_pool_block *block = nullptr;
+    magazine &mag = local_magazine();
+    mag.lock();
+    if (mag.size == 0 && magazine_size > 0)
+    {
+        // Move a batch of blocks (with their credits) from the shared stack
+        while (mag.size < batch_size)
+        {
+            memory_pool_block *next = free_blocks.pop();
+            if (!next)
+                break;
+            mag.blocks[mag.size++] = next;
+            mag.credits++;
+        }
+    }
+    if (mag.size > 0)
+    {
+        block = mag.blocks[--mag.size];
+        mag.gets++;
+        // The credit for the block stays with the magazine. Return surplus credits in bulk.
+        std::size_t surplus = mag.credits - mag.size;
+        if (surplus > batch_size)
+        {
+            n_free.fetch_sub(surplus, std::memory_order_relaxed);
+            mag.credits = mag.size;
+        }
+    }
+    mag.unlock();
+    /* Free blocks may be sitting in the magazines of threads that only free
+     * (for example, consumers of a ringbuffer). Fetch them rather than
+     * allocating more memory.
+     */
+    if (!block && free_count() > 0)
+        block = steal();
+    return block;
+}
+
+void memory_pool_core::put(memory_pool_block *block)
+{
+    magazine &mag = local_magazine();
+    mag.lock();
+    mag.puts++;
+    /* The magazine lock orders this with respect to close(): either close
+     * will see the block when it empties this magazine, or we see the flag.
+     * For the same reason, blocks are only pushed to the shared stack with
+     * the lock held.
+     */
+    if (closed.load(std::memory_order_relaxed))
+    {
+        mag.unlock();
+        destroy_block(block);
+        return;
+    }
+    if (mag.credits == mag.size)
+    {
+        std::size_t grant = reserve_credits(magazine_size == 0 ? 1 : batch_size);
+        if (grant == 0)
+        {
+            // The pool is full
+            mag.unlock();
+            destroy_block(block);
+            return;
+        }
+        mag.credits += grant;
+    }
+    if (magazine_size == 0)
+    {
+        free_blocks.push(block);
+        mag.credits--;
+    }
+    else
+    {
+        if (mag.size == magazine_size)
+        {
+            // Spill the oldest blocks to the shared stack
+            for (std::size_t i = 0; i < batch_size; i++)
+                free_blocks.push(mag.blocks[i]);
+            std::copy(mag.blocks + batch_size, mag.blocks + mag.size, mag.blocks);
+            mag.size -= batch_size;
+            mag.credits -= batch_size;
+        }
+        mag.blocks[mag.size++] = block;
+    }
+    mag.unlock();
+}
+
+void memory_pool_core::close()
+{
+    closed.store(true);
+    for (auto &mag : magazines)
+    {
+        memory_pool_block *blocks[max_magazine_size];
+        mag.lock();
+        std::size_t size = mag.size;
+        std::copy(mag.blocks, mag.blocks + size, blocks);
+        mag.size = 0;
+        mag.credits = 0;
+        mag.unlock();
+        // Base deleters run without the lock held, in case they re-enter the pool
+        for (std::size_t i = 0; i < size; i++)
+            destroy_block(blocks[i]);
+    }
+    while (memory_pool_block *block = free_blocks.pop())
+        destroy_block(block);
+    unref();
+}
+
+std::size_t memory_pool_core::free_block_count()
+{
+    std::size_t unused_credits = 0;
+    for (auto &mag : magazines)
+    {
+        mag.lock();
+        unused_credits += mag.credits - mag.size;
+        mag.unlock();
+    }
+    std::size_t reserved = free_count();
+    return reserved > unused_credits ? reserved - unused_credits : 0;
+}
+
+bool memory_pool_core::free_below(std::size_t threshold)
+{
+    std::size_t reserved = free_count();
+    if (reserved < threshold)
+        return true;
+    // Each magazine holds at most a batch of credits without blocks
+    if (threshold == 0 || reserved - threshold >= num_magazines * batch_size)
+        return false;
+    return free_block_count() < threshold;
+}
+
+void memory_pool_core::get_stats(
+    memory_pool_stats &stats, std::size_t block_size, std::uint64_t extra_gets)
+{
+    std::uint64_t gets = stolen.load(std::memory_order_relaxed);
+    std::uint64_t puts = 0;
+    for (auto &mag : magazines)
+    {
+        mag.lock();
+        gets += mag.gets;
+        puts += mag.puts;
+        mag.unlock();
+    }
+    stats.hits = gets;
+    stats.free = free_block_count();
+    stats.free_high_water = n_free_high_water.load(std::memory_order_relaxed);
+    // The counters are not read atomically, so the difference could be negative
+    gets += extra_gets;
+    stats.bytes_outstanding = gets > puts ? (gets - puts) * block_size : 0;
+}
+
+void memory_pool_deleter::operator()(std::uint8_t *ptr) const
+{
+    assert(ptr == block->data);
+    (void) ptr;
+    block->core->put(block);
+}
 
 } // namespace detail
 
+memory_pool::memory_pool()
+    : memory_pool(boost::none, 0, 0, 0, 0, 0, nullptr)
+{
+}
+
+memory_pool::memory_pool(std::size_t lower, std::size_t upper, std::size_t max_free, std::size_t initial,
+                         std::shared_ptr<memory_allocator> allocator)
+    : memory_pool(boost::none, lower, upper, max_free, initial, 0, std::move(allocator))
+{
+}
+
+memory_pool::memory_pool(
+    io_service_ref io_service,
+    std::size_t lower, std::size_t upper, std::size_t max_free, std::size_t initial,
+    std::size_t low_water,
+    std::shared_ptr<memory_allocator> allocator)
+    : memory_pool(boost::optional<io_service_ref>(std::move(io_service)),
+                  lower, upper, max_free, initial, low_water, std::move(allocator))
+{
+}
+
 memory_pool::memory_pool(
     boost::optional<io_service_ref> io_service,
     std::size_t lower, std::size_t upper, std::size_t max_free, std::size_t initial,
@@ -97,51 +571,38 @@ memory_pool::memory_pool(
     std::shared_ptr<memory_allocator> allocator)
     : io_service(std::move(io_service)), lower(lower), upper(upper), max_free(max_free),
     initial(initial), low_water(low_water),
-    base_allocator(allocator ? move(allocator) : std::make_shared<memory_allocator>())
+    base_allocator(allocator ? move(allocator) : std::make_shared<memory_allocator>()),
+    core(new detail::memory_pool_core(max_free))
 {
     assert(lower <= upper);
     assert(initial <= max_free);
     assert(low_water <= initial);
     assert(low_water == 0 || io_service);
-    for (std::size_t i = 0; i < initial; i++)
-        pool.emplace(base_allocator->allocate(upper, nullptr));
+    try
+    {
+        for (std::size_t i = 0; i < initial; i++)
+            core->add(core->make_block(base_allocator->allocate(upper, nullptr)));
+    }
+    catch (...)
+    {
+        core->close();
+        throw;
+    }
 }
 
-std::shared_ptr<memory_pool> memory_pool::shared_this()
+memory_pool::~memory_pool()
 {
-    return std::static_pointer_cast<memory_pool>(shared_from_this());
+    core->close();
 }
 
-void memory_pool::free_impl(std::uint8_t *ptr, memory_allocator::deleter &&base_deleter)
+std::shared_ptr<memory_pool> memory_pool::shared_this()
 {
-    pointer wrapped(ptr, std::move(base_deleter));
-    std::unique_lock<std::mutex> lock(mutex);
-    if (pool.size() < max_free)
-    {
-        log_debug("returning memory to the pool");
-        pool.push(std::move(wrapped));
-    }
-    else
-    {
-        log_debug("dropping memory because the pool is full");
-        lock.unlock();
-        // deleter for wrapped will free the memory
-    }
+    return std::static_pointer_cast<memory_pool>(shared_from_this());
 }
 
-memory_pool::pointer memory_pool::convert(pointer &&base)
+memory_pool::pointer memory_pool::convert(detail::memory_pool_block *block)
 {
-    /* TODO: in theory this might not be exception-safe, because in C++11
-     * the move constructor for std::function is not noexcept. Thus, after
-     * constructing the memory_pool_deleter argument, the construction of
-     * the pointer could fail. The lack of noexcept is assumed to be an
-     * oversight in older C++ standards, and GCC 9 at least makes it
-     * no-except.
-     */
-    pointer wrapped(base.get(),
-                    detail::memory_pool_deleter(shared_this(), std::move(base.get_deleter())));
-    base.release();
-    return wrapped;
+    return pointer(block->data, detail::memory_pool_deleter(block));
 }
 
 void memory_pool::refill(std::size_t upper, std::shared_ptr<memory_allocator> allocator,
@@ -149,21 +610,22 @@ void memory_pool::refill(std::size_t upper, std::shared_ptr<memory_allocator> al
 {
     while (true)
     {
+        auto start = std::chrono::steady_clock::now();
         pointer ptr = allocator->allocate(upper, nullptr);
         std::shared_ptr<memory_pool> self = self_weak.lock();
         if (!self)
         {
             break;  // The memory pool vanished from under us
         }
-        std::lock_guard<std::mutex> lock(self->mutex);
-        if (self->pool.size() < self->max_free)
-        {
+        if (self->core->add(self->core->make_block(std::move(ptr))))
             log_debug("adding background memory to the pool");
-            self->pool.push(std::move(ptr));
-        }
-        if (self->pool.size() >= self->initial)
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        self->refill_time_ns.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+            std::memory_order_relaxed);
+        if (!self->core->free_below(self->initial))
         {
-            self->refilling = false;
+            self->refilling.store(false);
             log_debug("exiting refill task");
             break;
         }
@@ -173,22 +635,15 @@ void memory_pool::refill(std::size_t upper, std::shared_ptr<memory_allocator> al
 memory_pool::pointer memory_pool::allocate(std::size_t size, void *hint)
 {
     (void) hint;
-    pointer ptr;
     if (size >= lower && size <= upper)
     {
-        /* Declaration order here is important: if there is an exception,
-         * we want to drop the lock before trying to put the pointer back in
-         * the pool.
-         */
-        std::unique_lock<std::mutex> lock(mutex);
-        if (!pool.empty())
+        detail::memory_pool_block *block = core->get();
+        if (block)
         {
-            ptr = std::move(pool.top());
-            pool.pop();
-            ptr = convert(std::move(ptr));
-            if (pool.size() < low_water && !refilling)
+            if (!refilling.load(std::memory_order_relaxed)
+                && core->free_below(low_water) && !refilling.exchange(true))
             {
-                refilling = true;
+                refills.fetch_add(1, std::memory_order_relaxed);
                 std::shared_ptr<memory_pool> self = shared_this();
                 std::weak_ptr<memory_pool> weak{self};
                 // C++ (or at least GCC) won't let me capture the members by value directly
@@ -198,39 +653,59 @@ memory_pool::pointer memory_pool::allocate(std::size_t size, void *hint)
                     refill(upper, allocator, std::move(weak));
                 });
             }
-            lock.unlock();
             log_debug("allocating %d bytes from pool", size);
+            return convert(block);
         }
         else
         {
-            // Copy the flag while the lock is held, to safely issue the
-            // warning after it is released.
-            bool warn = warn_on_empty;
-            lock.unlock();
-            ptr = convert(base_allocator->allocate(upper, nullptr));
-            if (warn)
+            pointer base = base_allocator->allocate(upper, nullptr);
+            empty.fetch_add(1, std::memory_order_relaxed);
+            if (warn_on_empty.load(std::memory_order_relaxed))
                 log_warning("memory pool is empty when allocating %d bytes", size);
             log_debug("allocating %d bytes which will be added to the pool", size);
+            return convert(core->make_block(std::move(base)));
         }
     }
     else
     {
         log_debug("allocating %d bytes without using the pool", size);
-        ptr = base_allocator->allocate(size, nullptr);
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return base_allocator->allocate(size, nullptr);
     }
-    return ptr;
 }
 
 void memory_pool::set_warn_on_empty(bool warn)
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    warn_on_empty = warn;
+    warn_on_empty.store(warn);
 }
 
 bool memory_pool::get_warn_on_empty() const
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    return warn_on_empty;
+    return warn_on_empty.load();
+}
+
+memory_pool_stats memory_pool::get_stats() const
+{
+    memory_pool_stats stats;
+    stats.misses = misses.load(std::memory_order_relaxed);
+    stats.empty = empty.load(std::memory_order_relaxed);
+    stats.refills = refills.load(std::memory_order_relaxed);
+    stats.refill_time_ns = refill_time_ns.load(std::memory_order_relaxed);
+    core->get_stats(stats, upper, stats.empty);
+    return stats;
+}
+
+memory_pool_stats &memory_pool_stats::operator+=(const memory_pool_stats &other)
+{
+    hits += other.hits;
+    misses += other.misses;
+    empty += other.empty;
+    refills += other.refills;
+    refill_time_ns += other.refill_time_ns;
+    free += other.free;
+    free_high_water += other.free_high_water;
+    bytes_outstanding += other.bytes_outstanding;
+    return *this;
 }
 
 const memory_allocator::deleter &memory_pool::get_base_deleter(const memory_allocator::pointer &ptr)
@@ -0,0 +1,91 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_MEMFD
+
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <spead2/common_logging.h>
+#include <spead2/common_mirrored_buffer.h>
+
+namespace spead2
+{
+
+namespace
+{
+
+// Closes a file descriptor when it goes out of scope
+class fd_guard
+{
+private:
+    int fd;
+public:
+    explicit fd_guard(int fd) : fd(fd) {}
+    ~fd_guard() { close(fd); }
+};
+
+} // anonymous namespace
+
+mirrored_buffer::mirrored_buffer(std::size_t size)
+{
+    std::size_t page_size = sysconf(_SC_PAGESIZE);
+    size = (size + page_size - 1) / page_size * page_size;
+    if (size == 0)
+        size = page_size;
+
+    int fd = memfd_create("spead2_mirrored_buffer", MFD_CLOEXEC);
+    if (fd < 0)
+        throw_errno("memfd_create failed");
+    fd_guard guard(fd);
+    if (ftruncate(fd, size) != 0)
+        throw_errno("ftruncate failed");
+
+    // Reserve address space for both mappings, then overlay them
+    void *base = mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        throw_errno("mmap failed");
+    std::uint8_t *data = static_cast<std::uint8_t *>(base);
+    for (int i = 0; i < 2; i++)
+    {
+        void *ret = mmap(data + i * size, size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_FIXED, fd, 0);
+        if (ret == MAP_FAILED)
+        {
+            int err = errno;
+            munmap(base, 2 * size);
+            throw_errno("mmap failed", err);
+        }
+    }
+    ptr = data;
+    buffer_size = size;
+}
+
+mirrored_buffer::~mirrored_buffer()
+{
+    munmap(ptr, 2 * buffer_size);
+}
+
+} // namespace spead2
+
+#endif // SPEAD2_USE_MEMFD
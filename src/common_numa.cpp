@@ -0,0 +1,271 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include <spead2/common_features.h>
+#include <spead2/common_logging.h>
+#include <spead2/common_numa.h>
+#if SPEAD2_USE_NUMA
+# include <unistd.h>
+# include <sys/syscall.h>
+# include <linux/mempolicy.h>
+#endif
+
+// Some operating systems only provide MAP_ANON
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+namespace spead2
+{
+
+namespace detail
+{
+
+std::vector<int> parse_id_list(const std::string &list)
+{
+    std::vector<int> out;
+    std::size_t pos = 0;
+    // Parses a non-negative integer at pos, advancing pos
+    auto parse_int = [&]() -> int
+    {
+        std::size_t start = pos;
+        long value = 0;
+        while (pos < list.size() && list[pos] >= '0' && list[pos] <= '9')
+        {
+            value = value * 10 + (list[pos] - '0');
+            if (value > INT_MAX)
+                throw std::invalid_argument("ID out of range in list '" + list + "'");
+            pos++;
+        }
+        if (pos == start)
+            throw std::invalid_argument("malformed ID list '" + list + "'");
+        return value;
+    };
+
+    // Trailing whitespace (typically a newline from sysfs) is ignored
+    std::size_t end = list.find_last_not_of(" \t\n");
+    std::size_t size = (end == std::string::npos) ? 0 : end + 1;
+    while (pos < size)
+    {
+        int first = parse_int();
+        int last = first;
+        if (pos < size && list[pos] == '-')
+        {
+            pos++;
+            last = parse_int();
+            if (last < first)
+                throw std::invalid_argument("malformed ID list '" + list + "'");
+        }
+        for (int i = first; i <= last; i++)
+            out.push_back(i);
+        if (pos < size)
+        {
+            if (list[pos] != ',')
+                throw std::invalid_argument("malformed ID list '" + list + "'");
+            pos++;
+            if (pos == size)
+                throw std::invalid_argument("malformed ID list '" + list + "'");
+        }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+} // namespace detail
+
+static const char sysfs_node_dir[] = "/sys/devices/system/node/";
+
+/**
+ * Read and parse an ID list from sysfs. Returns false if the file cannot be
+ * read or is malformed.
+ */
+static bool read_id_list(const std::string &filename, std::vector<int> &out)
+{
+    std::ifstream in(filename);
+    std::string line;
+    if (!in || !std::getline(in, line))
+        return false;
+    try
+    {
+        out = detail::parse_id_list(line);
+        return true;
+    }
+    catch (std::invalid_argument &e)
+    {
+        log_warning("Could not parse %1%: %2%", filename, e.what());
+        return false;
+    }
+}
+
+/// Topology information, loaded on first use
+struct numa_topology
+{
+    std::vector<int> nodes;
+    std::vector<std::vector<int>> cpus;   ///< CPUs for each entry in @a nodes
+
+    numa_topology()
+    {
+        if (read_id_list(std::string(sysfs_node_dir) + "online", nodes) && !nodes.empty())
+        {
+            for (int node : nodes)
+            {
+                std::vector<int> node_cpus;
+                read_id_list(std::string(sysfs_node_dir) + "node" + std::to_string(node) + "/cpulist",
+                             node_cpus);
+                cpus.push_back(std::move(node_cpus));
+            }
+        }
+        else
+        {
+            // No topology information: treat as a single node with all CPUs
+            nodes = {0};
+            std::vector<int> all;
+            int n = std::max(1U, std::thread::hardware_concurrency());
+            for (int i = 0; i < n; i++)
+                all.push_back(i);
+            cpus.push_back(std::move(all));
+        }
+    }
+
+    /// Index of @a node in @a nodes, or -1
+    int index(int node) const
+    {
+        auto pos = std::lower_bound(nodes.begin(), nodes.end(), node);
+        if (pos == nodes.end() || *pos != node)
+            return -1;
+        return pos - nodes.begin();
+    }
+};
+
+static const numa_topology &get_topology()
+{
+    static const numa_topology topology;
+    return topology;
+}
+
+static int check_node(int node)
+{
+    int idx = get_topology().index(node);
+    if (idx < 0)
+        throw std::invalid_argument("NUMA node " + std::to_string(node) + " is not online");
+    return idx;
+}
+
+const std::vector<int> &numa_nodes()
+{
+    return get_topology().nodes;
+}
+
+std::vector<int> numa_node_cpus(int node)
+{
+    return get_topology().cpus[check_node(node)];
+}
+
+int numa_cpu_node(int cpu)
+{
+    const numa_topology &topology = get_topology();
+    for (std::size_t i = 0; i < topology.nodes.size(); i++)
+        if (std::binary_search(topology.cpus[i].begin(), topology.cpus[i].end(), cpu))
+            return topology.nodes[i];
+    return -1;
+}
+
+#if SPEAD2_USE_NUMA
+/// Node mask in the form expected by the memory policy system calls
+class node_mask
+{
+private:
+    static constexpr int bits_per_word = sizeof(unsigned long) * CHAR_BIT;
+    std::vector<unsigned long> words;
+
+public:
+    explicit node_mask(int node) : words(node / bits_per_word + 1)
+    {
+        words[node / bits_per_word] = 1UL << (node % bits_per_word);
+    }
+
+    const unsigned long *data() const { return words.data(); }
+    // The kernel ignores the last bit of maxnode, so add one
+    unsigned long max_node() const { return words.size() * bits_per_word + 1; }
+};
+
+constexpr int node_mask::bits_per_word;
+#endif
+
+/// Whether memory placement is worth doing at all
+static bool numa_active()
+{
+    return SPEAD2_USE_NUMA && numa_nodes().size() > 1;
+}
+
+void numa_set_preferred_node(int node)
+{
+    check_node(node);
+    if (!numa_active())
+        return;
+#if SPEAD2_USE_NUMA
+    node_mask mask(node);
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.data(), mask.max_node()) != 0)
+        log_errno("set_mempolicy failed: %1% (%2%)");
+#endif
+}
+
+numa_allocator::numa_allocator(int node, bool strict, int flags)
+    : node(node), strict(strict), flags(flags)
+{
+    check_node(node);
+}
+
+numa_allocator::pointer numa_allocator::allocate(std::size_t size, void *hint)
+{
+    (void) hint;
+    /* MAP_POPULATE is not used, because the pages must only be faulted in
+     * once the policy is in place.
+     */
+    std::uint8_t *ptr = (std::uint8_t *) mmap(
+        nullptr, size, PROT_READ | PROT_WRITE, flags | MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ptr == MAP_FAILED)
+        throw std::bad_alloc();
+#if SPEAD2_USE_NUMA
+    if (numa_active())
+    {
+        node_mask mask(node);
+        if (syscall(SYS_mbind, ptr, size, strict ? MPOL_BIND : MPOL_PREFERRED,
+                    mask.data(), mask.max_node(), 0) != 0)
+            log_errno("mbind failed: %1% (%2%)");
+    }
+#endif
+    prefault(ptr, size);
+    return pointer(ptr, [size](std::uint8_t *ptr) { munmap(ptr, size); });
+}
+
+} // namespace spead2
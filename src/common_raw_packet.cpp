@@ -36,6 +36,7 @@
 #include <sys/socket.h>
 #include <net/ethernet.h>
 #include <net/if_arp.h>
+#include <net/if.h>
 #include <ifaddrs.h>
 #include <spead2/common_raw_packet.h>
 #include <spead2/common_endian.h>
@@ -75,15 +76,9 @@ struct freeifaddrs_deleter
 };
 } // anonymous namespace
 
-mac_address interface_mac(const boost::asio::ip::address &address)
+// Map an IP address to the name of the interface that has it
+static const char *find_interface_name(ifaddrs *ifap, const boost::asio::ip::address &address)
 {
-    ifaddrs *ifap;
-    if (getifaddrs(&ifap) < 0)
-        throw std::system_error(errno, std::system_category(), "getifaddrs failed");
-    std::unique_ptr<ifaddrs, freeifaddrs_deleter> ifap_owner(ifap);
-
-    // Map address to an interface name
-    char *if_name = nullptr;
     for (ifaddrs *cur = ifap; cur; cur = cur->ifa_next)
     {
         if (cur->ifa_addr && *(sa_family_t *) cur->ifa_addr == AF_INET && address.is_v4())
@@ -91,26 +86,27 @@ mac_address interface_mac(const boost::asio::ip::address &address)
             const sockaddr_in *cur_address = (const sockaddr_in *) cur->ifa_addr;
             const auto expected = address.to_v4().to_bytes();
             if (memcmp(&cur_address->sin_addr, &expected, sizeof(expected)) == 0)
-            {
-                if_name = cur->ifa_name;
-                break;
-            }
+                return cur->ifa_name;
         }
         else if (cur->ifa_addr && *(sa_family_t *) cur->ifa_addr == AF_INET6 && address.is_v6())
         {
             const sockaddr_in6 *cur_address = (const sockaddr_in6 *) cur->ifa_addr;
             const auto expected = address.to_v6().to_bytes();
             if (memcmp(&cur_address->sin6_addr, &expected, sizeof(expected)) == 0)
-            {
-                if_name = cur->ifa_name;
-                break;
-            }
+                return cur->ifa_name;
         }
     }
-    if (!if_name)
-    {
-        throw std::runtime_error("no interface found with the address " + address.to_string());
-    }
+    throw std::runtime_error("no interface found with the address " + address.to_string());
+}
+
+mac_address interface_mac(const boost::asio::ip::address &address)
+{
+    ifaddrs *ifap;
+    if (getifaddrs(&ifap) < 0)
+        throw std::system_error(errno, std::system_category(), "getifaddrs failed");
+    std::unique_ptr<ifaddrs, freeifaddrs_deleter> ifap_owner(ifap);
+
+    const char *if_name = find_interface_name(ifap, address);
 
     // Now find the MAC address for this interface
     for (ifaddrs *cur = ifap; cur; cur = cur->ifa_next)
@@ -144,6 +140,20 @@ mac_address interface_mac(const boost::asio::ip::address &address)
     throw std::runtime_error(std::string("no MAC address found for interface ") + if_name);
 }
 
+unsigned int interface_index(const boost::asio::ip::address &address)
+{
+    ifaddrs *ifap;
+    if (getifaddrs(&ifap) < 0)
+        throw std::system_error(errno, std::system_category(), "getifaddrs failed");
+    std::unique_ptr<ifaddrs, freeifaddrs_deleter> ifap_owner(ifap);
+
+    const char *if_name = find_interface_name(ifap, address);
+    unsigned int index = if_nametoindex(if_name);
+    if (index == 0)
+        throw std::system_error(errno, std::system_category(), "if_nametoindex failed");
+    return index;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 packet_buffer::packet_buffer() : ptr(nullptr), length(0) {}
@@ -254,17 +264,20 @@ packet_buffer udp_from_ethernet(void *ptr, size_t size)
     if (eth.ethertype_be() != htobe(ipv4_packet::ethertype))
         throw packet_type_error("Frame has wrong ethernet type (VLAN tagging?), discarding");
     else
-    {
-        ipv4_packet ipv4 = eth.payload_ipv4();
-        if (ipv4.version() != 4)
-            throw packet_type_error("Frame is not IPv4, discarding");
-        else if (ipv4.is_fragment())
-            throw packet_type_error("IP datagram is fragmented, discarding");
-        else if (ipv4.protocol() != udp_packet::protocol)
-            throw packet_type_error("Packet is not UDP, discarding");
-        else
-            return ipv4.payload_udp().payload();
-    }
+        return udp_from_ipv4(eth.data() + ethernet_frame::min_size, eth.size() - ethernet_frame::min_size);
+}
+
+packet_buffer udp_from_ipv4(void *ptr, size_t size)
+{
+    ipv4_packet ipv4(ptr, size);
+    if (ipv4.version() != 4)
+        throw packet_type_error("Frame is not IPv4, discarding");
+    else if (ipv4.is_fragment())
+        throw packet_type_error("IP datagram is fragmented, discarding");
+    else if (ipv4.protocol() != udp_packet::protocol)
+        throw packet_type_error("Packet is not UDP, discarding");
+    else
+        return ipv4.payload_udp().payload();
 }
 
 } // namespace spead2
@@ -31,11 +31,21 @@
 #include <fcntl.h>
 #include <poll.h>
 #include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <cassert>
+#include <thread>
 #include <spead2/common_semaphore.h>
 #include <spead2/common_logging.h>
 #if SPEAD2_USE_EVENTFD
 # include <sys/eventfd.h>
 #endif
+#if SPEAD2_USE_FUTEX
+# include <sys/syscall.h>
+# include <linux/futex.h>
+#endif
 
 namespace spead2
 {
@@ -50,6 +60,11 @@ void semaphore_spin::put()
     value.fetch_add(1, std::memory_order_release);
 }
 
+void semaphore_spin::put(std::size_t n)
+{
+    value.fetch_add(n, std::memory_order_release);
+}
+
 int semaphore_spin::get()
 {
     unsigned int cur = value.load(std::memory_order_acquire);
@@ -100,6 +115,13 @@ void semaphore_posix::put()
         throw_errno("sem_post failed");
 }
 
+void semaphore_posix::put(std::size_t n)
+{
+    // There is no batch operation, but sem_post is cheap when uncontended
+    for (std::size_t i = 0; i < n; i++)
+        put();
+}
+
 int semaphore_posix::try_get()
 {
     int status = sem_trywait(&sem);
@@ -212,6 +234,22 @@ void semaphore_pipe::put()
     } while (status < 0);
 }
 
+void semaphore_pipe::put(std::size_t n)
+{
+    static const char zeros[256] = {};
+    while (n > 0)
+    {
+        ssize_t status = write(pipe_fds[1], zeros, std::min(n, sizeof(zeros)));
+        if (status < 0)
+        {
+            if (errno != EINTR)
+                throw_errno("write failed");
+        }
+        else
+            n -= status;
+    }
+}
+
 int semaphore_pipe::get()
 {
     char byte = 0;
@@ -316,6 +354,17 @@ void semaphore_eventfd::put()
     } while (status == -1);
 }
 
+void semaphore_eventfd::put(std::size_t n)
+{
+    if (n == 0)
+        return;
+    while (eventfd_write(fd, n) == -1)
+    {
+        if (errno != EINTR)
+            throw_errno("eventfd_write failed");
+    }
+}
+
 int semaphore_eventfd::try_get()
 {
     eventfd_t value;
@@ -380,4 +429,204 @@ boost::asio::posix::stream_descriptor wrap_fd(boost::asio::io_service &io_servic
     return wrapper;
 }
 
+/////////////////////////////////////////////////////////////////////////////
+
+#if SPEAD2_USE_FUTEX
+
+static int futex(std::atomic<std::uint32_t> *addr, int op, std::uint32_t val)
+{
+    return syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(addr), op, val,
+                   nullptr, nullptr, 0);
+}
+
+// Spinning only helps if the thread that will put the semaphore can run meanwhile
+static bool spin_useful()
+{
+    static const bool useful = std::thread::hardware_concurrency() != 1;
+    return useful;
+}
+
+static inline void cpu_relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+}
+
+constexpr unsigned int semaphore_futex::default_spin_count;
+
+semaphore_futex::semaphore_futex(unsigned int initial, unsigned int spin_count)
+    : value(initial), spin_count(spin_useful() ? spin_count : 0)
+{
+}
+
+std::uint32_t semaphore_futex::increment(std::uint32_t n)
+{
+    /* The sequentially consistent operations here and in decrement ensure
+     * that either we see the waiter, or the waiter sees the new value.
+     */
+    std::uint32_t old = value.fetch_add(n);
+    if (waiters.load() > 0)
+    {
+        if (futex(&value, FUTEX_WAKE_PRIVATE, std::min(n, std::uint32_t(INT_MAX))) == -1)
+            throw_errno("futex failed");
+    }
+    return old;
+}
+
+bool semaphore_futex::try_decrement(std::uint32_t &old)
+{
+    old = value.load();
+    while (old > 0)
+    {
+        if (value.compare_exchange_weak(old, old - 1))
+            return true;
+    }
+    return false;
+}
+
+int semaphore_futex::decrement(std::uint32_t &old)
+{
+    for (unsigned int i = 0; i < spin_count; i++)
+    {
+        if (try_decrement(old))
+            return 0;
+        cpu_relax();
+    }
+
+    int result = 0;
+    waiters.fetch_add(1);
+    while (!try_decrement(old))
+    {
+        // Only sleeps if the value is still zero
+        if (futex(&value, FUTEX_WAIT_PRIVATE, 0) == -1)
+        {
+            if (errno == EINTR)
+            {
+                result = -1;
+                break;
+            }
+            else if (errno != EAGAIN)
+            {
+                waiters.fetch_sub(1);
+                throw_errno("futex failed");
+            }
+        }
+    }
+    waiters.fetch_sub(1);
+    if (result == -1 && value.load() > 0 && waiters.load() > 0)
+    {
+        // We may have absorbed a wakeup meant for another waiter: pass it on
+        futex(&value, FUTEX_WAKE_PRIVATE, 1);
+    }
+    return result;
+}
+
+void semaphore_futex::put()
+{
+    increment(1);
+}
+
+void semaphore_futex::put(std::size_t n)
+{
+    assert(n <= UINT32_MAX);
+    if (n > 0)
+        increment(n);
+}
+
+int semaphore_futex::get()
+{
+    std::uint32_t old;
+    return decrement(old);
+}
+
+int semaphore_futex::try_get()
+{
+    std::uint32_t old;
+    return try_decrement(old) ? 0 : -1;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+semaphore_futex_fd::semaphore_futex_fd(unsigned int initial, unsigned int spin_count)
+    : semaphore_futex(initial, spin_count)
+{
+}
+
+void semaphore_futex_fd::sync_fd() const
+{
+    while (true)
+    {
+        while (fd_sem.try_get() == 0)
+        {
+        }
+        if (current() == 0)
+            return;
+        fd_sem.put();
+        /* If the value dropped to zero before we put, the getter may have
+         * drained the file descriptor before our token arrived, so go around
+         * again to remove it.
+         */
+        if (current() > 0)
+            return;
+    }
+}
+
+void semaphore_futex_fd::increased(std::uint32_t old)
+{
+    if (old == 0 && fd_active.load())
+    {
+        fd_sem.put();
+        // A getter may have taken the value back to zero and drained before our put
+        if (current() == 0)
+            sync_fd();
+    }
+}
+
+void semaphore_futex_fd::decreased(std::uint32_t old)
+{
+    if (old == 1 && fd_active.load())
+        sync_fd();
+}
+
+void semaphore_futex_fd::put()
+{
+    increased(increment(1));
+}
+
+void semaphore_futex_fd::put(std::size_t n)
+{
+    assert(n <= UINT32_MAX);
+    if (n > 0)
+        increased(increment(n));
+}
+
+int semaphore_futex_fd::get()
+{
+    std::uint32_t old;
+    int result = decrement(old);
+    if (result == 0)
+        decreased(old);
+    return result;
+}
+
+int semaphore_futex_fd::try_get()
+{
+    std::uint32_t old;
+    if (!try_decrement(old))
+        return -1;
+    decreased(old);
+    return 0;
+}
+
+int semaphore_futex_fd::get_fd() const
+{
+    // Bring the file descriptor in line with the current value
+    if (!fd_active.exchange(true))
+        sync_fd();
+    return fd_sem.get_fd();
+}
+
+#endif // SPEAD2_USE_FUTEX
+
 } // namespace spead2
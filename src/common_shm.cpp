@@ -0,0 +1,358 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_SHM
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <climits>
+#include <atomic>
+#include <string>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <spead2/common_logging.h>
+#include <spead2/common_shm.h>
+
+namespace spead2
+{
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "shared-memory queues need lock-free atomics");
+
+/**
+ * Layout at the start of the shared memory segment. The producer and consumer
+ * positions are on separate cache lines to avoid false sharing.
+ */
+struct shm_queue::header
+{
+    static constexpr std::uint64_t magic_value = 0x5350454144324d51;  // "SPEAD2MQ"
+
+    std::atomic<std::uint64_t> magic;   ///< Set last, once the rest is valid
+    std::uint64_t slot_size;
+    std::uint64_t num_slots;
+    std::uint64_t slot_stride;
+
+    alignas(64) std::atomic<std::uint64_t> head;   ///< Packets committed (producer)
+    alignas(64) std::atomic<std::uint64_t> tail;   ///< Packets released (consumer)
+    alignas(64) std::atomic<std::uint32_t> data_futex;  ///< Bumped to wake the consumer
+    std::atomic<std::uint32_t> consumer_waiting;
+    std::atomic<std::uint32_t> stopped;
+    std::atomic<std::uint32_t> closed;
+    std::atomic<std::int32_t> consumer_pid;   ///< Receiving process (0 if unknown)
+};
+
+constexpr std::uint64_t shm_queue::header::magic_value;
+constexpr std::size_t shm_queue::default_slot_size;
+constexpr std::size_t shm_queue::default_num_slots;
+
+// Space for the packet size before each slot
+static constexpr std::size_t slot_prefix = 8;
+static constexpr std::size_t slot_align = 64;
+
+// Space reserved for the header at the start of the segment
+static constexpr std::size_t header_size = 4096;
+
+static int futex(std::atomic<std::uint32_t> *addr, int op, std::uint32_t val)
+{
+    // Not FUTEX_PRIVATE_FLAG, since the waker may be in another process
+    return syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(addr), op, val,
+                   nullptr, nullptr, 0);
+}
+
+shm_queue::shm_queue(const std::string &name, std::size_t slot_size, std::size_t num_slots)
+{
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1)
+        throw_errno("shm_open failed");
+    unlink_name = name;
+    try
+    {
+        create(slot_size, num_slots);
+    }
+    catch (...)
+    {
+        cleanup();
+        throw;
+    }
+}
+
+shm_queue::shm_queue(const std::string &name)
+{
+    fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd == -1)
+        throw_errno("shm_open failed");
+    try
+    {
+        attach();
+    }
+    catch (...)
+    {
+        cleanup();
+        throw;
+    }
+}
+
+shm_queue::shm_queue(std::size_t slot_size, std::size_t num_slots)
+{
+#if SPEAD2_USE_MEMFD
+    fd = memfd_create("spead2_shm_queue", MFD_CLOEXEC);
+    if (fd == -1)
+        throw_errno("memfd_create failed");
+#else
+    // Create with a unique name then remove it, leaving only the descriptor
+    static std::atomic<unsigned int> counter{0};
+    std::string name = "/spead2-" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1)
+        throw_errno("shm_open failed");
+    shm_unlink(name.c_str());
+#endif
+    try
+    {
+        create(slot_size, num_slots);
+    }
+    catch (...)
+    {
+        cleanup();
+        throw;
+    }
+}
+
+shm_queue::shm_queue(int fd)
+{
+    this->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (this->fd == -1)
+        throw_errno("fcntl failed");
+    try
+    {
+        attach();
+    }
+    catch (...)
+    {
+        cleanup();
+        throw;
+    }
+}
+
+shm_queue::~shm_queue()
+{
+    cleanup();
+}
+
+void shm_queue::cleanup()
+{
+    if (hdr)
+    {
+        if (munmap(hdr, mapped_size) != 0)
+            log_errno("munmap failed: %1% (%2%)");
+        hdr = nullptr;
+    }
+    if (fd != -1)
+    {
+        if (::close(fd) != 0)
+            log_errno("close failed: %1% (%2%)");
+        fd = -1;
+    }
+    if (!unlink_name.empty())
+    {
+        if (shm_unlink(unlink_name.c_str()) != 0)
+            log_errno("shm_unlink failed: %1% (%2%)");
+        unlink_name.clear();
+    }
+}
+
+void shm_queue::create(std::size_t slot_size, std::size_t num_slots)
+{
+    if (slot_size == 0 || num_slots == 0)
+        throw std::invalid_argument("slot_size and num_slots must be positive");
+    static_assert(sizeof(header) <= header_size, "header_size is too small");
+    std::size_t stride = (slot_prefix + slot_size + slot_align - 1) / slot_align * slot_align;
+    if (num_slots > (SIZE_MAX - header_size) / stride)
+        throw std::invalid_argument("queue is too large");
+    std::size_t size = header_size + num_slots * stride;
+    if (ftruncate(fd, size) != 0)
+        throw_errno("ftruncate failed");
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED)
+        throw_errno("mmap failed");
+    mapped_size = size;
+    // The segment is zero-filled, which is a valid state for the atomics
+    hdr = new(ptr) header;
+    hdr->slot_size = slot_size;
+    hdr->num_slots = num_slots;
+    hdr->slot_stride = stride;
+    hdr->head.store(0, std::memory_order_relaxed);
+    hdr->tail.store(0, std::memory_order_relaxed);
+    hdr->data_futex.store(0, std::memory_order_relaxed);
+    hdr->consumer_waiting.store(0, std::memory_order_relaxed);
+    hdr->stopped.store(0, std::memory_order_relaxed);
+    hdr->closed.store(0, std::memory_order_relaxed);
+    hdr->consumer_pid.store(0, std::memory_order_relaxed);
+    hdr->magic.store(header::magic_value, std::memory_order_release);
+    this->slot_size = slot_size;
+    this->num_slots = num_slots;
+    slot_stride = stride;
+    slots = reinterpret_cast<std::uint8_t *>(ptr) + header_size;
+}
+
+void shm_queue::attach()
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        throw_errno("fstat failed");
+    std::size_t size = st.st_size;
+    if (size < header_size)
+        throw std::invalid_argument("shared memory object is not a spead2 queue");
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED)
+        throw_errno("mmap failed");
+    mapped_size = size;
+    hdr = reinterpret_cast<header *>(ptr);
+    /* The header was written by another process, so check it carefully:
+     * slot() divides by num_slots, and the producer writes up to slot_size
+     * bytes after the prefix of every slot.
+     */
+    if (hdr->magic.load(std::memory_order_acquire) != header::magic_value
+        || hdr->num_slots == 0
+        || hdr->slot_stride <= slot_prefix
+        || hdr->slot_size == 0
+        || hdr->slot_size > hdr->slot_stride - slot_prefix
+        || hdr->num_slots > (size - header_size) / hdr->slot_stride)
+        throw std::invalid_argument("shared memory object is not a spead2 queue");
+    slot_size = hdr->slot_size;
+    num_slots = hdr->num_slots;
+    slot_stride = hdr->slot_stride;
+    slots = reinterpret_cast<std::uint8_t *>(ptr) + header_size;
+}
+
+std::uint8_t *shm_queue::slot(std::uint64_t index) const
+{
+    return slots + (index % num_slots) * slot_stride;
+}
+
+void shm_queue::wake_consumer()
+{
+    hdr->data_futex.fetch_add(1, std::memory_order_seq_cst);
+    futex(&hdr->data_futex, FUTEX_WAKE, INT_MAX);
+}
+
+std::size_t shm_queue::free_slots() const
+{
+    std::uint64_t head = hdr->head.load(std::memory_order_relaxed);
+    std::uint64_t tail = hdr->tail.load(std::memory_order_acquire);
+    return num_slots - (head - tail);
+}
+
+std::uint8_t *shm_queue::get_free_slot(std::size_t i, std::size_t size)
+{
+    std::uint8_t *ptr = slot(hdr->head.load(std::memory_order_relaxed) + i);
+    *reinterpret_cast<std::uint64_t *>(ptr) = size;
+    return ptr + slot_prefix;
+}
+
+void shm_queue::commit(std::size_t n)
+{
+    hdr->head.fetch_add(n, std::memory_order_release);
+    /* Pairs with the fence in wait_for_data: either the consumer sees the
+     * new head, or we see that it is waiting.
+     */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (hdr->consumer_waiting.load(std::memory_order_relaxed))
+        wake_consumer();
+}
+
+void shm_queue::stop()
+{
+    hdr->stopped.store(1, std::memory_order_release);
+    wake_consumer();
+}
+
+bool shm_queue::is_closed() const
+{
+    return hdr->closed.load(std::memory_order_relaxed);
+}
+
+bool shm_queue::consumer_exited() const
+{
+    pid_t pid = hdr->consumer_pid.load(std::memory_order_relaxed);
+    return pid > 0 && kill(pid, 0) == -1 && errno == ESRCH;
+}
+
+void shm_queue::set_consumer()
+{
+    hdr->consumer_pid.store(getpid(), std::memory_order_relaxed);
+}
+
+std::size_t shm_queue::filled_slots() const
+{
+    return hdr->head.load(std::memory_order_acquire) - hdr->tail.load(std::memory_order_relaxed);
+}
+
+const std::uint8_t *shm_queue::get_filled_slot(std::size_t i, std::size_t &size) const
+{
+    const std::uint8_t *ptr = slot(hdr->tail.load(std::memory_order_relaxed) + i);
+    size = *reinterpret_cast<const std::uint64_t *>(ptr);
+    if (size > slot_size)
+        size = 0;   // corrupt; the caller will discard it
+    return ptr + slot_prefix;
+}
+
+void shm_queue::release(std::size_t n)
+{
+    hdr->tail.fetch_add(n, std::memory_order_release);
+}
+
+bool shm_queue::is_stopped() const
+{
+    return hdr->stopped.load(std::memory_order_acquire);
+}
+
+void shm_queue::wait_for_data(const std::atomic<bool> &interrupt)
+{
+    hdr->consumer_waiting.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::uint32_t seq = hdr->data_futex.load(std::memory_order_relaxed);
+    // Check again now that the producer is guaranteed to wake us
+    if (filled_slots() == 0 && !is_stopped() && !interrupt.load())
+        futex(&hdr->data_futex, FUTEX_WAIT, seq);
+    hdr->consumer_waiting.store(0, std::memory_order_relaxed);
+}
+
+void shm_queue::interrupt_consumer()
+{
+    wake_consumer();
+}
+
+void shm_queue::close()
+{
+    hdr->closed.store(1, std::memory_order_relaxed);
+}
+
+} // namespace spead2
+
+#endif // SPEAD2_USE_SHM
@@ -0,0 +1,143 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <boost/optional.hpp>
+#include <spead2/common_logging.h>
+#include <spead2/common_memory_pool.h>
+#include <spead2/common_slab_pool.h>
+
+namespace spead2
+{
+
+slab_pool::size_class::size_class(
+    std::size_t size, std::size_t max_free, std::size_t initial, std::size_t low_water)
+    : size(size), max_free(max_free), initial(initial), low_water(low_water)
+{
+}
+
+slab_pool::slab_pool(std::vector<size_class> classes, std::shared_ptr<memory_allocator> allocator)
+    : slab_pool(boost::none, std::move(classes), std::move(allocator))
+{
+}
+
+slab_pool::slab_pool(
+    io_service_ref io_service, std::vector<size_class> classes,
+    std::shared_ptr<memory_allocator> allocator)
+    : slab_pool(boost::optional<io_service_ref>(std::move(io_service)),
+                std::move(classes), std::move(allocator))
+{
+}
+
+slab_pool::slab_pool(
+    boost::optional<io_service_ref> io_service, std::vector<size_class> classes,
+    std::shared_ptr<memory_allocator> allocator)
+    : classes(std::move(classes)),
+    base_allocator(allocator ? std::move(allocator) : std::make_shared<memory_allocator>())
+{
+    std::size_t lower = 0;
+    for (const size_class &c : this->classes)
+    {
+        if (c.size < lower)
+            throw std::invalid_argument("size classes must be strictly increasing");
+        if (c.initial > c.max_free)
+            throw std::invalid_argument("initial must not be greater than max_free");
+        if (c.low_water > c.initial)
+            throw std::invalid_argument("low_water must not be greater than initial");
+        if (c.low_water > 0 && !io_service)
+            throw std::invalid_argument("low_water requires a thread pool");
+        if (io_service)
+            pools.push_back(std::make_shared<memory_pool>(
+                *io_service, lower, c.size, c.max_free, c.initial, c.low_water, base_allocator));
+        else
+            pools.push_back(std::make_shared<memory_pool>(
+                lower, c.size, c.max_free, c.initial, base_allocator));
+        lower = c.size + 1;
+    }
+}
+
+std::vector<slab_pool::size_class> slab_pool::power_of_two_classes(
+    std::size_t min_size, std::size_t max_size,
+    std::size_t max_free, std::size_t initial, std::size_t low_water)
+{
+    if (min_size > max_size)
+        throw std::invalid_argument("min_size must not be greater than max_size");
+    std::vector<size_class> out;
+    std::size_t size = 1;
+    while (size < min_size)
+        size *= 2;
+    while (true)
+    {
+        out.emplace_back(size, max_free, initial, low_water);
+        if (size >= max_size)
+            break;
+        size *= 2;
+    }
+    return out;
+}
+
+bool slab_pool::get_warn_on_empty() const
+{
+    for (const auto &pool : pools)
+        if (!pool->get_warn_on_empty())
+            return false;
+    return true;
+}
+
+void slab_pool::set_warn_on_empty(bool warn)
+{
+    for (const auto &pool : pools)
+        pool->set_warn_on_empty(warn);
+}
+
+std::vector<memory_pool_stats> slab_pool::get_class_stats() const
+{
+    std::vector<memory_pool_stats> out;
+    out.reserve(pools.size());
+    for (const auto &pool : pools)
+        out.push_back(pool->get_stats());
+    return out;
+}
+
+memory_pool_stats slab_pool::get_stats() const
+{
+    memory_pool_stats out;
+    for (const auto &pool : pools)
+        out += pool->get_stats();
+    out.misses += misses.load(std::memory_order_relaxed);
+    return out;
+}
+
+slab_pool::pointer slab_pool::allocate(std::size_t size, void *hint)
+{
+    // There are few classes, so a linear search is as fast as anything else
+    for (std::size_t i = 0; i < classes.size(); i++)
+        if (size <= classes[i].size)
+            return pools[i]->allocate(size, hint);
+    log_debug("allocating %d bytes without using the slab pool", size);
+    misses.fetch_add(1, std::memory_order_relaxed);
+    return base_allocator->allocate(size, hint);
+}
+
+} // namespace spead2
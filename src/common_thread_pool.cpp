@@ -25,6 +25,7 @@
 #include <spead2/common_thread_pool.h>
 #include <spead2/common_logging.h>
 #include <spead2/common_features.h>
+#include <spead2/common_numa.h>
 #if SPEAD2_USE_PTHREAD_SETAFFINITY_NP
 # include <sched.h>
 # include <pthread.h>
@@ -91,6 +92,29 @@ thread_pool::thread_pool(int num_threads, const std::vector<int> &affinity)
     }
 }
 
+thread_pool::thread_pool(int num_threads, numa_nodes_tag, const std::vector<int> &nodes)
+    : work(io_service)
+{
+    if (num_threads < 1)
+        throw std::invalid_argument("at least one thread is required");
+    if (nodes.empty())
+        throw std::invalid_argument("at least one NUMA node is required");
+    std::vector<std::vector<int>> node_cpus;
+    for (int node : nodes)
+        node_cpus.push_back(numa_node_cpus(node));
+    workers.reserve(num_threads);
+    for (int i = 0; i < num_threads; i++)
+    {
+        int node = nodes[i % nodes.size()];
+        const std::vector<int> &cpus = node_cpus[i % nodes.size()];
+        workers.push_back(std::async(std::launch::async, [this, node, cpus] {
+            set_affinity(cpus);
+            numa_set_preferred_node(node);
+            run_io_service(io_service);
+        }));
+    }
+}
+
 void thread_pool::set_affinity(int core)
 {
 #if SPEAD2_USE_PTHREAD_SETAFFINITY_NP
@@ -113,6 +137,31 @@ void thread_pool::set_affinity(int core)
 #endif
 }
 
+void thread_pool::set_affinity(const std::vector<int> &cores)
+{
+#if SPEAD2_USE_PTHREAD_SETAFFINITY_NP
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int core : cores)
+    {
+        if (core < 0 || core >= CPU_SETSIZE)
+            log_warning("Core ID %1% is out of range for a CPU_SET", core);
+        else
+            CPU_SET(core, &set);
+    }
+    if (CPU_COUNT(&set) == 0)
+        return;
+    int status = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (status != 0)
+    {
+        std::error_code code(status, std::system_category());
+        log_warning("Failed to bind to %1% cores: %2% (%3%)", CPU_COUNT(&set), code.value(), code.message());
+    }
+#else
+    log_warning("Could not set affinity: pthread_setaffinity_np not detected");
+#endif
+}
+
 void thread_pool::stop()
 {
     io_service.stop();
@@ -31,8 +31,12 @@
 #include <spead2/common_flavour.h>
 #include <spead2/common_logging.h>
 #include <spead2/common_memory_pool.h>
+#include <spead2/common_slab_pool.h>
+#include <spead2/common_numa.h>
+#include <spead2/common_memfd_allocator.h>
 #include <spead2/common_thread_pool.h>
 #include <spead2/common_inproc.h>
+#include <spead2/common_shm.h>
 #if SPEAD2_USE_IBV
 # include <spead2/common_ibv.h>
 #endif
@@ -297,7 +301,37 @@ void register_module(py::module m)
 
     py::class_<mmap_allocator, memory_allocator, std::shared_ptr<mmap_allocator>>(
         m, "MmapAllocator")
-        .def(py::init<int>(), "flags"_a=0);
+        .def(py::init<int, bool>(), "flags"_a=0, "prefer_huge"_a=false);
+
+    py::class_<hugepage_allocator, memory_allocator, std::shared_ptr<hugepage_allocator>>
+        hugepage_allocator_cls(m, "HugepageAllocator");
+    py::enum_<hugepage_allocator::mode>(hugepage_allocator_cls, "Mode")
+        .value("NORMAL", hugepage_allocator::mode::NORMAL)
+        .value("TRANSPARENT", hugepage_allocator::mode::TRANSPARENT)
+        .value("HUGETLB", hugepage_allocator::mode::HUGETLB);
+    hugepage_allocator_cls
+        .def(py::init<std::size_t, int, bool>(), "page_size"_a=0, "flags"_a=0, "retry_hugetlb"_a=false)
+        .def_property_readonly("page_size", SPEAD2_PTMF(hugepage_allocator, get_page_size))
+        .def_property_readonly("last_mode", SPEAD2_PTMF(hugepage_allocator, get_last_mode));
+
+    py::class_<numa_allocator, memory_allocator, std::shared_ptr<numa_allocator>>(
+        m, "NumaAllocator")
+        .def(py::init<int, bool, int>(), "node"_a, "strict"_a=false, "flags"_a=0)
+        .def_property_readonly("node", SPEAD2_PTMF(numa_allocator, get_node))
+        .def_property_readonly("strict", SPEAD2_PTMF(numa_allocator, get_strict));
+
+    m.def("numa_nodes", &numa_nodes, "Return the online NUMA nodes");
+    m.def("numa_node_cpus", &numa_node_cpus, "node"_a, "Return the CPUs belonging to a NUMA node");
+
+    py::class_<memory_pool_stats>(m, "MemoryPoolStats")
+        .def_readonly("hits", &memory_pool_stats::hits)
+        .def_readonly("misses", &memory_pool_stats::misses)
+        .def_readonly("empty", &memory_pool_stats::empty)
+        .def_readonly("refills", &memory_pool_stats::refills)
+        .def_readonly("refill_time_ns", &memory_pool_stats::refill_time_ns)
+        .def_readonly("free", &memory_pool_stats::free)
+        .def_readonly("free_high_water", &memory_pool_stats::free_high_water)
+        .def_readonly("bytes_outstanding", &memory_pool_stats::bytes_outstanding);
 
     py::class_<memory_pool, memory_allocator, std::shared_ptr<memory_pool>>(
         m, "MemoryPool")
@@ -306,12 +340,75 @@ void register_module(py::module m)
         .def(py::init<std::shared_ptr<thread_pool>, std::size_t, std::size_t, std::size_t, std::size_t, std::size_t, std::shared_ptr<memory_allocator>>(),
              "thread_pool"_a, "lower"_a, "upper"_a, "max_free"_a, "initial"_a, "low_water"_a, "allocator"_a)
         .def_property("warn_on_empty",
-                      &memory_pool::get_warn_on_empty, &memory_pool::set_warn_on_empty);
+                      &memory_pool::get_warn_on_empty, &memory_pool::set_warn_on_empty)
+        .def_property_readonly("stats", SPEAD2_PTMF(memory_pool, get_stats));
+
+    py::class_<slab_pool, memory_allocator, std::shared_ptr<slab_pool>>
+        slab_pool_cls(m, "SlabPool");
+    py::class_<slab_pool::size_class>(slab_pool_cls, "SizeClass")
+        .def(py::init<std::size_t, std::size_t, std::size_t, std::size_t>(),
+             "size"_a, "max_free"_a, "initial"_a, "low_water"_a=0)
+        .def_readwrite("size", &slab_pool::size_class::size)
+        .def_readwrite("max_free", &slab_pool::size_class::max_free)
+        .def_readwrite("initial", &slab_pool::size_class::initial)
+        .def_readwrite("low_water", &slab_pool::size_class::low_water);
+    slab_pool_cls
+        .def(py::init<std::vector<slab_pool::size_class>, std::shared_ptr<memory_allocator>>(),
+             "classes"_a, py::arg_v("allocator", nullptr, "None"))
+        .def(py::init<std::shared_ptr<thread_pool>, std::vector<slab_pool::size_class>, std::shared_ptr<memory_allocator>>(),
+             "thread_pool"_a, "classes"_a, py::arg_v("allocator", nullptr, "None"))
+        .def_static("power_of_two_classes", &slab_pool::power_of_two_classes,
+                    "min_size"_a, "max_size"_a, "max_free"_a, "initial"_a, "low_water"_a=0)
+        .def_property_readonly("classes", SPEAD2_PTMF(slab_pool, get_classes))
+        .def_property("warn_on_empty",
+                      &slab_pool::get_warn_on_empty, &slab_pool::set_warn_on_empty)
+        .def_property_readonly("stats", SPEAD2_PTMF(slab_pool, get_stats))
+        .def_property_readonly("class_stats", SPEAD2_PTMF(slab_pool, get_class_stats));
+
+#if SPEAD2_USE_MEMFD
+    py::class_<memfd_descriptor>(m, "MemfdDescriptor")
+        .def(py::init([](int fd, std::size_t offset, std::size_t length)
+            {
+                return memfd_descriptor{fd, offset, length};
+            }), "fd"_a, "offset"_a, "length"_a)
+        .def_readwrite("fd", &memfd_descriptor::fd)
+        .def_readwrite("offset", &memfd_descriptor::offset)
+        .def_readwrite("length", &memfd_descriptor::length);
+
+    py::class_<memfd_allocator, memory_allocator, std::shared_ptr<memfd_allocator>>(
+        m, "MemfdAllocator")
+        .def(py::init<std::size_t, bool, bool>(), "size"_a, "hugetlb"_a=false, "seal"_a=true)
+        .def_property_readonly("fd", SPEAD2_PTMF(memfd_allocator, get_fd))
+        .def_property_readonly("size", SPEAD2_PTMF(memfd_allocator, get_size))
+        .def_property_readonly("hugetlb", SPEAD2_PTMF(memfd_allocator, is_hugetlb))
+        .def("descriptor", [](const memfd_allocator &self, py::buffer obj)
+        {
+            py::buffer_info info = request_buffer_info(obj, PyBUF_C_CONTIGUOUS);
+            return self.get_descriptor(static_cast<const std::uint8_t *>(info.ptr));
+        }, "buffer"_a);
+
+    py::class_<memfd_mapping>(m, "MemfdMapping", py::buffer_protocol())
+        .def(py::init<int, bool>(), "fd"_a, "writable"_a=false)
+        .def_property_readonly("size", SPEAD2_PTMF(memfd_mapping, size))
+        .def_buffer([](memfd_mapping &self)
+        {
+            return py::buffer_info(
+                self.data(),
+                1,      // size of individual elements
+                py::format_descriptor<std::uint8_t>::format(),
+                self.size(),
+                !self.is_writable());
+        });
+#endif
 
     py::class_<thread_pool_wrapper, std::shared_ptr<thread_pool_wrapper>>(m, "ThreadPool")
         .def(py::init<int>(), "threads"_a = 1)
         .def(py::init<int, const std::vector<int> &>(), "threads"_a, "affinity"_a)
-        .def_static("set_affinity", &thread_pool_wrapper::set_affinity)
+        .def(py::init([](int threads, const std::vector<int> &numa_nodes)
+            {
+                return new thread_pool_wrapper(threads, thread_pool::numa_nodes_tag(), numa_nodes);
+            }), "threads"_a, py::kw_only(), "numa_nodes"_a)
+        .def_static("set_affinity", static_cast<void (*)(int)>(&thread_pool_wrapper::set_affinity))
         .def("stop", SPEAD2_PTMF(thread_pool_wrapper, stop));
 
     py::class_<inproc_queue, std::shared_ptr<inproc_queue>>(m, "InprocQueue")
@@ -327,6 +424,22 @@ void register_module(py::module m)
         }, "packet")
         .def("stop", SPEAD2_PTMF(inproc_queue, stop));
 
+#if SPEAD2_USE_SHM
+    py::class_<shm_queue, std::shared_ptr<shm_queue>>(m, "ShmQueue")
+        .def(py::init<const std::string &, std::size_t, std::size_t>(),
+             "name"_a, "slot_size"_a = shm_queue::default_slot_size,
+             "num_slots"_a = shm_queue::default_num_slots)
+        .def(py::init<const std::string &>(), "name"_a)
+        .def(py::init<std::size_t, std::size_t>(),
+             "slot_size"_a = shm_queue::default_slot_size,
+             "num_slots"_a = shm_queue::default_num_slots)
+        .def_static("from_fd", [](int fd) { return std::make_shared<shm_queue>(fd); }, "fd"_a)
+        .def_property_readonly("fd", SPEAD2_PTMF(shm_queue, get_fd))
+        .def_property_readonly("slot_size", SPEAD2_PTMF(shm_queue, get_slot_size))
+        .def_property_readonly("num_slots", SPEAD2_PTMF(shm_queue, get_num_slots))
+        .def("stop", SPEAD2_PTMF(shm_queue, stop));
+#endif
+
     py::class_<descriptor>(m, "RawDescriptor")
         .def(py::init<>())
         .def_readwrite("id", &descriptor::id)
@@ -32,9 +32,12 @@
 #include <spead2/recv_udp.h>
 #include <spead2/recv_udp_ibv.h>
 #include <spead2/recv_udp_pcap.h>
+#include <spead2/recv_udp_capture.h>
+#include <spead2/recv_udp_packet_mmap.h>
 #include <spead2/recv_tcp.h>
 #include <spead2/recv_mem.h>
 #include <spead2/recv_inproc.h>
+#include <spead2/recv_shm.h>
 #include <spead2/recv_stream.h>
 #include <spead2/recv_ring_stream.h>
 #include <spead2/recv_chunk_stream.h>
@@ -120,6 +123,16 @@ public:
 };
 #endif // SPEAD2_USE_IBV
 
+#if SPEAD2_USE_PACKET_MMAP
+// See udp_ibv_config_wrapper for an explanation
+class udp_packet_mmap_config_wrapper : public udp_packet_mmap_config
+{
+public:
+    std::vector<std::pair<std::string, std::uint16_t>> py_endpoints;
+    std::string py_interface_address;
+};
+#endif // SPEAD2_USE_PACKET_MMAP
+
 static boost::asio::ip::address make_address(stream &s, const std::string &hostname)
 {
     return make_address_no_release(s.get_io_service(), hostname,
@@ -275,6 +288,20 @@ static void add_udp_ibv_reader_new(stream &s, const udp_ibv_config_wrapper &conf
 }
 #endif  // SPEAD2_USE_IBV
 
+#if SPEAD2_USE_PACKET_MMAP
+static void add_udp_packet_mmap_reader(stream &s, const udp_packet_mmap_config_wrapper &config_wrapper)
+{
+    py::gil_scoped_release gil;
+    udp_packet_mmap_config config = config_wrapper;
+    for (const auto &endpoint : config_wrapper.py_endpoints)
+        config.add_endpoint(make_endpoint<boost::asio::ip::udp>(
+            s, endpoint.first, endpoint.second));
+    config.set_interface_address(
+        make_address(s, config_wrapper.py_interface_address));
+    s.emplace_reader<udp_packet_mmap_reader>(config);
+}
+#endif  // SPEAD2_USE_PACKET_MMAP
+
 #if SPEAD2_USE_PCAP
 static void add_udp_pcap_file_reader(stream &s, const std::string &filename)
 {
@@ -283,12 +310,31 @@ static void add_udp_pcap_file_reader(stream &s, const std::string &filename)
 }
 #endif
 
+static void add_udp_capture_reader(
+    stream &s,
+    const std::vector<std::string> &filenames,
+    const std::string &address,
+    std::uint16_t port)
+{
+    py::gil_scoped_release gil;
+    auto filter = make_endpoint<boost::asio::ip::udp>(s, address, port);
+    s.emplace_reader<udp_capture_reader>(filenames, filter);
+}
+
 static void add_inproc_reader(stream &s, std::shared_ptr<inproc_queue> queue)
 {
     py::gil_scoped_release gil;
     s.emplace_reader<inproc_reader>(queue);
 }
 
+#if SPEAD2_USE_SHM
+static void add_shm_reader(stream &s, std::shared_ptr<shm_queue> queue, int affinity)
+{
+    py::gil_scoped_release gil;
+    s.emplace_reader<shm_reader>(queue, affinity);
+}
+#endif
+
 class ring_stream_config_wrapper : public ring_stream_config
 {
 private:
@@ -636,6 +682,7 @@ py::module register_module(py::module &parent)
     STREAM_STATS_PROPERTY(max_batch);
     STREAM_STATS_PROPERTY(single_packet_heaps);
     STREAM_STATS_PROPERTY(search_dist);
+    STREAM_STATS_PROPERTY(reassembly_time_ns);
 #undef STREAM_STATS_PROPERTY
 
     py::class_<stream_config>(m, "StreamConfig")
@@ -680,6 +727,7 @@ py::module register_module(py::module &parent)
         .def("add_stat", SPEAD2_PTMF(stream_config, add_stat),
              "name"_a,
              "mode"_a = stream_stat_config::mode::COUNTER)
+        .def("add_memory_pool_stats", SPEAD2_PTMF_VOID(stream_config, add_memory_pool_stats))
         .def_property_readonly("stats", SPEAD2_PTMF(stream_config, get_stats))
         .def("get_stat_index", SPEAD2_PTMF(stream_config, get_stat_index),
              "name"_a)
@@ -718,6 +766,42 @@ py::module register_module(py::module &parent)
         .def_readonly_static("DEFAULT_MAX_SIZE", &udp_ibv_config_wrapper::default_max_size)
         .def_readonly_static("DEFAULT_MAX_POLL", &udp_ibv_config_wrapper::default_max_poll);
 #endif // SPEAD2_USE_IBV
+#if SPEAD2_USE_PACKET_MMAP
+    py::class_<udp_packet_mmap_config_wrapper> udp_packet_mmap_config_cls(m, "UdpPacketMmapConfig");
+    py::enum_<udp_packet_mmap_config::fanout_mode>(udp_packet_mmap_config_cls, "FanoutMode")
+        .value("HASH", udp_packet_mmap_config::fanout_mode::HASH)
+        .value("LB", udp_packet_mmap_config::fanout_mode::LB)
+        .value("CPU", udp_packet_mmap_config::fanout_mode::CPU)
+        .value("ROLLOVER", udp_packet_mmap_config::fanout_mode::ROLLOVER)
+        .value("RND", udp_packet_mmap_config::fanout_mode::RND)
+        .value("QM", udp_packet_mmap_config::fanout_mode::QM);
+    udp_packet_mmap_config_cls
+        .def(py::init(&data_class_constructor<udp_packet_mmap_config_wrapper>))
+        .def_readwrite("endpoints", &udp_packet_mmap_config_wrapper::py_endpoints)
+        .def_readwrite("interface_address", &udp_packet_mmap_config_wrapper::py_interface_address)
+        .def_property("max_size",
+                      SPEAD2_PTMF(udp_packet_mmap_config_wrapper, get_max_size),
+                      SPEAD2_PTMF_VOID(udp_packet_mmap_config_wrapper, set_max_size))
+        .def_property("block_size",
+                      SPEAD2_PTMF(udp_packet_mmap_config_wrapper, get_block_size),
+                      SPEAD2_PTMF_VOID(udp_packet_mmap_config_wrapper, set_block_size))
+        .def_property("num_blocks",
+                      SPEAD2_PTMF(udp_packet_mmap_config_wrapper, get_num_blocks),
+                      SPEAD2_PTMF_VOID(udp_packet_mmap_config_wrapper, set_num_blocks))
+        .def_property("block_timeout",
+                      SPEAD2_PTMF(udp_packet_mmap_config_wrapper, get_block_timeout),
+                      SPEAD2_PTMF_VOID(udp_packet_mmap_config_wrapper, set_block_timeout))
+        .def_property("fanout_group",
+                      SPEAD2_PTMF(udp_packet_mmap_config_wrapper, get_fanout_group),
+                      SPEAD2_PTMF_VOID(udp_packet_mmap_config_wrapper, set_fanout_group))
+        .def_property("fanout_mode",
+                      SPEAD2_PTMF(udp_packet_mmap_config_wrapper, get_fanout_mode),
+                      SPEAD2_PTMF_VOID(udp_packet_mmap_config_wrapper, set_fanout_mode))
+        .def_readonly_static("DEFAULT_MAX_SIZE", &udp_packet_mmap_config_wrapper::default_max_size)
+        .def_readonly_static("DEFAULT_BLOCK_SIZE", &udp_packet_mmap_config_wrapper::default_block_size)
+        .def_readonly_static("DEFAULT_NUM_BLOCKS", &udp_packet_mmap_config_wrapper::default_num_blocks)
+        .def_readonly_static("DEFAULT_BLOCK_TIMEOUT", &udp_packet_mmap_config_wrapper::default_block_timeout);
+#endif // SPEAD2_USE_PACKET_MMAP
     py::class_<stream>(m, "_Stream")
         // SPEAD2_PTMF doesn't work for get_stats because it's defined in stream_base, which is a protected ancestor
         .def_property_readonly("stats", [](const stream &self) { return self.get_stats(); })
@@ -771,12 +855,28 @@ py::module register_module(py::module &parent)
         .def("add_udp_ibv_reader", add_udp_ibv_reader_new,
              "config"_a)
 #endif
+#if SPEAD2_USE_PACKET_MMAP
+        .def("add_udp_packet_mmap_reader", add_udp_packet_mmap_reader,
+             "config"_a)
+#endif
 #if SPEAD2_USE_PCAP
         .def("add_udp_pcap_file_reader", add_udp_pcap_file_reader,
              "filename"_a)
 #endif
+        .def("add_udp_capture_reader",
+             [](stream &s, const std::string &filename, const std::string &address, std::uint16_t port)
+             {
+                 add_udp_capture_reader(s, std::vector<std::string>{filename}, address, port);
+             },
+             "filename"_a, "address"_a = std::string(), "port"_a = 0)
+        .def("add_udp_capture_reader", add_udp_capture_reader,
+             "filenames"_a, "address"_a = std::string(), "port"_a = 0)
         .def("add_inproc_reader", add_inproc_reader,
              "queue"_a)
+#if SPEAD2_USE_SHM
+        .def("add_shm_reader", add_shm_reader,
+             "queue"_a, "affinity"_a = -1)
+#endif
         .def("stop", SPEAD2_PTMF(stream, stop))
 #if SPEAD2_USE_IBV
         .def_property_readonly_static("DEFAULT_UDP_IBV_MAX_SIZE",
@@ -32,9 +32,11 @@
 #include <spead2/send_stream.h>
 #include <spead2/send_udp.h>
 #include <spead2/send_udp_ibv.h>
+#include <spead2/send_udp_parallel.h>
 #include <spead2/send_tcp.h>
 #include <spead2/send_streambuf.h>
 #include <spead2/send_inproc.h>
+#include <spead2/send_shm.h>
 #include <spead2/common_thread_pool.h>
 #include <spead2/common_semaphore.h>
 #include <spead2/py_common.h>
@@ -314,7 +316,12 @@ public:
 
     void process_callbacks()
     {
-        semaphore_get(sem, gil_release_tag());
+        /* This is called when the file descriptor is readable, but that may
+         * be a spurious wakeup (see semaphore_futex_fd), and blocking would
+         * stall the event loop.
+         */
+        if (sem.try_get() == -1)
+            return;
         std::vector<callback_item> current_callbacks;
         {
             std::unique_lock<std::mutex> lock(callbacks_mutex);
@@ -502,6 +509,27 @@ public:
     }
 };
 
+template<typename Base>
+class udp_parallel_stream_wrapper : public Base
+{
+public:
+    udp_parallel_stream_wrapper(
+        io_service_ref io_service,
+        const std::vector<std::pair<std::string, std::uint16_t>> &endpoints,
+        const stream_config &config,
+        std::size_t threads,
+        const std::vector<int> &affinity,
+        std::size_t buffer_size,
+        const std::string &interface_address)
+        : Base(
+            io_service,
+            make_endpoints<boost::asio::ip::udp>(*io_service, endpoints),
+            config, threads, affinity, buffer_size,
+            make_address(*io_service, interface_address))
+    {
+    }
+};
+
 #if SPEAD2_USE_IBV
 
 /* Managing the endpoint and memory region lists requires some sleight of
@@ -892,6 +920,32 @@ static py::class_<T, stream> inproc_stream_register(py::module &m, const char *n
         });
 }
 
+template<typename T>
+static py::class_<T, stream> udp_parallel_stream_register(py::module &m, const char *name)
+{
+    using namespace pybind11::literals;
+    return py::class_<T, stream>(m, name)
+        .def(py::init<std::shared_ptr<thread_pool_wrapper>, const std::vector<std::pair<std::string, std::uint16_t>> &, const stream_config &, std::size_t, const std::vector<int> &, std::size_t, std::string>(),
+             "thread_pool"_a.none(false), "endpoints"_a,
+             "config"_a = stream_config(),
+             "threads"_a,
+             "affinity"_a = std::vector<int>(),
+             "buffer_size"_a = udp_stream::default_buffer_size,
+             "interface_address"_a = std::string());
+}
+
+#if SPEAD2_USE_SHM
+template<typename T>
+static py::class_<T, stream> shm_stream_register(py::module &m, const char *name)
+{
+    using namespace pybind11::literals;
+    return py::class_<T, stream>(m, name)
+        .def(py::init<std::shared_ptr<thread_pool_wrapper>, const std::vector<std::shared_ptr<shm_queue>> &, const stream_config &>(),
+             "thread_pool"_a.none(false), "queues"_a, "config"_a = stream_config())
+        .def_property_readonly("queues", SPEAD2_PTMF(T, get_queues));
+}
+#endif
+
 template<typename T>
 static void sync_stream_register(py::class_<T, stream> &stream_class)
 {
@@ -1013,6 +1067,14 @@ py::module register_module(py::module &parent)
         auto stream_class = udp_stream_register<udp_stream_wrapper<asyncio_stream_wrapper<udp_stream>>>(m, "UdpStreamAsyncio");
         async_stream_register(stream_class);
     }
+    {
+        auto stream_class = udp_parallel_stream_register<udp_parallel_stream_wrapper<stream_wrapper<udp_parallel_stream>>>(m, "UdpParallelStream");
+        sync_stream_register(stream_class);
+    }
+    {
+        auto stream_class = udp_parallel_stream_register<udp_parallel_stream_wrapper<asyncio_stream_wrapper<udp_parallel_stream>>>(m, "UdpParallelStreamAsyncio");
+        async_stream_register(stream_class);
+    }
 
 #if SPEAD2_USE_IBV
     py::class_<udp_ibv_config_wrapper>(m, "UdpIbvConfig")
@@ -1072,6 +1134,17 @@ py::module register_module(py::module &parent)
         async_stream_register(stream_class);
     }
 
+#if SPEAD2_USE_SHM
+    {
+        auto stream_class = shm_stream_register<stream_wrapper<shm_stream>>(m, "ShmStream");
+        sync_stream_register(stream_class);
+    }
+    {
+        auto stream_class = shm_stream_register<asyncio_stream_wrapper<shm_stream>>(m, "ShmStreamAsyncio");
+        async_stream_register(stream_class);
+    }
+#endif
+
     return m;
 }
 
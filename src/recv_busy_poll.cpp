@@ -0,0 +1,162 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <cstddef>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <stdexcept>
+#include <system_error>
+#include <sys/socket.h>
+#include <spead2/common_logging.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_busy_poll.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+constexpr std::size_t busy_poll_config::default_spin_count;
+constexpr std::chrono::microseconds busy_poll_config::default_sleep;
+
+busy_poll_config &busy_poll_config::set_affinity(int affinity)
+{
+    this->affinity = affinity;
+    return *this;
+}
+
+busy_poll_config &busy_poll_config::set_busy_poll(int busy_poll)
+{
+    if (busy_poll < 0)
+        throw std::invalid_argument("busy_poll cannot be negative");
+    this->busy_poll = busy_poll;
+    return *this;
+}
+
+busy_poll_config &busy_poll_config::set_prefer_busy_poll(bool prefer_busy_poll)
+{
+    this->prefer_busy_poll = prefer_busy_poll;
+    return *this;
+}
+
+busy_poll_config &busy_poll_config::set_spin_count(std::size_t spin_count)
+{
+    this->spin_count = spin_count;
+    return *this;
+}
+
+busy_poll_config &busy_poll_config::set_sleep(std::chrono::microseconds sleep)
+{
+    if (sleep.count() < 0)
+        throw std::invalid_argument("sleep cannot be negative");
+    this->sleep = sleep;
+    return *this;
+}
+
+namespace detail
+{
+
+busy_poller::busy_poller(const busy_poll_config &config)
+    : config(config)
+{
+}
+
+busy_poller::~busy_poller()
+{
+    stop();
+    if (thread.joinable())
+        thread.join();
+}
+
+void busy_poller::start(std::function<status()> poll, std::function<void()> finish)
+{
+    thread = std::thread([this, poll, finish] { run(std::move(poll), std::move(finish)); });
+}
+
+void busy_poller::stop()
+{
+    stop_requested.store(true, std::memory_order_relaxed);
+}
+
+void busy_poller::run(std::function<status()> poll, std::function<void()> finish)
+{
+    if (config.get_affinity() >= 0)
+        thread_pool::set_affinity(config.get_affinity());
+
+    std::size_t idle = 0;
+    while (!stop_requested.load(std::memory_order_relaxed))
+    {
+        status s;
+        try
+        {
+            s = poll();
+        }
+        catch (std::exception &e)
+        {
+            log_warning("Error in busy-polling reader: %1%", e.what());
+            s = status::DONE;
+        }
+        if (s == status::DONE)
+            break;
+        else if (s == status::PROGRESS)
+            idle = 0;
+        else if (idle < config.get_spin_count())
+            idle++;
+        else
+            std::this_thread::sleep_for(config.get_sleep());
+    }
+    finish();
+}
+
+void busy_poller::apply_socket_options(int fd) const
+{
+    if (config.get_busy_poll() > 0)
+    {
+#ifdef SO_BUSY_POLL
+        int value = config.get_busy_poll();
+        if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value)) < 0)
+        {
+            std::error_code code(errno, std::system_category());
+            log_warning("setsockopt(SO_BUSY_POLL) failed: %1% (%2%)", code.value(), code.message());
+        }
+#else
+        log_warning("SO_BUSY_POLL requested but not supported on this platform");
+#endif
+    }
+    if (config.get_prefer_busy_poll())
+    {
+#ifdef SO_PREFER_BUSY_POLL
+        int value = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &value, sizeof(value)) < 0)
+        {
+            std::error_code code(errno, std::system_category());
+            log_warning("setsockopt(SO_PREFER_BUSY_POLL) failed: %1% (%2%)", code.value(), code.message());
+        }
+#else
+        log_warning("SO_PREFER_BUSY_POLL requested but not supported on this platform");
+#endif
+    }
+}
+
+} // namespace detail
+
+} // namespace recv
+} // namespace spead2
@@ -0,0 +1,133 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <stdexcept>
+#include <utility>
+#include <spead2/common_logging.h>
+#include <spead2/recv_callback_stream.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+callback_stream_config &callback_stream_config::set_live_heap_callback(
+    live_heap_callback_function callback)
+{
+    this->live_heap_callback = std::move(callback);
+    return *this;
+}
+
+callback_stream_config &callback_stream_config::set_heap_callback(
+    heap_callback_function callback)
+{
+    this->heap_callback = std::move(callback);
+    return *this;
+}
+
+callback_stream_config &callback_stream_config::set_batch_callback(
+    heap_batch_callback_function callback)
+{
+    this->batch_callback = std::move(callback);
+    return *this;
+}
+
+callback_stream_config &callback_stream_config::set_contiguous_only(bool contiguous_only)
+{
+    this->contiguous_only = contiguous_only;
+    return *this;
+}
+
+/* Check the config before the stream is constructed, so that a bad config
+ * does not start a stream.
+ */
+static const callback_stream_config &check_callback_config(const callback_stream_config &config)
+{
+    int n = bool(config.get_live_heap_callback())
+        + bool(config.get_heap_callback())
+        + bool(config.get_batch_callback());
+    if (n != 1)
+        throw std::invalid_argument("exactly one callback must be set");
+    if (config.get_heap_callback() && !config.get_contiguous_only())
+        throw std::invalid_argument("a heap callback requires contiguous_only");
+    return config;
+}
+
+callback_stream::callback_stream(
+    io_service_ref io_service,
+    const stream_config &config,
+    const callback_stream_config &callback_config)
+    : stream(std::move(io_service), config),
+    callback_config(check_callback_config(callback_config))
+{
+    /* This is only an initial guess: the number of heaps a batch completes
+     * depends on the readers (which are added later) and on how many heaps
+     * their packets evict, so the vector may still grow. Since clearing it
+     * keeps the capacity, it stops reallocating once it has reached the
+     * largest batch seen.
+     */
+    if (this->callback_config.get_batch_callback())
+        batch.reserve(config.get_max_heaps() * config.get_substreams());
+}
+
+void callback_stream::heap_ready(live_heap &&h)
+{
+    if (callback_config.get_contiguous_only() && !h.is_contiguous())
+    {
+        log_warning("dropped incomplete heap %d (%d/%d bytes of payload)",
+                    h.get_cnt(), h.get_received_length(), h.get_heap_length());
+        return;
+    }
+    if (callback_config.get_live_heap_callback())
+        callback_config.get_live_heap_callback()(std::move(h), batch_stats.data());
+    else if (callback_config.get_heap_callback())
+        callback_config.get_heap_callback()(heap(std::move(h)), batch_stats.data());
+    else
+        batch.push_back(std::move(h));
+}
+
+void callback_stream::batch_ready()
+{
+    if (!batch.empty())
+    {
+        try
+        {
+            callback_config.get_batch_callback()(batch, batch_stats.data());
+        }
+        catch (...)
+        {
+            // Don't deliver the same heaps again with the next batch
+            batch.clear();
+            throw;
+        }
+        batch.clear();
+    }
+}
+
+callback_stream::~callback_stream()
+{
+    /* Stop here rather than leaving it to the base class, so that heaps
+     * flushed by stopping are still delivered to the callback.
+     */
+    stop();
+}
+
+} // namespace recv
+} // namespace spead2
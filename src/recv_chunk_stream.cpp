@@ -26,6 +26,7 @@
 #include <functional>
 #include <algorithm>
 #include <utility>
+#include <chrono>
 #include <spead2/common_defines.h>
 #include <spead2/common_endian.h>
 #include <spead2/common_memory_allocator.h>
@@ -263,6 +264,9 @@ chunk_stream_state::allocate(std::size_t size, const packet_header &packet)
                 {
                     chunks[tail_pos]->chunk_id = tail_chunk;
                     chunks[tail_pos]->stream_id = stream_id;
+                    // Chunks may be recycled, so clear any stale timestamps
+                    chunks[tail_pos]->first_timestamp = std::chrono::system_clock::time_point();
+                    chunks[tail_pos]->last_timestamp = std::chrono::system_clock::time_point();
                 }
                 tail_chunk++;
                 tail_pos++;
@@ -336,6 +340,16 @@ void chunk_stream::heap_ready(live_heap &&lh)
             assert(metadata->heap_index < metadata->chunk_ptr->present_size);
             metadata->chunk_ptr->present[metadata->heap_index] = true;
         }
+        if (metadata && metadata->chunk_ptr && metadata->chunk_id >= get_head_chunk()
+            && h.get_first_timestamp() != std::chrono::system_clock::time_point())
+        {
+            chunk &c = *metadata->chunk_ptr;
+            if (c.first_timestamp == std::chrono::system_clock::time_point()
+                || h.get_first_timestamp() < c.first_timestamp)
+                c.first_timestamp = h.get_first_timestamp();
+            if (h.get_last_timestamp() > c.last_timestamp)
+                c.last_timestamp = h.get_last_timestamp();
+        }
     }
 }
 
@@ -0,0 +1,194 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <spead2/common_logging.h>
+#include <spead2/recv_file.h>
+#include <spead2/recv_packet.h>
+#include <spead2/recv_stream.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+file_mapping::file_mapping(const std::string &filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        throw_errno("open failed");
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        int err = errno;
+        close(fd);
+        throw_errno("fstat failed", err);
+    }
+    size = st.st_size;
+    if (size > 0)
+    {
+        // Private and writable, so that users can modify heaps referencing it
+        void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+            int err = errno;
+            close(fd);
+            throw_errno("mmap failed", err);
+        }
+        data = static_cast<std::uint8_t *>(ptr);
+        if (madvise(data, size, MADV_SEQUENTIAL) != 0)
+            log_errno("madvise failed: %1% (%2%)");
+    }
+    // The mapping remains valid after closing the file
+    close(fd);
+}
+
+file_mapping::~file_mapping()
+{
+    if (data && munmap(data, size) != 0)
+        log_errno("munmap failed: %1% (%2%)");
+}
+
+bool file_mapping::contains(const std::uint8_t *ptr, std::size_t length) const
+{
+    // Compare as integers, since the pointers need not point into the mapping
+    std::uintptr_t start = reinterpret_cast<std::uintptr_t>(data);
+    std::uintptr_t p = reinterpret_cast<std::uintptr_t>(ptr);
+    return p >= start && p - start <= size && length <= size - (p - start);
+}
+
+file_mapping_allocator::file_mapping_allocator(
+    std::shared_ptr<const file_mapping> mapping,
+    std::shared_ptr<memory_allocator> fallback)
+    : mapping(std::move(mapping)),
+    fallback(fallback ? std::move(fallback) : std::make_shared<memory_allocator>())
+{
+}
+
+memory_allocator::pointer file_mapping_allocator::allocate(std::size_t size, void *hint)
+{
+    if (hint)
+    {
+        const packet_header *packet = static_cast<const packet_header *>(hint);
+        if (packet->payload_offset == 0
+            && packet->payload_length == s_item_pointer_t(size)
+            && packet->heap_length == s_item_pointer_t(size)
+            && mapping->contains(packet->payload, size))
+        {
+            /* Nothing is freed: the deleter just keeps the mapping alive. The
+             * mapping is private, so it is safe for the user to modify it.
+             */
+            std::shared_ptr<const file_mapping> ref = mapping;
+            return pointer(const_cast<std::uint8_t *>(packet->payload),
+                           [ref](std::uint8_t *) {});
+        }
+    }
+    return fallback->allocate(size, hint);
+}
+
+void file_mapping_zero_copy(stream_config &config, std::shared_ptr<const file_mapping> mapping)
+{
+    packet_memcpy_function base_memcpy = config.get_memcpy();
+    config.set_memory_allocator(std::make_shared<file_mapping_allocator>(
+        std::move(mapping), config.get_memory_allocator()));
+    config.set_memcpy(
+        [base_memcpy](const memory_allocator::pointer &allocation, const packet_header &packet)
+        {
+            if (allocation.get() + packet.payload_offset != packet.payload)
+                base_memcpy(allocation, packet);
+        });
+}
+
+constexpr int file_reader::max_batch;
+constexpr std::size_t file_reader::readahead_size;
+
+file_reader::file_reader(stream &owner, const std::string &filename)
+    : file_reader(owner, std::make_shared<file_mapping>(filename))
+{
+}
+
+file_reader::file_reader(stream &owner, std::shared_ptr<const file_mapping> mapping)
+    : reader(owner), mapping(std::move(mapping))
+{
+    advise(std::min(readahead_size, this->mapping->get_size()));
+    get_io_service().post([this] { run(); });
+}
+
+void file_reader::advise(std::size_t end)
+{
+    // madvise needs a page-aligned start
+    static const std::size_t page_size = sysconf(_SC_PAGESIZE);
+    std::size_t start = readahead / page_size * page_size;
+    if (end > start
+        && madvise(const_cast<std::uint8_t *>(mapping->get_data()) + start,
+                   end - start, MADV_WILLNEED) != 0)
+        log_errno("madvise failed: %1% (%2%)");
+    readahead = end;
+}
+
+void file_reader::run()
+{
+    const std::uint8_t *data = mapping->get_data();
+    const std::size_t size = mapping->get_size();
+    stream_base::add_packet_state state(get_stream_base());
+    for (int i = 0; i < max_batch && !state.is_stopped(); i++)
+    {
+        if (offset == size)
+        {
+            state.stop();
+            break;
+        }
+        packet_header packet;
+        std::size_t packet_size = decode_packet(packet, data + offset, size - offset);
+        if (packet_size == 0)
+        {
+            log_warning("stopping at malformed or truncated packet at offset %1%", offset);
+            state.stop();
+            break;
+        }
+        state.add_packet(packet);
+        offset += packet_size;
+    }
+    // Keep the read-ahead window ahead of us, extending it in large steps
+    if (readahead < size && offset + readahead_size / 2 > readahead)
+        advise(std::min(offset + readahead_size, size));
+
+    if (!state.is_stopped())
+        get_io_service().post([this] { run(); });
+    else
+        stopped();
+}
+
+bool file_reader::lossy() const
+{
+    return false;
+}
+
+} // namespace recv
+} // namespace spead2
@@ -49,9 +49,87 @@ static inline item_pointer_t load_bytes_be(const std::uint8_t *ptr, int len)
     return betoh<item_pointer_t>(out);
 }
 
+namespace
+{
+
+/**
+ * Cache of the dynamic storage of destroyed heaps, so that converting a
+ * @ref live_heap does not need to allocate memory. Heaps are normally
+ * created and destroyed on the same (consumer) thread, so the cache is
+ * per-thread and needs no locking. Only a few small buffers are kept, so
+ * that a burst of large heaps does not pin memory indefinitely.
+ */
+class heap_storage_cache
+{
+private:
+    static constexpr std::size_t max_entries = 8;
+    static constexpr std::size_t max_items = 256;
+    static constexpr std::size_t max_immediate_bytes = 4096;
+
+    struct entry
+    {
+        std::vector<item> items;
+        std::vector<std::uint8_t> immediate_payload;
+    };
+
+    std::vector<entry> entries;
+
+    heap_storage_cache() { entries.reserve(max_entries); }
+    ~heap_storage_cache() { destroyed = true; }
+
+    /**
+     * Set when the calling thread's cache has been destroyed (during thread
+     * exit). It is trivially destructible, so it remains valid after that.
+     */
+    static thread_local bool destroyed;
+
+    static heap_storage_cache *get()
+    {
+        static thread_local heap_storage_cache cache;
+        return destroyed ? nullptr : &cache;
+    }
+
+public:
+    /// Obtain storage, if any is cached. The vectors are always empty.
+    static void take(std::vector<item> &items, std::vector<std::uint8_t> &immediate_payload)
+    {
+        heap_storage_cache *cache = get();
+        if (cache && !cache->entries.empty())
+        {
+            items = std::move(cache->entries.back().items);
+            immediate_payload = std::move(cache->entries.back().immediate_payload);
+            cache->entries.pop_back();
+        }
+    }
+
+    /// Return storage to the cache, or free it if the cache is full
+    static void give(std::vector<item> &&items, std::vector<std::uint8_t> &&immediate_payload)
+    {
+        if (items.capacity() == 0 && immediate_payload.capacity() == 0)
+            return;
+        heap_storage_cache *cache = get();
+        if (cache
+            && cache->entries.size() < max_entries
+            && items.capacity() <= max_items
+            && immediate_payload.capacity() <= max_immediate_bytes)
+        {
+            items.clear();
+            immediate_payload.clear();
+            cache->entries.push_back(entry{std::move(items), std::move(immediate_payload)});
+        }
+    }
+};
+
+thread_local bool heap_storage_cache::destroyed = false;
+
+} // anonymous namespace
+
 void heap_base::transfer_immediates(heap_base &&other) noexcept
 {
-    if (!immediate_payload)
+    /* Moving the vector keeps the pointers into it valid, so only the
+     * inline storage needs to be fixed up.
+     */
+    if (immediate_payload.empty())
     {
         std::memcpy(immediate_payload_inline, other.immediate_payload_inline,
                     sizeof(immediate_payload_inline));
@@ -66,17 +144,27 @@ heap_base::heap_base(heap_base &&other) noexcept
     flavour_(std::move(other.flavour_)),
     items(std::move(other.items)),
     immediate_payload(std::move(other.immediate_payload)),
+    first_timestamp(other.first_timestamp),
+    last_timestamp(other.last_timestamp),
     payload(std::move(other.payload))
 {
     transfer_immediates(std::move(other));
 }
 
+heap_base::~heap_base()
+{
+    heap_storage_cache::give(std::move(items), std::move(immediate_payload));
+}
+
 heap_base &heap_base::operator=(heap_base &&other) noexcept
 {
+    heap_storage_cache::give(std::move(items), std::move(immediate_payload));
     cnt = std::move(other.cnt);
     flavour_ = std::move(other.flavour_);
     items = std::move(other.items);
     immediate_payload = std::move(other.immediate_payload);
+    first_timestamp = other.first_timestamp;
+    last_timestamp = other.last_timestamp;
     payload = std::move(other.payload);
     transfer_immediates(std::move(other));
     return *this;
@@ -104,7 +192,16 @@ void heap_base::load(live_heap &&h, bool keep_addressed, bool keep_payload)
     auto compare = [sort_mask](item_pointer_t a, item_pointer_t b) {
         return (a & sort_mask) < (b & sort_mask);
     };
-    std::stable_sort(first, last, compare);
+    /* std::stable_sort allocates a temporary buffer, so for the short lists
+     * of typical heaps, use an insertion sort (which is also stable).
+     */
+    if (last - first <= 32)
+    {
+        for (auto ptr = first; ptr != last; ++ptr)
+            std::rotate(std::upper_bound(first, ptr, *ptr, compare), ptr, ptr + 1);
+    }
+    else
+        std::stable_sort(first, last, compare);
 
     /* Determine how much memory is needed to store immediates
      * (conservative - also counts null items).
@@ -118,11 +215,13 @@ void heap_base::load(live_heap &&h, bool keep_addressed, bool keep_payload)
     // Allocate memory if necessary
     const std::size_t immediate_size = decoder.address_bits() / 8;
     const std::size_t id_size = sizeof(item_pointer_t) - immediate_size;
+    if (items.capacity() == 0)
+        heap_storage_cache::take(items, immediate_payload);
     uint8_t *next_immediate;
     if (immediate_size * n_immediates > sizeof(immediate_payload_inline))
     {
-        next_immediate = new uint8_t[immediate_size * n_immediates];
-        immediate_payload.reset(next_immediate);
+        immediate_payload.resize(immediate_size * n_immediates);
+        next_immediate = immediate_payload.data();
     }
     else
         next_immediate = immediate_payload_inline;
@@ -176,6 +275,8 @@ void heap_base::load(live_heap &&h, bool keep_addressed, bool keep_payload)
     cnt = h.cnt;
     flavour_ = flavour(maximum_version, 8 * sizeof(item_pointer_t),
                        decoder.address_bits(), h.bug_compat);
+    first_timestamp = h.first_timestamp;
+    last_timestamp = h.last_timestamp;
     if (keep_payload)
         payload = std::move(h.payload);
 }
@@ -21,6 +21,7 @@
 #include <cstddef>
 #include <memory>
 #include <functional>
+#include <vector>
 #include <spead2/common_inproc.h>
 #include <spead2/common_logging.h>
 #include <spead2/recv_inproc.h>
@@ -42,6 +43,19 @@ inproc_reader::inproc_reader(
     enqueue();
 }
 
+inproc_reader::inproc_reader(
+    stream &owner,
+    std::shared_ptr<inproc_queue> queue,
+    const busy_poll_config &busy_config)
+    : reader(owner),
+    queue(std::move(queue)),
+    data_sem_wrapper(owner.get_io_service()),
+    poller(new detail::busy_poller(busy_config))
+{
+    poller->start([this] { return poll_busy(); },
+                  [this] { finish_busy(); });
+}
+
 void inproc_reader::process_one_packet(stream_base::add_packet_state &state,
                                        const inproc_queue::packet &packet)
 {
@@ -57,6 +71,19 @@ void inproc_reader::process_one_packet(stream_base::add_packet_state &state,
     }
 }
 
+void inproc_reader::process_packets(stream_base::add_packet_state &state,
+                                    std::vector<inproc_queue::packet> &&packets)
+{
+    for (const auto &packet : packets)
+    {
+        process_one_packet(state, packet);
+        if (state.is_stopped())
+            break;
+    }
+    // The payloads have been copied into the heaps, so the storage can be reused
+    queue->recycle_packets(std::move(packets));
+}
+
 void inproc_reader::packet_handler(
     const boost::system::error_code &error,
     std::size_t bytes_transferred)
@@ -72,9 +99,7 @@ void inproc_reader::packet_handler(
         {
             try
             {
-                inproc_queue::packet packet = queue->buffer.try_pop();
-                process_one_packet(state, packet);
-                /* TODO: could grab a batch of packets to amortise costs */
+                process_packets(state, queue->buffer.try_pop());
             }
             catch (ringbuffer_stopped &)
             {
@@ -98,6 +123,40 @@ void inproc_reader::packet_handler(
     }
 }
 
+detail::busy_poller::status inproc_reader::poll_busy()
+{
+    std::vector<inproc_queue::packet> packets;
+    try
+    {
+        packets = queue->buffer.try_pop();
+    }
+    catch (ringbuffer_empty &)
+    {
+        return detail::busy_poller::status::IDLE;
+    }
+    catch (ringbuffer_stopped &)
+    {
+        stream_base::add_packet_state state(get_stream_base());
+        state.stop();
+        return detail::busy_poller::status::DONE;
+    }
+
+    stream_base::add_packet_state state(get_stream_base());
+    if (state.is_stopped())
+    {
+        log_info("inproc reader: discarding packet received after stream stopped");
+        return detail::busy_poller::status::DONE;
+    }
+    process_packets(state, std::move(packets));
+    return state.is_stopped() ? detail::busy_poller::status::DONE
+                              : detail::busy_poller::status::PROGRESS;
+}
+
+void inproc_reader::finish_busy()
+{
+    stopped();
+}
+
 void inproc_reader::enqueue()
 {
     using namespace std::placeholders;
@@ -108,7 +167,10 @@ void inproc_reader::enqueue()
 
 void inproc_reader::stop()
 {
-    data_sem_wrapper.close();
+    if (poller)
+        poller->stop();
+    else
+        data_sem_wrapper.close();
 }
 
 bool inproc_reader::lossy() const
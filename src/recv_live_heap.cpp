@@ -229,6 +229,12 @@ bool live_heap::add_packet(const packet_header &packet,
         packet_memcpy(payload, packet);
         received_length += packet.payload_length;
     }
+    if (packet.timestamp != std::chrono::system_clock::time_point())
+    {
+        if (first_timestamp == std::chrono::system_clock::time_point())
+            first_timestamp = packet.timestamp;
+        last_timestamp = packet.timestamp;
+    }
     log_debug("packet with %d bytes of payload at offset %d added to heap %d",
               packet.payload_length, packet.payload_offset, cnt);
     return true;
@@ -292,6 +298,7 @@ void live_heap::reset()
     external_pointers.shrink_to_fit();
     seen_pointers.clear();
     payload_ranges.clear();
+    first_timestamp = last_timestamp = std::chrono::system_clock::time_point();
 }
 
 } // namespace recv
@@ -0,0 +1,129 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_SHM
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <spead2/common_logging.h>
+#include <spead2/common_shm.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_packet.h>
+#include <spead2/recv_reader.h>
+#include <spead2/recv_shm.h>
+#include <spead2/recv_stream.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+constexpr std::size_t shm_reader::max_batch;
+
+shm_reader::shm_reader(
+    stream &owner,
+    std::shared_ptr<shm_queue> queue,
+    int affinity)
+    : reader(owner), queue(std::move(queue))
+{
+    this->queue->set_consumer();
+    thread = std::thread([this, affinity] { run(affinity); });
+}
+
+shm_reader::~shm_reader()
+{
+    stop();
+    if (thread.joinable())
+        thread.join();
+}
+
+void shm_reader::run(int affinity)
+{
+    if (affinity >= 0)
+        thread_pool::set_affinity(affinity);
+    try
+    {
+        while (!stop_requested.load(std::memory_order_relaxed))
+        {
+            std::size_t n = queue->filled_slots();
+            if (n == 0)
+            {
+                if (queue->is_stopped())
+                {
+                    // The stop is published after the last packet, so this is final
+                    if (queue->filled_slots() == 0)
+                    {
+                        stream_base::add_packet_state state(get_stream_base());
+                        state.stop();
+                        break;
+                    }
+                }
+                else
+                    queue->wait_for_data(stop_requested);
+                continue;
+            }
+
+            n = std::min(n, max_batch);
+            stream_base::add_packet_state state(get_stream_base());
+            if (state.is_stopped())
+                break;
+            for (std::size_t i = 0; i < n && !state.is_stopped(); i++)
+            {
+                std::size_t size;
+                const std::uint8_t *data = queue->get_filled_slot(i, size);
+                packet_header header;
+                std::size_t used = decode_packet(header, data, size);
+                if (used == size)
+                    state.add_packet(header);
+                else if (used != 0)
+                    log_info("discarding packet due to size mismatch (%1% != %2%)", used, size);
+            }
+            // The payloads have been copied into the heaps, so the slots can be reused
+            queue->release(n);
+            if (state.is_stopped())
+                break;
+        }
+    }
+    catch (std::exception &e)
+    {
+        log_warning("Error in shared memory reader: %1%", e.what());
+    }
+    queue->close();
+    stopped();
+}
+
+void shm_reader::stop()
+{
+    stop_requested.store(true);
+    queue->interrupt_consumer();
+}
+
+bool shm_reader::lossy() const
+{
+    return false;
+}
+
+} // namespace recv
+} // namespace spead2
+
+#endif // SPEAD2_USE_SHM
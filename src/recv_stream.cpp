@@ -23,11 +23,15 @@
 #include <algorithm>
 #include <cassert>
 #include <atomic>
+#include <chrono>
+#include <exception>
 #include <spead2/recv_stream.h>
 #include <spead2/recv_live_heap.h>
 #include <spead2/common_memcpy.h>
 #include <spead2/common_thread_pool.h>
 #include <spead2/common_logging.h>
+#include <spead2/common_memory_pool.h>
+#include <spead2/common_slab_pool.h>
 
 #define INVALID_ENTRY ((queue_entry *) -1)
 
@@ -113,6 +117,7 @@ static std::shared_ptr<std::vector<stream_stat_config>> make_default_stats()
     // For backwards compatibility, worker_blocked is always stats->emplace_backed, although
     // it is not part of the base stream statistics
     stats->emplace_back("worker_blocked", stream_stat_config::mode::COUNTER);
+    stats->emplace_back("reassembly_time_ns", stream_stat_config::mode::COUNTER);
     assert(stats->size() == stream_stat_indices::custom);
     return stats;
 }
@@ -367,6 +372,33 @@ std::size_t stream_config::add_stat(std::string name, stream_stat_config::mode m
     return index;
 }
 
+// Keep this in sync with stream_base::get_stats
+static const struct
+{
+    const char *name;
+    stream_stat_config::mode mode;
+} memory_pool_stats_config[] =
+{
+    {"memory_pool_hits", stream_stat_config::mode::COUNTER},
+    {"memory_pool_misses", stream_stat_config::mode::COUNTER},
+    {"memory_pool_empty", stream_stat_config::mode::COUNTER},
+    {"memory_pool_refills", stream_stat_config::mode::COUNTER},
+    {"memory_pool_refill_time_ns", stream_stat_config::mode::COUNTER},
+    // These are gauges rather than counts, so summing them is meaningless
+    {"memory_pool_free", stream_stat_config::mode::MAXIMUM},
+    {"memory_pool_free_high_water", stream_stat_config::mode::MAXIMUM},
+    {"memory_pool_bytes_outstanding", stream_stat_config::mode::MAXIMUM}
+};
+
+stream_config &stream_config::add_memory_pool_stats()
+{
+    if (get_stat_index_nothrow(*stats, memory_pool_stats_config[0].name) != stats->size())
+        throw std::invalid_argument("memory pool statistics have already been added");
+    for (const auto &stat : memory_pool_stats_config)
+        add_stat(stat.name, stat.mode);
+    return *this;
+}
+
 std::size_t stream_config::get_stat_index(const std::string &name) const
 {
     return spead2::recv::get_stat_index(*stats, name);
@@ -381,6 +413,7 @@ stream_base::stream_base(const stream_config &config)
     substreams(new substream[config.get_substreams() + 1]),
     substream_div(config.get_substreams()),
     config(config),
+    memory_pool_stats_index(get_stat_index_nothrow(config.get_stats(), memory_pool_stats_config[0].name)),
     stats(config.get_stats().size()),
     batch_stats(config.get_stats().size())
 {
@@ -447,6 +480,7 @@ stream_base::add_packet_state::add_packet_state(stream_base &owner)
 
 stream_base::add_packet_state::~add_packet_state()
 {
+    owner.call_batch_ready();
     if (!packets && is_stopped())
         return;   // Stream was stopped before we could do anything - don't count as a batch
     std::lock_guard<std::mutex> stats_lock(owner.stats_mutex);
@@ -457,6 +491,7 @@ stream_base::add_packet_state::~add_packet_state()
     owner.stats[stream_stat_indices::incomplete_heaps_evicted] += incomplete_heaps_evicted;
     owner.stats[stream_stat_indices::single_packet_heaps] += single_packet_heaps;
     owner.stats[stream_stat_indices::search_dist] += search_dist;
+    owner.stats[stream_stat_indices::reassembly_time_ns] += reassembly_time_ns;
     auto &owner_max_batch = owner.stats[stream_stat_indices::max_batch];
     owner_max_batch = std::max(owner_max_batch, packets);
     // Update custom statistics
@@ -545,6 +580,8 @@ bool stream_base::add_packet(add_packet_state &state, const packet_header &packe
             if (!end_of_stream)
             {
                 state.complete_heaps++;
+                state.reassembly_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    h->get_last_timestamp() - h->get_first_timestamp()).count();
                 heap_ready(std::move(*h));
             }
             h->~live_heap();
@@ -578,11 +615,28 @@ void stream_base::flush_unlocked()
             }
         }
     }
+    call_batch_ready();
     std::lock_guard<std::mutex> stats_lock(stats_mutex);
     stats[stream_stat_indices::heaps] += n_flushed;
     stats[stream_stat_indices::incomplete_heaps_flushed] += n_flushed;
 }
 
+void stream_base::call_batch_ready() noexcept
+{
+    try
+    {
+        batch_ready();
+    }
+    catch (const std::exception &e)
+    {
+        log_warning("batch_ready threw an exception: %1%", e.what());
+    }
+    catch (...)
+    {
+        log_warning("batch_ready threw an unknown exception");
+    }
+}
+
 void stream_base::flush()
 {
     std::lock_guard<std::mutex> lock(queue_mutex);
@@ -608,10 +662,41 @@ void stream_base::stop_received()
     flush_unlocked();
 }
 
+/* Get statistics from the allocator if it is one of the pool types. Returns
+ * false if it is not.
+ */
+static bool get_memory_pool_stats(const memory_allocator &allocator, memory_pool_stats &out)
+{
+    if (const memory_pool *pool = dynamic_cast<const memory_pool *>(&allocator))
+        out = pool->get_stats();
+    else if (const slab_pool *pool = dynamic_cast<const slab_pool *>(&allocator))
+        out = pool->get_stats();
+    else
+        return false;
+    return true;
+}
+
 stream_stats stream_base::get_stats() const
 {
+    // This must be done before taking stats_mutex, as it takes other locks
+    memory_pool_stats pool_stats;
+    bool have_pool_stats = memory_pool_stats_index != config.get_stats().size()
+        && get_memory_pool_stats(*config.get_memory_allocator(), pool_stats);
+
     std::lock_guard<std::mutex> stats_lock(stats_mutex);
     stream_stats ret(get_config().stats, stats);
+    if (have_pool_stats)
+    {
+        std::uint64_t *out = &ret[memory_pool_stats_index];
+        out[0] = pool_stats.hits;
+        out[1] = pool_stats.misses;
+        out[2] = pool_stats.empty;
+        out[3] = pool_stats.refills;
+        out[4] = pool_stats.refill_time_ns;
+        out[5] = pool_stats.free;
+        out[6] = pool_stats.free_high_water;
+        out[7] = pool_stats.bytes_outstanding;
+    }
     return ret;
 }
 
@@ -27,8 +27,10 @@
 #include <system_error>
 #include <cstdint>
 #include <cstring>
+#include <algorithm>
 #include <cstdlib>
 #include <functional>
+#include <stdexcept>
 #include <boost/asio.hpp>
 #include <spead2/recv_reader.h>
 #include <spead2/recv_tcp.h>
@@ -41,80 +43,53 @@ namespace spead2
 namespace recv
 {
 
-constexpr std::size_t tcp_reader::pkts_per_buffer;
-constexpr std::size_t tcp_reader::default_max_size;
-constexpr std::size_t tcp_reader::default_buffer_size;
-
-tcp_reader::tcp_reader(
-    stream &owner,
-    boost::asio::ip::tcp::acceptor &&acceptor,
-    std::size_t max_size,
-    std::size_t buffer_size)
-    : reader(owner), acceptor(std::move(acceptor)),
-    peer(get_socket_io_service(this->acceptor)),
-    max_size(max_size),
-    buffer(new std::uint8_t[max_size * pkts_per_buffer]),
-    head(buffer.get()),
-    tail(buffer.get())
+namespace detail
 {
-    assert(socket_uses_io_service(this->acceptor, get_io_service()));
-    set_socket_recv_buffer_size(this->acceptor, buffer_size);
-    this->acceptor.async_accept(peer,
-        std::bind(&tcp_reader::accept_handler, this, std::placeholders::_1));
-}
 
-tcp_reader::tcp_reader(
-    stream &owner,
-    const boost::asio::ip::tcp::endpoint &endpoint,
-    std::size_t max_size,
-    std::size_t buffer_size)
-    : tcp_reader(
-          owner,
-          boost::asio::ip::tcp::acceptor(owner.get_io_service(), endpoint),
-          max_size, buffer_size)
-{
-}
+constexpr std::size_t tcp_framer::pkts_per_buffer;
 
-tcp_reader::tcp_reader(
-    stream &owner,
-    boost::asio::ip::tcp::acceptor &&acceptor,
-    std::size_t max_size)
-    : tcp_reader(owner, std::move(acceptor), max_size, 0)
+tcp_framer::tcp_framer(std::size_t max_size, std::size_t ring_size, bool mirror)
+    : max_size(max_size)
 {
-}
-
-void tcp_reader::packet_handler(
-    const boost::system::error_code &error,
-    std::size_t bytes_transferred)
-{
-    stream_base::add_packet_state state(get_stream_base());
-
-    bool read_more = false;
-    if (!error)
+    if (ring_size == 0)
+        ring_size = max_size * pkts_per_buffer;
+    ring_size = std::max(ring_size, 2 * max_size);
+#if SPEAD2_USE_MEMFD
+    if (mirror)
     {
-        if (state.is_stopped())
-            log_info("TCP reader: discarding packet received after stream stopped");
-        else
-            read_more = process_buffer(state, bytes_transferred);
+        try
+        {
+            this->mirror.reset(new mirrored_buffer(ring_size));
+            base = this->mirror->data();
+            capacity = this->mirror->size();
+        }
+        catch (std::system_error &e)
+        {
+            log_warning("could not create mirrored buffer, falling back to copying: %1%", e.what());
+        }
     }
-    else if (error == boost::asio::error::eof)
+#else
+    (void) mirror;
+#endif
+    if (!is_mirrored())
     {
-        state.stop();
-        read_more = false;
+        buffer.reset(new std::uint8_t[ring_size]);
+        base = buffer.get();
+        capacity = ring_size;
     }
-    else if (error != boost::asio::error::operation_aborted)
-        log_warning("Error in TCP receiver: %1%", error.message());
+    head = tail = base;
+}
 
-    if (read_more)
-        enqueue_receive();
-    else
-    {
-        peer.close();
-        stopped();
-    }
+bool tcp_framer::is_mirrored() const
+{
+#if SPEAD2_USE_MEMFD
+    return bool(mirror);
+#else
+    return false;
+#endif
 }
 
-bool tcp_reader::parse_packet(stream_base::add_packet_state &state)
+bool tcp_framer::parse_packet(stream_base::add_packet_state &state)
 {
     assert(pkt_size > 0);
     assert(tail - head >= pkt_size);
@@ -138,7 +113,7 @@ bool tcp_reader::parse_packet(stream_base::add_packet_state &state)
     return false;
 }
 
-bool tcp_reader::process_buffer(stream_base::add_packet_state &state, const std::size_t bytes_recv)
+bool tcp_framer::process_buffer(stream_base::add_packet_state &state, const std::size_t bytes_recv)
 {
     tail += bytes_recv;
     while (tail > head)
@@ -157,7 +132,7 @@ bool tcp_reader::process_buffer(stream_base::add_packet_state &state, const std:
     return true;
 }
 
-bool tcp_reader::parse_packet_size()
+bool tcp_framer::parse_packet_size()
 {
     if (pkt_size > 0)
         return false;
@@ -179,7 +154,7 @@ bool tcp_reader::parse_packet_size()
     }
     else if (s_pkt_size == 0)
     {
-        if (bufsize == max_size * pkts_per_buffer)
+        if (bufsize == capacity)
         {
             /* Discard the whole buffer hoping that a proper packet will appear
              * later with a supported length
@@ -200,7 +175,7 @@ bool tcp_reader::parse_packet_size()
     return false;
 }
 
-bool tcp_reader::skip_bytes()
+bool tcp_framer::skip_bytes()
 {
     if (to_skip == 0)
         return false;
@@ -214,6 +189,148 @@ bool tcp_reader::skip_bytes()
     return to_skip > 0;
 }
 
+boost::asio::mutable_buffer tcp_framer::prepare_receive()
+{
+    assert(tail >= head);
+    assert(head >= base);
+
+    if (is_mirrored())
+    {
+        /* Once the head is in the mirror, move both pointers back to the
+         * first copy. The data up to the end of the ring is contiguous
+         * regardless of where it wraps.
+         */
+        if (std::size_t(head - base) >= capacity)
+        {
+            head -= capacity;
+            tail -= capacity;
+        }
+        return boost::asio::buffer(tail, capacity - (tail - head));
+    }
+
+    // Make room for the incoming data
+    if (std::size_t(head - base) > capacity / 2)
+    {
+        auto len = tail - head;
+        std::memcpy(base, head, std::size_t(len));
+        head = base;
+        tail = head + len;
+    }
+    return boost::asio::buffer(tail, capacity - (tail - base));
+}
+
+} // namespace detail
+
+constexpr std::size_t tcp_reader::default_max_size;
+constexpr std::size_t tcp_reader::default_buffer_size;
+
+tcp_reader::tcp_reader(
+    stream &owner,
+    boost::asio::ip::tcp::acceptor &&acceptor,
+    std::size_t max_size,
+    std::size_t buffer_size,
+    std::size_t ring_size,
+    std::unique_ptr<detail::busy_poller> &&poller)
+    : reader(owner), acceptor(std::move(acceptor)),
+    peer(get_socket_io_service(this->acceptor)),
+    framer(max_size, ring_size),
+    poller(std::move(poller))
+{
+    assert(socket_uses_io_service(this->acceptor, get_io_service()));
+    set_socket_recv_buffer_size(this->acceptor, buffer_size);
+    if (this->poller)
+    {
+        this->acceptor.non_blocking(true);
+        this->poller->start([this] { return poll_busy(); },
+                            [this] { finish_busy(); });
+    }
+    else
+    {
+        this->acceptor.async_accept(peer,
+            std::bind(&tcp_reader::accept_handler, this, std::placeholders::_1));
+    }
+}
+
+tcp_reader::tcp_reader(
+    stream &owner,
+    const boost::asio::ip::tcp::endpoint &endpoint,
+    std::size_t max_size,
+    std::size_t buffer_size,
+    std::size_t ring_size)
+    : tcp_reader(
+          owner,
+          boost::asio::ip::tcp::acceptor(owner.get_io_service(), endpoint),
+          max_size, buffer_size, ring_size, nullptr)
+{
+}
+
+tcp_reader::tcp_reader(
+    stream &owner,
+    boost::asio::ip::tcp::acceptor &&acceptor,
+    std::size_t max_size,
+    std::size_t ring_size)
+    : tcp_reader(owner, std::move(acceptor), max_size, 0, ring_size, nullptr)
+{
+}
+
+tcp_reader::tcp_reader(
+    stream &owner,
+    const boost::asio::ip::tcp::endpoint &endpoint,
+    std::size_t max_size,
+    std::size_t buffer_size,
+    const busy_poll_config &busy_config,
+    std::size_t ring_size)
+    : tcp_reader(
+          owner,
+          boost::asio::ip::tcp::acceptor(owner.get_io_service(), endpoint),
+          max_size, buffer_size, ring_size,
+          std::unique_ptr<detail::busy_poller>(new detail::busy_poller(busy_config)))
+{
+}
+
+tcp_reader::tcp_reader(
+    stream &owner,
+    boost::asio::ip::tcp::acceptor &&acceptor,
+    std::size_t max_size,
+    const busy_poll_config &busy_config,
+    std::size_t ring_size)
+    : tcp_reader(
+          owner, std::move(acceptor), max_size, 0, ring_size,
+          std::unique_ptr<detail::busy_poller>(new detail::busy_poller(busy_config)))
+{
+}
+
+void tcp_reader::packet_handler(
+    const boost::system::error_code &error,
+    std::size_t bytes_transferred)
+{
+    stream_base::add_packet_state state(get_stream_base());
+
+    bool read_more = false;
+    if (!error)
+    {
+        if (state.is_stopped())
+            log_info("TCP reader: discarding packet received after stream stopped");
+        else
+            read_more = framer.process_buffer(state, bytes_transferred);
+    }
+    else if (error == boost::asio::error::eof)
+    {
+        state.stop();
+        read_more = false;
+    }
+    else if (error != boost::asio::error::operation_aborted)
+        log_warning("Error in TCP receiver: %1%", error.message());
+
+    if (read_more)
+        enqueue_receive();
+    else
+    {
+        peer.close();
+        stopped();
+    }
+}
+
 void tcp_reader::accept_handler(const boost::system::error_code &error)
 {
     /* We need to hold the stream's queue_mutex, because that guards access
@@ -238,23 +355,58 @@ void tcp_reader::enqueue_receive()
 {
     using namespace std::placeholders;
 
-    auto buf = buffer.get();
-    auto bufsize = max_size * pkts_per_buffer;
-    assert(tail >= head);
-    assert(head >= buf);
+    peer.async_receive(
+        framer.prepare_receive(),
+        std::bind(&tcp_reader::packet_handler, this, _1, _2));
+}
 
-    // Make room for the incoming data
-    if (std::size_t(head - buf) > bufsize / 2)
+detail::busy_poller::status tcp_reader::poll_busy()
+{
+    boost::system::error_code error;
+    if (acceptor.is_open())
     {
-        auto len = tail - head;
-        std::memcpy(buf, head, std::size_t(len));
-        head = buf;
-        tail = head + len;
+        acceptor.accept(peer, error);
+        if (error == boost::asio::error::would_block)
+            return detail::busy_poller::status::IDLE;
+        acceptor.close();
+        if (error)
+        {
+            log_warning("Error in TCP accept: %1%", error.message());
+            return detail::busy_poller::status::DONE;
+        }
+        poller->apply_socket_options(peer.native_handle());
+        peer.non_blocking(true);
+        return detail::busy_poller::status::PROGRESS;
     }
 
-    peer.async_receive(
-        boost::asio::buffer(tail, bufsize - (tail - buf)),
-        std::bind(&tcp_reader::packet_handler, this, _1, _2));
+    std::size_t bytes_transferred = peer.receive(framer.prepare_receive(), 0, error);
+    if (error == boost::asio::error::would_block)
+        return detail::busy_poller::status::IDLE;
+
+    stream_base::add_packet_state state(get_stream_base());
+    bool read_more = false;
+    if (!error)
+    {
+        if (state.is_stopped())
+            log_info("TCP reader: discarding packet received after stream stopped");
+        else
+            read_more = framer.process_buffer(state, bytes_transferred);
+    }
+    else if (error == boost::asio::error::eof)
+        state.stop();
+    else
+        log_warning("Error in TCP receiver: %1%", error.message());
+    return read_more ? detail::busy_poller::status::PROGRESS
+                     : detail::busy_poller::status::DONE;
+}
+
+void tcp_reader::finish_busy()
+{
+    if (peer.is_open())
+        peer.close();
+    if (acceptor.is_open())
+        acceptor.close();
+    stopped();
 }
 
 void tcp_reader::stop()
@@ -263,14 +415,241 @@ void tcp_reader::stop()
      * operations on it.
      * Don't put any logging here: it could be running in a shutdown
      * path where it is no longer safe to do so.
+     *
+     * In busy-polling mode the polling thread may be using the sockets, so
+     * it is left to close them.
+     */
+    if (poller)
+        poller->stop();
+    else
+    {
+        if (peer.is_open())
+            peer.close();
+        if (acceptor.is_open())
+            acceptor.close();
+    }
+}
+
+bool tcp_reader::lossy() const
+{
+    return false;
+}
+
+constexpr std::size_t tcp_multi_config::no_connection_stats;
+
+tcp_multi_config &tcp_multi_config::set_max_size(std::size_t max_size)
+{
+    this->max_size = max_size;
+    return *this;
+}
+
+tcp_multi_config &tcp_multi_config::set_buffer_size(std::size_t buffer_size)
+{
+    this->buffer_size = buffer_size;
+    return *this;
+}
+
+tcp_multi_config &tcp_multi_config::set_ring_size(std::size_t ring_size)
+{
+    this->ring_size = ring_size;
+    return *this;
+}
+
+tcp_multi_config &tcp_multi_config::set_max_connections(std::size_t max_connections)
+{
+    this->max_connections = max_connections;
+    return *this;
+}
+
+tcp_multi_config &tcp_multi_config::set_stop_on_eof(bool stop_on_eof)
+{
+    this->stop_on_eof = stop_on_eof;
+    return *this;
+}
+
+tcp_multi_config &tcp_multi_config::set_connection_stats(std::size_t index)
+{
+    this->connection_stats = index;
+    return *this;
+}
+
+tcp_multi_reader::connection::connection(
+    boost::asio::io_service &io_service, std::size_t max_size, std::size_t ring_size)
+    : socket(io_service), framer(max_size, ring_size)
+{
+}
+
+static const tcp_multi_config &validate_multi_config(stream &owner, const tcp_multi_config &config)
+{
+    if (config.get_connection_stats() != tcp_multi_config::no_connection_stats)
+    {
+        if (config.get_max_connections() == 0)
+            throw std::invalid_argument("connection statistics require max_connections to be set");
+        std::size_t n_stats = owner.get_config().get_stats().size();
+        if (config.get_connection_stats() < stream_stat_indices::custom
+            || config.get_connection_stats() > n_stats
+            || n_stats - config.get_connection_stats() < config.get_max_connections())
+            throw std::invalid_argument("connection statistics are not in the stream config");
+    }
+    return config;
+}
+
+tcp_multi_reader::tcp_multi_reader(
+    stream &owner,
+    boost::asio::ip::tcp::acceptor &&acceptor,
+    const tcp_multi_config &config,
+    std::size_t buffer_size)
+    : reader(owner), config(validate_multi_config(owner, config)),
+    acceptor(std::move(acceptor)),
+    connections(config.get_max_connections())
+{
+    assert(socket_uses_io_service(this->acceptor, get_io_service()));
+    // Accepted sockets inherit the buffer size from the acceptor
+    set_socket_recv_buffer_size(this->acceptor, buffer_size);
+    enqueue_accept();
+}
+
+tcp_multi_reader::tcp_multi_reader(
+    stream &owner,
+    const boost::asio::ip::tcp::endpoint &endpoint,
+    const tcp_multi_config &config)
+    : tcp_multi_reader(
+          owner,
+          boost::asio::ip::tcp::acceptor(owner.get_io_service(), endpoint),
+          config, config.get_buffer_size())
+{
+}
+
+tcp_multi_reader::tcp_multi_reader(
+    stream &owner,
+    boost::asio::ip::tcp::acceptor &&acceptor,
+    const tcp_multi_config &config)
+    : tcp_multi_reader(owner, std::move(acceptor), config, 0)
+{
+}
+
+void tcp_multi_reader::enqueue_accept()
+{
+    if (accepting || !acceptor.is_open())
+        return;
+    if (config.get_max_connections() != 0 && n_connections == config.get_max_connections())
+        return;   // Resumed by packet_handler when a connection closes
+    accepting.reset(new connection(get_io_service(), config.get_max_size(), config.get_ring_size()));
+    acceptor.async_accept(accepting->socket,
+        std::bind(&tcp_multi_reader::accept_handler, this, std::placeholders::_1));
+    pending++;
+}
+
+void tcp_multi_reader::enqueue_receive(std::size_t slot)
+{
+    using namespace std::placeholders;
+
+    connection &conn = *connections[slot];
+    conn.socket.async_receive(
+        conn.framer.prepare_receive(),
+        std::bind(&tcp_multi_reader::packet_handler, this, slot, _1, _2));
+    pending++;
+}
+
+void tcp_multi_reader::check_done()
+{
+    /* Either an accept or a receive is pending for as long as the reader
+     * is active, so once there are none left the reader is finished.
+     */
+    if (pending == 0 && !done)
+    {
+        done = true;
+        if (acceptor.is_open())
+            acceptor.close();
+        stopped();
+    }
+}
+
+void tcp_multi_reader::accept_handler(const boost::system::error_code &error)
+{
+    // Holding queue_mutex serialises all the handlers with each other and with stop()
+    stream_base::add_packet_state state(get_stream_base());
+    pending--;
+
+    std::unique_ptr<connection> conn = std::move(accepting);
+    if (!error && !state.is_stopped())
+    {
+        std::size_t slot = 0;
+        while (slot < connections.size() && connections[slot])
+            slot++;
+        if (slot == connections.size())
+            connections.emplace_back();
+        connections[slot] = std::move(conn);
+        n_connections++;
+        enqueue_receive(slot);
+        enqueue_accept();
+    }
+    else if (error && error != boost::asio::error::operation_aborted)
+    {
+        log_warning("Error in TCP accept: %1%", error.message());
+        acceptor.close();
+    }
+    check_done();
+}
+
+void tcp_multi_reader::packet_handler(
+    std::size_t slot,
+    const boost::system::error_code &error,
+    std::size_t bytes_transferred)
+{
+    stream_base::add_packet_state state(get_stream_base());
+    pending--;
+
+    connection &conn = *connections[slot];
+    bool read_more = false;
+    if (!error)
+    {
+        if (state.is_stopped())
+            log_info("TCP reader: discarding packet received after stream stopped");
+        else
+        {
+            std::uint64_t old_packets = state.packets;
+            read_more = conn.framer.process_buffer(state, bytes_transferred);
+            if (config.get_connection_stats() != tcp_multi_config::no_connection_stats)
+                state.get_batch_stats()[config.get_connection_stats() + slot]
+                    += state.packets - old_packets;
+        }
+    }
+    else if (error == boost::asio::error::eof)
+    {
+        if (config.get_stop_on_eof())
+            state.stop();
+    }
+    else if (error != boost::asio::error::operation_aborted)
+        log_warning("Error in TCP receiver: %1%", error.message());
+
+    if (read_more)
+        enqueue_receive(slot);
+    else
+    {
+        connections[slot].reset();
+        n_connections--;
+        if (!state.is_stopped())
+            enqueue_accept();
+    }
+    check_done();
+}
+
+void tcp_multi_reader::stop()
+{
+    /* Closing the sockets cancels the pending operations, and the last
+     * handler to run will call stopped().
      */
-    if (peer.is_open())
-        peer.close();
     if (acceptor.is_open())
         acceptor.close();
+    if (accepting && accepting->socket.is_open())
+        accepting->socket.close();
+    for (const auto &conn : connections)
+        if (conn && conn->socket.is_open())
+            conn->socket.close();
 }
 
-bool tcp_reader::lossy() const
+bool tcp_multi_reader::lossy() const
 {
     return false;
 }
@@ -31,6 +31,8 @@
 #include <cstdint>
 #include <cstring>
 #include <cstdlib>
+#include <ctime>
+#include <chrono>
 #include <mutex>
 #include <functional>
 #include <boost/asio.hpp>
@@ -49,6 +51,40 @@ namespace recv
 
 constexpr std::size_t udp_reader::default_buffer_size;
 
+#if SPEAD2_USE_RECVMMSG
+/// Space for the ancillary data of one message
+static constexpr std::size_t control_size = CMSG_SPACE(sizeof(timespec));
+#endif
+
+#ifdef SO_TIMESTAMPNS
+static bool timestamps_enabled(boost::asio::ip::udp::socket &socket)
+{
+    int value = 0;
+    socklen_t len = sizeof(value);
+    if (getsockopt(socket.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &value, &len) < 0)
+        return false;
+    return value != 0;
+}
+
+void udp_reader::enable_timestamps(boost::asio::ip::udp::socket &socket)
+{
+    int value = 1;
+    if (setsockopt(socket.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &value, sizeof(value)) < 0)
+        throw_errno("setsockopt(SO_TIMESTAMPNS) failed");
+}
+#else
+static bool timestamps_enabled(boost::asio::ip::udp::socket &)
+{
+    return false;
+}
+
+void udp_reader::enable_timestamps(boost::asio::ip::udp::socket &)
+{
+    throw std::system_error(std::make_error_code(std::errc::not_supported),
+                            "SO_TIMESTAMPNS is not supported on this platform");
+}
+#endif
+
 static boost::asio::ip::udp::socket bind_socket(
     boost::asio::ip::udp::socket &&socket,
     const boost::asio::ip::udp::endpoint &endpoint,
@@ -62,13 +98,15 @@ static boost::asio::ip::udp::socket bind_socket(
 udp_reader::udp_reader(
     stream &owner,
     boost::asio::ip::udp::socket &&socket,
-    std::size_t max_size)
+    std::size_t max_size,
+    std::unique_ptr<detail::busy_poller> &&poller)
     : udp_reader_base(owner), socket(std::move(socket)), max_size(max_size),
 #if SPEAD2_USE_RECVMMSG
-    buffer(mmsg_count), iov(mmsg_count), msgvec(mmsg_count)
+    buffer(mmsg_count), iov(mmsg_count), msgvec(mmsg_count),
 #else
-    buffer(new std::uint8_t[max_size + 1])
+    buffer(new std::uint8_t[max_size + 1]),
 #endif
+    poller(std::move(poller))
 {
     assert(socket_uses_io_service(this->socket, get_io_service()));
 #if SPEAD2_USE_RECVMMSG
@@ -84,7 +122,44 @@ udp_reader::udp_reader(
     }
 #endif
 
-    enqueue_receive();
+    if (timestamps_enabled(this->socket))
+    {
+#if SPEAD2_USE_RECVMMSG
+        control.reset(new std::uint8_t[mmsg_count * control_size]);
+        for (std::size_t i = 0; i < mmsg_count; i++)
+            msgvec[i].msg_hdr.msg_control = (void *) (control.get() + i * control_size);
+#else
+        log_warning("SO_TIMESTAMPNS is set on the socket, but timestamps require recvmmsg support");
+#endif
+    }
+
+    if (this->poller)
+    {
+        this->poller->apply_socket_options(this->socket.native_handle());
+        this->socket.non_blocking(true);
+        this->poller->start([this] { return poll_busy(); },
+                            [this] { finish_busy(); });
+    }
+    else
+        enqueue_receive();
+}
+
+udp_reader::udp_reader(
+    stream &owner,
+    boost::asio::ip::udp::socket &&socket,
+    std::size_t max_size)
+    : udp_reader(owner, std::move(socket), max_size, nullptr)
+{
+}
+
+udp_reader::udp_reader(
+    stream &owner,
+    boost::asio::ip::udp::socket &&socket,
+    std::size_t max_size,
+    const busy_poll_config &busy_config)
+    : udp_reader(owner, std::move(socket), max_size,
+                 std::unique_ptr<detail::busy_poller>(new detail::busy_poller(busy_config)))
+{
 }
 
 static boost::asio::ip::udp::socket make_bound_v4_socket(
@@ -181,6 +256,19 @@ udp_reader::udp_reader(
 {
 }
 
+udp_reader::udp_reader(
+    stream &owner,
+    const boost::asio::ip::udp::endpoint &endpoint,
+    std::size_t max_size,
+    std::size_t buffer_size,
+    const busy_poll_config &busy_config)
+    : udp_reader(
+        owner,
+        make_socket(owner.get_io_service(), endpoint, buffer_size),
+        max_size, busy_config)
+{
+}
+
 void udp_reader::packet_handler(
     const boost::system::error_code &error,
     std::size_t bytes_transferred)
@@ -195,21 +283,7 @@ void udp_reader::packet_handler(
         else
         {
 #if SPEAD2_USE_RECVMMSG
-            int received = recvmmsg(socket.native_handle(), msgvec.data(), msgvec.size(),
-                                    MSG_DONTWAIT, nullptr);
-            log_debug("recvmmsg returned %1%", received);
-            if (received == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
-            {
-                std::error_code code(errno, std::system_category());
-                log_warning("recvmmsg failed: %1% (%2%)", code.value(), code.message());
-            }
-            for (int i = 0; i < received; i++)
-            {
-                bool stopped = process_one_packet(state,
-                                                  buffer[i].get(), msgvec[i].msg_len, max_size);
-                if (stopped)
-                    break;
-            }
+            process_batch(state, receive_batch());
 #else
             process_one_packet(state, buffer.get(), bytes_transferred, max_size);
 #endif
@@ -228,6 +302,101 @@ void udp_reader::packet_handler(
     }
 }
 
+#if SPEAD2_USE_RECVMMSG
+int udp_reader::receive_batch()
+{
+    // The kernel overwrites msg_controllen, so it has to be reset each time
+    if (control)
+        for (std::size_t i = 0; i < mmsg_count; i++)
+            msgvec[i].msg_hdr.msg_controllen = control_size;
+    int received = recvmmsg(socket.native_handle(), msgvec.data(), msgvec.size(),
+                            MSG_DONTWAIT, nullptr);
+    log_debug("recvmmsg returned %1%", received);
+    if (received == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        std::error_code code(errno, std::system_category());
+        log_warning("recvmmsg failed: %1% (%2%)", code.value(), code.message());
+    }
+    return received;
+}
+
+void udp_reader::process_batch(stream_base::add_packet_state &state, int received)
+{
+    for (int i = 0; i < received; i++)
+    {
+        std::chrono::system_clock::time_point timestamp;
+        if (control)
+            timestamp = get_timestamp(msgvec[i].msg_hdr);
+        bool stopped = process_one_packet(state,
+                                          buffer[i].get(), msgvec[i].msg_len, max_size,
+                                          timestamp);
+        if (stopped)
+            break;
+    }
+}
+
+std::chrono::system_clock::time_point udp_reader::get_timestamp(const msghdr &msg)
+{
+#ifdef SO_TIMESTAMPNS
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(const_cast<msghdr *>(&msg), cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            timespec ts;
+            std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            auto since_epoch = std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+            return std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(since_epoch));
+        }
+    }
+#endif
+    return std::chrono::system_clock::time_point();
+}
+#endif
+
+detail::busy_poller::status udp_reader::poll_busy()
+{
+    /* Receive before taking the stream lock, so that an idle poll does not
+     * contend with the stream's other users.
+     */
+#if SPEAD2_USE_RECVMMSG
+    int received = receive_batch();
+    if (received <= 0)
+        return detail::busy_poller::status::IDLE;
+#else
+    boost::system::error_code error;
+    std::size_t bytes_transferred = socket.receive(
+        boost::asio::buffer(buffer.get(), max_size + 1), 0, error);
+    if (error)
+    {
+        if (error != boost::asio::error::would_block)
+            log_warning("Error in UDP receiver: %1%", error.message());
+        return detail::busy_poller::status::IDLE;
+    }
+#endif
+
+    stream_base::add_packet_state state(get_stream_base());
+    if (state.is_stopped())
+    {
+        log_info("UDP reader: discarding packet received after stream stopped");
+        return detail::busy_poller::status::DONE;
+    }
+#if SPEAD2_USE_RECVMMSG
+    process_batch(state, received);
+#else
+    process_one_packet(state, buffer.get(), bytes_transferred, max_size);
+#endif
+    return state.is_stopped() ? detail::busy_poller::status::DONE
+                              : detail::busy_poller::status::PROGRESS;
+}
+
+void udp_reader::finish_busy()
+{
+    socket.close();
+    stopped();
+}
+
 void udp_reader::enqueue_receive()
 {
     using namespace std::placeholders;
@@ -247,8 +416,14 @@ void udp_reader::stop()
      * operations on it.
      * Don't put any logging here: it could be running in a shutdown
      * path where it is no longer safe to do so.
+     *
+     * In busy-polling mode the polling thread may be using the socket, so
+     * it is left to close it.
      */
-    socket.close();
+    if (poller)
+        poller->stop();
+    else
+        socket.close();
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -372,5 +547,26 @@ std::unique_ptr<reader> reader_factory<udp_reader>::make_reader(
             owner, std::move(socket), max_size));
 }
 
+std::unique_ptr<reader> reader_factory<udp_reader>::make_reader(
+    stream &owner,
+    const boost::asio::ip::udp::endpoint &endpoint,
+    std::size_t max_size,
+    std::size_t buffer_size,
+    const busy_poll_config &busy_config)
+{
+    return std::unique_ptr<reader>(new udp_reader(
+            owner, endpoint, max_size, buffer_size, busy_config));
+}
+
+std::unique_ptr<reader> reader_factory<udp_reader>::make_reader(
+    stream &owner,
+    boost::asio::ip::udp::socket &&socket,
+    std::size_t max_size,
+    const busy_poll_config &busy_config)
+{
+    return std::unique_ptr<reader>(new udp_reader(
+            owner, std::move(socket), max_size, busy_config));
+}
+
 } // namespace recv
 } // namespace spead2
@@ -20,6 +20,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <chrono>
 #include <spead2/recv_reader.h>
 #include <spead2/recv_packet.h>
 #include <spead2/recv_stream.h>
@@ -35,7 +36,8 @@ constexpr std::size_t udp_reader_base::default_max_size;
 
 bool udp_reader_base::process_one_packet(
     stream_base::add_packet_state &state,
-    const std::uint8_t *data, std::size_t length, std::size_t max_size)
+    const std::uint8_t *data, std::size_t length, std::size_t max_size,
+    std::chrono::system_clock::time_point timestamp)
 {
     bool stopped = false;
     if (length <= max_size && length > 0)
@@ -45,6 +47,7 @@ bool udp_reader_base::process_one_packet(
         std::size_t size = decode_packet(packet, data, length);
         if (size == length)
         {
+            packet.timestamp = timestamp;
             state.add_packet(packet);
             if (state.is_stopped())
             {
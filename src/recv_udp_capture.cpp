@@ -0,0 +1,477 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Native pcap and pcapng reader. The file formats are described at
+ * https://wiki.wireshark.org/Development/LibpcapFileFormat and
+ * https://www.ietf.org/archive/id/draft-tuexen-opsawg-pcapng-05.html.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <boost/asio.hpp>
+#include <spead2/common_endian.h>
+#include <spead2/common_logging.h>
+#include <spead2/common_raw_packet.h>
+#include <spead2/recv_file.h>
+#include <spead2/recv_stream.h>
+#include <spead2/recv_udp_base.h>
+#include <spead2/recv_udp_capture.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+namespace detail
+{
+
+constexpr std::uint32_t capture_file::linktype_ethernet;
+constexpr std::uint32_t capture_file::linktype_raw;
+constexpr std::uint32_t capture_file::linktype_ipv4;
+
+namespace
+{
+
+// Magic numbers, as they appear when loaded little-endian
+constexpr std::uint32_t pcap_magic_us = 0xa1b2c3d4;
+constexpr std::uint32_t pcap_magic_ns = 0xa1b23c4d;
+constexpr std::uint32_t pcap_magic_us_swapped = 0xd4c3b2a1;
+constexpr std::uint32_t pcap_magic_ns_swapped = 0x4d3cb2a1;
+constexpr std::uint32_t pcapng_byte_order_magic = 0x1a2b3c4d;
+constexpr std::uint32_t pcapng_byte_order_magic_swapped = 0x4d3c2b1a;
+
+constexpr std::size_t pcap_file_header_size = 24;
+constexpr std::size_t pcap_record_header_size = 16;
+
+// pcapng block types
+constexpr std::uint32_t block_section_header = 0x0a0d0d0a;
+constexpr std::uint32_t block_interface_description = 1;
+constexpr std::uint32_t block_packet = 2;   // obsolete, but still readable
+constexpr std::uint32_t block_simple_packet = 3;
+constexpr std::uint32_t block_enhanced_packet = 6;
+
+// pcapng interface description block options
+constexpr std::uint16_t option_end = 0;
+constexpr std::uint16_t option_if_tsresol = 9;
+constexpr std::uint16_t option_if_tsoffset = 14;
+
+// Minimum block size (type, length, trailing length)
+constexpr std::size_t block_overhead = 12;
+constexpr std::size_t section_header_min_size = 28;
+
+bool supported_linktype(std::uint32_t linktype)
+{
+    return linktype == capture_file::linktype_ethernet
+        || linktype == capture_file::linktype_raw
+        || linktype == capture_file::linktype_ipv4;
+}
+
+} // anonymous namespace
+
+template<typename T>
+T capture_file::load(std::size_t offset) const
+{
+    const std::uint8_t *ptr = mapping->get_data() + offset;
+    return big_endian ? load_be<T>(ptr) : load_le<T>(ptr);
+}
+
+std::uint64_t capture_file::to_nanoseconds(const interface &iface, std::uint64_t ts)
+{
+    static const std::uint64_t ns_per_s = 1000000000;
+    std::uint64_t ns;
+    if (iface.binary)
+    {
+        // Split into seconds and fraction to avoid overflow
+        unsigned int e = std::min(iface.exponent, 63U);
+        std::uint64_t frac = ts & ((std::uint64_t(1) << e) - 1);
+        ns = (ts >> e) * ns_per_s;
+        if (e > 32)
+        {
+            frac >>= e - 32;
+            e = 32;
+        }
+        ns += frac * ns_per_s >> e;
+    }
+    else
+    {
+        unsigned int diff = (iface.exponent <= 9) ? 9 - iface.exponent : iface.exponent - 9;
+        std::uint64_t scale = 1;
+        for (unsigned int i = 0; i < diff && i < 19; i++)
+            scale *= 10;
+        ns = (iface.exponent <= 9) ? ts * scale : ts / scale;
+    }
+    return ns + std::uint64_t(iface.offset) * ns_per_s;
+}
+
+capture_file::capture_file(const std::string &filename)
+    : mapping(std::make_shared<file_mapping>(filename)), filename(filename)
+{
+    const std::size_t size = mapping->get_size();
+    if (size < 4)
+        throw std::runtime_error(filename + " is not a pcap or pcapng file");
+    std::uint32_t magic = load_le<std::uint32_t>(mapping->get_data());
+    if (magic == block_section_header)
+    {
+        pcapng = true;
+        std::size_t length = parse_section_header(size);
+        if (length == 0)
+            throw std::runtime_error(filename + " has an invalid pcapng section header");
+        pos = length;
+    }
+    else
+    {
+        switch (magic)
+        {
+        case pcap_magic_us:
+        case pcap_magic_ns:
+            big_endian = false;
+            break;
+        case pcap_magic_us_swapped:
+        case pcap_magic_ns_swapped:
+            big_endian = true;
+            break;
+        default:
+            throw std::runtime_error(filename + " is not a pcap or pcapng file");
+        }
+        if (size < pcap_file_header_size)
+            throw std::runtime_error(filename + " has a truncated pcap header");
+        magic = load<std::uint32_t>(0);
+        pcap_interface.linktype = load<std::uint32_t>(20) & 0xffff;
+        pcap_interface.binary = false;
+        pcap_interface.exponent = (magic == pcap_magic_ns) ? 9 : 6;
+        pcap_interface.offset = 0;
+        if (!supported_linktype(pcap_interface.linktype))
+            throw std::runtime_error(
+                filename + " has unsupported link type " + std::to_string(pcap_interface.linktype));
+        pos = pcap_file_header_size;
+    }
+}
+
+bool capture_file::malformed(const char *what)
+{
+    log_warning("%1%: %2% at offset %3%, ignoring the rest of the file", filename, what, pos);
+    pos = mapping->get_size();
+    return false;
+}
+
+bool capture_file::next(record &out)
+{
+    return pcapng ? next_pcapng(out) : next_pcap(out);
+}
+
+bool capture_file::next_pcap(record &out)
+{
+    const std::size_t size = mapping->get_size();
+    if (pos == size)
+        return false;
+    if (size - pos < pcap_record_header_size)
+        return malformed("truncated record header");
+    std::uint32_t ts_sec = load<std::uint32_t>(pos);
+    std::uint32_t ts_frac = load<std::uint32_t>(pos + 4);
+    out.captured_length = load<std::uint32_t>(pos + 8);
+    out.original_length = load<std::uint32_t>(pos + 12);
+    if (size - pos - pcap_record_header_size < out.captured_length)
+        return malformed("truncated record");
+    out.timestamp = to_nanoseconds(
+        pcap_interface,
+        std::uint64_t(ts_sec) * (pcap_interface.exponent == 9 ? 1000000000 : 1000000) + ts_frac);
+    out.linktype = pcap_interface.linktype;
+    out.data = const_cast<std::uint8_t *>(mapping->get_data()) + pos + pcap_record_header_size;
+    pos += pcap_record_header_size + out.captured_length;
+    return true;
+}
+
+std::size_t capture_file::parse_section_header(std::size_t available)
+{
+    if (available < section_header_min_size)
+        return 0;
+    std::uint32_t order = load_le<std::uint32_t>(mapping->get_data() + pos + 8);
+    if (order == pcapng_byte_order_magic)
+        big_endian = false;
+    else if (order == pcapng_byte_order_magic_swapped)
+        big_endian = true;
+    else
+        return 0;
+    std::uint32_t length = load<std::uint32_t>(pos + 4);
+    if (length < section_header_min_size || length > available || length % 4 != 0)
+        return 0;
+    // Interface IDs are local to the section
+    interfaces.clear();
+    return length;
+}
+
+void capture_file::parse_interface(std::size_t body, std::size_t body_length)
+{
+    interface iface;
+    iface.linktype = load<std::uint16_t>(body);
+    iface.binary = false;
+    iface.exponent = 6;
+    iface.offset = 0;
+    std::size_t opt = body + 8;
+    const std::size_t end = body + body_length;
+    while (end - opt >= 4)
+    {
+        std::uint16_t code = load<std::uint16_t>(opt);
+        std::uint16_t length = load<std::uint16_t>(opt + 2);
+        if (code == option_end || end - opt - 4 < length)
+            break;
+        if (code == option_if_tsresol && length >= 1)
+        {
+            std::uint8_t value = mapping->get_data()[opt + 4];
+            iface.binary = value & 0x80;
+            iface.exponent = value & 0x7f;
+        }
+        else if (code == option_if_tsoffset && length >= 8)
+            iface.offset = std::int64_t(load<std::uint64_t>(opt + 4));
+        opt += 4 + (length + 3) / 4 * 4;
+    }
+    if (!supported_linktype(iface.linktype))
+        log_warning("%1%: ignoring packets on interface %2% with unsupported link type %3%",
+                    filename, interfaces.size(), iface.linktype);
+    interfaces.push_back(iface);
+}
+
+bool capture_file::next_pcapng(record &out)
+{
+    const std::size_t size = mapping->get_size();
+    while (pos < size)
+    {
+        if (size - pos < block_overhead)
+            return malformed("truncated block header");
+        std::uint32_t type = load<std::uint32_t>(pos);
+        if (type == block_section_header)
+        {
+            std::size_t length = parse_section_header(size - pos);
+            if (length == 0)
+                return malformed("invalid section header");
+            pos += length;
+            continue;
+        }
+        std::uint32_t length = load<std::uint32_t>(pos + 4);
+        if (length < block_overhead || length % 4 != 0)
+            return malformed("invalid block length");
+        if (length > size - pos)
+            return malformed("truncated block");
+        const std::size_t body = pos + 8;
+        const std::size_t body_length = length - block_overhead;
+        std::uint32_t iface_id;
+        std::size_t data_offset;
+        switch (type)
+        {
+        case block_interface_description:
+            if (body_length < 8)
+                return malformed("invalid interface description block");
+            parse_interface(body, body_length);
+            pos += length;
+            continue;
+        case block_enhanced_packet:
+        case block_packet:
+            if (body_length < 20)
+                return malformed("invalid packet block");
+            if (type == block_enhanced_packet)
+                iface_id = load<std::uint32_t>(body);
+            else
+                iface_id = load<std::uint16_t>(body);
+            if (iface_id >= interfaces.size())
+                return malformed("packet block references unknown interface");
+            out.timestamp = to_nanoseconds(
+                interfaces[iface_id],
+                std::uint64_t(load<std::uint32_t>(body + 4)) << 32 | load<std::uint32_t>(body + 8));
+            out.captured_length = load<std::uint32_t>(body + 12);
+            out.original_length = load<std::uint32_t>(body + 16);
+            data_offset = 20;
+            break;
+        case block_simple_packet:
+            if (body_length < 4 || interfaces.empty())
+                return malformed("invalid simple packet block");
+            iface_id = 0;
+            // Simple packet blocks have no timestamp: assume no time passed
+            out.timestamp = last_timestamp;
+            out.original_length = load<std::uint32_t>(body);
+            out.captured_length = std::min(std::size_t(out.original_length), body_length - 4);
+            data_offset = 4;
+            break;
+        default:
+            // Statistics, name resolution, custom blocks etc.
+            pos += length;
+            continue;
+        }
+        if (body_length - data_offset < out.captured_length)
+            return malformed("packet block data overruns block");
+        out.linktype = interfaces[iface_id].linktype;
+        out.data = const_cast<std::uint8_t *>(mapping->get_data()) + body + data_offset;
+        last_timestamp = out.timestamp;
+        pos += length;
+        return true;
+    }
+    return false;
+}
+
+void capture_file::preload() const
+{
+    static const std::size_t page_size = sysconf(_SC_PAGESIZE);
+    const volatile std::uint8_t *data = mapping->get_data();
+    const std::size_t size = mapping->get_size();
+    for (std::size_t i = 0; i < size; i += page_size)
+        (void) data[i];
+}
+
+capture_merge::capture_merge(const std::vector<std::string> &filenames)
+{
+    if (filenames.empty())
+        throw std::invalid_argument("at least one file must be given");
+    for (const std::string &filename : filenames)
+        files.emplace_back(new capture_file(filename));
+    heads.resize(files.size());
+    have.resize(files.size());
+    for (std::size_t i = 0; i < files.size(); i++)
+        have[i] = files[i]->next(heads[i]);
+}
+
+bool capture_merge::next(capture_file::record &out)
+{
+    // There are normally only a few files, so a linear search is fine
+    int best = -1;
+    for (std::size_t i = 0; i < files.size(); i++)
+        if (have[i] && (best == -1 || heads[i].timestamp < heads[best].timestamp))
+            best = i;
+    if (best == -1)
+        return false;
+    out = heads[best];
+    have[best] = files[best]->next(heads[best]);
+    return true;
+}
+
+void capture_merge::preload() const
+{
+    for (const auto &file : files)
+        file->preload();
+}
+
+bool udp_from_capture(
+    const capture_file::record &r, packet_buffer &payload,
+    boost::asio::ip::udp::endpoint &destination)
+{
+    std::uint8_t *ip;
+    switch (r.linktype)
+    {
+    case capture_file::linktype_ethernet:
+        payload = udp_from_ethernet(r.data, r.captured_length);
+        ip = r.data + ethernet_frame::min_size;
+        break;
+    case capture_file::linktype_raw:
+    case capture_file::linktype_ipv4:
+        payload = udp_from_ipv4(r.data, r.captured_length);
+        ip = r.data;
+        break;
+    default:
+        return false;
+    }
+    // The headers have already been validated, so only the minimum sizes are needed
+    udp_packet udp(payload.data() - udp_packet::min_size, udp_packet::min_size);
+    ipv4_packet ipv4(ip, ipv4_packet::min_size);
+    destination = boost::asio::ip::udp::endpoint(ipv4.destination_address(), udp.destination_port());
+    return true;
+}
+
+} // namespace detail
+
+constexpr int udp_capture_reader::max_batch;
+
+udp_capture_reader::udp_capture_reader(
+    stream &owner, const std::vector<std::string> &filenames,
+    const boost::asio::ip::udp::endpoint &filter)
+    : udp_reader_base(owner), files(filenames), filter(filter)
+{
+    get_io_service().post([this] { run(); });
+}
+
+udp_capture_reader::udp_capture_reader(
+    stream &owner, const std::string &filename,
+    const boost::asio::ip::udp::endpoint &filter)
+    : udp_capture_reader(owner, std::vector<std::string>{filename}, filter)
+{
+}
+
+void udp_capture_reader::process(
+    stream_base::add_packet_state &state, const detail::capture_file::record &r)
+{
+    if (r.captured_length < r.original_length)
+    {
+        log_warning("Packet was truncated (%1% < %2%)", r.captured_length, r.original_length);
+        return;
+    }
+    try
+    {
+        packet_buffer payload;
+        boost::asio::ip::udp::endpoint destination;
+        if (!detail::udp_from_capture(r, payload, destination))
+            return;  // unsupported link type: a warning was logged when the interface was found
+        if (filter.port() != 0 && destination.port() != filter.port())
+            return;
+        if (!filter.address().is_unspecified() && destination.address() != filter.address())
+            return;
+        auto timestamp = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(r.timestamp)));
+        process_one_packet(state, payload.data(), payload.size(), payload.size(), timestamp);
+    }
+    catch (packet_type_error &)
+    {
+        // Not a UDP datagram (e.g. ARP): skip silently, like a capture filter
+    }
+    catch (std::length_error &e)
+    {
+        log_warning(e.what());
+    }
+}
+
+void udp_capture_reader::run()
+{
+    stream_base::add_packet_state state(get_stream_base());
+    for (int i = 0; i < max_batch && !state.is_stopped(); i++)
+    {
+        detail::capture_file::record r;
+        if (!files.next(r))
+        {
+            state.stop();
+            break;
+        }
+        process(state, r);
+    }
+    if (!state.is_stopped())
+        get_io_service().post([this] { run(); });
+    else
+        stopped();
+}
+
+bool udp_capture_reader::lossy() const
+{
+    return false;
+}
+
+} // namespace recv
+} // namespace spead2
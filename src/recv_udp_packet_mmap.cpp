@@ -0,0 +1,412 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_PACKET_MMAP
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <stdexcept>
+#include <functional>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+#include <boost/asio.hpp>
+#include <spead2/recv_reader.h>
+#include <spead2/recv_stream.h>
+#include <spead2/recv_udp_base.h>
+#include <spead2/recv_udp_packet_mmap.h>
+#include <spead2/common_raw_packet.h>
+#include <spead2/common_logging.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+constexpr std::size_t udp_packet_mmap_config::default_block_size;
+constexpr std::size_t udp_packet_mmap_config::default_num_blocks;
+constexpr unsigned int udp_packet_mmap_config::default_block_timeout;
+constexpr std::size_t udp_packet_mmap_config::default_max_size;
+
+static void validate_endpoint(const boost::asio::ip::udp::endpoint &endpoint)
+{
+    if (!endpoint.address().is_unspecified() && !endpoint.address().is_v4())
+        throw std::invalid_argument("endpoint is not an IPv4 address");
+}
+
+udp_packet_mmap_config &udp_packet_mmap_config::set_endpoints(
+    const std::vector<boost::asio::ip::udp::endpoint> &endpoints)
+{
+    for (const auto &endpoint : endpoints)
+        validate_endpoint(endpoint);
+    this->endpoints = endpoints;
+    return *this;
+}
+
+udp_packet_mmap_config &udp_packet_mmap_config::add_endpoint(
+    const boost::asio::ip::udp::endpoint &endpoint)
+{
+    validate_endpoint(endpoint);
+    endpoints.push_back(endpoint);
+    return *this;
+}
+
+udp_packet_mmap_config &udp_packet_mmap_config::set_interface_address(
+    const boost::asio::ip::address &interface_address)
+{
+    if (!interface_address.is_v4())
+        throw std::invalid_argument("interface address is not an IPv4 address");
+    this->interface_address = interface_address;
+    return *this;
+}
+
+udp_packet_mmap_config &udp_packet_mmap_config::set_max_size(std::size_t max_size)
+{
+    if (max_size < 1)
+        throw std::invalid_argument("max_size must be positive");
+    this->max_size = max_size;
+    return *this;
+}
+
+udp_packet_mmap_config &udp_packet_mmap_config::set_block_size(std::size_t block_size)
+{
+    if (block_size == 0)
+        throw std::invalid_argument("block_size must be positive");
+    this->block_size = block_size;
+    return *this;
+}
+
+udp_packet_mmap_config &udp_packet_mmap_config::set_num_blocks(std::size_t num_blocks)
+{
+    if (num_blocks == 0)
+        throw std::invalid_argument("num_blocks must be positive");
+    this->num_blocks = num_blocks;
+    return *this;
+}
+
+udp_packet_mmap_config &udp_packet_mmap_config::set_block_timeout(unsigned int block_timeout)
+{
+    this->block_timeout = block_timeout;
+    return *this;
+}
+
+udp_packet_mmap_config &udp_packet_mmap_config::set_fanout_group(int fanout_group)
+{
+    if (fanout_group > 0xffff)
+        throw std::invalid_argument("fanout_group must be at most 65535");
+    this->fanout_group = fanout_group < 0 ? -1 : fanout_group;
+    return *this;
+}
+
+udp_packet_mmap_config &udp_packet_mmap_config::set_fanout_mode(fanout_mode fanout)
+{
+    this->fanout = fanout;
+    return *this;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+/* Offsets (relative to the start of the ethernet frame) of fields that are
+ * inspected by the BPF filter. Offsets of UDP header fields exclude the
+ * variable-length IPv4 header, whose length is loaded into the X register.
+ */
+constexpr std::uint32_t ethertype_offset = 12;
+constexpr std::uint32_t ipv4_offset = 14;
+constexpr std::uint32_t ipv4_frag_offset = ipv4_offset + 6;
+constexpr std::uint32_t ipv4_protocol_offset = ipv4_offset + 9;
+constexpr std::uint32_t ipv4_destination_offset = ipv4_offset + 16;
+constexpr std::uint32_t udp_destination_port_offset = ipv4_offset + 2;
+// Maximum number of bytes of headers before the UDP payload
+constexpr std::size_t max_header_size = 14 + 60 + 8;
+
+/* Build a classic BPF program that accepts only unfragmented IPv4 UDP
+ * packets addressed to one of the endpoints. Each endpoint gets its own
+ * short block of instructions, so that all jumps are local and the 8-bit
+ * jump offsets are never exceeded.
+ */
+std::vector<sock_filter> make_filter(const std::vector<boost::asio::ip::udp::endpoint> &endpoints)
+{
+    const std::uint32_t accept = 0xffffffffU;
+    std::vector<sock_filter> code;
+    // Ethertype must be IPv4
+    code.push_back(BPF_STMT(BPF_LD | BPF_H | BPF_ABS, ethertype_offset));
+    code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 1, 0));
+    code.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+    // Protocol must be UDP
+    code.push_back(BPF_STMT(BPF_LD | BPF_B | BPF_ABS, ipv4_protocol_offset));
+    code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 1, 0));
+    code.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+    // Must not be a fragment (more-fragments flag or non-zero offset)
+    code.push_back(BPF_STMT(BPF_LD | BPF_H | BPF_ABS, ipv4_frag_offset));
+    code.push_back(BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x3fff, 0, 1));
+    code.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+    // X <- IPv4 header length
+    code.push_back(BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, ipv4_offset));
+    for (const auto &endpoint : endpoints)
+    {
+        code.push_back(BPF_STMT(BPF_LD | BPF_H | BPF_IND, udp_destination_port_offset));
+        if (endpoint.address().is_unspecified())
+        {
+            code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, endpoint.port(), 0, 1));
+        }
+        else
+        {
+            code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, endpoint.port(), 0, 3));
+            code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, ipv4_destination_offset));
+            code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                                    std::uint32_t(endpoint.address().to_v4().to_ulong()), 0, 1));
+        }
+        code.push_back(BPF_STMT(BPF_RET | BPF_K, accept));
+    }
+    code.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+    if (code.size() > BPF_MAXINSNS)
+        throw std::invalid_argument("too many endpoints for the packet filter");
+    return code;
+}
+
+int fanout_mode_value(udp_packet_mmap_config::fanout_mode mode)
+{
+    switch (mode)
+    {
+    case udp_packet_mmap_config::fanout_mode::HASH: return PACKET_FANOUT_HASH;
+    case udp_packet_mmap_config::fanout_mode::LB: return PACKET_FANOUT_LB;
+    case udp_packet_mmap_config::fanout_mode::CPU: return PACKET_FANOUT_CPU;
+    case udp_packet_mmap_config::fanout_mode::ROLLOVER: return PACKET_FANOUT_ROLLOVER;
+    case udp_packet_mmap_config::fanout_mode::RND: return PACKET_FANOUT_RND;
+    case udp_packet_mmap_config::fanout_mode::QM: return PACKET_FANOUT_QM;
+    }
+    throw std::invalid_argument("unknown fanout mode");
+}
+
+int make_packet_socket()
+{
+    /* Protocol 0 means no packets are delivered until the socket is bound,
+     * so that nothing slips through before the filter is attached.
+     */
+    int fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (fd < 0)
+        throw_errno("socket(AF_PACKET) failed");
+    return fd;
+}
+
+template<typename T>
+void set_packet_option(int fd, int level, int name, const T &value, const char *msg)
+{
+    if (setsockopt(fd, level, name, &value, sizeof(value)) != 0)
+        throw_errno(msg);
+}
+
+} // anonymous namespace
+
+void udp_packet_mmap_reader::munmap_deleter::operator()(std::uint8_t *ptr) const
+{
+    munmap(ptr, size);
+}
+
+udp_packet_mmap_reader::udp_packet_mmap_reader(
+    stream &owner, const udp_packet_mmap_config &config)
+    : udp_reader_base(owner),
+    descriptor(get_io_service(), make_packet_socket()),
+    join_socket(get_io_service(), boost::asio::ip::udp::v4()),
+    max_size(config.get_max_size()),
+    block_size(config.get_block_size()),
+    num_blocks(config.get_num_blocks()),
+    ring(nullptr, munmap_deleter{0})
+{
+    if (config.get_endpoints().empty())
+        throw std::invalid_argument("endpoints is empty");
+    if (config.get_interface_address().is_unspecified())
+        throw std::invalid_argument("interface address has not been specified");
+    std::size_t page_size = sysconf(_SC_PAGESIZE);
+    if (block_size % page_size != 0)
+        throw std::invalid_argument("block_size must be a multiple of the page size");
+    /* For TPACKET_V3 the frame size only needs to be self-consistent; the
+     * kernel packs variable-sized frames into each block. It is chosen so
+     * that a maximum-sized packet is guaranteed to fit.
+     */
+    std::size_t frame_size = TPACKET_ALIGN(TPACKET3_HDRLEN + max_header_size + max_size);
+    if (frame_size + TPACKET_ALIGN(sizeof(tpacket_block_desc)) > block_size)
+        throw std::invalid_argument("block_size is too small for max_size");
+
+    int fd = descriptor.native_handle();
+    std::vector<sock_filter> code = make_filter(config.get_endpoints());
+    sock_fprog filter;
+    filter.len = code.size();
+    filter.filter = code.data();
+    set_packet_option(fd, SOL_SOCKET, SO_ATTACH_FILTER, filter, "setsockopt(SO_ATTACH_FILTER) failed");
+    set_packet_option(fd, SOL_PACKET, PACKET_VERSION, int(TPACKET_V3), "setsockopt(PACKET_VERSION) failed");
+
+    tpacket_req3 req = {};
+    req.tp_block_size = block_size;
+    req.tp_block_nr = num_blocks;
+    req.tp_frame_size = frame_size;
+    req.tp_frame_nr = (block_size / frame_size) * num_blocks;
+    req.tp_retire_blk_tov = config.get_block_timeout();
+    set_packet_option(fd, SOL_PACKET, PACKET_RX_RING, req, "setsockopt(PACKET_RX_RING) failed");
+
+    std::size_t ring_size = block_size * num_blocks;
+    void *ptr = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED)
+        throw_errno("mmap of packet ring failed");
+    ring = std::unique_ptr<std::uint8_t, munmap_deleter>(
+        reinterpret_cast<std::uint8_t *>(ptr), munmap_deleter{ring_size});
+
+    sockaddr_ll addr = {};
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_IP);
+    addr.sll_ifindex = interface_index(config.get_interface_address());
+    if (bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0)
+        throw_errno("bind of packet socket failed");
+
+    if (config.get_fanout_group() >= 0)
+    {
+        int fanout = config.get_fanout_group() | (fanout_mode_value(config.get_fanout_mode()) << 16);
+        set_packet_option(fd, SOL_PACKET, PACKET_FANOUT, fanout, "setsockopt(PACKET_FANOUT) failed");
+    }
+
+    join_socket.set_option(boost::asio::socket_base::reuse_address(true));
+    for (const auto &endpoint : config.get_endpoints())
+        if (endpoint.address().is_multicast())
+        {
+            join_socket.set_option(boost::asio::ip::multicast::join_group(
+                endpoint.address().to_v4(), config.get_interface_address().to_v4()));
+        }
+
+    enqueue_receive(false);
+}
+
+bool udp_packet_mmap_reader::process_block(
+    stream_base::add_packet_state &state, std::uint8_t *block)
+{
+    tpacket_block_desc *desc = reinterpret_cast<tpacket_block_desc *>(block);
+    tpacket_hdr_v1 &bh = desc->hdr.bh1;
+    if (!(__atomic_load_n(&bh.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+        return false;
+
+    std::uint8_t *ptr = block + bh.offset_to_first_pkt;
+    for (std::uint32_t i = 0; i < bh.num_pkts && !state.is_stopped(); i++)
+    {
+        const tpacket3_hdr *hdr = reinterpret_cast<const tpacket3_hdr *>(ptr);
+        const sockaddr_ll *ll = reinterpret_cast<const sockaddr_ll *>(
+            ptr + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+        // On loopback we also see our own transmissions; skip them
+        if (ll->sll_pkttype != PACKET_OUTGOING)
+        {
+            if (hdr->tp_snaplen < hdr->tp_len)
+                log_info("dropped packet due to truncation");
+            else
+            {
+                try
+                {
+                    packet_buffer payload = udp_from_ethernet(ptr + hdr->tp_mac, hdr->tp_snaplen);
+                    process_one_packet(state, payload.data(), payload.size(), max_size);
+                }
+                catch (packet_type_error &e)
+                {
+                    log_info(e.what());
+                }
+                catch (std::length_error &e)
+                {
+                    log_info(e.what());
+                }
+            }
+        }
+        ptr += hdr->tp_next_offset;
+    }
+    // Hand the block back to the kernel
+    __atomic_store_n(&bh.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    return true;
+}
+
+void udp_packet_mmap_reader::packet_handler(const boost::system::error_code &error)
+{
+    stream_base::add_packet_state state(get_stream_base());
+
+    bool need_poll = false;
+    if (!error)
+    {
+        if (state.is_stopped())
+        {
+            log_info("UDP reader: discarding packet received after stream stopped");
+        }
+        else
+        {
+            /* Go at most once around the ring, to avoid starving other work
+             * on the io_service if the kernel keeps up with us. If we stop
+             * because of that limit, there may be more blocks ready, and
+             * we need to come back without waiting for the socket.
+             */
+            need_poll = true;
+            for (std::size_t i = 0; i < num_blocks && !state.is_stopped(); i++)
+            {
+                if (!process_block(state, ring.get() + next_block * block_size))
+                {
+                    need_poll = false;
+                    break;
+                }
+                if (++next_block == num_blocks)
+                    next_block = 0;
+            }
+        }
+    }
+    else if (error != boost::asio::error::operation_aborted)
+        log_warning("Error in UDP receiver: %1%", error.message());
+
+    if (!state.is_stopped())
+        enqueue_receive(need_poll);
+    else
+        stopped();
+}
+
+void udp_packet_mmap_reader::enqueue_receive(bool need_poll)
+{
+    using namespace std::placeholders;
+    if (need_poll)
+        get_io_service().post(
+            std::bind(&udp_packet_mmap_reader::packet_handler, this, boost::system::error_code()));
+    else
+        descriptor.async_read_some(
+            boost::asio::null_buffers(),
+            std::bind(&udp_packet_mmap_reader::packet_handler, this, _1));
+}
+
+void udp_packet_mmap_reader::stop()
+{
+    /* asio guarantees that closing the descriptor will cancel any pending
+     * operations on it. A posted poll will notice that the stream is
+     * stopped.
+     */
+    descriptor.close();
+}
+
+} // namespace recv
+} // namespace spead2
+
+#endif // SPEAD2_USE_PACKET_MMAP
@@ -0,0 +1,170 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_REUSEPORT
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <linux/filter.h>
+#include <boost/asio.hpp>
+#include <spead2/common_logging.h>
+#include <spead2/common_socket.h>
+#include <spead2/recv_udp_reuseport.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+constexpr std::size_t udp_reuseport_config::default_num_sockets;
+constexpr std::size_t udp_reuseport_config::default_max_size;
+constexpr std::size_t udp_reuseport_config::default_buffer_size;
+
+udp_reuseport_config &udp_reuseport_config::set_endpoint(
+    const boost::asio::ip::udp::endpoint &endpoint)
+{
+    if (endpoint.address().is_multicast())
+        throw std::invalid_argument("multicast endpoints are not supported with SO_REUSEPORT");
+    this->endpoint = endpoint;
+    return *this;
+}
+
+udp_reuseport_config &udp_reuseport_config::set_num_sockets(std::size_t num_sockets)
+{
+    if (num_sockets == 0)
+        throw std::invalid_argument("num_sockets must be positive");
+    this->num_sockets = num_sockets;
+    return *this;
+}
+
+udp_reuseport_config &udp_reuseport_config::set_max_size(std::size_t max_size)
+{
+    this->max_size = max_size;
+    return *this;
+}
+
+udp_reuseport_config &udp_reuseport_config::set_buffer_size(std::size_t buffer_size)
+{
+    this->buffer_size = buffer_size;
+    return *this;
+}
+
+udp_reuseport_config &udp_reuseport_config::set_affinity(const std::vector<int> &affinity)
+{
+    this->affinity = affinity;
+    return *this;
+}
+
+udp_reuseport_config &udp_reuseport_config::set_steering(steering steer)
+{
+    this->steer = steer;
+    return *this;
+}
+
+namespace detail
+{
+
+/* The program runs with the packet data starting at the UDP payload i.e.
+ * the SPEAD header. Returning an out-of-range index makes the kernel fall
+ * back to its hash.
+ */
+static std::vector<sock_filter> make_steering_program(
+    udp_reuseport_config::steering steer, std::uint32_t num_sockets)
+{
+    static constexpr std::uint32_t fallback = 0xffffffff;
+    switch (steer)
+    {
+    case udp_reuseport_config::steering::HEAP_CNT:
+        return std::vector<sock_filter>{
+            // Packet must be long enough for the header and one item pointer
+            BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+            BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 16, 0, 16),
+            // Check magic and version
+            BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 0),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x5304, 0, 14),
+            // Heap address width must be 4 to 7 bytes
+            BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 3),
+            BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 4, 0, 12),
+            BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 7, 11, 0),
+            // X = number of bits of the upper word below the item ID, plus 1
+            BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 3),
+            BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, 31),
+            BPF_STMT(BPF_MISC | BPF_TAX, 0),
+            // First item pointer must be immediate with ID HEAP_CNT
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 8),
+            BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x80000000, 0, 6),
+            BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 1),
+            BPF_STMT(BPF_ALU | BPF_RSH | BPF_X, 0),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 1, 0, 3),
+            // Select a socket from the low 32 bits of the heap counter
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 12),
+            BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, num_sockets),
+            BPF_STMT(BPF_RET | BPF_A, 0),
+            BPF_STMT(BPF_RET | BPF_K, fallback)
+        };
+    case udp_reuseport_config::steering::CPU:
+        return std::vector<sock_filter>{
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, std::uint32_t(SKF_AD_OFF + SKF_AD_CPU)),
+            BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, num_sockets),
+            BPF_STMT(BPF_RET | BPF_A, 0)
+        };
+    default:
+        return std::vector<sock_filter>();
+    }
+}
+
+boost::asio::ip::udp::socket make_reuseport_socket(
+    boost::asio::io_service &io_service, const udp_reuseport_config &config,
+    const boost::asio::ip::udp::endpoint &endpoint, bool first)
+{
+    boost::asio::ip::udp::socket socket(io_service, endpoint.protocol());
+    int enable = 1;
+    if (setsockopt(socket.native_handle(), SOL_SOCKET, SO_REUSEPORT,
+                   &enable, sizeof(enable)) < 0)
+        throw_errno("setsockopt(SO_REUSEPORT) failed");
+    set_socket_recv_buffer_size(socket, config.get_buffer_size());
+    socket.bind(endpoint);
+
+    if (first)
+    {
+        std::vector<sock_filter> program = make_steering_program(
+            config.get_steering(), config.get_num_sockets());
+        if (!program.empty())
+        {
+            sock_fprog fprog;
+            fprog.len = program.size();
+            fprog.filter = program.data();
+            if (setsockopt(socket.native_handle(), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                           &fprog, sizeof(fprog)) < 0)
+                throw_errno("setsockopt(SO_ATTACH_REUSEPORT_CBPF) failed");
+        }
+    }
+    return socket;
+}
+
+} // namespace detail
+
+} // namespace recv
+} // namespace spead2
+
+#endif // SPEAD2_USE_REUSEPORT
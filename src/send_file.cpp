@@ -0,0 +1,503 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <stdexcept>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <boost/asio.hpp>
+#include <spead2/common_logging.h>
+#include <spead2/common_memory_allocator.h>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/send_file.h>
+#include <spead2/send_writer.h>
+
+namespace spead2
+{
+namespace send
+{
+
+constexpr std::size_t file_stream_config::default_block_size;
+constexpr std::size_t file_stream_config::default_queue_depth;
+constexpr std::size_t file_stream_config::direct_alignment;
+
+file_stream_config &file_stream_config::set_block_size(std::size_t block_size)
+{
+    if (block_size == 0)
+        throw std::invalid_argument("block_size cannot be 0");
+    this->block_size = block_size;
+    return *this;
+}
+
+file_stream_config &file_stream_config::set_queue_depth(std::size_t queue_depth)
+{
+    if (queue_depth == 0)
+        throw std::invalid_argument("queue_depth cannot be 0");
+    this->queue_depth = queue_depth;
+    return *this;
+}
+
+file_stream_config &file_stream_config::set_direct(bool direct)
+{
+    this->direct = direct;
+    return *this;
+}
+
+file_stream_config &file_stream_config::set_affinity(int affinity)
+{
+    this->affinity = affinity;
+    return *this;
+}
+
+namespace
+{
+
+class file_writer : public writer
+{
+private:
+    static constexpr int max_batch = 64;
+
+    /// Staging block, corresponding to a fixed range of the file
+    struct block
+    {
+        memory_allocator::pointer data;
+        std::uint64_t offset = 0;     ///< File position of the start of the block
+        std::size_t length = 0;       ///< Bytes filled
+        std::size_t written = 0;      ///< Bytes already written by an earlier (partial) write
+        std::size_t groups = 0;       ///< Groups whose last packet is in this block
+        /// Groups with packets in this block (for reporting errors)
+        std::vector<detail::queue_item *> items;
+        boost::system::error_code result;
+    };
+
+    int fd = -1;
+    const std::size_t block_size;
+    const std::size_t max_packet_size;
+    /// Alignment of write offsets and sizes (1 unless using O_DIRECT)
+    const std::size_t alignment;
+
+    // State only accessed by wakeup
+    block cur;                     ///< Block being filled (valid if @ref has_cur)
+    bool has_cur = false;
+    /// The partially-filled block is being written, and must be resumed afterwards
+    bool partial_in_flight = false;
+    std::vector<block> spare;      ///< Empty blocks
+    std::size_t in_flight = 0;     ///< Blocks passed to the writer thread and not yet reaped
+    std::vector<block> reaping;    ///< Blocks being reaped (kept to reuse the allocation)
+    std::uint64_t next_offset = 0; ///< File position for the next new block
+    std::unique_ptr<std::uint8_t[]> scratch;
+    /// Packet that did not fit in the remainder of a block
+    transmit_packet pending;
+    std::size_t pending_offset = 0;  ///< Bytes of @ref pending already copied
+    bool has_pending = false;
+
+    /// Blocks waiting to be written
+    ringbuffer<block> to_write;
+    /// Protects @ref done and @ref parked
+    std::mutex done_mutex;
+    /// Blocks that have been written, but not yet reaped
+    std::vector<block> done;
+    /// Whether wakeup is waiting for a block to be written
+    bool parked = false;
+
+    std::thread thread;
+
+    /// Take the next free block (or resume the partial block), if possible
+    bool ensure_block();
+    /// Pass the current block to the writer thread
+    void submit();
+    /// Add part of a packet to the current block, starting at byte @a offset of the packet
+    void append(const transmit_packet &data, std::size_t &offset);
+    /// Copy @ref pending into blocks. Returns false if blocked on a free block.
+    bool write_pending();
+    /// Complete groups in written blocks and recycle the blocks
+    void reap();
+    /// Wait for the writer thread to finish a block before calling wakeup again
+    void park();
+
+    /// Write a contiguous range of blocks to the file
+    boost::system::error_code write_blocks(std::vector<block>::iterator first, std::vector<block>::iterator last);
+    void run(int affinity);
+
+    virtual void wakeup() override final;
+
+public:
+    file_writer(
+        io_service_ref io_service,
+        const std::string &filename,
+        const stream_config &config,
+        const file_stream_config &file_config);
+    ~file_writer();
+
+    virtual std::size_t get_num_substreams() const override final { return 1; }
+};
+
+constexpr int file_writer::max_batch;
+
+file_writer::file_writer(
+    io_service_ref io_service,
+    const std::string &filename,
+    const stream_config &config,
+    const file_stream_config &file_config)
+    : writer(std::move(io_service), config),
+    block_size(file_config.get_block_size()),
+    max_packet_size(config.get_max_packet_size()),
+    alignment(file_config.get_direct() ? file_stream_config::direct_alignment : 1),
+    scratch(new std::uint8_t[config.get_max_packet_size()]),
+    to_write(file_config.get_queue_depth())
+{
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    if (file_config.get_direct())
+    {
+#ifdef O_DIRECT
+        if (block_size % file_stream_config::direct_alignment != 0)
+            throw std::invalid_argument("block_size must be a multiple of the direct I/O alignment");
+        flags |= O_DIRECT;
+#else
+        throw std::invalid_argument("direct I/O is not supported on this platform");
+#endif
+    }
+
+    mmap_allocator allocator;
+    spare.resize(file_config.get_queue_depth());
+    for (block &b : spare)
+    {
+        b.data = allocator.allocate(block_size, nullptr);
+        b.items.reserve(max_batch);
+    }
+    done.reserve(spare.size());
+    reaping.reserve(spare.size());
+
+    fd = open(filename.c_str(), flags, 0666);
+    if (fd == -1)
+        throw_errno("open failed");
+    thread = std::thread([this, file_config] { run(file_config.get_affinity()); });
+}
+
+file_writer::~file_writer()
+{
+    to_write.stop();
+    thread.join();
+    if (close(fd) != 0)
+        log_errno("close failed: %1% (%2%)");
+}
+
+bool file_writer::ensure_block()
+{
+    if (has_cur)
+        return true;
+    if (partial_in_flight || spare.empty())
+        return false;
+    cur = std::move(spare.back());
+    spare.pop_back();
+    cur.offset = next_offset;
+    cur.length = 0;
+    cur.written = 0;
+    next_offset += block_size;
+    has_cur = true;
+    return true;
+}
+
+void file_writer::submit()
+{
+    partial_in_flight = (cur.length < block_size);
+    has_cur = false;
+    in_flight++;
+    // Cannot block, because there are only queue_depth blocks
+    to_write.push(std::move(cur));
+}
+
+void file_writer::append(const transmit_packet &data, std::size_t &offset)
+{
+    std::uint8_t *dest = cur.data.get() + cur.length;
+    std::size_t space = block_size - cur.length;
+    std::size_t pos = 0;
+    std::size_t copied = 0;
+    for (const auto &buffer : data.buffers)
+    {
+        std::size_t size = boost::asio::buffer_size(buffer);
+        if (pos + size > offset)
+        {
+            std::size_t skip = offset > pos ? offset - pos : 0;
+            std::size_t n = std::min(size - skip, space - copied);
+            const std::uint8_t *src = boost::asio::buffer_cast<const std::uint8_t *>(buffer) + skip;
+            // The packet header may already have been generated in place
+            if (src != dest + copied)
+                std::memcpy(dest + copied, src, n);
+            copied += n;
+            if (copied == space)
+                break;
+        }
+        pos += size;
+    }
+    offset += copied;
+    cur.length += copied;
+    data.item->bytes_sent += copied;
+    if (cur.items.empty() || cur.items.back() != data.item)
+        cur.items.push_back(data.item);
+    if (offset == data.size && data.last)
+        cur.groups++;
+    if (cur.length == block_size)
+        submit();
+}
+
+bool file_writer::write_pending()
+{
+    while (pending_offset < pending.size)
+    {
+        if (!ensure_block())
+            return false;
+        append(pending, pending_offset);
+    }
+    has_pending = false;
+    return true;
+}
+
+void file_writer::reap()
+{
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        reaping.swap(done);
+    }
+    std::size_t groups = 0;
+    for (block &b : reaping)
+    {
+        if (b.result)
+        {
+            for (detail::queue_item *item : b.items)
+                if (!item->result)
+                    item->result = b.result;
+        }
+        groups += b.groups;
+        b.groups = 0;
+        b.items.clear();
+        b.result = boost::system::error_code();
+        in_flight--;
+        if (b.length < block_size)
+        {
+            // Resume filling the block
+            cur = std::move(b);
+            has_cur = true;
+            partial_in_flight = false;
+        }
+        else
+            spare.push_back(std::move(b));
+    }
+    reaping.clear();
+    if (groups > 0)
+        groups_completed(groups);
+}
+
+void file_writer::park()
+{
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        if (done.empty())
+        {
+            parked = true;
+            return;
+        }
+    }
+    // A block completed in the meantime
+    post_wakeup();
+}
+
+void file_writer::wakeup()
+{
+    reap();
+
+    packet_result result = packet_result::SUCCESS;
+    for (int i = 0; i < max_batch; i++)
+    {
+        if ((has_pending && !write_pending()) || !ensure_block())
+        {
+            park();
+            return;
+        }
+        if (block_size - cur.length >= max_packet_size)
+        {
+            // Generate the packet header directly in the block
+            transmit_packet data;
+            result = get_packet(data, cur.data.get() + cur.length);
+            if (result != packet_result::SUCCESS)
+                break;
+            std::size_t offset = 0;
+            append(data, offset);
+        }
+        else
+        {
+            result = get_packet(pending, scratch.get());
+            if (result != packet_result::SUCCESS)
+                break;
+            pending_offset = 0;
+            has_pending = true;
+        }
+    }
+
+    switch (result)
+    {
+    case packet_result::SLEEP:
+        sleep();
+        break;
+    case packet_result::EMPTY:
+        // Write out what we have, so that the heaps can complete
+        if (has_cur && cur.length > cur.written)
+            submit();
+        if (in_flight > 0)
+            park();
+        else
+            request_wakeup();
+        break;
+    case packet_result::SUCCESS:
+        post_wakeup();
+        break;
+    }
+}
+
+static boost::system::error_code write_all(int fd, struct iovec *iov, int iovcnt, off_t offset)
+{
+    while (iovcnt > 0)
+    {
+        ssize_t ret = pwritev(fd, iov, iovcnt, offset);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return boost::system::error_code(errno, boost::asio::error::get_system_category());
+        }
+        offset += ret;
+        while (iovcnt > 0 && std::size_t(ret) >= iov->iov_len)
+        {
+            ret -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = static_cast<std::uint8_t *>(iov->iov_base) + ret;
+            iov->iov_len -= ret;
+        }
+    }
+    return boost::system::error_code();
+}
+
+boost::system::error_code file_writer::write_blocks(
+    std::vector<block>::iterator first, std::vector<block>::iterator last)
+{
+    struct iovec iov[max_batch];
+    int n = 0;
+    std::uint64_t start = 0;
+    for (auto it = first; it != last; ++it, ++n)
+    {
+        std::size_t lo = it->written / alignment * alignment;
+        std::size_t hi = (it->length + alignment - 1) / alignment * alignment;
+        if (n == 0)
+            start = it->offset + lo;
+        iov[n].iov_base = it->data.get() + lo;
+        iov[n].iov_len = hi - lo;
+    }
+    auto ec = write_all(fd, iov, n, start);
+    const block &tail = *(last - 1);
+    if (!ec && tail.length % alignment != 0)
+    {
+        // Remove the padding written for O_DIRECT
+        if (ftruncate(fd, tail.offset + tail.length) != 0)
+            ec = boost::system::error_code(errno, boost::asio::error::get_system_category());
+    }
+    return ec;
+}
+
+void file_writer::run(int affinity)
+{
+    if (affinity >= 0)
+        thread_pool::set_affinity(affinity);
+    std::vector<block> batch;
+    try
+    {
+        while (true)
+        {
+            batch.push_back(to_write.pop());
+            while (batch.size() < std::size_t(max_batch) && to_write.size() > 0)
+                batch.push_back(to_write.pop());
+
+            // Write runs of blocks that are contiguous in the file
+            auto first = batch.begin();
+            while (first != batch.end())
+            {
+                auto last = first + 1;
+                while (last != batch.end()
+                       && last->offset + last->written / alignment * alignment
+                           == (last - 1)->offset + (last - 1)->length
+                       && (last - 1)->length == block_size)
+                    ++last;
+                auto ec = write_blocks(first, last);
+                for (auto it = first; it != last; ++it)
+                {
+                    it->result = ec;
+                    it->written = it->length;
+                }
+                first = last;
+            }
+
+            bool wake;
+            {
+                std::lock_guard<std::mutex> lock(done_mutex);
+                for (block &b : batch)
+                    done.push_back(std::move(b));
+                wake = parked;
+                parked = false;
+            }
+            batch.clear();
+            if (wake)
+                post_wakeup();
+        }
+    }
+    catch (ringbuffer_stopped &)
+    {
+    }
+}
+
+} // anonymous namespace
+
+file_stream::file_stream(
+    io_service_ref io_service,
+    const std::string &filename,
+    const stream_config &config,
+    const file_stream_config &file_config)
+    : stream(std::unique_ptr<writer>(new file_writer(
+        std::move(io_service), filename, config, file_config)))
+{
+}
+
+} // namespace send
+} // namespace spead2
@@ -0,0 +1,144 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <climits>
+#include <stdexcept>
+#include <boost/asio/buffer.hpp>
+#include <spead2/send_heap.h>
+#include <spead2/send_heap_template.h>
+#include <spead2/send_packet.h>
+
+namespace spead2
+{
+namespace send
+{
+
+heap_template::heap_template(
+    const heap &h, std::size_t max_packet_size,
+    const std::vector<heap::item_handle> &variable)
+    : flavour_(h.get_flavour()),
+    repeat_pointers(h.get_repeat_pointers()),
+    max_packet_size(max_packet_size & ~std::size_t(7))
+{
+    const std::size_t max_immediate_size = flavour_.get_heap_address_bits() / CHAR_BIT;
+    auto is_addressed = [max_immediate_size](const item &it)
+    {
+        return !it.is_inline
+            && !(it.allow_immediate && it.data.buffer.length <= max_immediate_size);
+    };
+
+    std::vector<bool> is_variable(h.items.size());
+    for (heap::item_handle handle : variable)
+    {
+        if (handle >= h.items.size())
+            throw std::invalid_argument("item handle is out of range");
+        if (is_addressed(h.items[handle]))
+            throw std::invalid_argument("variable items must be sent as immediates");
+        is_variable[handle] = true;
+    }
+
+    items.reserve(h.items.size());
+    for (const item &it : h.items)
+        items.push_back(item_layout{
+            it.id, it.is_inline, it.allow_immediate, it.is_inline ? 0 : it.data.buffer.length});
+
+    /* Run a generator over the prototype, and record the header of each packet
+     * along with where its payload comes from.
+     */
+    packet_generator gen(h, 0, max_packet_size, nullptr);
+    payload_size = gen.payload_size;
+    std::unique_ptr<std::uint8_t[]> scratch(new std::uint8_t[gen.get_max_packet_size()]);
+    while (gen.has_next_packet())
+    {
+        std::size_t first_pointer = repeat_pointers ? 0 : gen.next_item_pointer;
+        std::size_t next_item = gen.next_item;
+        std::size_t next_item_offset = gen.next_item_offset;
+        s_item_pointer_t payload_offset = gen.payload_offset;
+        std::vector<boost::asio::const_buffer> buffers = gen.next_packet(scratch.get());
+
+        packet pkt;
+        pkt.header_offset = headers.size();
+        pkt.header_size = boost::asio::buffer_size(buffers[0]);
+        pkt.payload_length = gen.payload_offset - payload_offset;
+        headers.insert(headers.end(), scratch.get(), scratch.get() + pkt.header_size);
+
+        pkt.first_patch = patches.size();
+        for (std::size_t i = first_pointer; i < gen.next_item_pointer; i++)
+        {
+            // The last pointer may be the NULL item marking padding
+            if (i < items.size() && is_variable[i])
+            {
+                std::size_t offset = packet_generator::prefix_size + (i - first_pointer) * sizeof(item_pointer_t);
+                patches.push_back(patch{offset, i});
+            }
+        }
+        pkt.n_patches = patches.size() - pkt.first_patch;
+
+        // Follow the generator's walk over the items to identify each payload buffer
+        pkt.first_segment = segments.size();
+        for (std::size_t i = 1; i < buffers.size(); i++)
+        {
+            while (!is_addressed(h.items[next_item]))
+            {
+                next_item++;
+                next_item_offset = 0;
+            }
+            std::size_t length = boost::asio::buffer_size(buffers[i]);
+            segments.push_back(segment{next_item, next_item_offset, length});
+            next_item_offset += length;
+            if (next_item_offset == items[next_item].length)
+            {
+                next_item++;
+                next_item_offset = 0;
+            }
+        }
+        pkt.n_segments = segments.size() - pkt.first_segment;
+        packets.push_back(pkt);
+    }
+}
+
+bool heap_template::matches(const heap &h, std::size_t max_packet_size) const
+{
+    // Rounded down in the same way as packet_generator
+    if ((max_packet_size & ~std::size_t(7)) != this->max_packet_size)
+        return false;
+    if (!(h.get_flavour() == flavour_) || h.get_repeat_pointers() != repeat_pointers)
+        return false;
+    if (h.items.size() != items.size())
+        return false;
+    for (std::size_t i = 0; i < items.size(); i++)
+    {
+        const item &it = h.items[i];
+        const item_layout &layout = items[i];
+        if (it.id != layout.id
+            || it.is_inline != layout.is_inline
+            || (!it.is_inline
+                && (it.allow_immediate != layout.allow_immediate
+                    || it.data.buffer.length != layout.length)))
+            return false;
+    }
+    return true;
+}
+
+} // namespace send
+} // namespace spead2
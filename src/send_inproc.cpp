@@ -17,6 +17,8 @@
 #include <cstddef>
 #include <utility>
 #include <memory>
+#include <vector>
+#include <algorithm>
 #include <boost/asio.hpp>
 #include <spead2/common_thread_pool.h>
 #include <spead2/common_inproc.h>
@@ -32,23 +34,32 @@ namespace send
 namespace
 {
 
-static inproc_queue::packet copy_packet(const std::vector<boost::asio::const_buffer> &in)
-{
-    std::size_t size = boost::asio::buffer_size(in);
-    inproc_queue::packet out;
-    out.data.reset(new std::uint8_t[size]);
-    out.size = size;
-    boost::asio::mutable_buffer buffer(out.data.get(), size);
-    boost::asio::buffer_copy(buffer, in);
-    return out;
-}
-
 class inproc_writer : public writer
 {
 private:
+    static constexpr int max_batch = 64;
+
     std::vector<std::shared_ptr<inproc_queue>> queues;
+    /// Packet storage taken from each queue's free list, for reuse
+    std::vector<std::vector<inproc_queue::packet>> spare;
+    /// Packets waiting to be added to each queue
+    std::vector<std::vector<inproc_queue::packet>> batches;
+    /// Whether each queue was found to be stopped when adding the batch
+    std::vector<bool> stopped;
+    /// Per-packet information needed to report completion
+    struct
+    {
+        detail::queue_item *item;
+        std::size_t size;
+        std::size_t substream_index;
+        bool last;
+    } packets[max_batch];
+    std::size_t max_packet_size;
     std::unique_ptr<std::uint8_t[]> scratch;   ///< Scratch space for constructing packets
 
+    /// Copy a packet into packet storage owned by the target queue
+    void copy_packet(const transmit_packet &data);
+
     virtual void wakeup() override;
 
 public:
@@ -64,35 +75,85 @@ public:
     virtual std::size_t get_num_substreams() const override final { return queues.size(); }
 };
 
+constexpr int inproc_writer::max_batch;
+
+void inproc_writer::copy_packet(const transmit_packet &data)
+{
+    std::size_t size = data.size;
+    auto &free = spare[data.substream_index];
+    if (free.empty())
+        queues[data.substream_index]->reuse_packets(free, max_batch);
+    inproc_queue::packet out;
+    if (!free.empty())
+    {
+        out = std::move(free.back());
+        free.pop_back();
+    }
+    if (out.capacity < size)
+    {
+        // Allocate the full packet size so that the storage can be reused
+        std::size_t capacity = std::max(max_packet_size, size);
+        out.data.reset(new std::uint8_t[capacity]);
+        out.capacity = capacity;
+    }
+    out.size = size;
+    boost::asio::mutable_buffer buffer(out.data.get(), size);
+    boost::asio::buffer_copy(buffer, data.buffers);
+    batches[data.substream_index].push_back(std::move(out));
+}
+
 void inproc_writer::wakeup()
 {
-    transmit_packet data;
-    switch (get_packet(data, scratch.get()))
+    int n;
+    for (n = 0; n < max_batch; n++)
     {
-    case packet_result::SLEEP:
-        sleep();
-        return;
-    case packet_result::EMPTY:
-        request_wakeup();
-        return;
-    case packet_result::SUCCESS:
-        break;
+        transmit_packet data;
+        packet_result result = get_packet(data, scratch.get());
+        if (result != packet_result::SUCCESS)
+        {
+            if (n > 0)
+                break;   // deal with it on the next wakeup
+            else if (result == packet_result::SLEEP)
+                sleep();
+            else
+                request_wakeup();
+            return;
+        }
+        copy_packet(data);
+        packets[n].item = data.item;
+        packets[n].size = data.size;
+        packets[n].substream_index = data.substream_index;
+        packets[n].last = data.last;
     }
 
-    inproc_queue::packet dup = copy_packet(data.buffers);
-    std::size_t size = dup.size;
-    auto *item = data.item;
-    try
+    // Hand each queue its batch with a single push
+    for (std::size_t i = 0; i < queues.size(); i++)
     {
-        queues[data.substream_index]->add_packet(std::move(dup));
-        item->bytes_sent += size;
+        try
+        {
+            queues[i]->add_packets(batches[i]);
+            stopped[i] = false;
+        }
+        catch (ringbuffer_stopped &)
+        {
+            stopped[i] = true;
+            batches[i].clear();
+        }
     }
-    catch (ringbuffer_stopped &)
+
+    std::size_t groups = 0;
+    for (int i = 0; i < n; i++)
     {
-        item->result = boost::asio::error::operation_aborted;
+        auto *item = packets[i].item;
+        if (stopped[packets[i].substream_index])
+            item->result = boost::asio::error::operation_aborted;
+        else
+            item->bytes_sent += packets[i].size;
+        if (packets[i].last)
+            groups++;
     }
-    if (data.last)
-        groups_completed(1);
+    if (groups > 0)
+        groups_completed(groups);
     post_wakeup();
 }
 
@@ -107,6 +168,10 @@ inproc_writer::inproc_writer(
     const stream_config &config)
     : writer(std::move(io_service), config),
     queues(queues),
+    spare(queues.size()),
+    batches(queues.size()),
+    stopped(queues.size()),
+    max_packet_size(config.get_max_packet_size()),
     scratch(new std::uint8_t[config.get_max_packet_size()])
 {
     if (queues.empty())
@@ -25,6 +25,7 @@
 #include <stdexcept>
 #include <algorithm>
 #include <spead2/send_heap.h>
+#include <spead2/send_heap_template.h>
 #include <spead2/send_utils.h>
 #include <spead2/send_packet.h>
 #include <spead2/common_defines.h>
@@ -44,14 +45,42 @@ static bool use_immediate(const item &it, std::size_t max_immediate_size)
         || (it.allow_immediate && it.data.buffer.length <= max_immediate_size);
 }
 
+// Encode the item pointer (in big endian) for an item that is sent as an immediate
+static item_pointer_t encode_immediate_item(
+    const pointer_encoder &encoder, const item &it, std::size_t max_immediate_size)
+{
+    item_pointer_t ip;
+    if (it.is_inline)
+    {
+        ip = htobe<item_pointer_t>(encoder.encode_immediate(it.id, it.data.immediate));
+    }
+    else
+    {
+        assert(it.allow_immediate && it.data.buffer.length <= max_immediate_size);
+        (void) max_immediate_size;  // only used by the assertion
+        ip = htobe<item_pointer_t>(encoder.encode_immediate(it.id, 0));
+        std::memcpy(reinterpret_cast<char *>(&ip) + sizeof(item_pointer_t) - it.data.buffer.length,
+                    it.data.buffer.ptr, it.data.buffer.length);
+    }
+    return ip;
+}
+
 packet_generator::packet_generator(
     const heap &h, item_pointer_t cnt, std::size_t max_packet_size)
+    : packet_generator(h, cnt, max_packet_size, h.get_template().get())
+{
+}
+
+packet_generator::packet_generator(
+    const heap &h, item_pointer_t cnt, std::size_t max_packet_size,
+    const heap_template *tmpl)
     : h(h), cnt(cnt),
     // Round down max packet size so that we can align payload
     max_packet_size(max_packet_size &= ~7),
     max_item_pointers_per_packet(
         (max_packet_size - (prefix_size + sizeof(item_pointer_t))) / sizeof(item_pointer_t)
-    )
+    ),
+    tmpl(tmpl)
 {
     /* We need
      * - the prefix
@@ -62,6 +91,17 @@ packet_generator::packet_generator(
     if (max_packet_size < prefix_size + 2 * sizeof(item_pointer_t))
         throw std::invalid_argument("packet size is too small");
 
+    if (tmpl)
+    {
+        // The layout was validated and measured when the template was built
+        if (!tmpl->matches(h, max_packet_size))
+            throw std::invalid_argument("heap does not match its template");
+        payload_size = tmpl->payload_size;
+        pointer_encoder encoder(h.get_flavour().get_heap_address_bits());
+        cnt_pointer = htobe<item_pointer_t>(encoder.encode_immediate(HEAP_CNT_ID, cnt));
+        return;
+    }
+
     payload_size = 0;
     const std::size_t max_immediate_size = h.get_flavour().get_heap_address_bits() / CHAR_BIT;
     for (const item &it : h.items)
@@ -104,8 +144,44 @@ bool packet_generator::has_next_packet() const
     return payload_offset < payload_size;
 }
 
+std::vector<boost::asio::const_buffer> packet_generator::next_packet_template(std::uint8_t *scratch)
+{
+    std::vector<boost::asio::const_buffer> out;
+    if (payload_offset < payload_size)
+    {
+        const heap_template::packet &pkt = tmpl->packets[next_packet_index++];
+        std::memcpy(scratch, tmpl->headers.data() + pkt.header_offset, pkt.header_size);
+        // The heap counter is always the first item pointer
+        std::memcpy(scratch + 8, &cnt_pointer, sizeof(cnt_pointer));
+        if (pkt.n_patches > 0)
+        {
+            pointer_encoder encoder(h.get_flavour().get_heap_address_bits());
+            const std::size_t max_immediate_size = h.get_flavour().get_heap_address_bits() / CHAR_BIT;
+            for (std::size_t i = 0; i < pkt.n_patches; i++)
+            {
+                const heap_template::patch &p = tmpl->patches[pkt.first_patch + i];
+                item_pointer_t ip = encode_immediate_item(encoder, h.items[p.item], max_immediate_size);
+                std::memcpy(scratch + p.offset, &ip, sizeof(ip));
+            }
+        }
+        payload_offset += pkt.payload_length;
+
+        out.reserve(pkt.n_segments + 1);
+        out.emplace_back(scratch, pkt.header_size);
+        for (std::size_t i = 0; i < pkt.n_segments; i++)
+        {
+            const heap_template::segment &s = tmpl->segments[pkt.first_segment + i];
+            out.emplace_back(h.items[s.item].data.buffer.ptr + s.offset, s.length);
+        }
+    }
+    return out;
+}
+
 std::vector<boost::asio::const_buffer> packet_generator::next_packet(std::uint8_t *scratch)
 {
+    if (tmpl)
+        return next_packet_template(scratch);
+
     std::vector<boost::asio::const_buffer> out;
 
     if (h.get_repeat_pointers())
@@ -153,15 +229,9 @@ std::vector<boost::asio::const_buffer> packet_generator::next_packet(std::uint8_
             else
             {
                 const item &it = h.items[next_item_pointer];
-                if (it.is_inline)
-                {
-                    ip = htobe<item_pointer_t>(encoder.encode_immediate(it.id, it.data.immediate));
-                }
-                else if (it.allow_immediate && it.data.buffer.length <= max_immediate_size)
+                if (use_immediate(it, max_immediate_size))
                 {
-                    ip = htobe<item_pointer_t>(encoder.encode_immediate(it.id, 0));
-                    std::memcpy(reinterpret_cast<char *>(&ip) + sizeof(item_pointer_t) - it.data.buffer.length,
-                                it.data.buffer.ptr, it.data.buffer.length);
+                    ip = encode_immediate_item(encoder, it, max_immediate_size);
                 }
                 else
                 {
@@ -0,0 +1,196 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_SHM
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <boost/asio.hpp>
+#include <spead2/common_logging.h>
+#include <spead2/common_shm.h>
+#include <spead2/send_shm.h>
+#include <spead2/send_writer.h>
+
+namespace spead2
+{
+namespace send
+{
+
+namespace
+{
+
+class shm_writer : public writer
+{
+private:
+    static constexpr int max_batch = 64;
+
+    std::vector<std::shared_ptr<shm_queue>> queues;
+    /// Known number of free slots in each queue
+    std::vector<std::size_t> free;
+    /// Number of slots filled in each queue but not yet committed
+    std::vector<std::size_t> used;
+    /// Whether the receiver of each queue has exited without closing it
+    std::vector<bool> consumer_gone;
+    boost::asio::steady_timer retry_timer;
+
+    /**
+     * A packet that has been generated but not yet copied to its queue,
+     * because the queue was full.
+     */
+    transmit_packet pending;
+    bool have_pending = false;
+    std::unique_ptr<std::uint8_t[]> scratch;   ///< Scratch space for constructing packets
+
+    virtual void wakeup() override;
+
+public:
+    shm_writer(
+        io_service_ref io_service,
+        const std::vector<std::shared_ptr<shm_queue>> &queues,
+        const stream_config &config);
+
+    const std::vector<std::shared_ptr<shm_queue>> &get_queues() const { return queues; }
+
+    virtual std::size_t get_num_substreams() const override final { return queues.size(); }
+};
+
+constexpr int shm_writer::max_batch;
+
+void shm_writer::wakeup()
+{
+    std::size_t groups = 0;
+    bool progress = false;
+    bool full = false;
+    for (int i = 0; i < max_batch; i++)
+    {
+        if (!have_pending)
+        {
+            packet_result result = get_packet(pending, scratch.get());
+            if (result != packet_result::SUCCESS)
+            {
+                if (progress)
+                    break;   // deal with it on the next wakeup
+                else if (result == packet_result::SLEEP)
+                    sleep();
+                else
+                    request_wakeup();
+                return;
+            }
+            have_pending = true;
+        }
+
+        std::size_t idx = pending.substream_index;
+        shm_queue &queue = *queues[idx];
+        auto *item = pending.item;
+        bool closed = queue.is_closed() || queue.is_stopped();
+        if (!closed && !consumer_gone[idx] && free[idx] == 0)
+        {
+            free[idx] = queue.free_slots() - used[idx];
+            if (free[idx] == 0)
+            {
+                // Without this check, a receiver that died would block us forever
+                if (!queue.consumer_exited())
+                {
+                    full = true;
+                    break;
+                }
+                log_warning("shm_stream: receiver exited without closing the queue");
+                consumer_gone[idx] = true;
+            }
+        }
+        if (closed)
+            item->result = boost::asio::error::operation_aborted;
+        else if (consumer_gone[idx])
+            item->result = boost::asio::error::broken_pipe;
+        else
+        {
+            std::uint8_t *slot = queue.get_free_slot(used[idx], pending.size);
+            boost::asio::buffer_copy(boost::asio::buffer(slot, pending.size), pending.buffers);
+            used[idx]++;
+            free[idx]--;
+            item->bytes_sent += pending.size;
+        }
+        have_pending = false;
+        progress = true;
+        if (pending.last)
+            groups++;
+    }
+
+    for (std::size_t i = 0; i < queues.size(); i++)
+        if (used[i] > 0)
+        {
+            queues[i]->commit(used[i]);
+            used[i] = 0;
+        }
+    if (groups > 0)
+        groups_completed(groups);
+    if (full)
+    {
+        retry_timer.expires_from_now(shm_stream::retry_interval);
+        retry_timer.async_wait([this](const boost::system::error_code &) { wakeup(); });
+    }
+    else
+        post_wakeup();
+}
+
+shm_writer::shm_writer(
+    io_service_ref io_service,
+    const std::vector<std::shared_ptr<shm_queue>> &queues,
+    const stream_config &config)
+    : writer(std::move(io_service), config),
+    queues(queues),
+    free(queues.size()),
+    used(queues.size()),
+    consumer_gone(queues.size()),
+    retry_timer(get_io_service()),
+    scratch(new std::uint8_t[config.get_max_packet_size()])
+{
+    if (queues.empty())
+        throw std::invalid_argument("queues is empty");
+    for (const auto &queue : queues)
+        if (queue->get_slot_size() < config.get_max_packet_size())
+            throw std::invalid_argument("max_packet_size is larger than the queue slot size");
+}
+
+} // anonymous namespace
+
+constexpr std::chrono::microseconds shm_stream::retry_interval;
+
+shm_stream::shm_stream(
+    io_service_ref io_service,
+    const std::vector<std::shared_ptr<shm_queue>> &queues,
+    const stream_config &config)
+    : stream(std::unique_ptr<writer>(new shm_writer(std::move(io_service), queues, config)))
+{
+}
+
+const std::vector<std::shared_ptr<shm_queue>> &shm_stream::get_queues() const
+{
+    return static_cast<const shm_writer &>(get_writer()).get_queues();
+}
+
+} // namespace send
+} // namespace spead2
+
+#endif // SPEAD2_USE_SHM
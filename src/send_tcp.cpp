@@ -19,8 +19,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 #include <spead2/common_socket.h>
 #include <spead2/send_tcp.h>
 #include <spead2/send_writer.h>
@@ -60,8 +62,22 @@ private:
     boost::asio::ip::tcp::endpoint endpoint;
     /// Callback once connected (if not pre-connected)
     std::function<void(const boost::system::error_code &)> connect_handler;
-    // Scratch space for constructing packets
-    std::unique_ptr<std::uint8_t[]> scratch;
+
+    /// Maximum number of packets gathered into a single write
+    static constexpr int max_batch = 64;
+    /// Packets in the current write, each with scratch space for its header
+    struct
+    {
+        transmit_packet packet;
+        std::unique_ptr<std::uint8_t[]> scratch;
+    } packets[max_batch];
+    /// Number of valid entries in @ref packets
+    int n_packets = 0;
+    /// Concatenation of the buffers of all packets in the current write
+    std::vector<boost::asio::const_buffer> buffers;
+
+    /// Update heap state once the current write completes
+    void packets_written(const boost::system::error_code &ec, std::size_t bytes_transferred);
 
     virtual void wakeup() override final;
     virtual void start() override final;
@@ -105,10 +121,32 @@ public:
     virtual std::size_t get_num_substreams() const override final { return 1; }
 };
 
+constexpr int tcp_writer::max_batch;
+
+void tcp_writer::packets_written(const boost::system::error_code &ec, std::size_t bytes_transferred)
+{
+    // On error, the bytes that did make it out were written in order, so
+    // attribute them to the packets from the front.
+    std::size_t groups = 0;
+    for (int i = 0; i < n_packets; i++)
+    {
+        const transmit_packet &data = packets[i].packet;
+        auto *item = data.item;
+        std::size_t bytes = std::min(bytes_transferred, data.size);
+        item->bytes_sent += bytes;
+        bytes_transferred -= bytes;
+        if (bytes < data.size && !item->result)
+            item->result = ec;
+        groups += data.last;
+    }
+    n_packets = 0;
+    if (groups > 0)
+        groups_completed(groups);
+}
+
 void tcp_writer::wakeup()
 {
-    transmit_packet data;
-    packet_result result = get_packet(data, scratch.get());
+    packet_result result = get_packet(packets[0].packet, packets[0].scratch.get());
     switch (result)
     {
     case packet_result::SLEEP:
@@ -121,18 +159,26 @@ void tcp_writer::wakeup()
         break;
     }
 
-    auto *item = data.item;
-    bool last = data.last;
-    auto handler = [this, item, last](const boost::system::error_code &ec, std::size_t bytes_transferred)
+    // We have at least one packet to send. See if we can get some more.
+    int n;
+    for (n = 1; n < max_batch; n++)
     {
-        item->bytes_sent += bytes_transferred;
-        if (!item->result)
-            item->result = ec;
-        if (last)
-            groups_completed(1);
+        result = get_packet(packets[n].packet, packets[n].scratch.get());
+        if (result != packet_result::SUCCESS)
+            break;
+    }
+    n_packets = n;
+
+    buffers.clear();
+    for (int i = 0; i < n; i++)
+        buffers.insert(buffers.end(),
+                       packets[i].packet.buffers.begin(), packets[i].packet.buffers.end());
+    auto handler = [this](const boost::system::error_code &ec, std::size_t bytes_transferred)
+    {
+        packets_written(ec, bytes_transferred);
         wakeup();
     };
-    boost::asio::async_write(socket, data.buffers, std::move(handler));
+    boost::asio::async_write(socket, buffers, std::move(handler));
 }
 
 void tcp_writer::start()
@@ -161,9 +207,10 @@ tcp_writer::tcp_writer(
     socket(make_socket(get_io_service(), endpoints, buffer_size, interface_address)),
     pre_connected(false),
     endpoint(endpoints[0]),
-    connect_handler(std::move(connect_handler)),
-    scratch(new std::uint8_t[config.get_max_packet_size()])
+    connect_handler(std::move(connect_handler))
 {
+    for (int i = 0; i < max_batch; i++)
+        packets[i].scratch.reset(new std::uint8_t[config.get_max_packet_size()]);
 }
 
 tcp_writer::tcp_writer(
@@ -172,9 +219,10 @@ tcp_writer::tcp_writer(
     const stream_config &config)
     : writer(std::move(io_service), config),
     socket(std::move(socket)),
-    pre_connected(true),
-    scratch(new std::uint8_t[config.get_max_packet_size()])
+    pre_connected(true)
 {
+    for (int i = 0; i < max_batch; i++)
+        packets[i].scratch.reset(new std::uint8_t[config.get_max_packet_size()]);
     if (!socket_uses_io_service(this->socket, get_io_service()))
         throw std::invalid_argument("I/O service does not match the socket's I/O service");
 }
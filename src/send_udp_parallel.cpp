@@ -0,0 +1,363 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <stdexcept>
+#include <boost/asio.hpp>
+#include <spead2/common_defines.h>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/common_socket.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/send_udp_parallel.h>
+#include <spead2/send_writer.h>
+
+namespace spead2
+{
+namespace send
+{
+
+namespace
+{
+
+class udp_parallel_writer : public writer
+{
+private:
+    static constexpr int max_batch = 64;
+
+    /// Range of queue indices forming a group
+    struct group
+    {
+        std::size_t start, end;
+        std::size_t seq;      ///< Sequence number in @ref in_flight
+    };
+
+    /// A transmit thread with its own socket and scratch space
+    class worker
+    {
+    private:
+        udp_parallel_writer &owner;
+        boost::asio::ip::udp::socket socket;
+#if SPEAD2_USE_SENDMMSG
+        struct mmsghdr msgvec[max_batch];
+        std::vector<struct iovec> msg_iov;
+#endif
+        struct
+        {
+            transmit_packet packet;
+            std::unique_ptr<std::uint8_t[]> scratch;
+        } packets[max_batch];
+        std::thread thread;
+
+        /// Send the first @a n entries of @ref packets, blocking as necessary
+        void send_packets(int n);
+        /// Generate and send all the packets of a group
+        void transmit(const group &g);
+        void run(int cpu);
+
+    public:
+        worker(udp_parallel_writer &owner, boost::asio::ip::udp::socket &&socket,
+               std::size_t max_packet_size, int cpu);
+        void join() { thread.join(); }
+    };
+
+    std::vector<boost::asio::ip::udp::endpoint> endpoints;
+    /**
+     * Serialises @ref wakeup with the completions posted by the workers,
+     * since the io_service may be run by several threads.
+     */
+    boost::asio::io_service::strand strand;
+    /// Groups claimed from the queue but not yet taken by a worker
+    ringbuffer<group> work;
+    /**
+     * Flags indicating whether each group handed to the workers has been
+     * transmitted, in queue order. The front has sequence number
+     * @ref in_flight_seq. Only accessed from @ref strand.
+     */
+    std::deque<bool> in_flight;
+    std::size_t in_flight_seq = 0;
+    std::vector<std::unique_ptr<worker>> workers;
+
+    /// Called on @ref strand when a worker has finished the group with sequence number @a seq
+    void group_done(std::size_t seq);
+    /// Implementation of @ref wakeup, run on @ref strand
+    void process();
+
+    virtual void wakeup() override final;
+
+public:
+    udp_parallel_writer(
+        io_service_ref io_service,
+        const std::vector<boost::asio::ip::udp::endpoint> &endpoints,
+        const stream_config &config,
+        std::size_t threads,
+        const std::vector<int> &affinity,
+        std::size_t buffer_size,
+        const boost::asio::ip::address &interface_address);
+    ~udp_parallel_writer();
+
+    virtual std::size_t get_num_substreams() const override final { return endpoints.size(); }
+};
+
+constexpr int udp_parallel_writer::max_batch;
+
+udp_parallel_writer::worker::worker(
+    udp_parallel_writer &owner, boost::asio::ip::udp::socket &&socket,
+    std::size_t max_packet_size, int cpu)
+    : owner(owner), socket(std::move(socket))
+{
+#if SPEAD2_USE_SENDMMSG
+    std::memset(&msgvec, 0, sizeof(msgvec));
+#endif
+    for (int i = 0; i < max_batch; i++)
+        packets[i].scratch.reset(new std::uint8_t[max_packet_size]);
+    thread = std::thread([this, cpu] { run(cpu); });
+}
+
+#if SPEAD2_USE_SENDMMSG
+
+void udp_parallel_writer::worker::send_packets(int n)
+{
+    std::size_t n_iov = 0;
+    for (int i = 0; i < n; i++)
+        n_iov += packets[i].packet.buffers.size();
+    msg_iov.resize(n_iov);
+    std::size_t offset = 0;
+    for (int i = 0; i < n; i++)
+    {
+        auto &hdr = msgvec[i].msg_hdr;
+        hdr.msg_iov = &msg_iov[offset];
+        hdr.msg_iovlen = packets[i].packet.buffers.size();
+        for (const auto &buffer : packets[i].packet.buffers)
+        {
+            msg_iov[offset].iov_base = const_cast<void *>(
+                boost::asio::buffer_cast<const void *>(buffer));
+            msg_iov[offset].iov_len = boost::asio::buffer_size(buffer);
+            offset++;
+        }
+        const auto &endpoint = owner.endpoints[packets[i].packet.substream_index];
+        hdr.msg_name = (void *) endpoint.data();
+        hdr.msg_namelen = endpoint.size();
+    }
+
+    int first = 0;
+    while (first < n)
+    {
+        // The socket is blocking, so this only returns early on error
+        int sent = sendmmsg(socket.native_handle(), msgvec + first, n - first, 0);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            auto *item = packets[first].packet.item;
+            if (!item->result)
+                item->result = boost::system::error_code(errno, boost::asio::error::get_system_category());
+            first++;
+        }
+        else
+        {
+            for (int i = 0; i < sent; i++)
+            {
+                packets[first].packet.item->bytes_sent += packets[first].packet.size;
+                first++;
+            }
+        }
+    }
+}
+
+#else // SPEAD2_USE_SENDMMSG
+
+void udp_parallel_writer::worker::send_packets(int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        const transmit_packet &data = packets[i].packet;
+        boost::system::error_code ec;
+        std::size_t bytes = socket.send_to(
+            data.buffers, owner.endpoints[data.substream_index], 0, ec);
+        data.item->bytes_sent += bytes;
+        if (!data.item->result)
+            data.item->result = ec;
+    }
+}
+
+#endif // !SPEAD2_USE_SENDMMSG
+
+void udp_parallel_writer::worker::transmit(const group &g)
+{
+    std::size_t active = g.start, active_start = g.start;
+    int n = 0;
+    bool last = false;
+    while (!last)
+    {
+        owner.next_group_packet(active, active_start, packets[n].packet, packets[n].scratch.get());
+        last = packets[n].packet.last;
+        n++;
+        if (n == max_batch || last)
+        {
+            send_packets(n);
+            n = 0;
+        }
+    }
+    udp_parallel_writer *w = &owner;
+    std::size_t seq = g.seq;
+    owner.strand.post([w, seq] { w->group_done(seq); });
+}
+
+void udp_parallel_writer::worker::run(int cpu)
+{
+    if (cpu >= 0)
+        thread_pool::set_affinity(cpu);
+    try
+    {
+        while (true)
+            transmit(owner.work.pop());
+    }
+    catch (ringbuffer_stopped &)
+    {
+    }
+}
+
+void udp_parallel_writer::group_done(std::size_t seq)
+{
+    in_flight[seq - in_flight_seq] = true;
+    std::size_t n = 0;
+    while (!in_flight.empty() && in_flight.front())
+    {
+        in_flight.pop_front();
+        in_flight_seq++;
+        n++;
+    }
+    if (n > 0)
+        groups_completed(n);
+    process();
+}
+
+void udp_parallel_writer::wakeup()
+{
+    strand.dispatch([this] { process(); });
+}
+
+void udp_parallel_writer::process()
+{
+    group g;
+    while (get_group(g.start, g.end))
+    {
+        g.seq = in_flight_seq + in_flight.size();
+        in_flight.push_back(false);
+        // Cannot fail, because the ringbuffer can hold every heap in the queue
+        work.try_push(std::move(g));
+    }
+    /* While groups are in flight, their completions will call wakeup again.
+     * Only once they have all completed is it safe to declare that we are
+     * idle, since at that point the stream may destroy the writer.
+     */
+    if (in_flight.empty())
+        request_wakeup();
+}
+
+static boost::asio::ip::udp::socket make_socket(
+    boost::asio::io_service &io_service,
+    const boost::asio::ip::udp &protocol,
+    std::size_t buffer_size,
+    const boost::asio::ip::address &interface_address)
+{
+    boost::asio::ip::udp::socket socket(io_service, protocol);
+    if (!interface_address.is_unspecified())
+        socket.bind(boost::asio::ip::udp::endpoint(interface_address, 0));
+    set_socket_send_buffer_size(socket, buffer_size);
+    return socket;
+}
+
+udp_parallel_writer::udp_parallel_writer(
+    io_service_ref io_service,
+    const std::vector<boost::asio::ip::udp::endpoint> &endpoints,
+    const stream_config &config,
+    std::size_t threads,
+    const std::vector<int> &affinity,
+    std::size_t buffer_size,
+    const boost::asio::ip::address &interface_address)
+    : writer(std::move(io_service), config),
+    endpoints(endpoints),
+    strand(get_io_service()),
+    work(config.get_max_heaps())
+{
+    if (threads == 0)
+        throw std::invalid_argument("threads must be positive");
+    if (config.get_rate() != 0.0)
+        throw std::invalid_argument("udp_parallel_stream does not support rate limiting");
+    if (endpoints.empty())
+        throw std::invalid_argument("Endpoint list must be non-empty");
+    auto protocol = endpoints[0].protocol();
+    for (const auto &endpoint : endpoints)
+        if (endpoint.protocol() != protocol)
+            throw std::invalid_argument("Endpoints must all use the same protocol");
+
+    try
+    {
+        for (std::size_t i = 0; i < threads; i++)
+        {
+            int cpu = affinity.empty() ? -1 : affinity[i % affinity.size()];
+            workers.emplace_back(new worker(
+                *this,
+                make_socket(get_io_service(), protocol, buffer_size, interface_address),
+                config.get_max_packet_size(), cpu));
+        }
+    }
+    catch (...)
+    {
+        work.stop();
+        for (const auto &w : workers)
+            w->join();
+        throw;
+    }
+}
+
+udp_parallel_writer::~udp_parallel_writer()
+{
+    work.stop();
+    for (const auto &w : workers)
+        w->join();
+}
+
+} // anonymous namespace
+
+udp_parallel_stream::udp_parallel_stream(
+    io_service_ref io_service,
+    const std::vector<boost::asio::ip::udp::endpoint> &endpoints,
+    const stream_config &config,
+    std::size_t threads,
+    const std::vector<int> &affinity,
+    std::size_t buffer_size,
+    const boost::asio::ip::address &interface_address)
+    : stream(std::unique_ptr<writer>(new udp_parallel_writer(
+        std::move(io_service), endpoints, config, threads, affinity,
+        buffer_size, interface_address)))
+{
+}
+
+} // namespace send
+} // namespace spead2
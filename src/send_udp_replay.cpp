@@ -0,0 +1,311 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <boost/asio.hpp>
+#include <spead2/common_defines.h>
+#include <spead2/common_features.h>
+#include <spead2/common_logging.h>
+#include <spead2/common_raw_packet.h>
+#include <spead2/common_socket.h>
+#include <spead2/recv_udp_capture.h>
+#include <spead2/send_udp_replay.h>
+
+namespace spead2
+{
+namespace send
+{
+
+constexpr std::size_t udp_replay_config::default_buffer_size;
+
+udp_replay_config &udp_replay_config::set_speed(double speed)
+{
+    if (!(speed >= 0.0) || !std::isfinite(speed))
+        throw std::invalid_argument("speed must be non-negative and finite");
+    this->speed = speed;
+    return *this;
+}
+
+udp_replay_config &udp_replay_config::set_destination(const boost::asio::ip::udp::endpoint &destination)
+{
+    this->destination = destination;
+    return *this;
+}
+
+udp_replay_config &udp_replay_config::set_buffer_size(std::size_t buffer_size)
+{
+    this->buffer_size = buffer_size;
+    return *this;
+}
+
+udp_replay_config &udp_replay_config::set_ttl(int ttl)
+{
+    this->ttl = ttl;
+    return *this;
+}
+
+udp_replay_config &udp_replay_config::set_interface_address(const boost::asio::ip::address &interface_address)
+{
+    this->interface_address = interface_address;
+    return *this;
+}
+
+udp_replay_config &udp_replay_config::set_preload(bool preload)
+{
+    this->preload = preload;
+    return *this;
+}
+
+namespace
+{
+
+typedef std::chrono::steady_clock clock_type;
+
+/// A packet that is ready to send
+struct replay_packet
+{
+    packet_buffer payload;
+    boost::asio::ip::udp::endpoint destination;
+    clock_type::time_point target;
+};
+
+} // anonymous namespace
+
+static boost::asio::ip::udp::socket make_socket(
+    boost::asio::io_service &io_service, const udp_replay_config &config)
+{
+    using boost::asio::ip::udp;
+    const auto &interface_address = config.get_interface_address();
+    bool v6 = config.get_destination().port() != 0
+        ? config.get_destination().address().is_v6()
+        : interface_address.is_v6();
+    udp::socket socket(io_service, v6 ? udp::v6() : udp::v4());
+    socket.set_option(boost::asio::ip::multicast::hops(config.get_ttl()));
+    if (!interface_address.is_unspecified())
+    {
+        socket.bind(udp::endpoint(interface_address, 0));
+        if (interface_address.is_v4())
+            socket.set_option(boost::asio::ip::multicast::outbound_interface(interface_address.to_v4()));
+    }
+    set_socket_send_buffer_size(socket, config.get_buffer_size());
+    return socket;
+}
+
+constexpr int udp_replayer::max_batch;
+
+udp_replayer::udp_replayer(
+    const std::vector<std::string> &filenames,
+    const udp_replay_config &config)
+    : config(config), files(filenames), socket(make_socket(io_service, config))
+{
+    if (config.get_preload())
+        files.preload();
+}
+
+void udp_replayer::stop()
+{
+    stopped.store(true, std::memory_order_relaxed);
+}
+
+udp_replay_stats udp_replayer::run()
+{
+    using std::chrono::duration;
+    using std::chrono::duration_cast;
+
+    udp_replay_stats stats;
+    const double speed = config.get_speed();
+    const bool redirect = config.get_destination().port() != 0;
+    std::uint64_t first_timestamp = 0;
+    clock_type::time_point start;
+    bool started = false;
+
+    /* Fetch the next UDP packet from the capture, computing the time at
+     * which it should be sent.
+     */
+    auto next = [&](replay_packet &out) -> bool
+    {
+        recv::detail::capture_file::record r;
+        while (files.next(r))
+        {
+            try
+            {
+                if (r.captured_length == r.original_length
+                    && recv::detail::udp_from_capture(r, out.payload, out.destination))
+                {
+                    if (redirect)
+                        out.destination = config.get_destination();
+                    if (!started)
+                    {
+                        first_timestamp = r.timestamp;
+                        start = clock_type::now();
+                        started = true;
+                    }
+                    /* Captures are not always in timestamp order. A packet
+                     * stamped before the first one is sent immediately
+                     * (and counted as late).
+                     */
+                    std::int64_t delta = std::int64_t(r.timestamp - first_timestamp);
+                    double offset = (speed == 0.0) ? 0.0 : std::max(delta, std::int64_t(0)) * 1e-9 / speed;
+                    out.target = start + duration_cast<clock_type::duration>(duration<double>(offset));
+                    return true;
+                }
+            }
+            catch (packet_type_error &)
+            {
+            }
+            catch (std::length_error &)
+            {
+            }
+            stats.skipped++;
+        }
+        return false;
+    };
+
+    // Sleeping is imprecise, so sleep until shortly before the target and spin for the rest
+    auto wait_until = [this](clock_type::time_point target)
+    {
+        const auto spin = std::chrono::microseconds(100);
+        const auto max_sleep = std::chrono::milliseconds(100);  // to check for stop()
+        auto now = clock_type::now();
+        while (target - now > spin && !stopped.load(std::memory_order_relaxed))
+        {
+            std::this_thread::sleep_until(std::min(target - spin, now + max_sleep));
+            now = clock_type::now();
+        }
+        while (clock_type::now() < target)
+        {
+        }
+    };
+
+    replay_packet batch[max_batch];
+#if SPEAD2_USE_SENDMMSG
+    struct mmsghdr msgvec[max_batch];
+    struct iovec iov[max_batch];
+    std::memset(&msgvec, 0, sizeof(msgvec));
+#endif
+    replay_packet pending;
+    bool have = next(pending);
+    clock_type::time_point first_sent, prev_sent, prev_target;
+    double sum_late = 0.0, sum_sq_gap_error = 0.0;
+    while (have && !stopped.load(std::memory_order_relaxed))
+    {
+        wait_until(pending.target);
+        if (stopped.load(std::memory_order_relaxed))
+            break;
+        // Gather everything that is due
+        auto now = clock_type::now();
+        int n = 0;
+        do
+        {
+            batch[n++] = pending;
+            have = next(pending);
+        } while (have && n < max_batch && pending.target <= now);
+
+#if SPEAD2_USE_SENDMMSG
+        for (int i = 0; i < n; i++)
+        {
+            iov[i].iov_base = batch[i].payload.data();
+            iov[i].iov_len = batch[i].payload.size();
+            auto &hdr = msgvec[i].msg_hdr;
+            hdr.msg_iov = &iov[i];
+            hdr.msg_iovlen = 1;
+            hdr.msg_name = (void *) batch[i].destination.data();
+            hdr.msg_namelen = batch[i].destination.size();
+        }
+        int first = 0;
+        while (first < n)
+        {
+            int sent = sendmmsg(socket.native_handle(), msgvec + first, n - first, 0);
+            if (sent < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (stats.errors == 0)
+                    log_errno("sendmmsg failed: %1% (%2%)");
+                // Skip the packet that failed
+                batch[first].payload = packet_buffer();
+                stats.errors++;
+                first++;
+            }
+            else
+                first += sent;
+        }
+#else
+        for (int i = 0; i < n; i++)
+        {
+            boost::system::error_code ec;
+            socket.send_to(boost::asio::buffer(batch[i].payload.data(), batch[i].payload.size()),
+                           batch[i].destination, 0, ec);
+            if (ec)
+            {
+                if (stats.errors == 0)
+                    log_warning("send_to failed: %1%", ec.message());
+                batch[i].payload = packet_buffer();
+                stats.errors++;
+            }
+        }
+#endif
+        auto sent_time = clock_type::now();
+
+        for (int i = 0; i < n; i++)
+        {
+            if (!batch[i].payload.data())
+                continue;   // failed to send
+            const auto &target = batch[i].target;
+            double late = duration<double>(sent_time - target).count();
+            sum_late += late;
+            stats.max_lateness = std::max(stats.max_lateness, late);
+            if (stats.packets == 0)
+                first_sent = sent_time;
+            else
+            {
+                double gap_error = duration<double>((sent_time - prev_sent) - (target - prev_target)).count();
+                sum_sq_gap_error += gap_error * gap_error;
+            }
+            prev_sent = sent_time;
+            prev_target = target;
+            stats.packets++;
+            stats.bytes += batch[i].payload.size();
+        }
+    }
+
+    if (stats.packets > 0)
+    {
+        stats.target_duration = duration<double>(prev_target - start).count();
+        stats.actual_duration = duration<double>(prev_sent - first_sent).count();
+        stats.mean_lateness = sum_late / stats.packets;
+        if (stats.packets > 1)
+            stats.rms_gap_error = std::sqrt(sum_sq_gap_error / (stats.packets - 1));
+    }
+    return stats;
+}
+
+} // namespace send
+} // namespace spead2
@@ -132,6 +132,31 @@ writer::packet_result writer::get_packet(transmit_packet &data, std::uint8_t *sc
         if (active == queue_tail)
             return packet_result::EMPTY;
     }
+    next_group_packet(active, active_start, data, scratch);
+    if (!hw_rate)
+        rate_bytes += data.size;
+    return packet_result::SUCCESS;
+}
+
+bool writer::get_group(std::size_t &start, std::size_t &end)
+{
+    assert(active == active_start);
+    if (active == queue_tail)
+    {
+        queue_tail = get_owner()->queue_tail.load(std::memory_order_acquire);
+        if (active == queue_tail)
+            return false;
+    }
+    start = active;
+    end = get_owner()->get_queue(active)->group_end;
+    active = active_start = end;
+    return true;
+}
+
+void writer::next_group_packet(
+    std::size_t &active, std::size_t &active_start,
+    transmit_packet &data, std::uint8_t *scratch)
+{
     detail::queue_item *cur = get_owner()->get_queue(active);
     assert(cur->gen.has_next_packet());
 
@@ -141,8 +166,6 @@ writer::packet_result writer::get_packet(transmit_packet &data, std::uint8_t *sc
     // Point at the start of the group, so that errors and byte counts accumulate
     // in one place.
     data.item = get_owner()->get_queue(active_start);
-    if (!hw_rate)
-        rate_bytes += data.size;
     data.last = false;
 
     switch (cur->mode)
@@ -162,7 +185,7 @@ writer::packet_result writer::get_packet(transmit_packet &data, std::uint8_t *sc
                     data.last = true;
                     active = cur->group_end;
                     active_start = active;
-                    return packet_result::SUCCESS;
+                    return;
                 }
                 next_active = next->group_next;
                 next = get_owner()->get_queue(next_active);
@@ -183,14 +206,13 @@ writer::packet_result writer::get_packet(transmit_packet &data, std::uint8_t *sc
                     // We've finished all the heaps in the group
                     data.last = true;
                     active_start = active;
-                    return packet_result::SUCCESS;
+                    return;
                 }
                 next = get_owner()->get_queue(active);
             }
         }
         break;
     }
-    return packet_result::SUCCESS;
 }
 
 void writer::groups_completed(std::size_t n)
@@ -50,6 +50,10 @@ try:
     from spead2._spead2 import IbvContext      # noqa: F401
 except ImportError:
     pass
+try:
+    from spead2._spead2 import ShmQueue        # noqa: F401
+except ImportError:
+    pass
 from spead2._version import __version__       # noqa: F401
 
 
@@ -16,6 +16,8 @@
 from typing import (List, Sequence, Optional, Tuple, Any, Union,
                     Dict, KeysView, ValuesView, Text, overload)
 
+import enum
+
 import numpy as np
 try:
     from numpy.typing import DTypeLike as _DTypeLike
@@ -82,12 +84,55 @@ class ThreadPool:
     def __init__(self, threads: int = ...) -> None: ...
     @overload
     def __init__(self, threads: int, affinity: List[int]) -> None: ...
+    @overload
+    def __init__(self, threads: int, *, numa_nodes: List[int]) -> None: ...
 
 class MemoryAllocator:
     def __init__(self) -> None: ...
 
 class MmapAllocator(MemoryAllocator):
-    def __init__(self, flags: int = ...) -> None: ...
+    def __init__(self, flags: int = ..., prefer_huge: bool = ...) -> None: ...
+
+class HugepageAllocator(MemoryAllocator):
+    class Mode(enum.Enum):
+        NORMAL: int = ...
+        TRANSPARENT: int = ...
+        HUGETLB: int = ...
+
+    def __init__(self, page_size: int = ..., flags: int = ...,
+                 retry_hugetlb: bool = ...) -> None: ...
+    @property
+    def page_size(self) -> int: ...
+    @property
+    def last_mode(self) -> HugepageAllocator.Mode: ...
+
+class NumaAllocator(MemoryAllocator):
+    def __init__(self, node: int, strict: bool = ..., flags: int = ...) -> None: ...
+    @property
+    def node(self) -> int: ...
+    @property
+    def strict(self) -> bool: ...
+
+def numa_nodes() -> List[int]: ...
+def numa_node_cpus(node: int) -> List[int]: ...
+
+class MemoryPoolStats:
+    @property
+    def hits(self) -> int: ...
+    @property
+    def misses(self) -> int: ...
+    @property
+    def empty(self) -> int: ...
+    @property
+    def refills(self) -> int: ...
+    @property
+    def refill_time_ns(self) -> int: ...
+    @property
+    def free(self) -> int: ...
+    @property
+    def free_high_water(self) -> int: ...
+    @property
+    def bytes_outstanding(self) -> int: ...
 
 class MemoryPool(MemoryAllocator):
     warn_on_empty: bool
@@ -98,13 +143,80 @@ class MemoryPool(MemoryAllocator):
     @overload
     def __init__(self, thread_pool: ThreadPool, lower: int, upper: int, max_free: int, initial: int,
                  low_water: int, allocator: MemoryAllocator) -> None: ...
+    @property
+    def stats(self) -> MemoryPoolStats: ...
+
+class SlabPool(MemoryAllocator):
+    class SizeClass:
+        size: int
+        max_free: int
+        initial: int
+        low_water: int
 
+        def __init__(self, size: int, max_free: int, initial: int, low_water: int = 0) -> None: ...
+
+    warn_on_empty: bool
+
+    @overload
+    def __init__(self, classes: Sequence[SlabPool.SizeClass],
+                 allocator: Optional[MemoryAllocator] = None) -> None: ...
+    @overload
+    def __init__(self, thread_pool: ThreadPool, classes: Sequence[SlabPool.SizeClass],
+                 allocator: Optional[MemoryAllocator] = None) -> None: ...
+    @staticmethod
+    def power_of_two_classes(min_size: int, max_size: int, max_free: int, initial: int,
+                             low_water: int = 0) -> List[SlabPool.SizeClass]: ...
+    @property
+    def classes(self) -> List[SlabPool.SizeClass]: ...
+    @property
+    def stats(self) -> MemoryPoolStats: ...
+    @property
+    def class_stats(self) -> List[MemoryPoolStats]: ...
+
+class MemfdDescriptor:
+    fd: int
+    offset: int
+    length: int
+
+    def __init__(self, fd: int, offset: int, length: int) -> None: ...
+
+class MemfdAllocator(MemoryAllocator):
+    def __init__(self, size: int, hugetlb: bool = False, seal: bool = True) -> None: ...
+    @property
+    def fd(self) -> int: ...
+    @property
+    def size(self) -> int: ...
+    @property
+    def hugetlb(self) -> bool: ...
+    def descriptor(self, buffer: Any) -> MemfdDescriptor: ...
+
+class MemfdMapping:
+    def __init__(self, fd: int, writable: bool = False) -> None: ...
+    @property
+    def size(self) -> int: ...
 
 class InprocQueue:
     def __init__(self) -> None: ...
     def add_packet(self, packet) -> None: ...
     def stop(self) -> None: ...
 
+class ShmQueue:
+    @overload
+    def __init__(self, name: str, slot_size: int = ..., num_slots: int = ...) -> None: ...
+    @overload
+    def __init__(self, name: str) -> None: ...
+    @overload
+    def __init__(self, slot_size: int = ..., num_slots: int = ...) -> None: ...
+    @staticmethod
+    def from_fd(fd: int) -> ShmQueue: ...
+    @property
+    def fd(self) -> int: ...
+    @property
+    def slot_size(self) -> int: ...
+    @property
+    def num_slots(self) -> int: ...
+    def stop(self) -> None: ...
+
 class RawDescriptor:
     id: int
     name: bytes
@@ -71,6 +71,7 @@ class StreamStats:
     max_batch: int
     single_packet_heaps: int
     search_dist: int
+    reassembly_time_ns: int
     @property
     def config(self) -> List[StreamStatConfig]: ...
 
@@ -110,6 +111,7 @@ class StreamConfig:
                  stop_on_stop_item: bool = ..., allow_unsized_heaps: bool = ...,
                  allow_out_of_order: bool = ..., stream_id: int = ...) -> None: ...
     def add_stat(self, name: str, mode: StreamStatConfig.Mode = ...) -> int: ...
+    def add_memory_pool_stats(self) -> None: ...
     def get_stat_index(self, name: str) -> int: ...
     def next_stat_index(self) -> int: ...
 
@@ -137,6 +139,34 @@ class UdpIbvConfig:
                  buffer_size: int = ..., max_size: int = ..., comp_vector: int = ...,
                  max_poll: int = ...) -> None: ...
 
+class UdpPacketMmapConfig:
+    class FanoutMode(enum.Enum):
+        HASH: int = ...
+        LB: int = ...
+        CPU: int = ...
+        ROLLOVER: int = ...
+        RND: int = ...
+        QM: int = ...
+
+    DEFAULT_MAX_SIZE: ClassVar[int]
+    DEFAULT_BLOCK_SIZE: ClassVar[int]
+    DEFAULT_NUM_BLOCKS: ClassVar[int]
+    DEFAULT_BLOCK_TIMEOUT: ClassVar[int]
+
+    endpoints: _EndpointList
+    interface_address: str
+    max_size: int
+    block_size: int
+    num_blocks: int
+    block_timeout: int
+    fanout_group: int
+    fanout_mode: UdpPacketMmapConfig.FanoutMode
+
+    def __init__(self, *, endpoints: _EndpointList = ..., interface_address: str = ...,
+                 max_size: int = ..., block_size: int = ..., num_blocks: int = ...,
+                 block_timeout: int = ..., fanout_group: int = ...,
+                 fanout_mode: UdpPacketMmapConfig.FanoutMode = ...) -> None: ...
+
 class Ringbuffer:
     def size(self) -> int: ...
     def capacity(self) -> int: ...
@@ -179,8 +209,15 @@ class _Stream:
                            comp_vector: int = ..., max_poll: int = ...) -> None: ...
     @overload
     def add_udp_ibv_reader(self, config: UdpIbvConfig) -> None: ...
+    def add_udp_packet_mmap_reader(self, config: UdpPacketMmapConfig) -> None: ...
     def add_udp_pcap_file_reader(self, filename: str) -> None: ...
+    @overload
+    def add_udp_capture_reader(self, filename: str, address: str = ..., port: int = ...) -> None: ...
+    @overload
+    def add_udp_capture_reader(self, filenames: Sequence[str], address: str = ...,
+                               port: int = ...) -> None: ...
     def add_inproc_reader(self, queue: spead2.InprocQueue) -> None: ...
+    def add_shm_reader(self, queue: spead2.ShmQueue, affinity: int = -1) -> None: ...
     def stop(self) -> None: ...
     @property
     def stats(self) -> StreamStats: ...
@@ -20,11 +20,16 @@ import weakref
 import spead2 as _spead2
 from spead2._spead2.send import (       # noqa: F401
     RateMethod, StreamConfig, GroupMode, Heap, HeapReference, HeapReferenceList,
-    PacketGenerator, Stream, BytesStream, UdpStream, TcpStream, InprocStream)
+    PacketGenerator, Stream, BytesStream, UdpStream, UdpParallelStream, TcpStream,
+    InprocStream)
 try:
     from spead2._spead2.send import UdpIbvStream, UdpIbvConfig      # noqa: F401
 except ImportError:
     pass
+try:
+    from spead2._spead2.send import ShmStream      # noqa: F401
+except ImportError:
+    pass
 
 
 class _ItemInfo:
@@ -150,6 +150,17 @@ class _UdpStream:
 class UdpStream(_UdpStream, SyncStream):
     pass
 
+class _UdpParallelStream:
+    def __init__(self, thread_pool: spead2.ThreadPool,
+                 endpoints: _EndpointList,
+                 config: StreamConfig = ...,
+                 *, threads: int,
+                 affinity: List[int] = ...,
+                 buffer_size: int = ..., interface_address: str = ...) -> None: ...
+
+class UdpParallelStream(_UdpParallelStream, SyncStream):
+    pass
+
 class UdpIbvConfig:
     DEFAULT_BUFFER_SIZE: ClassVar[int]
     DEFAULT_MAX_POLL: ClassVar[int]
@@ -226,6 +237,15 @@ class _InprocStream:
 class InprocStream(_InprocStream, SyncStream):
     pass
 
+class _ShmStream:
+    @property
+    def queues(self) -> Sequence[spead2.ShmQueue]: ...
+    def __init__(self, thread_pool: spead2.ThreadPool, queues: List[spead2.ShmQueue],
+                 config: StreamConfig = ...) -> None: ...
+
+class ShmStream(_ShmStream, SyncStream):
+    pass
+
 class HeapGenerator:
     def __init__(self, item_group: spead2.ItemGroup, descriptor_frequency: Optional[int] = None,
                  flavour: spead2.Flavour = spead2.Flavour()) -> None: ...
@@ -21,6 +21,7 @@ import asyncio
 
 
 from spead2._spead2.send import UdpStreamAsyncio as _UdpStreamAsyncio
+from spead2._spead2.send import UdpParallelStreamAsyncio as _UdpParallelStreamAsyncio
 from spead2._spead2.send import TcpStreamAsyncio as _TcpStreamAsyncio
 from spead2._spead2.send import InprocStreamAsyncio as _InprocStreamAsyncio
 
@@ -116,6 +117,28 @@ UdpStream.__doc__ = \
         to OS limits.
     """
 
+UdpParallelStream = _wrap_class('UdpParallelStream', _UdpParallelStreamAsyncio)
+UdpParallelStream.__doc__ = \
+    """SPEAD over UDP from several transmit threads, with asynchronous sends.
+
+    Parameters
+    ----------
+    thread_pool : :py:class:`spead2.ThreadPool`
+        Thread pool handling the completions
+    endpoints : List[Tuple[str, int]]
+        Peer endpoints (one per substreams).
+    config : :py:class:`spead2.send.StreamConfig`
+        Stream configuration (with no rate limit)
+    threads : int
+        Number of transmit threads
+    affinity : List[int]
+        CPU cores for the transmit threads
+    buffer_size : int
+        Socket buffer size for each thread's socket
+    interface_address : str
+        Source hostname/IP address
+    """
+
 _TcpStreamBase = _wrap_class('TcpStream', _TcpStreamAsyncio)
 
 
@@ -221,3 +244,23 @@ try:
 
 except ImportError:
     pass
+
+try:
+    from spead2._spead2.send import ShmStreamAsyncio as _ShmStreamAsyncio
+
+    ShmStream = _wrap_class('ShmStream', _ShmStreamAsyncio)
+    ShmStream.__doc__ = \
+        """SPEAD over shared memory to another process on the same host.
+
+        Parameters
+        ----------
+        thread_pool : :py:class:`spead2.ThreadPool`
+            Thread pool handling the I/O
+        queues : List[:py:class:`spead2.ShmQueue`]
+            Queue for each substream
+        config : :py:class:`spead2.send.StreamConfig`
+            Stream configuration
+        """
+
+except ImportError:
+    pass
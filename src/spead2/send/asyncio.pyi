@@ -36,6 +36,9 @@ class AsyncStream(spead2.send.Stream):
 class UdpStream(spead2.send._UdpStream, AsyncStream):
     pass
 
+class UdpParallelStream(spead2.send._UdpParallelStream, AsyncStream):
+    pass
+
 class UdpIbvStream(spead2.send._UdpIbvStream, AsyncStream):
     pass
 
@@ -58,3 +61,6 @@ class TcpStream(spead2.send._TcpStream, AsyncStream):
 
 class InprocStream(spead2.send._InprocStream, AsyncStream):
     pass
+
+class ShmStream(spead2.send._ShmStream, AsyncStream):
+    pass
@@ -17,6 +17,8 @@
 Command-line processing utilities for the tools in this module.
 """
 
+import ipaddress
+
 import spead2.recv
 import spead2.send
 
@@ -34,6 +36,18 @@ def parse_endpoint(endpoint):
     return host, port
 
 
+def _is_multicast(host):
+    try:
+        return ipaddress.ip_address(host).is_multicast
+    except ValueError:
+        return False
+
+
+def _parse_sizes(value):
+    """Parse a comma-separated list of sizes."""
+    return [int(size) for size in value.split(',')]
+
+
 class _Options:
     """Base class for classes holding command-line arguments.
 
@@ -112,6 +126,8 @@ class SharedOptions(_Options):
     and receiver.
     """
 
+    _threads_help = 'Number of worker threads [%(default)s]'
+
     def __init__(self, protocol, name_map=None) -> None:
         super().__init__(name_map)
         self._protocol = protocol
@@ -136,8 +152,7 @@ class SharedOptions(_Options):
                                help='Maximum number of times to poll in a row [%(default)s]')
         self._add_argument(parser, 'affinity', type=spead2.parse_range_list,
                            help='List of CPUs to pin threads to [no affinity]')
-        self._add_argument(parser, 'threads', type=int,
-                           help='Number of worker threads [%(default)s]')
+        self._add_argument(parser, 'threads', type=int, help=self._threads_help)
 
     def make_thread_pool(self):
         if self.affinity:
@@ -161,6 +176,9 @@ class ReceiverOptions(SharedOptions):
         self.mem_upper = 32 * 1024**2
         self.mem_max_free = 12
         self.mem_initial = 8
+        self.mem_slab = None
+        self.mem_hugepages = False
+        self.mem_hugepage_size = 0
         self.packet = None
         if _HAVE_IBV:
             self.ibv_max_poll = spead2.recv.UdpIbvConfig.DEFAULT_MAX_POLL
@@ -183,6 +201,12 @@ class ReceiverOptions(SharedOptions):
                            help='Maximum free memory buffers [%(default)s]')
         self._add_argument(parser, 'mem_initial', type=int,
                            help='Initial free memory buffers [%(default)s]')
+        self._add_argument(parser, 'mem_slab', type=_parse_sizes,
+                           help='Use a slab pool with these comma-separated buffer sizes')
+        self._add_argument(parser, 'mem_hugepages', action='store_true',
+                           help='Back the memory pool with huge pages')
+        self._add_argument(parser, 'mem_hugepage_size', type=int,
+                           help='Huge page size to request (0 for system default) [%(default)s]')
         self._add_argument(parser, 'packet', type=int, help='Maximum packet size to accept')
         super().add_arguments(parser)
 
@@ -193,6 +217,13 @@ class ReceiverOptions(SharedOptions):
                 parser.error('--ibv requires --bind')
             if self._protocol.tcp and self.ibv:
                 parser.error('--ibv and --tcp are incompatible')
+        if self.mem_slab is not None:
+            if self.mem_pool:
+                parser.error('--mem-pool and --mem-slab cannot be used together')
+            if any(a >= b for a, b in zip(self.mem_slab, self.mem_slab[1:])):
+                parser.error('--mem-slab sizes must be increasing')
+        if self.mem_hugepages and not self.mem_pool:
+            parser.error('--mem-hugepages requires --mem-pool')
 
         if self.buffer is None:
             if self._protocol.tcp:
@@ -216,8 +247,18 @@ class ReceiverOptions(SharedOptions):
         config.substreams = self.substreams
         config.bug_compat = spead2.BUG_COMPAT_PYSPEAD_0_5_2 if self._protocol.pyspead else 0
         if self.mem_pool:
+            allocator = None
+            if self.mem_hugepages:
+                allocator = spead2.HugepageAllocator(self.mem_hugepage_size)
             config.memory_allocator = spead2.MemoryPool(self.mem_lower, self.mem_upper,
-                                                        self.mem_max_free, self.mem_initial)
+                                                        self.mem_max_free, self.mem_initial,
+                                                        allocator)
+            config.add_memory_pool_stats()
+        elif self.mem_slab is not None:
+            classes = [spead2.SlabPool.SizeClass(size, self.mem_max_free, self.mem_initial)
+                       for size in self.mem_slab]
+            config.memory_allocator = spead2.SlabPool(classes)
+            config.add_memory_pool_stats()
         if self.memcpy_nt:
             config.memcpy = spead2.MEMCPY_NONTEMPORAL
         return config
@@ -233,10 +274,7 @@ class ReceiverOptions(SharedOptions):
             except ValueError:
                 if not allow_pcap:
                     raise
-                try:
-                    stream.add_udp_pcap_file_reader(source)
-                except AttributeError:
-                    raise RuntimeError('spead2 was compiled without pcap support') from None
+                stream.add_udp_capture_reader(source)
             else:
                 if self._protocol.tcp:
                     stream.add_tcp_reader(port, self.packet, self.buffer, host)
@@ -260,6 +298,9 @@ class ReceiverOptions(SharedOptions):
 class SenderOptions(SharedOptions):
     """Options for senders."""
 
+    _threads_help = ('Number of worker threads, which also transmit for UDP unicast '
+                     'without --rate [%(default)s]')
+
     def __init__(self, protocol, name_map=None):
         super().__init__(protocol, name_map)
         self.addr_bits = spead2.Flavour().heap_address_bits
@@ -346,6 +387,12 @@ class SenderOptions(SharedOptions):
                     memory_regions=memory_regions
                 )
             )
+        elif (self.threads != 1 and self.rate == 0.0
+              and not any(_is_multicast(host) for host, _ in endpoints)):
+            # Also use the worker threads for transmission, like spead2_send --threads
+            return spead2.send.asyncio.UdpParallelStream(
+                thread_pool, endpoints, config, threads=self.threads,
+                buffer_size=self.buffer, interface_address=self.bind or '')
         else:
             kwargs = {}
             if self.ttl is not None:
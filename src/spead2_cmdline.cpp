@@ -21,19 +21,22 @@
 #include <cassert>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 #include <functional>
 #include <vector>
 #include <type_traits>
 #include <boost/program_options.hpp>
 #include <spead2/common_features.h>
 #include <spead2/common_memory_pool.h>
+#include <spead2/common_slab_pool.h>
 #include <spead2/recv_tcp.h>
 #include <spead2/recv_udp.h>
-#if SPEAD2_USE_PCAP
-# include <spead2/recv_udp_pcap.h>
-#endif
+#include <spead2/recv_udp_capture.h>
 #include <spead2/send_tcp.h>
 #include <spead2/send_udp.h>
+#include <spead2/send_udp_parallel.h>
 #if SPEAD2_USE_IBV
 # include <spead2/recv_udp_ibv.h>
 # include <spead2/send_udp_ibv.h>
@@ -117,6 +120,41 @@ void receiver_options::notify(const protocol_options &protocol)
         throw po::error("--ibv and --tcp are incompatible");
 #endif
 
+    mem_slab_sizes.clear();
+    if (!mem_slab.empty())
+    {
+        if (mem_pool)
+            throw po::error("--mem-pool and --mem-slab cannot be used together");
+        std::istringstream in(mem_slab);
+        std::string token;
+        while (std::getline(in, token, ','))
+        {
+            std::size_t size = 0;
+            bool valid = !token.empty() && token.find_first_not_of("0123456789") == std::string::npos;
+            if (valid)
+            {
+                try
+                {
+                    size = std::stoull(token);
+                }
+                catch (std::out_of_range &)
+                {
+                    valid = false;
+                }
+            }
+            if (!valid)
+                throw po::error("invalid size '" + token + "' in --mem-slab");
+            if (!mem_slab_sizes.empty() && size <= mem_slab_sizes.back())
+                throw po::error("--mem-slab sizes must be increasing");
+            mem_slab_sizes.push_back(size);
+        }
+    }
+    /* Huge pages round every allocation up to a whole huge page, which is
+     * only affordable when the memory is recycled by a pool.
+     */
+    if (mem_hugepages && !mem_pool)
+        throw po::error("--mem-hugepages requires --mem-pool");
+
     if (!buffer_size)
     {
         if (protocol.tcp)
@@ -149,9 +187,21 @@ stream_config receiver_options::make_stream_config(const protocol_options &proto
     config.set_substreams(substreams);
     if (mem_pool)
     {
+        std::shared_ptr<memory_allocator> allocator;
+        if (mem_hugepages)
+            allocator = std::make_shared<hugepage_allocator>(mem_hugepage_size);
         std::shared_ptr<spead2::memory_pool> pool = std::make_shared<spead2::memory_pool>(
-            mem_lower, mem_upper, mem_max_free, mem_initial);
+            mem_lower, mem_upper, mem_max_free, mem_initial, std::move(allocator));
         config.set_memory_allocator(std::move(pool));
+        config.add_memory_pool_stats();
+    }
+    else if (!mem_slab_sizes.empty())
+    {
+        std::vector<slab_pool::size_class> classes;
+        for (std::size_t size : mem_slab_sizes)
+            classes.emplace_back(size, mem_max_free, mem_initial);
+        config.set_memory_allocator(std::make_shared<slab_pool>(std::move(classes)));
+        config.add_memory_pool_stats();
     }
     config.set_memcpy(memcpy_nt ? MEMCPY_NONTEMPORAL : MEMCPY_STD);
     config.set_bug_compat(protocol.pyspead ? BUG_COMPAT_PYSPEAD_0_5_2 : 0);
@@ -208,13 +258,7 @@ void receiver_options::add_readers(
         }
 
         if (is_pcap)
-        {
-#if SPEAD2_USE_PCAP
-            stream.emplace_reader<udp_pcap_file_reader>(endpoint);
-#else
-            throw std::runtime_error("spead2 was compiled without pcap support");
-#endif
-        }
+            stream.emplace_reader<udp_capture_reader>(endpoint);
         else if (protocol.tcp)
         {
             tcp::endpoint ep = parse_endpoint<tcp>(stream.get_io_service(), endpoint, true);
@@ -301,7 +345,15 @@ void sender_options::notify(const protocol_options &protocol)
         throw po::error("--tcp and --ibv cannot be used together");
     if (ibv && interface_address.empty())
         throw po::error("--ibv requires --bind");
+    if (ibv && threads != 1)
+        throw po::error("--ibv and --threads cannot be used together");
 #endif
+    if (threads == 0)
+        throw po::error("--threads must be positive");
+    if (protocol.tcp && threads != 1)
+        throw po::error("--tcp and --threads cannot be used together");
+    if (threads != 1 && rate != 0.0)
+        throw po::error("--rate and --threads cannot be used together");
 
     if (!buffer_size)
     {
@@ -380,7 +432,14 @@ std::unique_ptr<stream> sender_options::make_stream(
         else
 #endif // SPEAD2_USE_IBV
         {
-            if (ep[0].address().is_multicast())
+            if (threads != 1)
+            {
+                if (ep[0].address().is_multicast())
+                    throw std::invalid_argument("--threads is not supported with multicast");
+                stream.reset(new udp_parallel_stream(
+                    io_service, ep, config, threads, {}, *buffer_size, interface_address));
+            }
+            else if (ep[0].address().is_multicast())
             {
                 if (ep[0].address().is_v4())
                     stream.reset(new udp_stream(
@@ -186,6 +186,10 @@ struct receiver_options
     std::size_t mem_upper = 32 * 1024 * 1024;
     std::size_t mem_max_free = 12;
     std::size_t mem_initial = 8;
+    bool mem_hugepages = false;
+    std::size_t mem_hugepage_size = 0;
+    std::string mem_slab;
+    std::vector<std::size_t> mem_slab_sizes;   ///< Parsed from mem_slab by notify()
     boost::optional<std::size_t> buffer_size;
     boost::optional<std::size_t> max_packet_size;
     std::string interface_address;
@@ -211,6 +215,9 @@ struct receiver_options
         callback("mem-upper", "Maximum allocation which will use the memory pool", &mem_upper);
         callback("mem-max-free", "Maximum free memory buffers", &mem_max_free);
         callback("mem-initial", "Initial free memory buffers", &mem_initial);
+        callback("mem-slab", "Use a slab pool with these comma-separated buffer sizes", &mem_slab);
+        callback("mem-hugepages", "Back the memory pool with huge pages", &mem_hugepages);
+        callback("mem-hugepage-size", "Huge page size to request (0 for system default)", &mem_hugepage_size);
         callback("ring", "Use ringbuffer instead of callbacks", &ring);
         callback("memcpy-nt", "Use non-temporal memcpy", &memcpy_nt);
 #if SPEAD2_USE_IBV
@@ -230,7 +237,7 @@ struct receiver_options
      * Add reader(s) to a stream.
      *
      * If @a allow_pcap is true, endpoints that don't parse as a port number
-     * are assumed to be filenames and added with @ref udp_pcap_file_reader.
+     * are assumed to be filenames and added with @ref udp_capture_reader.
      */
     void add_readers(
         spead2::recv::stream &stream,
@@ -261,6 +268,7 @@ struct sender_options
     rate_method method = spead2::send::stream_config::default_rate_method;
     double rate = 0.0;
     int ttl = 1;
+    std::size_t threads = 1;
 #if SPEAD2_USE_IBV
     bool ibv = false;
     int ibv_comp_vector = 0;
@@ -282,6 +290,7 @@ struct sender_options
         callback("rate-method", "Rate limiting method (SW/HW/AUTO)", &method);
         callback("rate", "Transmission rate bound (Gb/s)", &rate);
         callback("ttl", "TTL for multicast target", &ttl);
+        callback("threads", "Number of transmit threads (UDP unicast only)", &threads);
 #if SPEAD2_USE_IBV
         callback("ibv", "Use ibverbs", &ibv);
         callback("ibv-vector", "Interrupt vector (-1 for polled)", &ibv_comp_vector);
@@ -0,0 +1,158 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Utility program to retransmit the UDP packets in pcap or pcapng files with
+ * their original timing (or a scaled version of it), and report how closely
+ * the timing was achieved. It works with any UDP data, not just SPEAD.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+#include <spead2/common_logging.h>
+#include <spead2/send_udp_replay.h>
+#include "spead2_cmdline.h"
+
+namespace po = boost::program_options;
+using boost::asio::ip::udp;
+
+struct options
+{
+    std::vector<std::string> filenames;
+    std::string destination;
+    std::string bind;
+    double speed = 1.0;
+    int ttl = 1;
+    std::size_t buffer = spead2::send::udp_replay_config::default_buffer_size;
+    bool preload = false;
+};
+
+static spead2::send::udp_replayer *active_replayer = nullptr;
+
+static void signal_handler(int)
+{
+    if (active_replayer)
+        active_replayer->stop();
+}
+
+static void usage(std::ostream &o, const po::options_description &desc)
+{
+    o << "Usage: spead2_replay [options] <filename>...\n";
+    o << desc;
+}
+
+template<typename T>
+static po::typed_value<T> *make_opt(T &var)
+{
+    return po::value<T>(&var)->default_value(var);
+}
+
+static po::typed_value<bool> *make_opt(bool &var)
+{
+    return po::bool_switch(&var)->default_value(var);
+}
+
+static options parse_args(int argc, const char **argv)
+{
+    options opts;
+    po::options_description desc, hidden, all;
+    desc.add_options()
+        ("dest,d", po::value<std::string>(&opts.destination),
+         "Send all packets to <host>:<port> instead of their original destinations")
+        ("speed,s", make_opt(opts.speed), "Replay speed relative to the capture (0 for as fast as possible)")
+        ("bind", po::value<std::string>(&opts.bind), "Local address to send from")
+        ("ttl", make_opt(opts.ttl), "TTL for multicast packets")
+        ("buffer", make_opt(opts.buffer), "Socket send buffer size")
+        ("preload", make_opt(opts.preload), "Read the files into memory before starting")
+        ("help,h", "Show help text")
+    ;
+    hidden.add_options()
+        ("filename", po::value<std::vector<std::string>>(&opts.filenames)->composing(), "capture file")
+    ;
+    all.add(desc);
+    all.add(hidden);
+
+    po::positional_options_description positional;
+    positional.add("filename", -1);
+    try
+    {
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv)
+            .style(po::command_line_style::default_style & ~po::command_line_style::allow_guessing)
+            .options(all)
+            .positional(positional)
+            .run(), vm);
+        po::notify(vm);
+        if (vm.count("help"))
+        {
+            usage(std::cout, desc);
+            std::exit(0);
+        }
+        if (opts.filenames.empty())
+            throw po::error("at least one filename must be specified");
+        return opts;
+    }
+    catch (po::error &e)
+    {
+        std::cerr << e.what() << '\n';
+        usage(std::cerr, desc);
+        std::exit(2);
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    options opts = parse_args(argc, argv);
+    spead2::send::udp_replay_config config;
+    config.set_speed(opts.speed)
+        .set_ttl(opts.ttl)
+        .set_buffer_size(opts.buffer)
+        .set_preload(opts.preload);
+    if (!opts.destination.empty())
+        config.set_destination(spead2::parse_endpoint<udp>(opts.destination, false));
+    if (!opts.bind.empty())
+        config.set_interface_address(boost::asio::ip::address::from_string(opts.bind));
+
+    spead2::send::udp_replayer replayer(opts.filenames, config);
+    struct sigaction act = {}, old_act;
+    act.sa_handler = signal_handler;
+    act.sa_flags = SA_RESETHAND | SA_RESTART;
+    active_replayer = &replayer;
+    if (sigaction(SIGINT, &act, &old_act) != 0)
+        spead2::throw_errno("sigaction failed");
+    spead2::send::udp_replay_stats stats = replayer.run();
+    sigaction(SIGINT, &old_act, &act);
+    active_replayer = nullptr;
+
+    std::cout << stats.packets << " packets sent (" << stats.bytes << " bytes), "
+        << stats.skipped << " skipped, " << stats.errors << " errors\n";
+    std::cout << "Duration: target " << stats.target_duration << " s, actual "
+        << stats.actual_duration << " s\n";
+    if (stats.target_duration > 0 && stats.actual_duration > 0)
+        std::cout << "Rate: target " << stats.bytes * 8e-9 / stats.target_duration
+            << " Gb/s, actual " << stats.bytes * 8e-9 / stats.actual_duration << " Gb/s\n";
+    std::cout << "Lateness: mean " << stats.mean_lateness * 1e6 << " us, max "
+        << stats.max_lateness * 1e6 << " us\n";
+    std::cout << "Inter-packet gap error: RMS " << stats.rms_gap_error * 1e6 << " us\n";
+    return 0;
+}
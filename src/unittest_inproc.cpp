@@ -0,0 +1,153 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for the batching and buffer recycling in the in-process
+ * transport.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_inproc.h>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_inproc.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/send_inproc.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(inproc)
+
+static spead2::inproc_queue::packet make_packet(std::size_t capacity)
+{
+    spead2::inproc_queue::packet pkt;
+    pkt.data.reset(new std::uint8_t[capacity]);
+    pkt.size = 0;
+    pkt.capacity = capacity;
+    return pkt;
+}
+
+BOOST_AUTO_TEST_CASE(add_packets)
+{
+    spead2::inproc_queue queue;
+    std::vector<spead2::inproc_queue::packet> pkts;
+    queue.add_packets(pkts);   // empty batch is ignored
+    for (int i = 0; i < 3; i++)
+        pkts.push_back(make_packet(16));
+    queue.add_packets(pkts);
+    BOOST_CHECK(pkts.empty());
+    queue.stop();
+    BOOST_CHECK_EQUAL(queue.buffer.try_pop().size(), 3);
+    BOOST_CHECK_THROW(queue.buffer.try_pop(), spead2::ringbuffer_stopped);
+    pkts.push_back(make_packet(16));
+    BOOST_CHECK_THROW(queue.add_packets(pkts), spead2::ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_CASE(recycle)
+{
+    spead2::inproc_queue queue;
+    std::vector<spead2::inproc_queue::packet> pkts;
+    pkts.push_back(make_packet(16));
+    pkts.push_back(make_packet(32));
+    spead2::inproc_queue::packet unowned;
+    unowned.data.reset(new std::uint8_t[8]);
+    unowned.size = 8;
+    pkts.push_back(std::move(unowned));
+    queue.recycle_packets(std::move(pkts));
+
+    std::vector<spead2::inproc_queue::packet> out;
+    queue.reuse_packets(out, 1);
+    BOOST_CHECK_EQUAL(out.size(), 1);
+    queue.reuse_packets(out, 10);
+    // The packet with zero capacity must not have been kept
+    BOOST_REQUIRE_EQUAL(out.size(), 2);
+    BOOST_CHECK(out[0].capacity > 0 && out[1].capacity > 0);
+    queue.reuse_packets(out, 10);
+    BOOST_CHECK_EQUAL(out.size(), 2);
+}
+
+/* Send heaps through two queues, and check that they arrive intact and that
+ * the receivers hand packet storage back for reuse.
+ */
+BOOST_AUTO_TEST_CASE(send_recv)
+{
+    constexpr int n_heaps = 20;
+    constexpr std::size_t payload_size = 5000;
+    spead2::thread_pool tp;
+    std::vector<std::shared_ptr<spead2::inproc_queue>> queues{
+        std::make_shared<spead2::inproc_queue>(), std::make_shared<spead2::inproc_queue>()};
+    std::vector<std::unique_ptr<spead2::recv::ring_stream<>>> streams;
+    for (const auto &queue : queues)
+    {
+        streams.emplace_back(new spead2::recv::ring_stream<>(
+            tp, spead2::recv::stream_config(),
+            spead2::recv::ring_stream_config().set_heaps(n_heaps)));
+        streams.back()->emplace_reader<spead2::recv::inproc_reader>(queue);
+    }
+
+    std::vector<std::uint8_t> payload(payload_size);
+    for (std::size_t i = 0; i < payload_size; i++)
+        payload[i] = std::uint8_t(i);
+    spead2::send::heap h;
+    h.add_item(0x1000, payload.data(), payload.size(), false);
+    spead2::send::inproc_stream stream(
+        tp, queues,
+        spead2::send::stream_config().set_max_packet_size(1024).set_max_heaps(n_heaps));
+    std::vector<boost::system::error_code> errors(n_heaps);
+    for (int i = 0; i < n_heaps; i++)
+        stream.async_send_heap(
+            h,
+            [&errors, i](const boost::system::error_code &ec, spead2::item_pointer_t)
+            {
+                errors[i] = ec;
+            },
+            -1, i % 2);
+    stream.flush();
+    for (const auto &ec : errors)
+        BOOST_CHECK_EQUAL(ec, boost::system::error_code());
+
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::recv::heap rh = streams[i % 2]->pop();
+        BOOST_CHECK_EQUAL(rh.get_cnt(), i + 1);
+        BOOST_REQUIRE_EQUAL(rh.get_items().size(), 1);
+        const auto &item = rh.get_items()[0];
+        BOOST_REQUIRE_EQUAL(item.length, payload_size);
+        BOOST_CHECK(std::equal(payload.begin(), payload.end(), item.ptr));
+    }
+    for (const auto &queue : queues)
+    {
+        std::vector<spead2::inproc_queue::packet> out;
+        queue->reuse_packets(out, 1);
+        BOOST_CHECK_EQUAL(out.size(), 1);
+        queue->stop();
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // inproc
+BOOST_AUTO_TEST_SUITE_END()  // common
+
+}} // namespace spead2::unittest
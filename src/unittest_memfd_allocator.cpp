@@ -0,0 +1,140 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for common_memfd_allocator.
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_MEMFD
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_memfd_allocator.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(memfd_allocator)
+
+// Data written through the allocator is visible through a separate mapping
+BOOST_AUTO_TEST_CASE(share)
+{
+    auto allocator = std::make_shared<spead2::memfd_allocator>(1024 * 1024);
+    auto ptr1 = allocator->allocate(100, nullptr);
+    auto ptr2 = allocator->allocate(5000, nullptr);
+    std::memset(ptr2.get(), 'x', 5000);
+
+    spead2::memfd_descriptor desc = allocator->get_descriptor(ptr2.get() + 10);
+    BOOST_CHECK_EQUAL(desc.fd, allocator->get_fd());
+    BOOST_CHECK_EQUAL(desc.offset, ptr2.get() - allocator->get_data());
+    BOOST_CHECK_EQUAL(desc.offset % spead2::memfd_allocator::alignment, 0);
+    BOOST_CHECK_EQUAL(desc.length, 5000);
+
+    spead2::memfd_mapping mapping(desc.fd);
+    BOOST_CHECK_EQUAL(mapping.size(), allocator->get_size());
+    const std::uint8_t *data = mapping.get(desc);
+    BOOST_CHECK_NE(data, ptr2.get());   // a different virtual mapping...
+    for (std::size_t i = 0; i < desc.length; i++)
+        BOOST_REQUIRE_EQUAL(data[i], 'x');   // ... of the same memory
+
+    desc.length = mapping.size();
+    BOOST_CHECK_THROW(mapping.get(desc), std::out_of_range);
+}
+
+// Freed space is merged and reused, and the region does not grow
+BOOST_AUTO_TEST_CASE(reuse)
+{
+    std::size_t page_size = sysconf(_SC_PAGESIZE);
+    auto allocator = std::make_shared<spead2::memfd_allocator>(page_size);
+    BOOST_REQUIRE_EQUAL(allocator->get_size(), page_size);
+    std::size_t quarter = page_size / 4;
+    auto a = allocator->allocate(quarter, nullptr);
+    auto b = allocator->allocate(quarter, nullptr);
+    auto c = allocator->allocate(2 * quarter, nullptr);
+    BOOST_CHECK_THROW(allocator->allocate(1, nullptr), std::bad_alloc);
+
+    std::uint8_t *start = a.get();
+    b.reset();
+    a.reset();
+    auto d = allocator->allocate(2 * quarter, nullptr);
+    BOOST_CHECK_EQUAL(d.get(), start);
+    BOOST_CHECK_EQUAL(allocator->get_descriptor(c.get()).offset, 2 * quarter);
+}
+
+BOOST_AUTO_TEST_CASE(bad_pointer)
+{
+    auto allocator = std::make_shared<spead2::memfd_allocator>(1);
+    std::uint8_t local;
+    BOOST_CHECK_THROW(allocator->get_descriptor(&local), std::invalid_argument);
+    // Inside the region but not allocated
+    BOOST_CHECK_THROW(allocator->get_descriptor(allocator->get_data()), std::invalid_argument);
+    auto ptr = allocator->allocate(1, nullptr);
+    BOOST_CHECK_EQUAL(allocator->get_descriptor(ptr.get()).length, 1);
+    ptr.reset();
+    BOOST_CHECK_THROW(allocator->get_descriptor(allocator->get_data()), std::invalid_argument);
+}
+
+// The allocator stays alive while memory is allocated
+BOOST_AUTO_TEST_CASE(lifetime)
+{
+    auto allocator = std::make_shared<spead2::memfd_allocator>(1);
+    std::weak_ptr<spead2::memfd_allocator> weak = allocator;
+    {
+        auto ptr = allocator->allocate(10, nullptr);
+        allocator.reset();
+        BOOST_CHECK(!weak.expired());
+        ptr[9] = 1;
+    }
+    BOOST_CHECK(weak.expired());
+}
+
+BOOST_AUTO_TEST_CASE(sealed)
+{
+    auto allocator = std::make_shared<spead2::memfd_allocator>(1);
+    BOOST_CHECK_NE(ftruncate(allocator->get_fd(), 0), 0);
+    auto unsealed = std::make_shared<spead2::memfd_allocator>(1, false, false);
+    std::size_t page_size = sysconf(_SC_PAGESIZE);
+    BOOST_CHECK_EQUAL(ftruncate(unsealed->get_fd(), 2 * page_size), 0);
+}
+
+// Huge pages may not be available, but the allocator must work either way
+BOOST_AUTO_TEST_CASE(hugetlb)
+{
+    auto allocator = std::make_shared<spead2::memfd_allocator>(1, true);
+    std::size_t page_size = sysconf(_SC_PAGESIZE);
+    BOOST_CHECK_EQUAL(allocator->get_size() % page_size, 0);
+    auto ptr = allocator->allocate(100, nullptr);
+    std::memset(ptr.get(), 0, 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // memfd_allocator
+BOOST_AUTO_TEST_SUITE_END()  // common
+
+}} // namespace spead2::unittest
+
+#endif // SPEAD2_USE_MEMFD
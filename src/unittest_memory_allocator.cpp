@@ -26,6 +26,7 @@
 #include <memory>
 #include <utility>
 #include <spead2/common_memory_allocator.h>
+#include <spead2/common_numa.h>
 
 namespace spead2
 {
@@ -42,6 +43,13 @@ public:
     huge_mmap_allocator() : spead2::mmap_allocator(0, true) {}
 };
 
+// Wrapper to place memory on the first NUMA node
+class first_node_numa_allocator : public spead2::numa_allocator
+{
+public:
+    first_node_numa_allocator() : spead2::numa_allocator(spead2::numa_nodes()[0]) {}
+};
+
 class legacy_allocator : public spead2::memory_allocator
 {
 public:
@@ -70,6 +78,8 @@ typedef boost::mpl::list<
     spead2::memory_allocator,
     spead2::mmap_allocator,
     huge_mmap_allocator,
+    first_node_numa_allocator,
+    spead2::hugepage_allocator,
     legacy_allocator> test_types;
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(allocator_test, T, test_types)
@@ -89,6 +99,34 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(out_of_memory, T, test_types)
     BOOST_CHECK_THROW(allocator->allocate(SIZE_MAX - 1, nullptr), std::bad_alloc);
 }
 
+BOOST_AUTO_TEST_CASE(hugepage)
+{
+    auto allocator = std::make_shared<spead2::hugepage_allocator>();
+    std::size_t page_size = allocator->get_page_size();
+    BOOST_TEST((page_size & (page_size - 1)) == 0);
+    auto ptr = allocator->allocate(3 * page_size + 1, nullptr);
+    auto mode = allocator->get_last_mode();
+    if (mode != spead2::hugepage_allocator::mode::NORMAL)
+    {
+        // Huge page backings are aligned to the huge page size
+        BOOST_TEST(std::uintptr_t(ptr.get()) % page_size == 0);
+    }
+    // The size is rounded up, so the rest of the last page is usable
+    ptr[4 * page_size - 1] = 1;
+    if (mode != spead2::hugepage_allocator::mode::HUGETLB)
+    {
+        // MAP_HUGETLB is not tried again once it has failed
+        auto ptr2 = allocator->allocate(1, nullptr);
+        BOOST_CHECK(allocator->get_last_mode() != spead2::hugepage_allocator::mode::HUGETLB);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hugepage_bad_page_size)
+{
+    BOOST_CHECK_THROW(spead2::hugepage_allocator(3 * 1024 * 1024), std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::hugepage_allocator(1024), std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_CASE(legacy)
 {
     auto allocator = std::make_shared<legacy_allocator>();
@@ -28,6 +28,8 @@
 #include <memory>
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <future>
 #include <spead2/common_memory_pool.h>
 #include <spead2/common_thread_pool.h>
 #include <spead2/common_logging.h>
@@ -58,6 +60,29 @@ BOOST_AUTO_TEST_CASE(memory_pool_refill)
         pointers.push_back(pool->allocate(1024 * 1024, nullptr));
     // Give the refiller time to refill completely
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    spead2::memory_pool_stats stats = pool->get_stats();
+    BOOST_CHECK_GE(stats.refills, 1);
+    BOOST_CHECK_GT(stats.refill_time_ns, 0);
+    BOOST_CHECK_EQUAL(stats.bytes_outstanding, 100 * 2 * 1024 * 1024);
+}
+
+/* The first allocation moves a batch of blocks into the thread's magazine,
+ * together with their credits. The refill must be triggered by the blocks
+ * actually left, not by the credits.
+ */
+BOOST_AUTO_TEST_CASE(memory_pool_refill_magazine)
+{
+    spead2::thread_pool tpool;
+    std::shared_ptr<spead2::memory_pool> pool = std::make_shared<spead2::memory_pool>(
+        tpool, 1024, 2048, 32, 8, 4);
+    std::vector<spead2::memory_pool::pointer> pointers;
+    for (int i = 0; i < 5; i++)
+        pointers.push_back(pool->allocate(1024, nullptr));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    spead2::memory_pool_stats stats = pool->get_stats();
+    BOOST_CHECK_EQUAL(stats.empty, 0);
+    BOOST_CHECK_GE(stats.refills, 1);
+    BOOST_CHECK_GE(stats.free, 8);
 }
 
 class mock_allocator : public spead2::memory_allocator
@@ -185,6 +210,88 @@ BOOST_AUTO_TEST_CASE(memory_pool_pass_deleter)
     BOOST_CHECK_EQUAL(allocator->records[7].ptr, allocator->records[4].ptr);
 }
 
+// Allocator that counts live allocations
+class counting_allocator : public spead2::memory_allocator
+{
+public:
+    std::atomic<int> allocated{0};
+    std::atomic<int> live{0};
+
+    virtual pointer allocate(std::size_t size, void *hint) override
+    {
+        pointer ptr = spead2::memory_allocator::allocate(size, hint);
+        allocated++;
+        live++;
+        std::shared_ptr<counting_allocator> self =
+            std::static_pointer_cast<counting_allocator>(shared_from_this());
+        return pointer(ptr.release(), [self](std::uint8_t *p) {
+            self->live--;
+            delete[] p;
+        });
+    }
+};
+
+// Memory freed by one thread must be reusable by another thread
+BOOST_AUTO_TEST_CASE(memory_pool_cross_thread)
+{
+    auto allocator = std::make_shared<counting_allocator>();
+    auto pool = std::make_shared<spead2::memory_pool>(1024, 2048, 8, 0, allocator);
+    pool->set_warn_on_empty(false);
+    std::vector<spead2::memory_pool::pointer> pointers;
+    for (int i = 0; i < 4; i++)
+        pointers.push_back(pool->allocate(1024, nullptr));
+    BOOST_CHECK_EQUAL(allocator->allocated.load(), 4);
+    std::async(std::launch::async, [&pointers] { pointers.clear(); }).get();
+    for (int i = 0; i < 4; i++)
+        pointers.push_back(pool->allocate(1024, nullptr));
+    BOOST_CHECK_EQUAL(allocator->allocated.load(), 4);
+
+    // Free after the pool is gone, from another thread
+    pool.reset();
+    BOOST_CHECK_EQUAL(allocator->live.load(), 4);
+    std::async(std::launch::async, [&pointers] { pointers.clear(); }).get();
+    BOOST_CHECK_EQUAL(allocator->live.load(), 0);
+}
+
+// Allocate and free concurrently from several threads
+BOOST_AUTO_TEST_CASE(memory_pool_threads)
+{
+    auto allocator = std::make_shared<counting_allocator>();
+    auto pool = std::make_shared<spead2::memory_pool>(1024, 2048, 32, 16, allocator);
+    pool->set_warn_on_empty(false);
+    // Boost.Test assertions are not thread-safe, so workers report corruption
+    std::vector<std::future<bool>> workers;
+    for (int t = 0; t < 4; t++)
+    {
+        workers.push_back(std::async(std::launch::async, [pool, t] {
+            bool ok = true;
+            std::vector<spead2::memory_pool::pointer> held;
+            for (int i = 0; i < 20000; i++)
+            {
+                held.push_back(pool->allocate(1500, nullptr));
+                held.back()[0] = t;
+                held.back()[1499] = t;
+                if (held.size() > std::size_t(i % 7))
+                {
+                    if (held[0][0] != t || held[0][1499] != t)
+                        ok = false;
+                    held.erase(held.begin());
+                }
+            }
+            return ok;
+        }));
+    }
+    for (auto &worker : workers)
+        BOOST_CHECK(worker.get());
+    /* Each thread holds at most 7 buffers, so memory should be recycled
+     * rather than allocated (allowing for some slack for races).
+     */
+    BOOST_CHECK_LE(allocator->allocated.load(), 100);
+    BOOST_CHECK_LE(allocator->live.load(), 32);
+    pool.reset();
+    BOOST_CHECK_EQUAL(allocator->live.load(), 0);
+}
+
 // Check that a warning is issued when the memory pool becomes empty, if and
 // only if the warning is enabled.
 BOOST_FIXTURE_TEST_CASE(memory_pool_warn_on_empty, logger_fixture)
@@ -205,6 +312,38 @@ BOOST_FIXTURE_TEST_CASE(memory_pool_warn_on_empty, logger_fixture)
     BOOST_CHECK_EQUAL(messages[spead2::log_level::warning].size(), 1);
 }
 
+BOOST_AUTO_TEST_CASE(memory_pool_stats)
+{
+    auto pool = std::make_shared<spead2::memory_pool>(1024, 2048, 4, 2);
+    pool->set_warn_on_empty(false);
+    spead2::memory_pool_stats stats = pool->get_stats();
+    BOOST_CHECK_EQUAL(stats.hits, 0);
+    BOOST_CHECK_EQUAL(stats.free, 2);
+    BOOST_CHECK_EQUAL(stats.free_high_water, 2);
+
+    auto small = pool->allocate(100, nullptr);
+    auto ptr1 = pool->allocate(1500, nullptr);
+    auto ptr2 = pool->allocate(1500, nullptr);
+    auto ptr3 = pool->allocate(1500, nullptr);
+    stats = pool->get_stats();
+    BOOST_CHECK_EQUAL(stats.hits, 2);
+    BOOST_CHECK_EQUAL(stats.misses, 1);
+    BOOST_CHECK_EQUAL(stats.empty, 1);
+    BOOST_CHECK_EQUAL(stats.refills, 0);
+    BOOST_CHECK_EQUAL(stats.refill_time_ns, 0);
+    BOOST_CHECK_EQUAL(stats.free, 0);
+    BOOST_CHECK_EQUAL(stats.bytes_outstanding, 3 * 2048);
+
+    ptr1.reset();
+    ptr2.reset();
+    ptr3.reset();
+    stats = pool->get_stats();
+    BOOST_CHECK_EQUAL(stats.bytes_outstanding, 0);
+    BOOST_CHECK_GE(stats.free, 3);
+    BOOST_CHECK_LE(stats.free, 4);
+    BOOST_CHECK_GE(stats.free_high_water, stats.free);
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // memory_pool
 BOOST_AUTO_TEST_SUITE_END()  // common
 
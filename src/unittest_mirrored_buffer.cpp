@@ -0,0 +1,65 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for common_mirrored_buffer.
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_MEMFD
+
+#include <cstring>
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_mirrored_buffer.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(mirrored_buffer)
+
+BOOST_AUTO_TEST_CASE(round_up)
+{
+    std::size_t page_size = sysconf(_SC_PAGESIZE);
+    spead2::mirrored_buffer buffer(page_size + 1);
+    BOOST_CHECK_EQUAL(buffer.size(), 2 * page_size);
+}
+
+BOOST_AUTO_TEST_CASE(mirror)
+{
+    spead2::mirrored_buffer buffer(1);
+    std::uint8_t *data = buffer.data();
+    std::size_t size = buffer.size();
+    // A write that wraps around the end is visible at the start
+    std::memcpy(data + size - 2, "abcd", 4);
+    BOOST_CHECK_EQUAL(data[0], 'c');
+    BOOST_CHECK_EQUAL(data[1], 'd');
+    // Writes to the first copy are visible in the second
+    data[5] = 'x';
+    BOOST_CHECK_EQUAL(data[size + 5], 'x');
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // mirrored_buffer
+BOOST_AUTO_TEST_SUITE_END()  // common
+
+}} // namespace spead2::unittest
+
+#endif // SPEAD2_USE_MEMFD
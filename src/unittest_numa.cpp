@@ -0,0 +1,101 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for common_numa and the NUMA-aware thread pool.
+ */
+
+#include <future>
+#include <stdexcept>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_numa.h>
+#include <spead2/common_thread_pool.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(numa)
+
+BOOST_AUTO_TEST_CASE(parse_id_list)
+{
+    using spead2::detail::parse_id_list;
+    BOOST_CHECK(parse_id_list("") == std::vector<int>());
+    BOOST_CHECK(parse_id_list("\n") == std::vector<int>());
+    BOOST_CHECK(parse_id_list("3\n") == std::vector<int>{3});
+    BOOST_CHECK((parse_id_list("0-3,8,10-11") == std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    BOOST_CHECK((parse_id_list("8,0-1,1") == std::vector<int>{0, 1, 8}));
+    BOOST_CHECK_THROW(parse_id_list("3-1"), std::invalid_argument);
+    BOOST_CHECK_THROW(parse_id_list("1,"), std::invalid_argument);
+    BOOST_CHECK_THROW(parse_id_list(",1"), std::invalid_argument);
+    BOOST_CHECK_THROW(parse_id_list("1-"), std::invalid_argument);
+    BOOST_CHECK_THROW(parse_id_list("a"), std::invalid_argument);
+    BOOST_CHECK_THROW(parse_id_list("99999999999"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(topology)
+{
+    const std::vector<int> &nodes = spead2::numa_nodes();
+    BOOST_REQUIRE(!nodes.empty());
+    for (int node : nodes)
+    {
+        for (int cpu : spead2::numa_node_cpus(node))
+            BOOST_CHECK_EQUAL(spead2::numa_cpu_node(cpu), node);
+    }
+    BOOST_CHECK_EQUAL(spead2::numa_cpu_node(-1), -1);
+    BOOST_CHECK_THROW(spead2::numa_node_cpus(-1), std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::numa_node_cpus(nodes.back() + 1), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(allocator_bad_node)
+{
+    BOOST_CHECK_THROW(spead2::numa_allocator(-1), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(allocator_strict)
+{
+    auto allocator = std::make_shared<spead2::numa_allocator>(spead2::numa_nodes()[0], true);
+    auto ptr = allocator->allocate(3 * 4096 + 1, nullptr);
+    for (std::size_t i = 0; i < 3 * 4096 + 1; i++)
+        ptr[i] = 1;
+}
+
+BOOST_AUTO_TEST_CASE(thread_pool_nodes)
+{
+    std::vector<int> nodes = spead2::numa_nodes();
+    spead2::thread_pool pool(3, spead2::thread_pool::numa_nodes_tag(), nodes);
+    std::promise<int> promise;
+    pool.get_io_service().post([&promise] { promise.set_value(1); });
+    BOOST_CHECK_EQUAL(promise.get_future().get(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(thread_pool_bad_nodes)
+{
+    using spead2::thread_pool;
+    BOOST_CHECK_THROW(thread_pool(1, thread_pool::numa_nodes_tag(), {}), std::invalid_argument);
+    BOOST_CHECK_THROW(thread_pool(1, thread_pool::numa_nodes_tag(), {-1}), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // numa
+BOOST_AUTO_TEST_SUITE_END()  // common
+
+}} // namespace spead2::unittest
@@ -236,6 +236,13 @@ BOOST_AUTO_TEST_CASE(udp_from_ethernet_fragmented)
     BOOST_CHECK_THROW(spead2::udp_from_ethernet(data.data(), data.size()), packet_type_error);
 }
 
+BOOST_AUTO_TEST_CASE(udp_from_ipv4)
+{
+    boost::asio::mutable_buffer payload = spead2::udp_from_ipv4(
+        data.data() + ethernet_frame::min_size, data.size() - ethernet_frame::min_size);
+    BOOST_CHECK_EQUAL(buffer_to_string(payload), sample_payload);
+}
+
 // Build a packet from scratch and check that it matches the sample packet
 BOOST_AUTO_TEST_CASE(build)
 {
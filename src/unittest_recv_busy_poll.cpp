@@ -0,0 +1,167 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for busy-polling mode of the readers.
+ */
+
+#include <memory>
+#include <chrono>
+#include <stdexcept>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_thread_pool.h>
+#include <spead2/common_inproc.h>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/recv_busy_poll.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_inproc.h>
+#include <spead2/recv_udp.h>
+#include <spead2/recv_tcp.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_stream.h>
+#include <spead2/send_inproc.h>
+#include <spead2/send_udp.h>
+#include <spead2/send_tcp.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(busy_poll)
+
+static constexpr int n_heaps = 10;
+
+// Use a short sleep so that tests exercise both spinning and sleeping
+static spead2::recv::busy_poll_config test_config()
+{
+    return spead2::recv::busy_poll_config()
+        .set_spin_count(100)
+        .set_sleep(std::chrono::microseconds(10));
+}
+
+static void send_heaps(spead2::send::stream &sender, bool end)
+{
+    auto handler = [](const boost::system::error_code &, item_pointer_t) {};
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap h;
+        h.add_item(0x1000, i);
+        sender.async_send_heap(h, handler);
+        sender.flush();
+    }
+    if (end)
+    {
+        spead2::send::heap h;
+        h.add_end();
+        sender.async_send_heap(h, handler);
+        sender.flush();
+    }
+}
+
+static void check_heaps(spead2::recv::ring_stream<> &stream)
+{
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::recv::heap h = stream.pop();
+        BOOST_REQUIRE_EQUAL(h.get_items().size(), 1);
+        BOOST_CHECK_EQUAL(h.get_items()[0].immediate_value, i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(config_validation)
+{
+    spead2::recv::busy_poll_config config;
+    BOOST_CHECK_THROW(config.set_busy_poll(-1), std::invalid_argument);
+    BOOST_CHECK_THROW(config.set_sleep(std::chrono::microseconds(-1)), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(inproc)
+{
+    spead2::thread_pool tp;
+    auto queue = std::make_shared<spead2::inproc_queue>();
+    spead2::recv::ring_stream<> stream(tp);
+    stream.emplace_reader<spead2::recv::inproc_reader>(queue, test_config());
+    spead2::send::inproc_stream sender(tp, {queue});
+    send_heaps(sender, false);
+    queue->stop();
+    check_heaps(stream);
+    BOOST_CHECK_THROW(stream.pop(), spead2::ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_CASE(udp)
+{
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(tp);
+    boost::asio::ip::udp::socket socket(
+        tp.get_io_service(),
+        boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    auto endpoint = socket.local_endpoint();
+    stream.emplace_reader<spead2::recv::udp_reader>(
+        std::move(socket), spead2::recv::udp_reader::default_max_size, test_config());
+    spead2::send::udp_stream sender(tp, {endpoint});
+    send_heaps(sender, true);
+    check_heaps(stream);
+    BOOST_CHECK_THROW(stream.pop(), spead2::ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_CASE(tcp)
+{
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(tp);
+    boost::asio::ip::tcp::acceptor acceptor(
+        tp.get_io_service(),
+        boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    auto endpoint = acceptor.local_endpoint();
+    // Use a small receive buffer, so that it wraps around
+    stream.emplace_reader<spead2::recv::tcp_reader>(
+        std::move(acceptor), spead2::recv::tcp_reader::default_max_size, test_config(),
+        2 * spead2::recv::tcp_reader::default_max_size);
+    {
+        boost::system::error_code connect_error;
+        spead2::send::tcp_stream sender(
+            tp, [&](const boost::system::error_code &ec) { connect_error = ec; },
+            {endpoint});
+        send_heaps(sender, false);
+        BOOST_CHECK(!connect_error);
+    }
+    // Closing the connection ends the stream
+    check_heaps(stream);
+    BOOST_CHECK_THROW(stream.pop(), spead2::ringbuffer_stopped);
+}
+
+// Stopping the stream must stop an idle polling thread
+BOOST_AUTO_TEST_CASE(stop_idle)
+{
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(tp);
+    stream.emplace_reader<spead2::recv::udp_reader>(
+        boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0),
+        spead2::recv::udp_reader::default_max_size,
+        spead2::recv::udp_reader::default_buffer_size,
+        test_config());
+    stream.stop();
+    BOOST_CHECK_THROW(stream.pop(), spead2::ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // busy_poll
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+}} // namespace spead2::unittest
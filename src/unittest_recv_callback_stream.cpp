@@ -0,0 +1,222 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for recv_callback_stream.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_inproc.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_callback_stream.h>
+#include <spead2/recv_heap.h>
+#include <spead2/recv_inproc.h>
+#include <spead2/recv_live_heap.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_inproc.h>
+#include <spead2/send_stream.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(callback_stream)
+
+static constexpr int n_heaps = 10;
+
+/* Send heaps with a single immediate item 0x1000 with values 0, 1, ...,
+ * followed by an end-of-stream heap.
+ */
+static void send_heaps(thread_pool &tp, std::shared_ptr<inproc_queue> queue)
+{
+    spead2::send::inproc_stream send_stream(
+        tp, {queue}, spead2::send::stream_config().set_max_heaps(n_heaps + 1));
+    flavour f(4, 64, 48);
+    std::vector<spead2::send::heap> heaps;
+    for (int i = 0; i < n_heaps; i++)
+    {
+        heaps.emplace_back(f);
+        heaps.back().add_item(0x1000, i);
+    }
+    heaps.emplace_back(f);
+    heaps.back().add_end();
+    for (const auto &h : heaps)
+        send_stream.async_send_heap(
+            h, [](const boost::system::error_code &, item_pointer_t) {});
+    send_stream.flush();
+}
+
+// Get the value of item 0x1000 from a heap
+static item_pointer_t get_value(const spead2::recv::heap &h)
+{
+    for (const auto &item : h.get_items())
+        if (item.id == 0x1000)
+            return item.immediate_value;
+    BOOST_FAIL("item 0x1000 not found");
+    return 0;
+}
+
+BOOST_AUTO_TEST_CASE(heap_callback)
+{
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    std::vector<item_pointer_t> values;
+    std::promise<void> done;
+    spead2::recv::callback_stream recv_stream(
+        tp, spead2::recv::stream_config(),
+        spead2::recv::callback_stream_config().set_heap_callback(
+            [&](spead2::recv::heap &&h, std::uint64_t *)
+            {
+                values.push_back(get_value(h));
+                if (values.size() == n_heaps)
+                    done.set_value();
+            }));
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue);
+    send_heaps(tp, queue);
+    BOOST_REQUIRE(done.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    recv_stream.stop();
+
+    std::vector<item_pointer_t> expected;
+    for (int i = 0; i < n_heaps; i++)
+        expected.push_back(i);
+    BOOST_TEST(values == expected);
+}
+
+BOOST_AUTO_TEST_CASE(live_heap_callback)
+{
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    std::vector<item_pointer_t> values;
+    std::promise<void> done;
+    spead2::recv::callback_stream recv_stream(
+        tp, spead2::recv::stream_config(),
+        spead2::recv::callback_stream_config().set_live_heap_callback(
+            [&](spead2::recv::live_heap &&lh, std::uint64_t *)
+            {
+                BOOST_CHECK(lh.is_complete());
+                values.push_back(get_value(spead2::recv::heap(std::move(lh))));
+                if (values.size() == n_heaps)
+                    done.set_value();
+            }));
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue);
+    send_heaps(tp, queue);
+    BOOST_REQUIRE(done.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    recv_stream.stop();
+    BOOST_CHECK_EQUAL(values.size(), n_heaps);
+}
+
+BOOST_AUTO_TEST_CASE(batch_callback)
+{
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    std::vector<item_pointer_t> values;
+    std::size_t n_batches = 0;
+    std::promise<void> done;
+    spead2::recv::callback_stream recv_stream(
+        tp, spead2::recv::stream_config(),
+        spead2::recv::callback_stream_config().set_batch_callback(
+            [&](std::vector<spead2::recv::live_heap> &heaps, std::uint64_t *)
+            {
+                BOOST_CHECK(!heaps.empty());
+                n_batches++;
+                for (auto &lh : heaps)
+                    values.push_back(get_value(spead2::recv::heap(std::move(lh))));
+                if (values.size() == n_heaps)
+                    done.set_value();
+            }));
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue);
+    send_heaps(tp, queue);
+    BOOST_REQUIRE(done.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    recv_stream.stop();
+
+    std::vector<item_pointer_t> expected;
+    for (int i = 0; i < n_heaps; i++)
+        expected.push_back(i);
+    BOOST_TEST(values == expected);
+    BOOST_CHECK_GE(n_batches, 1);
+    BOOST_CHECK_LE(n_batches, recv_stream.get_stats().batches);
+}
+
+BOOST_AUTO_TEST_CASE(batch_callback_throws)
+{
+    // Exceptions from the callback are logged, and each heap is seen only once
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    std::vector<item_pointer_t> values;
+    std::promise<void> done;
+    spead2::recv::callback_stream recv_stream(
+        tp, spead2::recv::stream_config(),
+        spead2::recv::callback_stream_config().set_batch_callback(
+            [&](std::vector<spead2::recv::live_heap> &heaps, std::uint64_t *)
+            {
+                for (auto &lh : heaps)
+                    values.push_back(get_value(spead2::recv::heap(std::move(lh))));
+                if (values.size() == n_heaps)
+                    done.set_value();
+                throw std::runtime_error("test exception");
+            }));
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue);
+    send_heaps(tp, queue);
+    BOOST_REQUIRE(done.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    recv_stream.stop();
+
+    std::vector<item_pointer_t> expected;
+    for (int i = 0; i < n_heaps; i++)
+        expected.push_back(i);
+    BOOST_TEST(values == expected);
+}
+
+BOOST_AUTO_TEST_CASE(bad_config)
+{
+    thread_pool tp;
+    auto live_heap_callback = [](spead2::recv::live_heap &&, std::uint64_t *) {};
+    auto heap_callback = [](spead2::recv::heap &&, std::uint64_t *) {};
+    BOOST_CHECK_THROW(
+        spead2::recv::callback_stream(
+            tp, spead2::recv::stream_config(), spead2::recv::callback_stream_config()),
+        std::invalid_argument);
+    BOOST_CHECK_THROW(
+        spead2::recv::callback_stream(
+            tp, spead2::recv::stream_config(),
+            spead2::recv::callback_stream_config()
+                .set_live_heap_callback(live_heap_callback)
+                .set_heap_callback(heap_callback)),
+        std::invalid_argument);
+    BOOST_CHECK_THROW(
+        spead2::recv::callback_stream(
+            tp, spead2::recv::stream_config(),
+            spead2::recv::callback_stream_config()
+                .set_heap_callback(heap_callback)
+                .set_contiguous_only(false)),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // callback_stream
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+}} // namespace spead2::unittest
@@ -0,0 +1,177 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for recv_file.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_file.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/send_streambuf.h>
+#include "unittest_temp_file.h"
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(file)
+
+namespace
+{
+
+/// Temporary file containing heaps of various sizes, removed on destruction
+class heap_file : public temp_file
+{
+public:
+    static constexpr int n_heaps = 30;
+
+    std::vector<std::uint8_t> payload;
+
+    explicit heap_file(std::size_t truncate_bytes = 0) : payload(20000)
+    {
+        for (std::size_t i = 0; i < payload.size(); i++)
+            payload[i] = std::uint8_t(i);
+
+        std::filebuf fb;
+        fb.open(name, std::ios::out | std::ios::binary | std::ios::trunc);
+        {
+            spead2::thread_pool tp;
+            spead2::send::streambuf_stream stream(
+                tp, fb, spead2::send::stream_config().set_max_packet_size(9000));
+            for (int i = 0; i < n_heaps; i++)
+            {
+                spead2::send::heap h;
+                h.add_item(0x1000, payload.data(), length(i), false);
+                stream.async_send_heap(h, [](const boost::system::error_code &, spead2::item_pointer_t) {});
+                stream.flush();
+            }
+        }
+        fb.close();
+        if (truncate_bytes > 0)
+        {
+            std::ifstream in(name, std::ios::binary | std::ios::ate);
+            std::size_t size = in.tellg();
+            if (truncate(name.c_str(), size - truncate_bytes) != 0)
+                throw std::system_error(errno, std::system_category(), "truncate failed");
+        }
+    }
+
+    /// Payload length of heap @a i (the even heaps fit in a single packet)
+    static std::size_t length(int i)
+    {
+        return (i % 2 == 0) ? 1000 + i : 15000 + i;
+    }
+
+    /// Check heap @a i, returning its payload pointer
+    const std::uint8_t *check_heap(spead2::recv::heap &h, int i) const
+    {
+        BOOST_CHECK_EQUAL(h.get_cnt(), i + 1);
+        BOOST_REQUIRE_EQUAL(h.get_items().size(), 1);
+        const auto &item = h.get_items()[0];
+        BOOST_REQUIRE_EQUAL(item.length, length(i));
+        BOOST_CHECK(std::equal(item.ptr, item.ptr + item.length, payload.begin()));
+        return item.ptr;
+    }
+};
+
+constexpr int heap_file::n_heaps;
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(read)
+{
+    heap_file file;
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(tp);
+    stream.emplace_reader<spead2::recv::file_reader>(file.name);
+    for (int i = 0; i < heap_file::n_heaps; i++)
+    {
+        spead2::recv::heap h = stream.pop();
+        file.check_heap(h, i);
+    }
+    BOOST_CHECK_THROW(stream.pop(), spead2::ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_CASE(zero_copy)
+{
+    heap_file file;
+    auto mapping = std::make_shared<spead2::recv::file_mapping>(file.name);
+    spead2::recv::stream_config config;
+    spead2::recv::file_mapping_zero_copy(config, mapping);
+    spead2::thread_pool tp;
+    std::vector<spead2::recv::heap> heaps;
+    {
+        spead2::recv::ring_stream<> stream(tp, config);
+        stream.emplace_reader<spead2::recv::file_reader>(mapping);
+        for (int i = 0; i < heap_file::n_heaps; i++)
+            heaps.push_back(stream.pop());
+    }
+    // Check the heaps after the stream and our reference are gone
+    auto *data = mapping->get_data();
+    std::size_t size = mapping->get_size();
+    mapping.reset();
+    for (int i = 0; i < heap_file::n_heaps; i++)
+    {
+        const std::uint8_t *ptr = file.check_heap(heaps[i], i);
+        bool in_mapping = ptr >= data && ptr < data + size;
+        BOOST_CHECK_EQUAL(in_mapping, i % 2 == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(truncated)
+{
+    heap_file file(10);
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(tp);
+    stream.emplace_reader<spead2::recv::file_reader>(file.name);
+    for (int i = 0; i < heap_file::n_heaps - 1; i++)
+    {
+        spead2::recv::heap h = stream.pop();
+        file.check_heap(h, i);
+    }
+    // The last heap is incomplete
+    BOOST_CHECK_THROW(stream.pop(), spead2::ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_CASE(missing)
+{
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(tp);
+    BOOST_CHECK_THROW(
+        stream.emplace_reader<spead2::recv::file_reader>("/nonexistent/spead2_unittest"),
+        std::system_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // file
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+}} // namespace spead2::unittest
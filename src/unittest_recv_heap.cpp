@@ -0,0 +1,140 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for recv_heap.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <spead2/common_endian.h>
+#include <spead2/common_memory_allocator.h>
+#include <spead2/recv_heap.h>
+#include <spead2/recv_live_heap.h>
+#include <spead2/recv_packet.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(heap)
+
+/* Build a heap from a single packet with no payload and immediate items
+ * with IDs 0x1000, 0x1001, ... and values 0, 1000, 2000, ...
+ */
+static spead2::recv::heap make_heap(s_item_pointer_t heap_cnt, int n_items)
+{
+    std::vector<item_pointer_t> pointers;
+    for (int i = 0; i < n_items; i++)
+    {
+        item_pointer_t pointer =
+            immediate_mask | (item_pointer_t(0x1000 + i) << 48) | item_pointer_t(i * 1000);
+        pointers.push_back(htobe(pointer));
+    }
+    spead2::recv::packet_header header;
+    header.heap_address_bits = 48;
+    header.n_items = n_items;
+    header.heap_cnt = heap_cnt;
+    header.heap_length = 0;
+    header.payload_offset = 0;
+    header.payload_length = 0;
+    header.pointers = reinterpret_cast<const std::uint8_t *>(pointers.data());
+    header.payload = nullptr;
+    header.packet = nullptr;
+
+    memory_allocator allocator;
+    spead2::recv::live_heap live(header, 0);
+    bool added = live.add_packet(
+        header,
+        [](const memory_allocator::pointer &, const spead2::recv::packet_header &) {},
+        allocator, true);
+    BOOST_REQUIRE(added);
+    return spead2::recv::heap(std::move(live));
+}
+
+static void check_items(const spead2::recv::heap &h, std::size_t n_items)
+{
+    const auto &items = h.get_items();
+    BOOST_REQUIRE_EQUAL(items.size(), n_items);
+    for (std::size_t i = 0; i < n_items; i++)
+    {
+        BOOST_TEST_CONTEXT("item " << i)
+        {
+            BOOST_CHECK_EQUAL(items[i].id, 0x1000 + i);
+            BOOST_CHECK(items[i].is_immediate);
+            BOOST_CHECK_EQUAL(items[i].immediate_value, i * 1000);
+            BOOST_REQUIRE_EQUAL(items[i].length, 6);
+            // The raw value is the 48-bit immediate in big endian
+            std::uint64_t raw = 0;
+            for (int j = 0; j < 6; j++)
+                raw = (raw << 8) | items[i].ptr[j];
+            BOOST_CHECK_EQUAL(raw, i * 1000);
+        }
+    }
+}
+
+// Few enough immediates to be held inside the heap object
+BOOST_AUTO_TEST_CASE(inline_immediates)
+{
+    spead2::recv::heap h = make_heap(1, 2);
+    check_items(h, 2);
+    spead2::recv::heap h2(std::move(h));
+    check_items(h2, 2);
+    h = make_heap(2, 3);
+    h2 = std::move(h);
+    check_items(h2, 3);
+}
+
+// Too many immediates to hold inside the heap object
+BOOST_AUTO_TEST_CASE(external_immediates)
+{
+    spead2::recv::heap h = make_heap(1, 20);
+    check_items(h, 20);
+    spead2::recv::heap h2(std::move(h));
+    check_items(h2, 20);
+    h = make_heap(2, 30);
+    h2 = std::move(h);
+    check_items(h2, 30);
+}
+
+// Storage of a destroyed heap is reused by the next heap
+BOOST_AUTO_TEST_CASE(reuse_storage)
+{
+    const spead2::recv::item *items;
+    const std::uint8_t *immediates;
+    {
+        spead2::recv::heap h = make_heap(1, 20);
+        items = h.get_items().data();
+        immediates = h.get_items()[0].ptr;
+    }
+    spead2::recv::heap h = make_heap(2, 10);
+    check_items(h, 10);
+    BOOST_CHECK_EQUAL(h.get_items().data(), items);
+    BOOST_CHECK_EQUAL(static_cast<const void *>(h.get_items()[0].ptr),
+                      static_cast<const void *>(immediates));
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // heap
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+}} // namespace spead2::unittest
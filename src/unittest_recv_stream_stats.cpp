@@ -27,6 +27,7 @@
 #include <utility>
 #include <boost/test/unit_test.hpp>
 #include <spead2/recv_stream.h>
+#include <spead2/common_memory_pool.h>
 
 namespace spead2
 {
@@ -209,6 +210,30 @@ BOOST_AUTO_TEST_CASE(test_move_assign)
     BOOST_TEST(&stats2.packets == &stats2["packets"]);
 }
 
+BOOST_AUTO_TEST_CASE(test_memory_pool_stats)
+{
+    auto pool = std::make_shared<spead2::memory_pool>(1024, 2048, 4, 2);
+    spead2::recv::stream_config config;
+    config.set_memory_allocator(pool);
+    config.add_memory_pool_stats();
+    BOOST_CHECK_THROW(config.add_memory_pool_stats(), std::invalid_argument);
+    spead2::recv::stream_base stream(config);
+
+    auto ptr = pool->allocate(1500, nullptr);
+    spead2::recv::stream_stats stats = stream.get_stats();
+    BOOST_TEST(stats["memory_pool_hits"] == 1);
+    BOOST_TEST(stats["memory_pool_free"] == 1);
+    BOOST_TEST(stats["memory_pool_free_high_water"] == 2);
+    BOOST_TEST(stats["memory_pool_bytes_outstanding"] == 2048);
+    BOOST_TEST(stats["heaps"] == 0);
+
+    // Levels are merged with the maximum rather than summed
+    spead2::recv::stream_stats merged = stats + stats;
+    BOOST_TEST(merged["memory_pool_hits"] == 2);
+    BOOST_TEST(merged["memory_pool_free"] == 1);
+    BOOST_TEST(merged["memory_pool_bytes_outstanding"] == 2048);
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // stream_stats
 BOOST_AUTO_TEST_SUITE_END()  // recv
 
@@ -0,0 +1,219 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for recv_tcp. This is just a targeted test for features that
+ * aren't tested by the Python unit tests.
+ */
+
+#include <memory>
+#include <vector>
+#include <set>
+#include <string>
+#include <future>
+#include <exception>
+#include <stdexcept>
+#include <boost/asio.hpp>
+#include <boost/system/system_error.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_tcp.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_tcp.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(tcp)
+
+static constexpr int n_heaps = 10;
+
+static boost::asio::ip::tcp::endpoint loopback_endpoint()
+{
+    return boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0);
+}
+
+static std::unique_ptr<spead2::send::tcp_stream> make_sender(
+    spead2::thread_pool &tp, const boost::asio::ip::tcp::endpoint &endpoint)
+{
+    std::promise<void> connected;
+    std::unique_ptr<spead2::send::tcp_stream> sender(new spead2::send::tcp_stream(
+        tp, [&](const boost::system::error_code &ec)
+        {
+            if (ec)
+                connected.set_exception(std::make_exception_ptr(boost::system::system_error(ec)));
+            else
+                connected.set_value();
+        },
+        {endpoint}));
+    connected.get_future().get();
+    return sender;
+}
+
+static void send_heaps(spead2::send::stream &sender)
+{
+    auto handler = [](const boost::system::error_code &, item_pointer_t) {};
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap h;
+        h.add_item(0x1000, i);
+        sender.async_send_heap(h, handler);
+        sender.flush();
+    }
+}
+
+// Packets wrap around a receive buffer that is barely larger than two packets
+BOOST_AUTO_TEST_CASE(small_ring)
+{
+    constexpr std::size_t payload_size = 1000;
+    constexpr std::size_t max_size = 1500;
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(
+        tp, spead2::recv::stream_config(),
+        spead2::recv::ring_stream_config().set_heaps(n_heaps));
+    boost::asio::ip::tcp::acceptor acceptor(tp.get_io_service(), loopback_endpoint());
+    auto endpoint = acceptor.local_endpoint();
+    stream.emplace_reader<spead2::recv::tcp_reader>(std::move(acceptor), max_size, 2 * max_size);
+
+    std::vector<std::uint8_t> payload(payload_size);
+    auto sender = make_sender(tp, endpoint);
+    auto handler = [](const boost::system::error_code &, item_pointer_t) {};
+    for (int i = 0; i < n_heaps; i++)
+    {
+        for (std::size_t j = 0; j < payload_size; j++)
+            payload[j] = std::uint8_t(i + j);
+        spead2::send::heap h;
+        h.add_item(0x1000, payload.data(), payload.size(), false);
+        sender->async_send_heap(h, handler);
+        sender->flush();
+    }
+    sender.reset();
+
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::recv::heap h = stream.pop();
+        BOOST_REQUIRE_EQUAL(h.get_items().size(), 1);
+        const auto &item = h.get_items()[0];
+        BOOST_REQUIRE_EQUAL(item.length, payload_size);
+        for (std::size_t j = 0; j < payload_size; j++)
+            BOOST_REQUIRE_EQUAL(item.ptr[j], std::uint8_t(i + j));
+    }
+    BOOST_CHECK_THROW(stream.pop(), spead2::ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_CASE(multi_connection_stats_validation)
+{
+    spead2::thread_pool tp;
+    spead2::recv::stream_config config;
+    std::size_t index = config.add_stat("conn0");
+    spead2::recv::ring_stream<> stream(tp, config);
+    // No limit on connections
+    BOOST_CHECK_THROW(
+        stream.emplace_reader<spead2::recv::tcp_multi_reader>(
+            loopback_endpoint(),
+            spead2::recv::tcp_multi_config().set_connection_stats(index)),
+        std::invalid_argument);
+    // Not enough statistics for the connections
+    BOOST_CHECK_THROW(
+        stream.emplace_reader<spead2::recv::tcp_multi_reader>(
+            loopback_endpoint(),
+            spead2::recv::tcp_multi_config().set_max_connections(2).set_connection_stats(index)),
+        std::invalid_argument);
+}
+
+// Several senders feed one stream, and the stream outlives their connections
+BOOST_AUTO_TEST_CASE(multi)
+{
+    constexpr int n_senders = 3;
+    spead2::thread_pool tp(2);
+    spead2::recv::stream_config config;
+    std::size_t index = config.next_stat_index();
+    for (int i = 0; i < n_senders; i++)
+        config.add_stat("conn" + std::to_string(i));
+    spead2::recv::ring_stream<> stream(
+        tp, config, spead2::recv::ring_stream_config().set_heaps(n_senders * n_heaps));
+    boost::asio::ip::tcp::acceptor acceptor(tp.get_io_service(), loopback_endpoint());
+    auto endpoint = acceptor.local_endpoint();
+    stream.emplace_reader<spead2::recv::tcp_multi_reader>(
+        std::move(acceptor),
+        spead2::recv::tcp_multi_config()
+            .set_max_connections(n_senders)
+            .set_connection_stats(index));
+
+    std::vector<std::unique_ptr<spead2::send::tcp_stream>> senders;
+    for (int i = 0; i < n_senders; i++)
+    {
+        senders.push_back(make_sender(tp, endpoint));
+        senders.back()->set_cnt_sequence(i + 1, n_senders);
+    }
+    for (const auto &sender : senders)
+        send_heaps(*sender);
+
+    std::set<s_item_pointer_t> cnts;
+    for (int i = 0; i < n_senders * n_heaps; i++)
+    {
+        spead2::recv::heap h = stream.pop();
+        cnts.insert(h.get_cnt());
+    }
+    // Only close the connections once all have been accepted, so that no slot is reused
+    senders.clear();
+    BOOST_CHECK_EQUAL(cnts.size(), n_senders * n_heaps);
+    BOOST_CHECK_EQUAL(*cnts.begin(), 1);
+    BOOST_CHECK_EQUAL(*cnts.rbegin(), n_senders * n_heaps);
+
+    // Closing the connections does not stop the stream
+    BOOST_CHECK_THROW(stream.try_pop(), spead2::ringbuffer_empty);
+    stream.stop();
+    BOOST_CHECK_THROW(stream.pop(), spead2::ringbuffer_stopped);
+    auto stats = stream.get_stats();
+    for (int i = 0; i < n_senders; i++)
+        BOOST_CHECK_EQUAL(stats[index + i], n_heaps);
+}
+
+BOOST_AUTO_TEST_CASE(multi_stop_on_eof)
+{
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(
+        tp, spead2::recv::stream_config(),
+        spead2::recv::ring_stream_config().set_heaps(n_heaps));
+    boost::asio::ip::tcp::acceptor acceptor(tp.get_io_service(), loopback_endpoint());
+    auto endpoint = acceptor.local_endpoint();
+    stream.emplace_reader<spead2::recv::tcp_multi_reader>(
+        std::move(acceptor), spead2::recv::tcp_multi_config().set_stop_on_eof(true));
+
+    auto sender = make_sender(tp, endpoint);
+    send_heaps(*sender);
+    sender.reset();
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::recv::heap h = stream.pop();
+        BOOST_REQUIRE_EQUAL(h.get_items().size(), 1);
+        BOOST_CHECK_EQUAL(h.get_items()[0].immediate_value, i);
+    }
+    BOOST_CHECK_THROW(stream.pop(), spead2::ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // tcp
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+}} // namespace spead2::unittest
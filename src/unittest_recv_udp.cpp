@@ -0,0 +1,193 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for recv_udp. This is just a targeted test for features that
+ * aren't tested by the Python unit tests.
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_RECVMMSG
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_defines.h>
+#include <spead2/common_memory_allocator.h>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_chunk_stream.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_udp.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_udp.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(udp)
+
+static constexpr std::size_t heap_payload_size = 1024;
+
+static boost::asio::ip::udp::socket make_timestamp_socket(boost::asio::io_service &io_service)
+{
+    boost::asio::ip::udp::socket socket(
+        io_service,
+        boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    spead2::recv::udp_reader::enable_timestamps(socket);
+    return socket;
+}
+
+// Sends heaps that are split over several packets, followed by end-of-stream.
+// The sender has its own thread pool so that it cannot be blocked by a
+// receiver that is waiting for ringbuffer space.
+static void send_heaps(const boost::asio::ip::udp::endpoint &endpoint, int n_heaps)
+{
+    spead2::thread_pool tp;
+    std::vector<std::uint8_t> payload(heap_payload_size);
+    spead2::send::udp_stream sender(
+        tp, {endpoint},
+        spead2::send::stream_config().set_max_packet_size(256));
+    auto handler = [](const boost::system::error_code &, item_pointer_t) {};
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap h;
+        h.add_item(0x1000, payload.data(), payload.size(), false);
+        sender.async_send_heap(h, handler);
+        sender.flush();
+    }
+    spead2::send::heap end;
+    end.add_end();
+    sender.async_send_heap(end, handler);
+    sender.flush();
+}
+
+static bool plausible(std::chrono::system_clock::time_point timestamp)
+{
+    auto now = std::chrono::system_clock::now();
+    return timestamp > now - std::chrono::minutes(1) && timestamp <= now;
+}
+
+BOOST_AUTO_TEST_CASE(heap_timestamps)
+{
+    constexpr int n_heaps = 5;
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(tp);
+    auto socket = make_timestamp_socket(tp.get_io_service());
+    auto endpoint = socket.local_endpoint();
+    stream.emplace_reader<spead2::recv::udp_reader>(std::move(socket));
+    send_heaps(endpoint, n_heaps);
+
+    std::uint64_t total_ns = 0;
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::recv::heap h = stream.pop();
+        BOOST_CHECK(plausible(h.get_first_timestamp()));
+        BOOST_CHECK(h.get_first_timestamp() <= h.get_last_timestamp());
+        total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            h.get_last_timestamp() - h.get_first_timestamp()).count();
+    }
+    BOOST_CHECK_THROW(stream.pop(), spead2::ringbuffer_stopped);
+    BOOST_CHECK_EQUAL(stream.get_stats()["reassembly_time_ns"], total_ns);
+}
+
+BOOST_AUTO_TEST_CASE(no_timestamps)
+{
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(tp);
+    boost::asio::ip::udp::socket socket(
+        tp.get_io_service(),
+        boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    auto endpoint = socket.local_endpoint();
+    stream.emplace_reader<spead2::recv::udp_reader>(std::move(socket));
+    send_heaps(endpoint, 1);
+
+    spead2::recv::heap h = stream.pop();
+    BOOST_CHECK(h.get_first_timestamp() == std::chrono::system_clock::time_point());
+    BOOST_CHECK(h.get_last_timestamp() == std::chrono::system_clock::time_point());
+    BOOST_CHECK_THROW(stream.pop(), spead2::ringbuffer_stopped);
+    BOOST_CHECK_EQUAL(stream.get_stats()["reassembly_time_ns"], 0);
+}
+
+BOOST_AUTO_TEST_CASE(chunk_timestamps)
+{
+    constexpr std::size_t heaps_per_chunk = 4;
+    constexpr std::size_t n_chunks = 2;
+    using data_ring_t = spead2::ringbuffer<std::unique_ptr<spead2::recv::chunk>>;
+
+    auto place = [](spead2::recv::chunk_place_data *data, std::size_t)
+    {
+        s_item_pointer_t idx = data->items[0] - 1;  // heap counters start at 1
+        if (idx >= s_item_pointer_t(heaps_per_chunk * n_chunks))
+            return;     // the end-of-stream heap, which must not evict a chunk
+        data->chunk_id = idx / heaps_per_chunk;
+        data->heap_index = idx % heaps_per_chunk;
+        data->heap_offset = data->heap_index * heap_payload_size;
+    };
+    spead2::recv::chunk_stream_config chunk_config;
+    chunk_config.set_items({HEAP_CNT_ID});
+    chunk_config.set_max_chunks(n_chunks);
+    chunk_config.set_place(place);
+
+    auto data_ring = std::make_shared<data_ring_t>(n_chunks);
+    auto free_ring = std::make_shared<data_ring_t>(n_chunks);
+    spead2::thread_pool tp;
+    spead2::recv::chunk_ring_stream<> stream(
+        tp, spead2::recv::stream_config(), chunk_config, data_ring, free_ring);
+    auto allocator = std::make_shared<spead2::memory_allocator>();
+    for (std::size_t i = 0; i < n_chunks; i++)
+    {
+        std::unique_ptr<spead2::recv::chunk> c(new spead2::recv::chunk);
+        c->present = allocator->allocate(heaps_per_chunk, nullptr);
+        c->present_size = heaps_per_chunk;
+        c->data = allocator->allocate(heaps_per_chunk * heap_payload_size, nullptr);
+        stream.add_free_chunk(std::move(c));
+    }
+
+    auto socket = make_timestamp_socket(tp.get_io_service());
+    auto endpoint = socket.local_endpoint();
+    stream.emplace_reader<spead2::recv::udp_reader>(std::move(socket));
+    send_heaps(endpoint, heaps_per_chunk * n_chunks);
+
+    std::chrono::system_clock::time_point prev_last;
+    for (std::size_t i = 0; i < n_chunks; i++)
+    {
+        std::unique_ptr<spead2::recv::chunk> c = data_ring->pop();
+        BOOST_CHECK_EQUAL(c->chunk_id, i);
+        for (std::size_t j = 0; j < heaps_per_chunk; j++)
+            BOOST_CHECK(c->present[j]);
+        BOOST_CHECK(plausible(c->first_timestamp));
+        BOOST_CHECK(c->first_timestamp <= c->last_timestamp);
+        BOOST_CHECK(prev_last <= c->first_timestamp);
+        prev_last = c->last_timestamp;
+    }
+    BOOST_CHECK_THROW(data_ring->pop(), spead2::ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // udp
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+}} // namespace spead2::unittest
+
+#endif // SPEAD2_USE_RECVMMSG
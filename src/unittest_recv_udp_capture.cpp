@@ -0,0 +1,394 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for recv_udp_capture.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_endian.h>
+#include <spead2/common_raw_packet.h>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_udp_capture.h>
+#include <spead2/send_streambuf.h>
+#include "unittest_temp_file.h"
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(udp_capture)
+
+namespace
+{
+
+const auto group = boost::asio::ip::address_v4::from_string("239.1.2.3");
+const auto other_group = boost::asio::ip::address_v4::from_string("239.1.2.4");
+
+/// Encode a single-packet heap with the given cnt
+std::string make_heap_packet(spead2::item_pointer_t cnt)
+{
+    spead2::thread_pool tp;
+    std::stringbuf sb;
+    spead2::send::streambuf_stream stream(tp, sb);
+    spead2::send::heap h;
+    h.add_item(0x1000, cnt);
+    stream.async_send_heap(
+        h, [](const boost::system::error_code &, spead2::item_pointer_t) {}, cnt);
+    stream.flush();
+    return sb.str();
+}
+
+/// Wrap a UDP payload in IPv4 (and optionally ethernet) headers
+std::string make_frame(const std::string &payload, const boost::asio::ip::address_v4 &address,
+                       std::uint16_t port, bool ethernet = true, std::uint8_t protocol = udp_packet::protocol)
+{
+    const std::size_t offset = ethernet ? ethernet_frame::min_size : 0;
+    std::vector<std::uint8_t> frame(offset + ipv4_packet::min_size + udp_packet::min_size + payload.size());
+    if (ethernet)
+    {
+        ethernet_frame eth(frame.data(), frame.size());
+        eth.destination_mac(multicast_mac(address));
+        eth.ethertype(ipv4_packet::ethertype);
+    }
+    ipv4_packet ipv4(frame.data() + offset, frame.size() - offset);
+    ipv4.version_ihl(0x45);
+    ipv4.total_length(frame.size() - offset);
+    ipv4.flags_frag_off(ipv4_packet::flag_do_not_fragment);
+    ipv4.ttl(1);
+    ipv4.protocol(protocol);
+    ipv4.source_address(boost::asio::ip::address_v4::from_string("10.0.0.1"));
+    ipv4.destination_address(address);
+    ipv4.update_checksum();
+    udp_packet udp = ipv4.payload_udp();
+    udp.source_port(1234);
+    udp.destination_port(port);
+    udp.length(udp_packet::min_size + payload.size());
+    std::memcpy(udp.payload().data(), payload.data(), payload.size());
+    return std::string(frame.begin(), frame.end());
+}
+
+/// Builds the contents of a capture file in memory, in either byte order
+class capture_builder
+{
+private:
+    bool big_endian;
+
+public:
+    std::string data;
+
+    explicit capture_builder(bool big_endian = false) : big_endian(big_endian) {}
+
+    template<typename T>
+    void put(T value)
+    {
+        value = big_endian ? htobe(value) : htole(value);
+        data.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void pad()
+    {
+        while (data.size() % 4 != 0)
+            data.push_back('\0');
+    }
+
+    void pcap_header(bool nanosecond, std::uint32_t linktype = 1)
+    {
+        put<std::uint32_t>(nanosecond ? 0xa1b23c4d : 0xa1b2c3d4);
+        put<std::uint16_t>(2);
+        put<std::uint16_t>(4);
+        put<std::uint32_t>(0);
+        put<std::uint32_t>(0);
+        put<std::uint32_t>(65536);
+        put<std::uint32_t>(linktype);
+    }
+
+    void pcap_record(std::uint32_t sec, std::uint32_t frac, const std::string &frame,
+                     std::uint32_t original_length = 0)
+    {
+        put<std::uint32_t>(sec);
+        put<std::uint32_t>(frac);
+        put<std::uint32_t>(frame.size());
+        put<std::uint32_t>(original_length ? original_length : frame.size());
+        data += frame;
+    }
+
+    void pcapng_section_header()
+    {
+        put<std::uint32_t>(0x0a0d0d0a);
+        put<std::uint32_t>(28);
+        put<std::uint32_t>(0x1a2b3c4d);
+        put<std::uint16_t>(1);
+        put<std::uint16_t>(0);
+        put<std::uint64_t>(std::uint64_t(-1));
+        put<std::uint32_t>(28);
+    }
+
+    // Interface with a timestamp resolution option
+    void pcapng_interface(std::uint16_t linktype, std::uint8_t tsresol)
+    {
+        put<std::uint32_t>(1);
+        put<std::uint32_t>(32);
+        put<std::uint16_t>(linktype);
+        put<std::uint16_t>(0);
+        put<std::uint32_t>(65536);
+        put<std::uint16_t>(9);     // if_tsresol
+        put<std::uint16_t>(1);
+        data.push_back(tsresol);
+        pad();
+        put<std::uint16_t>(0);     // opt_endofopt
+        put<std::uint16_t>(0);
+        put<std::uint32_t>(32);
+    }
+
+    void pcapng_enhanced_packet(std::uint32_t interface, std::uint64_t timestamp, const std::string &frame)
+    {
+        std::uint32_t length = 32 + (frame.size() + 3) / 4 * 4;
+        put<std::uint32_t>(6);
+        put<std::uint32_t>(length);
+        put<std::uint32_t>(interface);
+        put<std::uint32_t>(timestamp >> 32);
+        put<std::uint32_t>(timestamp);
+        put<std::uint32_t>(frame.size());
+        put<std::uint32_t>(frame.size());
+        data += frame;
+        pad();
+        put<std::uint32_t>(length);
+    }
+
+    void pcapng_simple_packet(const std::string &frame)
+    {
+        std::uint32_t length = 16 + (frame.size() + 3) / 4 * 4;
+        put<std::uint32_t>(3);
+        put<std::uint32_t>(length);
+        put<std::uint32_t>(frame.size());
+        data += frame;
+        pad();
+        put<std::uint32_t>(length);
+    }
+
+    // A block type that the reader should skip
+    void pcapng_unknown_block()
+    {
+        put<std::uint32_t>(0x0bad);
+        put<std::uint32_t>(16);
+        put<std::uint32_t>(0);
+        put<std::uint32_t>(16);
+    }
+};
+
+/// Read all heaps from the given files and return their cnts
+template<typename... Args>
+std::vector<spead2::item_pointer_t> read_cnts(Args&&... args)
+{
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(tp);
+    stream.emplace_reader<spead2::recv::udp_capture_reader>(std::forward<Args>(args)...);
+    std::vector<spead2::item_pointer_t> cnts;
+    while (true)
+    {
+        try
+        {
+            spead2::recv::heap h = stream.pop();
+            cnts.push_back(h.get_cnt());
+        }
+        catch (spead2::ringbuffer_stopped &)
+        {
+            break;
+        }
+    }
+    return cnts;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(pcap)
+{
+    for (bool big_endian : {false, true})
+        for (bool nanosecond : {false, true})
+        {
+            capture_builder builder(big_endian);
+            builder.pcap_header(nanosecond);
+            for (int i = 1; i <= 5; i++)
+                builder.pcap_record(1000 + i, 0, make_frame(make_heap_packet(i), group, 8888));
+            temp_file file(builder.data);
+            auto cnts = read_cnts(file.name);
+            std::vector<spead2::item_pointer_t> expected{1, 2, 3, 4, 5};
+            BOOST_CHECK_EQUAL_COLLECTIONS(cnts.begin(), cnts.end(), expected.begin(), expected.end());
+        }
+}
+
+// Packets that are not UDP, or that were truncated by the capture, are skipped
+BOOST_AUTO_TEST_CASE(skip)
+{
+    capture_builder builder;
+    builder.pcap_header(false);
+    builder.pcap_record(0, 0, make_frame(make_heap_packet(1), group, 8888));
+    builder.pcap_record(0, 1, make_frame(make_heap_packet(2), group, 8888, true, 1));
+    std::string frame = make_frame(make_heap_packet(3), group, 8888);
+    builder.pcap_record(0, 2, frame.substr(0, 40), frame.size());
+    builder.pcap_record(0, 3, make_frame(make_heap_packet(4), group, 8888));
+    temp_file file(builder.data);
+    auto cnts = read_cnts(file.name);
+    std::vector<spead2::item_pointer_t> expected{1, 4};
+    BOOST_CHECK_EQUAL_COLLECTIONS(cnts.begin(), cnts.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(raw_ipv4)
+{
+    capture_builder builder;
+    builder.pcap_header(false, 101);
+    builder.pcap_record(0, 0, make_frame(make_heap_packet(1), group, 8888, false));
+    builder.pcap_record(0, 1, make_frame(make_heap_packet(2), group, 8888, false));
+    temp_file file(builder.data);
+    auto cnts = read_cnts(file.name);
+    std::vector<spead2::item_pointer_t> expected{1, 2};
+    BOOST_CHECK_EQUAL_COLLECTIONS(cnts.begin(), cnts.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(pcapng)
+{
+    capture_builder builder;
+    builder.pcapng_section_header();
+    builder.pcapng_interface(1, 9);
+    builder.pcapng_unknown_block();
+    builder.pcapng_interface(101, 0x80 | 20);
+    builder.pcapng_enhanced_packet(0, 1, make_frame(make_heap_packet(1), group, 8888));
+    builder.pcapng_enhanced_packet(1, 2 << 20, make_frame(make_heap_packet(2), group, 8888, false));
+    builder.pcapng_simple_packet(make_frame(make_heap_packet(3), group, 8888));
+    // A second section restarts the interface numbering
+    builder.pcapng_section_header();
+    builder.pcapng_interface(101, 6);
+    builder.pcapng_enhanced_packet(0, 3000000, make_frame(make_heap_packet(4), group, 8888, false));
+    temp_file file(builder.data);
+    auto cnts = read_cnts(file.name);
+    std::vector<spead2::item_pointer_t> expected{1, 2, 3, 4};
+    BOOST_CHECK_EQUAL_COLLECTIONS(cnts.begin(), cnts.end(), expected.begin(), expected.end());
+}
+
+// Files are merged by timestamp, even if they use different formats
+BOOST_AUTO_TEST_CASE(merge)
+{
+    capture_builder a, b, c;
+    a.pcap_header(false);
+    b.pcap_header(true);
+    c.pcapng_section_header();
+    c.pcapng_interface(1, 6);
+    for (int i = 1; i <= 12; i++)
+    {
+        std::string frame = make_frame(make_heap_packet(i), group, 8888);
+        // Timestamps in microseconds; some are equal to check that ties go to the earlier file
+        std::uint32_t us = (i + 1) / 2 * 10;
+        switch (i % 3)
+        {
+        case 0:
+            a.pcap_record(100, us, frame);
+            break;
+        case 1:
+            b.pcap_record(100, us * 1000, frame);
+            break;
+        case 2:
+            c.pcapng_enhanced_packet(0, 100000000 + us, frame);
+            break;
+        }
+    }
+    temp_file fa(a.data), fb(b.data), fc(c.data);
+    auto cnts = read_cnts(std::vector<std::string>{fa.name, fb.name, fc.name});
+    std::vector<spead2::item_pointer_t> expected{1, 2, 3, 4, 6, 5, 7, 8, 9, 10, 12, 11};
+    BOOST_CHECK_EQUAL_COLLECTIONS(cnts.begin(), cnts.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(filter)
+{
+    capture_builder builder;
+    builder.pcap_header(false);
+    builder.pcap_record(0, 0, make_frame(make_heap_packet(1), group, 8888));
+    builder.pcap_record(0, 1, make_frame(make_heap_packet(2), group, 8889));
+    builder.pcap_record(0, 2, make_frame(make_heap_packet(3), other_group, 8888));
+    builder.pcap_record(0, 3, make_frame(make_heap_packet(4), other_group, 8889));
+    temp_file file(builder.data);
+
+    using boost::asio::ip::udp;
+    using boost::asio::ip::address;
+    std::vector<spead2::item_pointer_t> expected;
+    auto cnts = read_cnts(file.name, udp::endpoint(address(group), 8888));
+    expected = {1};
+    BOOST_CHECK_EQUAL_COLLECTIONS(cnts.begin(), cnts.end(), expected.begin(), expected.end());
+    cnts = read_cnts(file.name, udp::endpoint(address(other_group), 0));
+    expected = {3, 4};
+    BOOST_CHECK_EQUAL_COLLECTIONS(cnts.begin(), cnts.end(), expected.begin(), expected.end());
+    cnts = read_cnts(file.name, udp::endpoint(udp::v4(), 8889));
+    expected = {2, 4};
+    BOOST_CHECK_EQUAL_COLLECTIONS(cnts.begin(), cnts.end(), expected.begin(), expected.end());
+}
+
+// A truncated file is read up to the last complete record
+BOOST_AUTO_TEST_CASE(truncated)
+{
+    capture_builder builder;
+    builder.pcap_header(false);
+    builder.pcap_record(0, 0, make_frame(make_heap_packet(1), group, 8888));
+    builder.pcap_record(0, 1, make_frame(make_heap_packet(2), group, 8888));
+    builder.data.resize(builder.data.size() - 10);
+    temp_file file(builder.data);
+    auto cnts = read_cnts(file.name);
+    std::vector<spead2::item_pointer_t> expected{1};
+    BOOST_CHECK_EQUAL_COLLECTIONS(cnts.begin(), cnts.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(bad_file)
+{
+    temp_file file("this is not a capture file");
+    temp_file empty("");
+    capture_builder builder;
+    builder.pcap_header(false, 105);   // 802.11
+    temp_file wifi(builder.data);
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(tp);
+    using spead2::recv::udp_capture_reader;
+    BOOST_CHECK_THROW(stream.emplace_reader<udp_capture_reader>(file.name), std::runtime_error);
+    BOOST_CHECK_THROW(stream.emplace_reader<udp_capture_reader>(empty.name), std::runtime_error);
+    BOOST_CHECK_THROW(stream.emplace_reader<udp_capture_reader>(wifi.name), std::runtime_error);
+    BOOST_CHECK_THROW(
+        stream.emplace_reader<udp_capture_reader>("/nonexistent/spead2_unittest"),
+        std::system_error);
+    BOOST_CHECK_THROW(
+        stream.emplace_reader<udp_capture_reader>(std::vector<std::string>()),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // udp_capture
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+}} // namespace spead2::unittest
@@ -0,0 +1,106 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for recv_udp_reuseport.
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_REUSEPORT
+
+#include <set>
+#include <cstdint>
+#include <stdexcept>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_thread_pool.h>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/recv_udp_reuseport.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_udp.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(udp_reuseport)
+
+BOOST_AUTO_TEST_CASE(multicast_rejected)
+{
+    spead2::recv::udp_reuseport_config config;
+    boost::asio::ip::udp::endpoint endpoint(
+        boost::asio::ip::address_v4::from_string("239.255.1.1"), 8888);
+    BOOST_CHECK_THROW(config.set_endpoint(endpoint), std::invalid_argument);
+    BOOST_CHECK_THROW(config.set_num_sockets(0), std::invalid_argument);
+}
+
+/* Send heaps to a group with heap-counter steering, and check that they
+ * all arrive, that they are spread across the sockets, and that an
+ * end-of-stream on one socket stops the whole group.
+ */
+BOOST_AUTO_TEST_CASE(heap_cnt_steering)
+{
+    constexpr int n_heaps = 20;
+    spead2::recv::udp_reuseport_config udp_config;
+    udp_config.set_endpoint(boost::asio::ip::udp::endpoint(
+        boost::asio::ip::address_v4::loopback(), 0));
+    udp_config.set_num_sockets(2);
+    udp_config.set_steering(spead2::recv::udp_reuseport_config::steering::HEAP_CNT);
+    spead2::recv::udp_reuseport_group<> group(
+        spead2::recv::stream_config(),
+        spead2::recv::ring_stream_config().set_heaps(n_heaps + 1),
+        udp_config);
+
+    spead2::thread_pool tp;
+    spead2::send::udp_stream sender(
+        tp, {group.get_local_endpoint()},
+        spead2::send::stream_config().set_rate(1e6));
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap h;
+        h.add_item(0x1000, i);
+        sender.async_send_heap(h, [](const boost::system::error_code &, item_pointer_t) {});
+        sender.flush();
+    }
+
+    std::set<s_item_pointer_t> seen;
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::recv::heap h = group.pop();
+        seen.insert(h.get_cnt());
+    }
+    BOOST_CHECK_EQUAL(seen.size(), n_heaps);
+    for (std::size_t i = 0; i < group.get_num_streams(); i++)
+        BOOST_CHECK_EQUAL(group.get_stream(i).get_stats().heaps, n_heaps / 2);
+    BOOST_CHECK_EQUAL(group.get_stats().heaps, n_heaps);
+
+    spead2::send::heap end;
+    end.add_end();
+    sender.async_send_heap(end, [](const boost::system::error_code &, item_pointer_t) {});
+    sender.flush();
+    BOOST_CHECK_THROW(group.pop(), spead2::ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // udp_reuseport
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+}} // namespace spead2::unittest
+
+#endif // SPEAD2_USE_REUSEPORT
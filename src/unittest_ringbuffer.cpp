@@ -0,0 +1,284 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for common_ringbuffer.
+ */
+
+#include <cstdint>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_chunk_stream.h>
+
+// Check that the lock-free variants can be plugged into the streams
+template class spead2::recv::ring_stream<spead2::ringbuffer_spsc<spead2::recv::live_heap>>;
+template class spead2::recv::chunk_ring_stream<
+    spead2::ringbuffer_spsc<std::unique_ptr<spead2::recv::chunk>>,
+    spead2::ringbuffer_mpmc<std::unique_ptr<spead2::recv::chunk>>>;
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(ringbuffer)
+
+typedef std::unique_ptr<int> item;
+
+typedef boost::mpl::list<
+    spead2::ringbuffer<item>,
+    spead2::ringbuffer_spsc<item>,
+    spead2::ringbuffer_mpmc<item>,
+    spead2::ringbuffer_spsc<item, spead2::semaphore_fd, spead2::semaphore_fd>,
+    spead2::ringbuffer_mpmc<item, spead2::semaphore_spin, spead2::semaphore_spin>
+    > ringbuffer_types;
+
+// Types that can be used with several concurrent producers and consumers
+typedef boost::mpl::list<
+    spead2::ringbuffer<item>,
+    spead2::ringbuffer_mpmc<item>,
+    spead2::ringbuffer_mpmc<item, spead2::semaphore_fd, spead2::semaphore_fd>
+    > multi_ringbuffer_types;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(push_pop, T, ringbuffer_types)
+{
+    T ring(5);
+    BOOST_CHECK_EQUAL(ring.capacity(), 5);
+    for (int i = 0; i < 3; i++)
+        ring.push(item(new int(i)));
+    ring.emplace(new int(3));
+    BOOST_CHECK_EQUAL(ring.size(), 4);
+    for (int i = 0; i < 4; i++)
+        BOOST_CHECK_EQUAL(*ring.pop(), i);
+    BOOST_CHECK_EQUAL(ring.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(full_empty, T, ringbuffer_types)
+{
+    T ring(3);
+    BOOST_CHECK_THROW(ring.try_pop(), ringbuffer_empty);
+    // Go around a few times to exercise wrapping
+    for (int pass = 0; pass < 3; pass++)
+    {
+        for (int i = 0; i < 3; i++)
+            ring.try_push(item(new int(i)));
+        item extra(new int(3));
+        BOOST_CHECK_THROW(ring.try_push(std::move(extra)), ringbuffer_full);
+        BOOST_CHECK(extra);
+        BOOST_CHECK_THROW(ring.try_emplace(new int(3)), ringbuffer_full);
+        for (int i = 0; i < 3; i++)
+            BOOST_CHECK_EQUAL(*ring.try_pop(), i);
+        BOOST_CHECK_THROW(ring.try_pop(), ringbuffer_empty);
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(stop, T, ringbuffer_types)
+{
+    T ring(4);
+    ring.push(item(new int(0)));
+    ring.push(item(new int(1)));
+    BOOST_CHECK(ring.stop());
+    item extra(new int(2));
+    BOOST_CHECK_THROW(ring.push(std::move(extra)), ringbuffer_stopped);
+    BOOST_CHECK(extra);     // must not be consumed by a failed push
+    BOOST_CHECK_THROW(ring.try_push(std::move(extra)), ringbuffer_stopped);
+    BOOST_CHECK(extra);
+    BOOST_CHECK_THROW(ring.emplace(new int(2)), ringbuffer_stopped);
+    // Remaining items are still delivered, and only then is the stop seen
+    BOOST_CHECK_EQUAL(*ring.pop(), 0);
+    BOOST_CHECK_EQUAL(*ring.try_pop(), 1);
+    BOOST_CHECK_THROW(ring.pop(), ringbuffer_stopped);
+    BOOST_CHECK_THROW(ring.try_pop(), ringbuffer_stopped);
+    BOOST_CHECK_THROW(ring.pop(), ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(stop_wakes_consumer, T, ringbuffer_types)
+{
+    T ring(2);
+    auto consumer = std::async(std::launch::async, [&ring] {
+        try
+        {
+            ring.pop();
+            return false;
+        }
+        catch (ringbuffer_stopped &)
+        {
+            return true;
+        }
+    });
+    ring.stop();
+    BOOST_CHECK(consumer.get());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(remove_producer, T, ringbuffer_types)
+{
+    T ring(2);
+    ring.add_producer();
+    ring.add_producer();
+    BOOST_CHECK(!ring.remove_producer());
+    ring.push(item(new int(0)));
+    BOOST_CHECK(ring.remove_producer());
+    BOOST_CHECK_THROW(ring.push(item(new int(1))), ringbuffer_stopped);
+    BOOST_CHECK_EQUAL(*ring.pop(), 0);
+    BOOST_CHECK_THROW(ring.pop(), ringbuffer_stopped);
+}
+
+// Check that items left in the ringbuffer are destroyed
+template<typename Ringbuffer>
+static void check_destroy_nonempty()
+{
+    std::shared_ptr<int> value = std::make_shared<int>(1);
+    {
+        Ringbuffer ring(4);
+        ring.push(std::shared_ptr<int>(value));
+        ring.push(std::shared_ptr<int>(value));
+        ring.pop();
+        ring.push(std::shared_ptr<int>(value));
+        BOOST_CHECK_EQUAL(value.use_count(), 3);
+    }
+    BOOST_CHECK_EQUAL(value.use_count(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(destroy_nonempty)
+{
+    check_destroy_nonempty<spead2::ringbuffer<std::shared_ptr<int>>>();
+    check_destroy_nonempty<spead2::ringbuffer_spsc<std::shared_ptr<int>>>();
+    check_destroy_nonempty<spead2::ringbuffer_mpmc<std::shared_ptr<int>>>();
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(batch, T, ringbuffer_types)
+{
+    T ring(8);
+    std::vector<item> in;
+    for (int i = 0; i < 5; i++)
+        in.emplace_back(new int(i));
+    ring.push_many(in.begin(), in.end());
+    BOOST_CHECK_EQUAL(ring.size(), 5);
+
+    std::vector<item> out;
+    BOOST_CHECK_EQUAL(ring.pop_many(std::back_inserter(out), 3), 3);
+    BOOST_CHECK_EQUAL(ring.pop_many(std::back_inserter(out), 10), 2);
+    BOOST_REQUIRE_EQUAL(out.size(), 5);
+    for (int i = 0; i < 5; i++)
+        BOOST_CHECK_EQUAL(*out[i], i);
+    BOOST_CHECK_EQUAL(ring.pop_many(std::back_inserter(out), 0), 0);
+
+    // Items that cannot be pushed are left in place
+    ring.push_many(out.begin(), out.begin() + 2);
+    ring.stop();
+    BOOST_CHECK_THROW(ring.push_many(out.begin() + 2, out.end()), ringbuffer_stopped);
+    for (int i = 2; i < 5; i++)
+        BOOST_CHECK(out[i]);
+    // A batch pop stops at the stop position
+    item result[4];
+    BOOST_CHECK_EQUAL(ring.pop_many(result, 4), 2);
+    BOOST_CHECK_EQUAL(*result[0], 0);
+    BOOST_CHECK_EQUAL(*result[1], 1);
+    BOOST_CHECK_THROW(ring.pop_many(result, 4), ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(batch_threaded, T, ringbuffer_types)
+{
+    // Batches larger than the capacity, with concurrent consumer
+    const int N = 10000;
+    T ring(7);
+    auto consumer = std::async(std::launch::async, [&ring] {
+        std::vector<item> out;
+        try
+        {
+            while (true)
+                ring.pop_many(std::back_inserter(out), 5);
+        }
+        catch (ringbuffer_stopped &)
+        {
+        }
+        return out;
+    });
+    std::vector<item> in;
+    for (int i = 0; i < N; i++)
+        in.emplace_back(new int(i));
+    for (int i = 0; i < N; i += 1000)
+        ring.push_many(in.begin() + i, in.begin() + i + 1000);
+    ring.stop();
+    std::vector<item> out = consumer.get();
+    BOOST_REQUIRE_EQUAL(out.size(), N);
+    for (int i = 0; i < N; i++)
+        BOOST_CHECK_EQUAL(*out[i], i);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multi_thread, T, multi_ringbuffer_types)
+{
+    const int producers = 4, consumers = 3;
+    const std::int64_t N = 20000;   // per producer
+    T ring(16);
+    std::vector<std::future<void>> producer_futures;
+    std::vector<std::future<std::int64_t>> consumer_futures;
+    for (int i = 0; i < producers; i++)
+        ring.add_producer();
+    for (int i = 0; i < consumers; i++)
+    {
+        consumer_futures.push_back(std::async(std::launch::async, [&ring, i] {
+            std::int64_t sum = 0;
+            try
+            {
+                while (true)
+                {
+                    if (i == 0)
+                    {
+                        item batch[3];
+                        std::size_t n = ring.pop_many(batch, 3);
+                        for (std::size_t j = 0; j < n; j++)
+                            sum += *batch[j];
+                    }
+                    else
+                        sum += *ring.pop();
+                }
+            }
+            catch (ringbuffer_stopped &)
+            {
+            }
+            return sum;
+        }));
+    }
+    for (int i = 0; i < producers; i++)
+    {
+        producer_futures.push_back(std::async(std::launch::async, [&ring, i, N] {
+            for (std::int64_t j = 0; j < N; j++)
+                ring.emplace(new int(j));
+            ring.remove_producer();
+        }));
+    }
+    for (auto &f : producer_futures)
+        f.get();
+    std::int64_t sum = 0;
+    for (auto &f : consumer_futures)
+        sum += f.get();
+    BOOST_CHECK_EQUAL(sum, producers * (N * (N - 1) / 2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // ringbuffer
+BOOST_AUTO_TEST_SUITE_END()  // common
+
+}} // namespace spead2::unittest
@@ -24,6 +24,8 @@
 #include <boost/mpl/list.hpp>
 #include <spead2/common_semaphore.h>
 #include <future>
+#include <atomic>
+#include <thread>
 #include <utility>
 #include <cstring>
 #include <cerrno>
@@ -43,19 +45,34 @@ typedef boost::mpl::list<
 #if SPEAD2_USE_EVENTFD
     spead2::semaphore_eventfd,
 #endif
+#if SPEAD2_USE_FUTEX
+    spead2::semaphore_futex,
+    spead2::semaphore_futex_fd,
+#endif
 #if SPEAD2_USE_POSIX_SEMAPHORES
     spead2::semaphore_posix
-#else
-    spead2::semaphore      // a new type only when not using posix semaphores
+#elif !SPEAD2_USE_FUTEX
+    spead2::semaphore      // a new type only when not using posix or futex semaphores
 #endif
     > semaphore_types;
 
+// Types that can be moved
 typedef boost::mpl::list<
 #if SPEAD2_USE_EVENTFD
     spead2::semaphore_eventfd,
 #endif
     spead2::semaphore_pipe> semaphore_fd_types;
 
+// Types that provide get_fd
+typedef boost::mpl::list<
+#if SPEAD2_USE_EVENTFD
+    spead2::semaphore_eventfd,
+#endif
+#if SPEAD2_USE_FUTEX
+    spead2::semaphore_futex_fd,
+#endif
+    spead2::semaphore_pipe> semaphore_poll_types;
+
 /* Try to get a semaphore, but return only if it's zero, not on an interrupted
  * system call.
  */
@@ -106,6 +123,14 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(single_thread, T, semaphore_types)
     BOOST_CHECK_EQUAL(semaphore_get_value(sem), 1);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(put_many, T, semaphore_types)
+{
+    T sem(1);
+    sem.put(0);
+    sem.put(1000);
+    BOOST_CHECK_EQUAL(semaphore_get_value(sem), 1001);
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE(multi_thread, T, semaphore_types)
 {
     const std::int64_t N = 100000;
@@ -154,7 +179,7 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(move_construct, T, semaphore_fd_types)
     BOOST_CHECK_EQUAL(semaphore_get_value(sem2), 2);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(poll_fd, T, semaphore_fd_types)
+BOOST_AUTO_TEST_CASE_TEMPLATE(poll_fd, T, semaphore_poll_types)
 {
     T sem(1);
     pollfd fds[1];
@@ -168,6 +193,79 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(poll_fd, T, semaphore_fd_types)
     BOOST_CHECK_EQUAL(result, 0);
 }
 
+#if SPEAD2_USE_FUTEX
+
+BOOST_AUTO_TEST_CASE(futex_sleep)
+{
+    // Disable spinning so that the getter really goes to sleep
+    spead2::semaphore_futex sem(0, 0);
+    auto getter = std::async(std::launch::async, [&sem] {
+        semaphore_get(sem);
+        semaphore_get(sem);
+    });
+    sem.put();
+    sem.put();
+    getter.get();
+    BOOST_CHECK_EQUAL(semaphore_get_value(sem), 0);
+}
+
+BOOST_AUTO_TEST_CASE(futex_fd_late)
+{
+    // The file descriptor reflects a value set before it was requested
+    spead2::semaphore_futex_fd sem;
+    sem.put(2);
+    pollfd fds[1];
+    std::memset(&fds, 0, sizeof(fds));
+    fds[0].fd = sem.get_fd();
+    fds[0].events = POLLIN;
+    BOOST_CHECK_EQUAL(poll_restart(fds, 1, 0), 1);
+    semaphore_get(sem);
+    BOOST_CHECK_EQUAL(poll_restart(fds, 1, 0), 1);
+    BOOST_CHECK_EQUAL(semaphore_try_get(sem), 0);
+    BOOST_CHECK_EQUAL(poll_restart(fds, 1, 0), 0);
+    sem.put();
+    BOOST_CHECK_EQUAL(poll_restart(fds, 1, 0), 1);
+}
+
+BOOST_AUTO_TEST_CASE(futex_fd_race)
+{
+    /* Race puts against try_get, many times over. After each round, once
+     * both sides have finished and the value is back to zero, the file
+     * descriptor must not be left readable.
+     */
+    const int rounds = 20000;
+    spead2::semaphore_futex_fd sem;
+    pollfd fds[1];
+    std::memset(&fds, 0, sizeof(fds));
+    fds[0].fd = sem.get_fd();
+    fds[0].events = POLLIN;
+    std::atomic<int> started{0}, put_done{0};
+    auto producer = std::async(std::launch::async, [&] {
+        for (int i = 0; i < rounds; i++)
+        {
+            while (started.load() <= i)
+                std::this_thread::yield();
+            sem.put();
+            put_done.store(i + 1);
+        }
+    });
+    int readable = 0;
+    for (int i = 0; i < rounds; i++)
+    {
+        started.store(i + 1);
+        while (semaphore_try_get(sem) != 0)
+            std::this_thread::yield();
+        while (put_done.load() <= i)
+            std::this_thread::yield();
+        if (poll_restart(fds, 1, 0) != 0)
+            readable++;
+    }
+    producer.get();
+    BOOST_CHECK_EQUAL(readable, 0);
+}
+
+#endif // SPEAD2_USE_FUTEX
+
 BOOST_AUTO_TEST_SUITE_END()  // semaphore
 BOOST_AUTO_TEST_SUITE_END()  // common
 
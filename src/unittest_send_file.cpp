@@ -0,0 +1,173 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for send_file.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_thread_pool.h>
+#include <spead2/send_file.h>
+#include <spead2/send_streambuf.h>
+#include "unittest_temp_file.h"
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(send)
+BOOST_AUTO_TEST_SUITE(file)
+
+namespace
+{
+
+constexpr int n_heaps = 40;
+
+/* Send heaps of various sizes, flushing every @a flush_every heaps, and
+ * return any errors.
+ */
+boost::system::error_code send_heaps(spead2::send::stream &stream, int flush_every)
+{
+    boost::system::error_code result;
+    std::vector<std::uint8_t> payload(20000);
+    for (std::size_t i = 0; i < payload.size(); i++)
+        payload[i] = std::uint8_t(i);
+    // The heaps must remain valid until they have been sent
+    std::vector<spead2::send::heap> heaps(n_heaps);
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap &h = heaps[i];
+        h.add_item(0x1000, payload.data(), 100 + i * 487, false);
+        h.add_item(0x1001, i);
+        stream.async_send_heap(
+            h,
+            [&result](const boost::system::error_code &ec, spead2::item_pointer_t)
+            {
+                if (ec)
+                    result = ec;
+            });
+        if ((i + 1) % flush_every == 0)
+            stream.flush();
+    }
+    stream.flush();
+    return result;
+}
+
+// Generate the expected file contents using streambuf_stream
+std::string expected_contents(const spead2::send::stream_config &config)
+{
+    spead2::thread_pool tp;
+    std::stringbuf sb;
+    spead2::send::streambuf_stream stream(tp, sb, config);
+    send_heaps(stream, n_heaps);
+    return sb.str();
+}
+
+void check_file(const spead2::send::file_stream_config &file_config, int flush_every)
+{
+    auto config = spead2::send::stream_config()
+        .set_max_packet_size(1024)
+        .set_max_heaps(n_heaps);
+    temp_file file;
+    {
+        spead2::thread_pool tp;
+        spead2::send::file_stream stream(tp, file.name, config, file_config);
+        boost::system::error_code ec = send_heaps(stream, flush_every);
+        BOOST_CHECK_EQUAL(ec, boost::system::error_code());
+    }
+    std::string actual = file.contents();
+    std::string expected = expected_contents(config);
+    BOOST_CHECK_EQUAL(actual.size(), expected.size());
+    BOOST_CHECK(actual == expected);
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(default_config)
+{
+    check_file(spead2::send::file_stream_config(), n_heaps);
+}
+
+// Blocks that do not hold a whole number of packets, and few of them
+BOOST_AUTO_TEST_CASE(small_blocks)
+{
+    check_file(spead2::send::file_stream_config().set_block_size(4000).set_queue_depth(2), n_heaps);
+}
+
+// Blocks smaller than a packet
+BOOST_AUTO_TEST_CASE(tiny_blocks)
+{
+    check_file(spead2::send::file_stream_config().set_block_size(100).set_queue_depth(1), n_heaps);
+}
+
+// Flushing causes partial blocks to be written and later completed
+BOOST_AUTO_TEST_CASE(partial_blocks)
+{
+    check_file(spead2::send::file_stream_config().set_block_size(8192), 1);
+    check_file(spead2::send::file_stream_config().set_block_size(8192), 3);
+}
+
+BOOST_AUTO_TEST_CASE(direct)
+{
+    auto file_config = spead2::send::file_stream_config()
+        .set_block_size(8192)
+        .set_direct(true);
+    /* Not all filesystems support O_DIRECT, so check whether it works
+     * before running the test.
+     */
+    try
+    {
+        temp_file file;
+        spead2::thread_pool tp;
+        spead2::send::file_stream stream(tp, file.name, spead2::send::stream_config(), file_config);
+    }
+    catch (std::system_error &e)
+    {
+        BOOST_TEST_MESSAGE("Skipping direct I/O test: " << e.what());
+        return;
+    }
+    check_file(file_config, 1);
+    check_file(file_config, n_heaps);
+}
+
+BOOST_AUTO_TEST_CASE(bad_config)
+{
+    BOOST_CHECK_THROW(spead2::send::file_stream_config().set_block_size(0), std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::send::file_stream_config().set_queue_depth(0), std::invalid_argument);
+    spead2::thread_pool tp;
+    temp_file file;
+    BOOST_CHECK_THROW(
+        spead2::send::file_stream(
+            tp, file.name, spead2::send::stream_config(),
+            spead2::send::file_stream_config().set_block_size(1000).set_direct(true)),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // file
+BOOST_AUTO_TEST_SUITE_END()  // send
+
+}} // namespace spead2::unittest
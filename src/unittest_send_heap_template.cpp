@@ -0,0 +1,190 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for send_heap_template.
+ */
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdint>
+#include <future>
+#include <stdexcept>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_thread_pool.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_heap_template.h>
+#include <spead2/send_streambuf.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(send)
+BOOST_AUTO_TEST_SUITE(heap_template)
+
+static constexpr std::size_t max_packet_size = 1024;
+
+namespace
+{
+
+/* Heap with a mix of item encodings. The timestamp and the short string are
+ * variable; the payload buffers are supplied by the caller, and are omitted
+ * if empty.
+ */
+struct test_heap
+{
+    std::string flags_value;
+    spead2::send::heap h;
+    spead2::send::heap::item_handle timestamp;
+    spead2::send::heap::item_handle flags;
+
+    test_heap(const std::vector<std::uint8_t> &a, const std::vector<std::uint8_t> &b,
+              std::int64_t timestamp_value, const std::string &flags_value,
+              bool repeat_pointers = false)
+        : flags_value(flags_value)
+    {
+        timestamp = h.add_item(0x1600, timestamp_value);
+        h.add_item(0x1601, 0x1234);
+        flags = h.add_item(0x1602, this->flags_value, true);
+        if (!a.empty())
+            h.add_item(0x1603, a, false);
+        if (!b.empty())
+            h.add_item(0x1604, b, false);
+        h.set_repeat_pointers(repeat_pointers);
+    }
+};
+
+} // anonymous namespace
+
+static std::string send_heap(const spead2::send::heap &h, std::int64_t cnt)
+{
+    spead2::thread_pool tp;
+    std::stringbuf sb;
+    spead2::send::streambuf_stream stream(
+        tp, sb, spead2::send::stream_config().set_max_packet_size(max_packet_size));
+    stream.async_send_heap(h, [](const boost::system::error_code &, item_pointer_t) {}, cnt);
+    stream.flush();
+    return sb.str();
+}
+
+// Send a heap that is expected to be rejected, and return the error
+static boost::system::error_code send_heap_error(const spead2::send::heap &h)
+{
+    spead2::thread_pool tp;
+    std::stringbuf sb;
+    spead2::send::streambuf_stream stream(
+        tp, sb, spead2::send::stream_config().set_max_packet_size(max_packet_size));
+    std::promise<boost::system::error_code> result;
+    BOOST_CHECK(!stream.async_send_heap(
+        h, [&result](const boost::system::error_code &ec, item_pointer_t) { result.set_value(ec); }));
+    auto ec = result.get_future().get();
+    BOOST_CHECK(sb.str().empty());
+    return ec;
+}
+
+static void check_template(bool repeat_pointers, std::size_t size)
+{
+    std::vector<std::uint8_t> a(size), b(size / 2);
+    for (std::size_t i = 0; i < a.size(); i++)
+        a[i] = i;
+    test_heap proto(a, b, 0, "abcd", repeat_pointers);
+    auto tmpl = std::make_shared<spead2::send::heap_template>(
+        proto.h, max_packet_size,
+        std::vector<spead2::send::heap::item_handle>{proto.timestamp, proto.flags});
+
+    for (int i = 0; i < 3; i++)
+    {
+        // Different payload memory and variable values for each heap
+        std::vector<std::uint8_t> a2(a.size(), i), b2(b.size(), i + 100);
+        test_heap th(a2, b2, 1000 * i + 5, "wxy" + std::to_string(i), repeat_pointers);
+        std::string expected = send_heap(th.h, i + 1);
+        th.h.set_template(tmpl);
+        std::string actual = send_heap(th.h, i + 1);
+        BOOST_CHECK(expected == actual);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(match)
+{
+    check_template(false, 5000);
+}
+
+BOOST_AUTO_TEST_CASE(match_repeat_pointers)
+{
+    check_template(true, 5000);
+}
+
+// Only immediates, so the generator has to add padding
+BOOST_AUTO_TEST_CASE(match_padding)
+{
+    check_template(false, 0);
+}
+
+BOOST_AUTO_TEST_CASE(num_packets)
+{
+    std::vector<std::uint8_t> a(10000), b(100);
+    test_heap proto(a, b, 0, "abcd");
+    spead2::send::heap_template tmpl(proto.h, max_packet_size + 3);
+    BOOST_CHECK_EQUAL(tmpl.get_max_packet_size(), max_packet_size);
+    BOOST_CHECK_EQUAL(tmpl.get_num_packets(), 11);
+}
+
+BOOST_AUTO_TEST_CASE(variable_not_immediate)
+{
+    std::vector<std::uint8_t> a(100), b(100);
+    test_heap proto(a, b, 0, "abcd");
+    BOOST_CHECK_THROW(
+        spead2::send::heap_template(proto.h, max_packet_size, {3}),
+        std::invalid_argument);
+    BOOST_CHECK_THROW(
+        spead2::send::heap_template(proto.h, max_packet_size, {5}),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(mismatch)
+{
+    std::vector<std::uint8_t> a(100), b(100), c(101);
+    test_heap proto(a, b, 0, "abcd");
+    auto tmpl = std::make_shared<spead2::send::heap_template>(proto.h, max_packet_size);
+
+    // Different item length
+    test_heap th1(a, c, 0, "abcd");
+    th1.h.set_template(tmpl);
+    BOOST_CHECK_EQUAL(send_heap_error(th1.h), boost::system::error_code(boost::asio::error::invalid_argument));
+
+    // Different number of items
+    test_heap th2(a, b, 0, "abcd");
+    th2.h.add_item(0x1605, 1);
+    th2.h.set_template(tmpl);
+    BOOST_CHECK_EQUAL(send_heap_error(th2.h), boost::system::error_code(boost::asio::error::invalid_argument));
+
+    // Different packet size
+    auto tmpl2 = std::make_shared<spead2::send::heap_template>(proto.h, max_packet_size + 8);
+    test_heap th3(a, b, 0, "abcd");
+    th3.h.set_template(tmpl2);
+    BOOST_CHECK_EQUAL(send_heap_error(th3.h), boost::system::error_code(boost::asio::error::invalid_argument));
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // heap_template
+BOOST_AUTO_TEST_SUITE_END()  // send
+
+}} // namespace spead2::unittest
@@ -21,9 +21,15 @@
  * aren't tested by the Python unit tests.
  */
 
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 #include <boost/asio.hpp>
 #include <boost/test/unit_test.hpp>
+#include <spead2/common_ringbuffer.h>
 #include <spead2/common_thread_pool.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_tcp.h>
 #include <spead2/send_tcp.h>
 
 namespace spead2
@@ -63,6 +69,69 @@ BOOST_AUTO_TEST_CASE(connect_fail)
     BOOST_CHECK_EQUAL(heap_error, boost::asio::error::broken_pipe);
 }
 
+/* Queue many multi-packet heaps at once, so that the writer gathers packets
+ * from several heaps into each write, and check that every heap is accounted
+ * for and arrives intact.
+ */
+BOOST_AUTO_TEST_CASE(batch)
+{
+    constexpr int n_heaps = 50;
+    constexpr std::size_t payload_size = 10000;
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> recv_stream(
+        tp, spead2::recv::stream_config(),
+        spead2::recv::ring_stream_config().set_heaps(n_heaps));
+    boost::asio::ip::tcp::acceptor acceptor(
+        tp.get_io_service(),
+        boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    auto endpoint = acceptor.local_endpoint();
+    recv_stream.emplace_reader<spead2::recv::tcp_reader>(std::move(acceptor));
+
+    std::vector<std::uint8_t> payload(payload_size);
+    for (std::size_t i = 0; i < payload_size; i++)
+        payload[i] = std::uint8_t(i);
+    std::vector<spead2::send::heap> heaps(n_heaps);
+    for (auto &h : heaps)
+        h.add_item(0x1000, payload.data(), payload.size(), false);
+
+    std::vector<boost::system::error_code> errors(n_heaps);
+    std::vector<spead2::item_pointer_t> sizes(n_heaps);
+    {
+        spead2::send::tcp_stream stream(
+            tp, [](const boost::system::error_code &) {}, {endpoint},
+            spead2::send::stream_config().set_max_packet_size(1024).set_max_heaps(n_heaps));
+        for (int i = 0; i < n_heaps; i++)
+        {
+            stream.async_send_heap(
+                heaps[i],
+                [&errors, &sizes, i](const boost::system::error_code &ec,
+                                     spead2::item_pointer_t bytes_transferred)
+                {
+                    errors[i] = ec;
+                    sizes[i] = bytes_transferred;
+                });
+        }
+        stream.flush();
+    }
+
+    for (int i = 0; i < n_heaps; i++)
+    {
+        BOOST_CHECK_EQUAL(errors[i], boost::system::error_code());
+        BOOST_CHECK_EQUAL(sizes[i], sizes[0]);
+    }
+    BOOST_CHECK_GT(sizes[0], payload_size);
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::recv::heap h = recv_stream.pop();
+        BOOST_CHECK_EQUAL(h.get_cnt(), i + 1);
+        BOOST_REQUIRE_EQUAL(h.get_items().size(), 1);
+        const auto &item = h.get_items()[0];
+        BOOST_REQUIRE_EQUAL(item.length, payload_size);
+        BOOST_CHECK(std::equal(payload.begin(), payload.end(), item.ptr));
+    }
+    BOOST_CHECK_THROW(recv_stream.pop(), spead2::ringbuffer_stopped);
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // tcp
 BOOST_AUTO_TEST_SUITE_END()  // send
 
@@ -0,0 +1,186 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for send_udp_parallel.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <set>
+#include <stdexcept>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_defines.h>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_udp.h>
+#include <spead2/send_udp_parallel.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(send)
+BOOST_AUTO_TEST_SUITE(udp_parallel)
+
+/* Send heaps over loopback from several threads, and check that completion
+ * handlers run in enqueue order and that every heap arrives intact.
+ */
+BOOST_AUTO_TEST_CASE(send_heaps)
+{
+    constexpr int n_heaps = 40;
+    constexpr std::size_t payload_size = 10000;
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> recv_stream(
+        tp, spead2::recv::stream_config().set_max_heaps(n_heaps),
+        spead2::recv::ring_stream_config().set_heaps(n_heaps));
+    boost::asio::ip::udp::socket socket(
+        tp.get_io_service(),
+        boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    socket.set_option(boost::asio::socket_base::receive_buffer_size(4 * 1024 * 1024));
+    auto endpoint = socket.local_endpoint();
+    recv_stream.emplace_reader<spead2::recv::udp_reader>(std::move(socket));
+
+    std::vector<std::uint8_t> payload(payload_size);
+    for (std::size_t i = 0; i < payload_size; i++)
+        payload[i] = std::uint8_t(i);
+    std::vector<spead2::send::heap> heaps(n_heaps);
+    for (auto &h : heaps)
+        h.add_item(0x1000, payload.data(), payload.size(), false);
+    spead2::send::heap stop_heap;
+    stop_heap.add_end();
+
+    std::vector<int> order;
+    std::vector<boost::system::error_code> errors(n_heaps);
+    {
+        spead2::send::udp_parallel_stream stream(
+            tp, {endpoint},
+            spead2::send::stream_config().set_max_packet_size(1024).set_max_heaps(n_heaps),
+            4);
+        for (int i = 0; i < n_heaps; i++)
+        {
+            stream.async_send_heap(
+                heaps[i],
+                [&order, &errors, i](const boost::system::error_code &ec,
+                                     spead2::item_pointer_t bytes_transferred)
+                {
+                    order.push_back(i);
+                    errors[i] = ec;
+                });
+        }
+        stream.flush();
+        stream.async_send_heap(
+            stop_heap, [](const boost::system::error_code &, spead2::item_pointer_t) {});
+        stream.flush();
+    }
+
+    BOOST_REQUIRE_EQUAL(order.size(), n_heaps);
+    for (int i = 0; i < n_heaps; i++)
+    {
+        BOOST_CHECK_EQUAL(order[i], i);
+        BOOST_CHECK_EQUAL(errors[i], boost::system::error_code());
+    }
+
+    // Heaps sent by different threads may complete in any order
+    std::set<spead2::s_item_pointer_t> cnts;
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::recv::heap h = recv_stream.pop();
+        cnts.insert(h.get_cnt());
+        BOOST_REQUIRE_EQUAL(h.get_items().size(), 1);
+        const auto &item = h.get_items()[0];
+        BOOST_REQUIRE_EQUAL(item.length, payload_size);
+        BOOST_CHECK(std::equal(payload.begin(), payload.end(), item.ptr));
+    }
+    BOOST_CHECK_EQUAL(cnts.size(), n_heaps);
+    BOOST_CHECK_EQUAL(*cnts.begin(), 1);
+    BOOST_CHECK_EQUAL(*cnts.rbegin(), n_heaps);
+    BOOST_CHECK_THROW(recv_stream.pop(), spead2::ringbuffer_stopped);
+}
+
+/* Run the sending stream's io_service on several threads, so that worker
+ * completions may be handled concurrently. The packets are not received, so
+ * only the completion handlers are checked.
+ */
+BOOST_AUTO_TEST_CASE(threaded_io_service)
+{
+    constexpr int n_heaps = 2000;
+    constexpr int max_heaps = 50;
+    spead2::thread_pool tp(4);
+    boost::asio::ip::udp::socket socket(
+        tp.get_io_service(),
+        boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    auto endpoint = socket.local_endpoint();
+
+    std::uint64_t value = 0;
+    spead2::send::heap heap;
+    heap.add_item(0x1000, &value, sizeof(value), true);
+
+    std::vector<int> order;
+    std::vector<boost::system::error_code> errors(n_heaps);
+    {
+        spead2::send::udp_parallel_stream stream(
+            tp, {endpoint}, spead2::send::stream_config().set_max_heaps(max_heaps), 4);
+        for (int i = 0; i < n_heaps; i++)
+        {
+            if (i % max_heaps == 0)
+                stream.flush();
+            stream.async_send_heap(
+                heap,
+                [&order, &errors, i](const boost::system::error_code &ec,
+                                     spead2::item_pointer_t bytes_transferred)
+                {
+                    order.push_back(i);
+                    errors[i] = ec;
+                });
+        }
+        stream.flush();
+    }
+
+    BOOST_REQUIRE_EQUAL(order.size(), n_heaps);
+    for (int i = 0; i < n_heaps; i++)
+    {
+        BOOST_CHECK_EQUAL(order[i], i);
+        BOOST_CHECK_EQUAL(errors[i], boost::system::error_code());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bad_config)
+{
+    spead2::thread_pool tp;
+    boost::asio::ip::udp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), 8888);
+    BOOST_CHECK_THROW(
+        spead2::send::udp_parallel_stream(
+            tp, {endpoint}, spead2::send::stream_config().set_rate(1e9), 2),
+        std::invalid_argument);
+    BOOST_CHECK_THROW(
+        spead2::send::udp_parallel_stream(tp, {endpoint}, spead2::send::stream_config(), 0),
+        std::invalid_argument);
+    BOOST_CHECK_THROW(
+        spead2::send::udp_parallel_stream(tp, {}, spead2::send::stream_config(), 2),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // udp_parallel
+BOOST_AUTO_TEST_SUITE_END()  // send
+
+}} // namespace spead2::unittest
@@ -0,0 +1,206 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for send_udp_replay.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <unistd.h>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_raw_packet.h>
+#include <spead2/send_udp_replay.h>
+#include "unittest_temp_file.h"
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(send)
+BOOST_AUTO_TEST_SUITE(udp_replay)
+
+namespace
+{
+
+/// Build an ethernet frame containing a UDP datagram
+std::string make_frame(const std::string &payload, std::uint8_t protocol = udp_packet::protocol)
+{
+    std::vector<std::uint8_t> frame(
+        ethernet_frame::min_size + ipv4_packet::min_size + udp_packet::min_size + payload.size());
+    ethernet_frame eth(frame.data(), frame.size());
+    eth.ethertype(ipv4_packet::ethertype);
+    ipv4_packet ipv4 = eth.payload_ipv4();
+    ipv4.version_ihl(0x45);
+    ipv4.total_length(frame.size() - ethernet_frame::min_size);
+    ipv4.ttl(1);
+    ipv4.protocol(protocol);
+    ipv4.destination_address(boost::asio::ip::address_v4::from_string("239.1.2.3"));
+    ipv4.update_checksum();
+    udp_packet udp = ipv4.payload_udp();
+    udp.destination_port(8888);
+    udp.length(udp_packet::min_size + payload.size());
+    std::memcpy(udp.payload().data(), payload.data(), payload.size());
+    return std::string(frame.begin(), frame.end());
+}
+
+/// Temporary pcap file (microsecond resolution) that is removed on destruction
+class capture_file : public temp_file
+{
+public:
+    std::ofstream out;
+
+    capture_file()
+    {
+        out.open(name, std::ios::binary);
+        const std::uint32_t header[6] = {0xa1b2c3d4, 0x00040002, 0, 0, 65536, 1};
+        out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    }
+
+    void add(std::uint32_t us, const std::string &frame)
+    {
+        const std::uint32_t header[4] = {
+            100 + us / 1000000, us % 1000000, std::uint32_t(frame.size()), std::uint32_t(frame.size())
+        };
+        out.write(reinterpret_cast<const char *>(header), sizeof(header));
+        out << frame;
+        out.flush();
+    }
+};
+
+/// Socket on the loopback interface to receive replayed packets
+class receiver
+{
+public:
+    boost::asio::io_service io_service;
+    boost::asio::ip::udp::socket socket;
+
+    receiver()
+        : socket(io_service, boost::asio::ip::udp::endpoint(
+            boost::asio::ip::address_v4::loopback(), 0))
+    {
+        struct timeval tv = {5, 0};
+        setsockopt(socket.native_handle(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        socket.set_option(boost::asio::socket_base::receive_buffer_size(1024 * 1024));
+    }
+
+    std::string receive()
+    {
+        char buffer[9000];
+        std::size_t n = socket.receive(boost::asio::buffer(buffer));
+        return std::string(buffer, n);
+    }
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(replay)
+{
+    capture_file file;
+    std::vector<std::string> payloads;
+    for (int i = 0; i < 5; i++)
+    {
+        payloads.push_back("packet " + std::to_string(i));
+        file.add(i * 10000, make_frame(payloads.back()));
+    }
+    // Not UDP, so should be skipped
+    file.add(50000, make_frame("ignored", 1));
+
+    receiver recv;
+    spead2::send::udp_replayer replayer(
+        {file.name},
+        spead2::send::udp_replay_config()
+            .set_destination(recv.socket.local_endpoint())
+            .set_preload(true));
+    spead2::send::udp_replay_stats stats = replayer.run();
+    for (const auto &payload : payloads)
+        BOOST_CHECK_EQUAL(recv.receive(), payload);
+
+    BOOST_CHECK_EQUAL(stats.packets, 5);
+    BOOST_CHECK_EQUAL(stats.bytes, 5 * payloads[0].size());
+    BOOST_CHECK_EQUAL(stats.skipped, 1);
+    BOOST_CHECK_EQUAL(stats.errors, 0);
+    BOOST_CHECK_CLOSE(stats.target_duration, 0.04, 1e-3);
+    // Packets are never sent early
+    BOOST_CHECK_GE(stats.actual_duration, 0.04 - stats.max_lateness);
+    BOOST_CHECK_GE(stats.mean_lateness, 0.0);
+    BOOST_CHECK_GE(stats.max_lateness, stats.mean_lateness);
+}
+
+BOOST_AUTO_TEST_CASE(speed)
+{
+    capture_file file;
+    for (int i = 0; i < 3; i++)
+        file.add(i * 20000, make_frame("x"));
+    receiver recv;
+    auto config = spead2::send::udp_replay_config().set_destination(recv.socket.local_endpoint());
+
+    spead2::send::udp_replayer fast({file.name}, config.set_speed(4.0));
+    auto stats = fast.run();
+    BOOST_CHECK_EQUAL(stats.packets, 3);
+    BOOST_CHECK_CLOSE(stats.target_duration, 0.01, 1e-3);
+
+    spead2::send::udp_replayer unpaced({file.name}, config.set_speed(0.0));
+    stats = unpaced.run();
+    BOOST_CHECK_EQUAL(stats.packets, 3);
+    BOOST_CHECK_EQUAL(stats.target_duration, 0.0);
+}
+
+// A packet stamped before the first one is sent immediately rather than never
+BOOST_AUTO_TEST_CASE(out_of_order)
+{
+    capture_file file;
+    file.add(20000, make_frame("first"));
+    file.add(0, make_frame("early"));
+    file.add(30000, make_frame("last"));
+    receiver recv;
+    spead2::send::udp_replayer replayer(
+        {file.name},
+        spead2::send::udp_replay_config().set_destination(recv.socket.local_endpoint()));
+    spead2::send::udp_replay_stats stats = replayer.run();
+    BOOST_CHECK_EQUAL(recv.receive(), "first");
+    BOOST_CHECK_EQUAL(recv.receive(), "early");
+    BOOST_CHECK_EQUAL(recv.receive(), "last");
+    BOOST_CHECK_EQUAL(stats.packets, 3);
+    BOOST_CHECK_LT(stats.actual_duration, 1.0);
+    BOOST_CHECK_GE(stats.max_lateness, 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(bad_config)
+{
+    BOOST_CHECK_THROW(spead2::send::udp_replay_config().set_speed(-1.0), std::invalid_argument);
+    BOOST_CHECK_THROW(
+        spead2::send::udp_replay_config().set_speed(std::numeric_limits<double>::infinity()),
+        std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::send::udp_replayer({}), std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::send::udp_replayer({"/nonexistent/spead2_unittest"}), std::system_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // udp_replay
+BOOST_AUTO_TEST_SUITE_END()  // send
+
+}} // namespace spead2::unittest
@@ -0,0 +1,284 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for the shared-memory transport.
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_SHM
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/common_shm.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_shm.h>
+#include <spead2/send_shm.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(shm)
+
+constexpr int n_heaps = 50;
+constexpr std::size_t payload_size = 10000;
+
+static std::vector<std::uint8_t> make_payload()
+{
+    std::vector<std::uint8_t> payload(payload_size);
+    for (std::size_t i = 0; i < payload_size; i++)
+        payload[i] = std::uint8_t(i);
+    return payload;
+}
+
+// Send heaps to a queue, then stop it
+static void send_heaps(std::shared_ptr<spead2::shm_queue> queue,
+                       std::vector<boost::system::error_code> &errors)
+{
+    spead2::thread_pool tp;
+    std::vector<std::uint8_t> payload = make_payload();
+    spead2::send::heap h;
+    h.add_item(0x1000, payload.data(), payload.size(), false);
+    spead2::send::shm_stream stream(
+        tp, {queue},
+        spead2::send::stream_config().set_max_packet_size(1024).set_max_heaps(n_heaps));
+    for (int i = 0; i < n_heaps; i++)
+        stream.async_send_heap(
+            h,
+            [&errors, i](const boost::system::error_code &ec, spead2::item_pointer_t)
+            {
+                errors[i] = ec;
+            });
+    stream.flush();
+    queue->stop();
+}
+
+// Receive and check the heaps sent by send_heaps
+static void check_heaps(spead2::recv::ring_stream<> &stream)
+{
+    std::vector<std::uint8_t> payload = make_payload();
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::recv::heap h = stream.pop();
+        BOOST_CHECK_EQUAL(h.get_cnt(), i + 1);
+        BOOST_REQUIRE_EQUAL(h.get_items().size(), 1);
+        const auto &item = h.get_items()[0];
+        BOOST_REQUIRE_EQUAL(item.length, payload_size);
+        BOOST_CHECK(std::equal(payload.begin(), payload.end(), item.ptr));
+    }
+    BOOST_CHECK_THROW(stream.pop(), spead2::ringbuffer_stopped);
+}
+
+BOOST_AUTO_TEST_CASE(slots)
+{
+    spead2::shm_queue producer(100, 4);
+    spead2::shm_queue consumer(producer.get_fd());
+    BOOST_CHECK_EQUAL(consumer.get_slot_size(), 100);
+    BOOST_CHECK_EQUAL(consumer.get_num_slots(), 4);
+
+    BOOST_CHECK_EQUAL(producer.free_slots(), 4);
+    std::memcpy(producer.get_free_slot(0, 5), "hello", 5);
+    std::memcpy(producer.get_free_slot(1, 3), "abc", 3);
+    BOOST_CHECK_EQUAL(consumer.filled_slots(), 0);
+    producer.commit(2);
+    BOOST_CHECK_EQUAL(producer.free_slots(), 2);
+
+    BOOST_REQUIRE_EQUAL(consumer.filled_slots(), 2);
+    std::size_t size;
+    const std::uint8_t *data = consumer.get_filled_slot(0, size);
+    BOOST_CHECK_EQUAL(std::string((const char *) data, size), "hello");
+    data = consumer.get_filled_slot(1, size);
+    BOOST_CHECK_EQUAL(std::string((const char *) data, size), "abc");
+    consumer.release(2);
+    BOOST_CHECK_EQUAL(consumer.filled_slots(), 0);
+    BOOST_CHECK_EQUAL(producer.free_slots(), 4);
+
+    BOOST_CHECK(!consumer.is_stopped());
+    producer.stop();
+    BOOST_CHECK(consumer.is_stopped());
+    std::atomic<bool> interrupt{false};
+    consumer.wait_for_data(interrupt);   // must return immediately
+    BOOST_CHECK(!producer.is_closed());
+    consumer.close();
+    BOOST_CHECK(producer.is_closed());
+}
+
+BOOST_AUTO_TEST_CASE(named)
+{
+    std::string name = "/spead2-unittest-" + std::to_string(getpid());
+    {
+        spead2::shm_queue queue(name, 1024, 8);
+        BOOST_CHECK_THROW(spead2::shm_queue(name, 1024, 8), std::system_error);
+        spead2::shm_queue other(name);
+        BOOST_CHECK_EQUAL(other.get_slot_size(), 1024);
+        BOOST_CHECK_EQUAL(other.get_num_slots(), 8);
+    }
+    // The creator removes the name
+    BOOST_CHECK_THROW(spead2::shm_queue{name}, std::system_error);
+}
+
+BOOST_AUTO_TEST_CASE(bad_args)
+{
+    spead2::thread_pool tp;
+    BOOST_CHECK_THROW(spead2::shm_queue(0, 8), std::invalid_argument);
+    auto queue = std::make_shared<spead2::shm_queue>(512, 8);
+    BOOST_CHECK_THROW(
+        spead2::send::shm_stream(tp, {queue}, spead2::send::stream_config().set_max_packet_size(1024)),
+        std::invalid_argument);
+}
+
+/* Attach to a queue whose header has been corrupted. The offsets are those
+ * of slot_size, num_slots and slot_stride in the header.
+ */
+BOOST_AUTO_TEST_CASE(bad_header)
+{
+    spead2::shm_queue queue(100, 4);
+    std::size_t size = 4096 + 4 * 128;
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, queue.get_fd(), 0);
+    BOOST_REQUIRE(ptr != MAP_FAILED);
+    std::uint64_t *fields = reinterpret_cast<std::uint64_t *>(ptr);
+    const std::uint64_t orig[3] = {fields[1], fields[2], fields[3]};
+    BOOST_REQUIRE_EQUAL(orig[0], 100);   // slot_size
+    BOOST_REQUIRE_EQUAL(orig[1], 4);     // num_slots
+    BOOST_REQUIRE_EQUAL(orig[2], 128);   // slot_stride
+
+    auto check_bad = [&](std::size_t index, std::uint64_t value)
+    {
+        BOOST_TEST_CONTEXT("field " << index << " = " << value)
+        {
+            fields[index] = value;
+            BOOST_CHECK_THROW(spead2::shm_queue{queue.get_fd()}, std::invalid_argument);
+            fields[index] = orig[index - 1];
+        }
+    };
+    check_bad(1, 0);                            // zero slot_size
+    check_bad(1, 121);                          // slot_size overruns the slot
+    check_bad(2, 0);                            // zero num_slots
+    check_bad(2, 5);                            // more slots than the segment holds
+    check_bad(2, std::uint64_t(1) << 57);       // size computation would overflow
+    check_bad(3, 0);                            // zero slot_stride
+    check_bad(3, 8);                            // no room after the prefix
+    // With the header restored, it can be attached again
+    spead2::shm_queue consumer(queue.get_fd());
+    BOOST_CHECK_EQUAL(consumer.get_num_slots(), 4);
+    munmap(ptr, size);
+}
+
+/* Send more data than fits in the queue from the same process, so that the
+ * sender has to wait for space.
+ */
+BOOST_AUTO_TEST_CASE(send_recv)
+{
+    spead2::thread_pool tp;
+    auto queue = std::make_shared<spead2::shm_queue>(1024, 16);
+    spead2::recv::ring_stream<> stream(
+        tp, spead2::recv::stream_config(), spead2::recv::ring_stream_config().set_heaps(n_heaps));
+    stream.emplace_reader<spead2::recv::shm_reader>(
+        std::make_shared<spead2::shm_queue>(queue->get_fd()));
+    std::vector<boost::system::error_code> errors(n_heaps);
+    send_heaps(queue, errors);
+    for (const auto &ec : errors)
+        BOOST_CHECK_EQUAL(ec, boost::system::error_code());
+    check_heaps(stream);
+}
+
+// Send from a child process
+BOOST_AUTO_TEST_CASE(fork)
+{
+    auto queue = std::make_shared<spead2::shm_queue>(1024, 16);
+    pid_t pid = ::fork();
+    BOOST_REQUIRE(pid != -1);
+    if (pid == 0)
+    {
+        std::vector<boost::system::error_code> errors(n_heaps);
+        send_heaps(std::make_shared<spead2::shm_queue>(queue->get_fd()), errors);
+        bool good = std::all_of(errors.begin(), errors.end(),
+                                [](const boost::system::error_code &ec) { return !ec; });
+        _exit(good ? 0 : 1);
+    }
+
+    spead2::thread_pool tp;
+    spead2::recv::ring_stream<> stream(
+        tp, spead2::recv::stream_config(), spead2::recv::ring_stream_config().set_heaps(n_heaps));
+    stream.emplace_reader<spead2::recv::shm_reader>(queue);
+    check_heaps(stream);
+    int status;
+    BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+    BOOST_CHECK(WIFEXITED(status));
+    BOOST_CHECK_EQUAL(WEXITSTATUS(status), 0);
+}
+
+// Stopping the receiver closes the queue, so the sender fails rather than blocking
+BOOST_AUTO_TEST_CASE(receiver_stops)
+{
+    spead2::thread_pool tp;
+    auto queue = std::make_shared<spead2::shm_queue>(1024, 4);
+    {
+        spead2::recv::ring_stream<> stream(tp);
+        stream.emplace_reader<spead2::recv::shm_reader>(queue);
+        stream.stop();
+    }
+    BOOST_CHECK(queue->is_closed());
+    std::vector<boost::system::error_code> errors(n_heaps);
+    send_heaps(queue, errors);
+    BOOST_CHECK_EQUAL(errors[0], boost::asio::error::operation_aborted);
+}
+
+// A receiver that dies without closing the queue must not block the sender forever
+BOOST_AUTO_TEST_CASE(receiver_exits)
+{
+    auto queue = std::make_shared<spead2::shm_queue>(1024, 16);
+    pid_t pid = ::fork();
+    BOOST_REQUIRE(pid != -1);
+    if (pid == 0)
+    {
+        queue->set_consumer();
+        _exit(0);
+    }
+    int status;
+    BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+    BOOST_CHECK(!queue->is_closed());
+    BOOST_CHECK(queue->consumer_exited());
+
+    std::vector<boost::system::error_code> errors(n_heaps);
+    send_heaps(queue, errors);
+    BOOST_CHECK_EQUAL(errors[0], boost::system::error_code());
+    BOOST_CHECK_EQUAL(errors[n_heaps - 1], boost::asio::error::broken_pipe);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // shm
+BOOST_AUTO_TEST_SUITE_END()  // common
+
+}} // namespace spead2::unittest
+
+#endif // SPEAD2_USE_SHM
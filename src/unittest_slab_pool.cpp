@@ -0,0 +1,149 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for common_slab_pool.
+ */
+
+#include <cstddef>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_slab_pool.h>
+#include <spead2/common_thread_pool.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(slab_pool)
+
+namespace
+{
+
+// Records the sizes of allocations made through it
+class recording_allocator : public spead2::memory_allocator
+{
+public:
+    std::vector<std::size_t> sizes;
+
+    virtual pointer allocate(std::size_t size, void *hint) override
+    {
+        sizes.push_back(size);
+        return spead2::memory_allocator::allocate(size, hint);
+    }
+};
+
+} // anonymous namespace
+
+// Each allocation is served by the smallest class that fits it
+BOOST_AUTO_TEST_CASE(size_classes)
+{
+    auto allocator = std::make_shared<recording_allocator>();
+    std::vector<spead2::slab_pool::size_class> classes{
+        {1024, 2, 1},
+        {65536, 2, 1}
+    };
+    auto pool = std::make_shared<spead2::slab_pool>(classes, allocator);
+    pool->set_warn_on_empty(false);
+    BOOST_CHECK(!pool->get_warn_on_empty());
+    BOOST_CHECK_EQUAL(pool->get_classes().size(), 2);
+    BOOST_TEST(allocator->sizes == (std::vector<std::size_t>{1024, 65536}));
+
+    auto small = pool->allocate(100, nullptr);
+    auto large = pool->allocate(2000, nullptr);
+    BOOST_CHECK_EQUAL(allocator->sizes.size(), 2);   // both came from the pool
+    auto huge = pool->allocate(100000, nullptr);
+    auto small2 = pool->allocate(1024, nullptr);     // class is now empty
+    BOOST_TEST(allocator->sizes == (std::vector<std::size_t>{1024, 65536, 100000, 1024}));
+
+    // Returned memory is recycled within its class
+    small.reset();
+    auto small3 = pool->allocate(1, nullptr);
+    BOOST_CHECK_EQUAL(allocator->sizes.size(), 4);
+
+    auto class_stats = pool->get_class_stats();
+    BOOST_REQUIRE_EQUAL(class_stats.size(), 2);
+    BOOST_CHECK_EQUAL(class_stats[0].hits, 2);
+    BOOST_CHECK_EQUAL(class_stats[0].empty, 1);
+    BOOST_CHECK_EQUAL(class_stats[0].bytes_outstanding, 2 * 1024);
+    BOOST_CHECK_EQUAL(class_stats[1].hits, 1);
+    spead2::memory_pool_stats stats = pool->get_stats();
+    BOOST_CHECK_EQUAL(stats.hits, 3);
+    BOOST_CHECK_EQUAL(stats.misses, 1);
+    BOOST_CHECK_EQUAL(stats.empty, 1);
+    BOOST_CHECK_EQUAL(stats.bytes_outstanding, 2 * 1024 + 65536);
+}
+
+BOOST_AUTO_TEST_CASE(power_of_two_classes)
+{
+    auto classes = spead2::slab_pool::power_of_two_classes(1000, 5000, 4, 2);
+    std::vector<std::size_t> sizes;
+    for (const auto &c : classes)
+    {
+        sizes.push_back(c.size);
+        BOOST_CHECK_EQUAL(c.max_free, 4);
+        BOOST_CHECK_EQUAL(c.initial, 2);
+        BOOST_CHECK_EQUAL(c.low_water, 0);
+    }
+    BOOST_TEST(sizes == (std::vector<std::size_t>{1024, 2048, 4096, 8192}));
+
+    classes = spead2::slab_pool::power_of_two_classes(1024, 1024, 4, 2);
+    BOOST_REQUIRE_EQUAL(classes.size(), 1);
+    BOOST_CHECK_EQUAL(classes[0].size, 1024);
+    BOOST_CHECK_THROW(spead2::slab_pool::power_of_two_classes(2, 1, 4, 2), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(bad_classes)
+{
+    typedef std::vector<spead2::slab_pool::size_class> classes;
+    spead2::thread_pool tpool;
+    BOOST_CHECK_THROW(spead2::slab_pool(classes{{2048, 2, 1}, {1024, 2, 1}}), std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::slab_pool(classes{{1024, 2, 1}, {1024, 2, 1}}), std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::slab_pool(classes{{1024, 2, 3}}), std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::slab_pool(tpool, classes{{1024, 4, 2, 3}}), std::invalid_argument);
+    // low_water without a thread pool
+    BOOST_CHECK_THROW(spead2::slab_pool(classes{{1024, 4, 2, 1}}), std::invalid_argument);
+}
+
+// Repeatedly allocates to check that the background refill works per class
+BOOST_AUTO_TEST_CASE(refill)
+{
+    spead2::thread_pool tpool;
+    auto pool = std::make_shared<spead2::slab_pool>(
+        tpool, spead2::slab_pool::power_of_two_classes(1024, 65536, 8, 4, 2));
+    pool->set_warn_on_empty(false);
+    std::vector<spead2::memory_allocator::pointer> pointers;
+    for (int i = 0; i < 100; i++)
+    {
+        pointers.push_back(pool->allocate(1000, nullptr));
+        pointers.push_back(pool->allocate(60000, nullptr));
+    }
+    // Give the refiller time to refill completely
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // slab_pool
+BOOST_AUTO_TEST_SUITE_END()  // common
+
+}} // namespace spead2::unittest
@@ -0,0 +1,89 @@
+/* Copyright 2023 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Temporary file fixture shared by the unit tests.
+ */
+
+#ifndef SPEAD2_UNITTEST_TEMP_FILE_H
+#define SPEAD2_UNITTEST_TEMP_FILE_H
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <unistd.h>
+
+namespace spead2
+{
+namespace unittest
+{
+
+/**
+ * Temporary file that is removed on destruction. It is created in @c
+ * $TMPDIR, or in @c /tmp if that is not set.
+ */
+class temp_file
+{
+public:
+    std::string name;
+
+    temp_file()
+    {
+        const char *dir = std::getenv("TMPDIR");
+        if (!dir || !*dir)
+            dir = "/tmp";
+        std::string tmpl = std::string(dir) + "/spead2_unittest_XXXXXX";
+        std::vector<char> buffer(tmpl.begin(), tmpl.end());
+        buffer.push_back('\0');
+        int fd = mkstemp(buffer.data());
+        if (fd == -1)
+            throw std::system_error(errno, std::system_category(), "mkstemp failed");
+        close(fd);
+        name = buffer.data();
+    }
+
+    /// Create the file with the given initial contents
+    explicit temp_file(const std::string &contents) : temp_file()
+    {
+        std::ofstream out(name, std::ios::binary);
+        out << contents;
+    }
+
+    temp_file(const temp_file &) = delete;
+    temp_file &operator=(const temp_file &) = delete;
+
+    ~temp_file()
+    {
+        unlink(name.c_str());
+    }
+
+    /// Read back the whole file
+    std::string contents() const
+    {
+        std::ifstream in(name, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+};
+
+}} // namespace spead2::unittest
+
+#endif // SPEAD2_UNITTEST_TEMP_FILE_H
@@ -570,6 +570,32 @@ class TestPassthroughUdpIbv(BaseTestPassthroughSubstreams):
         assert_item_groups_equal(ig, recv_ig)
 
 
+class TestPassthroughUdpPacketMmap(BaseTestPassthroughSubstreams):
+    is_lossy = True
+
+    def setup(self):
+        if not hasattr(spead2.recv, 'UdpPacketMmapConfig'):
+            pytest.skip('AF_PACKET support not compiled in')
+        if os.geteuid() != 0:
+            pytest.skip('AF_PACKET sockets require CAP_NET_RAW')
+
+    def prepare_receivers(self, receivers):
+        for i, receiver in enumerate(receivers):
+            receiver.add_udp_packet_mmap_reader(
+                spead2.recv.UdpPacketMmapConfig(
+                    endpoints=[("127.0.0.1", 8878 + i)],
+                    interface_address="127.0.0.1",
+                    block_size=65536,
+                    num_blocks=16))
+
+    def prepare_senders(self, thread_pool, n):
+        return spead2.send.UdpStream(
+            thread_pool,
+            [("127.0.0.1", 8878 + i) for i in range(n)],
+            spead2.send.StreamConfig(rate=1e7),
+            buffer_size=0)
+
+
 class TestPassthroughTcp(BaseTestPassthrough):
     def prepare_receiver(self, receiver):
         receiver.add_tcp_reader(8887, bind_hostname="127.0.0.1")
@@ -662,3 +688,39 @@ class TestPassthroughInproc(BaseTestPassthroughSubstreams):
         assert stream.queues == [queue]
         with pytest.deprecated_call():
             assert stream.queue is queue
+
+
+class TestPassthroughShm(BaseTestPassthroughSubstreams):
+    def setup(self):
+        if not hasattr(spead2, 'ShmQueue'):
+            pytest.skip('Shared memory support not compiled in')
+
+    def prepare_receivers(self, receivers):
+        assert len(receivers) == len(self._queues)
+        for receiver, queue in zip(receivers, self._queues):
+            receiver.add_shm_reader(spead2.ShmQueue.from_fd(queue.fd))
+
+    def prepare_senders(self, thread_pool, n):
+        assert n == len(self._queues)
+        return spead2.send.ShmStream(thread_pool, self._queues)
+
+    def transmit_item_groups(self, item_groups, *,
+                             memcpy, allocator, new_order='=', group_mode=None):
+        # Small queues, so that the sender has to wait for the receiver
+        self._queues = [spead2.ShmQueue(num_slots=64) for ig in item_groups]
+        ret = super().transmit_item_groups(
+            item_groups, memcpy=memcpy, allocator=allocator,
+            new_order=new_order, group_mode=group_mode)
+        for queue in self._queues:
+            queue.stop()
+        return ret
+
+    def test_queues(self):
+        queues = [spead2.ShmQueue() for i in range(2)]
+        stream = spead2.send.ShmStream(spead2.ThreadPool(), queues)
+        assert stream.queues == queues
+
+    def test_slot_too_small(self):
+        queue = spead2.ShmQueue(slot_size=1000)
+        with pytest.raises(ValueError):
+            spead2.send.ShmStream(spead2.ThreadPool(), [queue])
@@ -744,7 +744,8 @@ class TestStreamConfig:
         recv.StreamStatConfig('max_batch', recv.StreamStatConfig.Mode.MAXIMUM),
         recv.StreamStatConfig('single_packet_heaps'),
         recv.StreamStatConfig('search_dist'),
-        recv.StreamStatConfig('worker_blocked')
+        recv.StreamStatConfig('worker_blocked'),
+        recv.StreamStatConfig('reassembly_time_ns')
     ]
 
     def test_default_construct(self):
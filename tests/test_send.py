@@ -17,6 +17,7 @@ import binascii
 import gc
 import math
 import platform
+import socket
 import struct
 import time
 import threading
@@ -772,6 +773,25 @@ class TestTcpStream:
             send.TcpStream(spead2.ThreadPool(), [('127.0.0.1', 8887)])
 
 
+class TestUdpParallelStream:
+    def test_send(self):
+        with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+            sock.bind(('127.0.0.1', 0))
+            sock.settimeout(5)
+            stream = send.UdpParallelStream(
+                spead2.ThreadPool(), [sock.getsockname()], threads=2)
+            ig = send.ItemGroup()
+            stream.send_heap(ig.get_end())
+            data = sock.recv(65536)
+            assert data[:2] == b'\x53\x04'
+
+    def test_rate(self):
+        with pytest.raises(ValueError):
+            send.UdpParallelStream(
+                spead2.ThreadPool(), [('127.0.0.1', 8888)],
+                send.StreamConfig(rate=1e9), threads=2)
+
+
 class TestInprocStream:
     def setup(self):
         self.flavour = Flavour(4, 64, 48, 0)